@@ -0,0 +1,12 @@
+win32: CONFIG += console
+mac:CONFIG -= app_bundle
+
+CONFIG += qtestlib
+
+HEADERS += corpus.h
+
+include(../build.pri)
+DESTDIR = $$BUILDDIR/benchmarks
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
@@ -0,0 +1,7 @@
+# The benchmarks are QTestLib applications, run them with e.g. "-xml -o result.xml"
+# to get machine-readable results, or "-tickcounter" for CPU tick counts.
+
+TEMPLATE = subdirs
+SUBDIRS = opensearchengine opensearchreader opensearchwriter
+
+CONFIG += ordered
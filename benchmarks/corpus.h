@@ -0,0 +1,108 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+#include "opensearchengine.h"
+
+// Synthetic, but realistic data shared by the benchmarks.
+
+inline OpenSearchEngine::Parameters corpusParameters(int count)
+{
+    OpenSearchEngine::Parameters parameters;
+    for (int i = 0; i < count; ++i) {
+        QString value = (i % 4 == 0) ? QString::fromLatin1("{searchTerms}")
+                      : (i % 4 == 1) ? QString::fromLatin1("{language}")
+                      : QString::fromLatin1("value %1").arg(i);
+        parameters.append(OpenSearchEngine::Parameter(QString::fromLatin1("param%1").arg(i), value));
+    }
+    return parameters;
+}
+
+inline OpenSearchEngine *corpusEngine(int index)
+{
+    OpenSearchEngine *engine = new OpenSearchEngine();
+    engine->setName(QString::fromLatin1("Engine %1").arg(index));
+    engine->setDescription(QString::fromLatin1("Full text search in the engine number %1").arg(index));
+    engine->setSearchUrlTemplate(QString::fromLatin1("http://www.example%1.com/search?q={searchTerms}&lang={language}&start={startIndex?}").arg(index));
+    engine->setSearchParameters(corpusParameters(index % 8));
+    engine->setSuggestionsUrlTemplate(QString::fromLatin1("http://suggest.example%1.com/?q={searchTerms}").arg(index));
+    engine->setImageUrl(QString::fromLatin1("http://www.example%1.com/favicon.ico").arg(index));
+    engine->setTags(QStringList() << QString::fromLatin1("example") << QString::fromLatin1("tag%1").arg(index));
+    return engine;
+}
+
+inline QByteArray corpusDescription(int index)
+{
+    QByteArray parameters;
+    for (int i = 0; i < index % 8; ++i)
+        parameters += "        <Param name=\"param" + QByteArray::number(i) + "\" value=\"{searchTerms}\"/>\n";
+
+    QByteArray number = QByteArray::number(index);
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<OpenSearchDescription xmlns=\"http://a9.com/-/spec/opensearch/1.1/\">\n"
+           "    <ShortName>Engine " + number + "</ShortName>\n"
+           "    <Description>Full text search in the engine number " + number + "</Description>\n"
+           "    <Url type=\"application/rss+xml\" template=\"http://www.example" + number + ".com/rss?q={searchTerms}\"/>\n"
+           "    <Url method=\"get\" type=\"text/html\" template=\"http://www.example" + number + ".com/search\">\n"
+           + parameters +
+           "    </Url>\n"
+           "    <Url type=\"application/x-suggestions+json\" template=\"http://suggest.example" + number + ".com/?q={searchTerms}\"/>\n"
+           "    <Image width=\"16\" height=\"16\">http://www.example" + number + ".com/favicon.ico</Image>\n"
+           "    <Tags>example tag" + number + "</Tags>\n"
+           "    <moz:SearchForm xmlns:moz=\"http://www.mozilla.org/2006/browser/search/\">http://www.example" + number + ".com/</moz:SearchForm>\n"
+           "</OpenSearchDescription>\n";
+}
+
+// An Atom feed embedding the descriptions, as served by a catalog.
+inline QByteArray corpusCatalog(int count)
+{
+    QByteArray data = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<feed xmlns=\"http://www.w3.org/2005/Atom\">\n"
+                      "<title>Catalog</title>\n";
+    for (int i = 0; i < count; ++i) {
+        QByteArray description = corpusDescription(i);
+        data += "<entry>\n<title>Engine " + QByteArray::number(i) + "</title>\n"
+                "<content type=\"application/opensearchdescription+xml\">\n"
+                + description.mid(description.indexOf('\n') + 1) +
+                "</content>\n</entry>\n";
+    }
+    data += "</feed>\n";
+    return data;
+}
+
+inline QByteArray corpusSuggestions(int count)
+{
+    QByteArray data = "[\"foo\",[";
+    for (int i = 0; i < count; ++i) {
+        if (i)
+            data += ',';
+        data += "\"foo suggestion \\u0105 " + QByteArray::number(i) + "\"";
+    }
+    data += "],[],[]]";
+    return data;
+}
+
+#endif // CORPUS_H
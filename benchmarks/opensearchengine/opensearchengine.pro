@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = tst_bench_opensearchengine
+
+QT += network
+
+include(../benchmarks.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_bench_opensearchengine.cpp
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "corpus.h"
+#include "opensearchengine.h"
+#include "opensearchsuggestionsparser.h"
+
+#include <qnetworkaccessmanager.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+
+class tst_Bench_OpenSearchEngine : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void parseTemplate_data();
+    void parseTemplate();
+    void searchUrl_data();
+    void searchUrl();
+    void encodedSearchUrls_data();
+    void encodedSearchUrls();
+    void suggestionsParser_data();
+    void suggestionsParser();
+    void requestSuggestions_data();
+    void requestSuggestions();
+};
+
+class SubOpenSearchEngine : public OpenSearchEngine
+{
+public:
+    static QString call_parseTemplate(const QString &searchTerm, const QString &searchTemplate)
+        { return OpenSearchEngine::parseTemplate(searchTerm, searchTemplate); }
+};
+
+class SuggestionsBenchNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    SuggestionsBenchNetworkReply(const QNetworkRequest &request, const QByteArray &data, QObject *parent = 0)
+        : QNetworkReply(parent)
+        , data(data)
+        , position(0)
+    {
+        setOperation(QNetworkAccessManager::GetOperation);
+        setRequest(request);
+        setUrl(request.url());
+        setOpenMode(QIODevice::ReadOnly);
+        setError(QNetworkReply::NoError, tr("No Error"));
+
+        QMetaObject::invokeMethod(this, "sendSuggestions", Qt::QueuedConnection);
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return data.size() - position + QNetworkReply::bytesAvailable();
+    }
+
+    qint64 readData(char *buffer, qint64 maxSize)
+    {
+        qint64 size = qMin(maxSize, qint64(data.size() - position));
+        memcpy(buffer, data.constData() + position, size);
+        position += size;
+        return size;
+    }
+
+    void abort()
+    {
+    }
+
+private slots:
+    void sendSuggestions()
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+
+        emit metaDataChanged();
+        emit readyRead();
+        emit finished();
+    }
+
+private:
+    QByteArray data;
+    qint64 position;
+};
+
+class SuggestionsBenchNetworkAccessManager : public QNetworkAccessManager
+{
+public:
+    SuggestionsBenchNetworkAccessManager(QObject *parent = 0)
+        : QNetworkAccessManager(parent)
+    {
+    }
+
+    QByteArray data;
+
+protected:
+    QNetworkReply *createRequest(QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice * = 0)
+    {
+        return new SuggestionsBenchNetworkReply(request, data, 0);
+    }
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_Bench_OpenSearchEngine::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_Bench_OpenSearchEngine::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_Bench_OpenSearchEngine::init()
+{
+}
+
+// This will be called after every test function.
+void tst_Bench_OpenSearchEngine::cleanup()
+{
+}
+
+void tst_Bench_OpenSearchEngine::parseTemplate_data()
+{
+    QTest::addColumn<QString>("searchTemplate");
+    QTest::newRow("plain") << QString("http://foobar.baz/search");
+    QTest::newRow("simple") << QString("http://foobar.baz/search?q={searchTerms}");
+    QTest::newRow("all") << QString("http://foobar.baz/?q={searchTerms}&c={count}&i={startIndex}&p={startPage}"
+                                    "&l={language}&ie={inputEncoding}&oe={outputEncoding}&s={source?}");
+}
+
+void tst_Bench_OpenSearchEngine::parseTemplate()
+{
+    QFETCH(QString, searchTemplate);
+
+    QString searchTerm = QString::fromUtf8("foo bar ąę");
+    QBENCHMARK {
+        SubOpenSearchEngine::call_parseTemplate(searchTerm, searchTemplate);
+    }
+}
+
+void tst_Bench_OpenSearchEngine::searchUrl_data()
+{
+    QTest::addColumn<int>("parameterCount");
+    QTest::newRow("0") << 0;
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+}
+
+void tst_Bench_OpenSearchEngine::searchUrl()
+{
+    QFETCH(int, parameterCount);
+
+    OpenSearchEngine engine;
+    engine.setSearchUrlTemplate("http://foobar.baz/search?q={searchTerms}&l={language}");
+    engine.setSearchParameters(corpusParameters(parameterCount));
+
+    QString searchTerm = QString::fromUtf8("foo bar ąę");
+    QBENCHMARK {
+        engine.searchUrl(searchTerm);
+    }
+}
+
+void tst_Bench_OpenSearchEngine::encodedSearchUrls_data()
+{
+    QTest::addColumn<int>("engineCount");
+    QTest::addColumn<int>("termCount");
+    QTest::newRow("1x10000") << 1 << 10000;
+    QTest::newRow("32x1000") << 32 << 1000;
+}
+
+void tst_Bench_OpenSearchEngine::encodedSearchUrls()
+{
+    QFETCH(int, engineCount);
+    QFETCH(int, termCount);
+
+    QList<OpenSearchDescription> descriptions;
+    for (int i = 0; i < engineCount; ++i) {
+        OpenSearchEngine *engine = corpusEngine(i);
+        descriptions.append(engine->openSearchDescription());
+        delete engine;
+    }
+
+    QStringList searchTerms;
+    for (int i = 0; i < termCount; ++i)
+        searchTerms.append(QString::fromUtf8("foo bar ąę %1").arg(i));
+
+    QBENCHMARK {
+        OpenSearchDescription::encodedSearchUrls(descriptions, searchTerms);
+    }
+}
+
+void tst_Bench_OpenSearchEngine::suggestionsParser_data()
+{
+    QTest::addColumn<int>("suggestionCount");
+    QTest::newRow("10") << 10;
+    QTest::newRow("1000") << 1000;
+}
+
+void tst_Bench_OpenSearchEngine::suggestionsParser()
+{
+    QFETCH(int, suggestionCount);
+
+    QByteArray data = corpusSuggestions(suggestionCount);
+    QBENCHMARK {
+        bool ok;
+        OpenSearchSuggestionsParser::parse(data, &ok);
+    }
+}
+
+void tst_Bench_OpenSearchEngine::requestSuggestions_data()
+{
+    suggestionsParser_data();
+}
+
+void tst_Bench_OpenSearchEngine::requestSuggestions()
+{
+    QFETCH(int, suggestionCount);
+
+    SuggestionsBenchNetworkAccessManager manager;
+    manager.data = corpusSuggestions(suggestionCount);
+
+    OpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/suggest?q={searchTerms}");
+    connect(&engine, SIGNAL(suggestions(QStringList)), &QTestEventLoop::instance(), SLOT(exitLoop()));
+
+    QBENCHMARK {
+        engine.requestSuggestions("foo");
+        QTestEventLoop::instance().enterLoop(5);
+        QVERIFY(!QTestEventLoop::instance().timeout());
+    }
+}
+
+QTEST_MAIN(tst_Bench_OpenSearchEngine)
+
+#include "tst_bench_opensearchengine.moc"
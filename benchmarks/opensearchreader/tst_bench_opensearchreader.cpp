@@ -0,0 +1,126 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+
+#include "corpus.h"
+#include "opensearchengine.h"
+#include "opensearchreader.h"
+
+class tst_Bench_OpenSearchReader : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void read_data();
+    void read();
+    void readNextDescription_data();
+    void readNextDescription();
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_Bench_OpenSearchReader::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_Bench_OpenSearchReader::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_Bench_OpenSearchReader::init()
+{
+}
+
+// This will be called after every test function.
+void tst_Bench_OpenSearchReader::cleanup()
+{
+}
+
+void tst_Bench_OpenSearchReader::read_data()
+{
+    QTest::addColumn<int>("documentCount");
+    QTest::newRow("1") << 1;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+void tst_Bench_OpenSearchReader::read()
+{
+    QFETCH(int, documentCount);
+
+    QList<QByteArray> documents;
+    for (int i = 0; i < documentCount; ++i)
+        documents.append(corpusDescription(i));
+
+    OpenSearchReader reader;
+    QBENCHMARK {
+        foreach (const QByteArray &document, documents) {
+            QBuffer buffer;
+            buffer.setData(document);
+            delete reader.read(&buffer);
+        }
+    }
+
+    QVERIFY(!reader.hasError());
+}
+
+void tst_Bench_OpenSearchReader::readNextDescription_data()
+{
+    read_data();
+}
+
+void tst_Bench_OpenSearchReader::readNextDescription()
+{
+    QFETCH(int, documentCount);
+
+    QByteArray catalog = corpusCatalog(documentCount);
+    int count = 0;
+
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.setData(catalog);
+
+        OpenSearchReader reader;
+        reader.setDevice(&buffer);
+
+        count = 0;
+        OpenSearchDescription description;
+        while (reader.readNextDescription(&description))
+            ++count;
+
+        QVERIFY(!reader.hasError());
+    }
+
+    QCOMPARE(count, documentCount);
+}
+
+QTEST_MAIN(tst_Bench_OpenSearchReader)
+
+#include "tst_bench_opensearchreader.moc"
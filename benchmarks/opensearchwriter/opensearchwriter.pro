@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = tst_bench_opensearchwriter
+
+include(../benchmarks.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_bench_opensearchwriter.cpp
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+
+#include "corpus.h"
+#include "opensearchengine.h"
+#include "opensearchwriter.h"
+
+class tst_Bench_OpenSearchWriter : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void write_data();
+    void write();
+    void writeBundle_data();
+    void writeBundle();
+    void writeDirectory_data();
+    void writeDirectory();
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_Bench_OpenSearchWriter::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_Bench_OpenSearchWriter::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_Bench_OpenSearchWriter::init()
+{
+}
+
+// This will be called after every test function.
+void tst_Bench_OpenSearchWriter::cleanup()
+{
+}
+
+void tst_Bench_OpenSearchWriter::write_data()
+{
+    QTest::addColumn<int>("engineCount");
+    QTest::addColumn<bool>("compact");
+    QTest::newRow("1") << 1 << false;
+    QTest::newRow("100") << 100 << false;
+    QTest::newRow("1000") << 1000 << false;
+    QTest::newRow("1000-compact") << 1000 << true;
+}
+
+void tst_Bench_OpenSearchWriter::write()
+{
+    QFETCH(int, engineCount);
+    QFETCH(bool, compact);
+
+    QList<OpenSearchEngine*> engines;
+    for (int i = 0; i < engineCount; ++i)
+        engines.append(corpusEngine(i));
+
+    OpenSearchWriter writer;
+    writer.setCompact(compact);
+    QBENCHMARK {
+        foreach (OpenSearchEngine *engine, engines) {
+            QBuffer buffer;
+            writer.write(&buffer, engine);
+        }
+    }
+
+    qDeleteAll(engines);
+}
+
+void tst_Bench_OpenSearchWriter::writeBundle_data()
+{
+    write_data();
+}
+
+void tst_Bench_OpenSearchWriter::writeBundle()
+{
+    QFETCH(int, engineCount);
+    QFETCH(bool, compact);
+
+    QList<OpenSearchDescription> descriptions;
+    for (int i = 0; i < engineCount; ++i) {
+        OpenSearchEngine *engine = corpusEngine(i);
+        descriptions.append(engine->openSearchDescription());
+        delete engine;
+    }
+
+    OpenSearchWriter writer;
+    writer.setCompact(compact);
+    QBENCHMARK {
+        QBuffer buffer;
+        writer.writeBundle(&buffer, descriptions);
+    }
+}
+
+void tst_Bench_OpenSearchWriter::writeDirectory_data()
+{
+    write_data();
+}
+
+void tst_Bench_OpenSearchWriter::writeDirectory()
+{
+    QFETCH(int, engineCount);
+    QFETCH(bool, compact);
+
+    QList<OpenSearchDescription> descriptions;
+    for (int i = 0; i < engineCount; ++i) {
+        OpenSearchEngine *engine = corpusEngine(i);
+        descriptions.append(engine->openSearchDescription());
+        delete engine;
+    }
+
+    QDir temp = QDir::temp();
+    QString path = temp.filePath(QString("tst_bench_opensearchwriter-%1").arg(QCoreApplication::applicationPid()));
+
+    OpenSearchWriter writer;
+    writer.setCompact(compact);
+    QBENCHMARK {
+        writer.writeDirectory(path, descriptions);
+    }
+
+    QDir directory(path);
+    foreach (const QString &file, directory.entryList(QDir::Files))
+        directory.remove(file);
+    temp.rmdir(path);
+}
+
+QTEST_MAIN(tst_Bench_OpenSearchWriter)
+
+#include "tst_bench_opensearchwriter.moc"
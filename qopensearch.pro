@@ -1,4 +1,4 @@
 TEMPLATE = subdirs
-SUBDIRS = src/opensearch.pro tests examples
+SUBDIRS = src/opensearch.pro tests benchmarks examples
 
 CONFIG += ordered
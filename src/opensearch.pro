@@ -8,16 +8,48 @@ DESTDIR = $$BUILDDIR
 INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
-QT += network script
+QT += network
 
 HEADERS += \
+    opensearchbatchreader.h \
+    opensearchcatalog.h \
+    opensearchdescription.h \
     opensearchengine.h \
     opensearchenginedelegate.h \
+    opensearchenginemanager.h \
+    opensearchengineobserver.h \
+    opensearchimagecache.h \
     opensearchreader.h \
+    opensearchrequestpolicy.h \
+    opensearchrequestscheduler.h \
+    opensearchresultsparser.h \
+    opensearchsnapshot.h \
+    opensearchstringpool.h \
+    opensearchsuggestionscache.h \
+    opensearchsuggestionsindex.h \
+    opensearchsuggestionsparser.h \
+    opensearchtemplatecontext.h \
+    opensearchurltemplate.h \
     opensearchwriter.h
 
 SOURCES += \
+    opensearchbatchreader.cpp \
+    opensearchcatalog.cpp \
+    opensearchdescription.cpp \
     opensearchengine.cpp \
     opensearchenginedelegate.cpp \
+    opensearchenginemanager.cpp \
+    opensearchengineobserver.cpp \
+    opensearchimagecache.cpp \
     opensearchreader.cpp \
+    opensearchrequestpolicy.cpp \
+    opensearchrequestscheduler.cpp \
+    opensearchresultsparser.cpp \
+    opensearchsnapshot.cpp \
+    opensearchstringpool.cpp \
+    opensearchsuggestionscache.cpp \
+    opensearchsuggestionsindex.cpp \
+    opensearchsuggestionsparser.cpp \
+    opensearchtemplatecontext.cpp \
+    opensearchurltemplate.cpp \
     opensearchwriter.cpp
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchbatchreader.h"
+
+#include "opensearchengine.h"
+#include "opensearchimagecache.h"
+#include "opensearchreader.h"
+
+#include <qdir.h>
+#include <qfile.h>
+#include <qthread.h>
+#include <qtconcurrentmap.h>
+
+namespace {
+
+struct ReadJob
+{
+    typedef OpenSearchBatchReader::Result result_type;
+
+    ReadJob(QThread *targetThread)
+        : targetThread(targetThread)
+    {}
+
+    result_type operator()(const OpenSearchBatchReader::Result &job) const
+    {
+        result_type result = job;
+
+        QFile file;
+        QIODevice *device = job.device;
+        if (!device) {
+            file.setFileName(job.fileName);
+            if (!file.open(QIODevice::ReadOnly)) {
+                result.errorString = file.errorString();
+                return result;
+            }
+            device = &file;
+        }
+
+        OpenSearchReader reader;
+        OpenSearchEngine *engine = reader.read(device);
+
+        if (reader.hasError()) {
+            result.errorString = reader.errorString();
+            delete engine;
+            return result;
+        }
+
+        // The engine has been created in a worker thread, only it can hand the engine over.
+        engine->moveToThread(targetThread);
+        result.engine = engine;
+        return result;
+    }
+
+    QThread *targetThread;
+};
+
+}
+
+/*!
+    \class OpenSearchBatchReader
+    \brief A class reading many search engine descriptions in parallel
+
+    OpenSearchBatchReader reads whole directories, lists of files or sets of devices
+    holding OpenSearch descriptions, distributing the documents among the threads of
+    the global QThreadPool, each of them parsed with an OpenSearchReader.
+
+    The functions block until all the documents have been read and return one Result
+    per document, in the order of the input, holding either the engine or a description
+    of the error. The engines are moved to targetThread(), the calling thread by default,
+    and their lifetime is up to the user.
+
+    \sa OpenSearchReader
+*/
+
+/*!
+    \class OpenSearchBatchReader::Result
+    \brief The outcome of reading a single document
+
+    Holds the file name or the device the document has been read from, and either the
+    engine that has been read, or the error string if the document could not be opened
+    or is not a well formed OpenSearch description, see hasError().
+*/
+
+/*!
+    Constructs a new batch reader.
+*/
+OpenSearchBatchReader::OpenSearchBatchReader()
+    : m_targetThread(0)
+{
+}
+
+/*!
+    Destroys the batch reader.
+*/
+OpenSearchBatchReader::~OpenSearchBatchReader()
+{
+}
+
+/*!
+    Returns the thread the engines that have been read are moved to, or 0, which means
+    the thread calling one of the read functions.
+*/
+QThread *OpenSearchBatchReader::targetThread() const
+{
+    return m_targetThread;
+}
+
+/*!
+    Sets the thread the engines are moved to to \a thread.
+*/
+void OpenSearchBatchReader::setTargetThread(QThread *thread)
+{
+    m_targetThread = thread;
+}
+
+/*!
+    Reads all the files in the directory at \a path that match \a nameFilters,
+    sorted by name.
+
+    \sa readFiles()
+*/
+OpenSearchBatchReader::Results OpenSearchBatchReader::readDirectory(const QString &path,
+                                                                    const QStringList &nameFilters)
+{
+    QDir directory(path);
+    QStringList fileNames;
+
+    QStringList entries = directory.entryList(nameFilters, QDir::Files | QDir::Readable, QDir::Name);
+    foreach (const QString &entry, entries)
+        fileNames.append(directory.absoluteFilePath(entry));
+
+    return readFiles(fileNames);
+}
+
+/*!
+    Reads the files with the given \a fileNames.
+*/
+OpenSearchBatchReader::Results OpenSearchBatchReader::readFiles(const QStringList &fileNames)
+{
+    Results jobs;
+
+    foreach (const QString &fileName, fileNames) {
+        Result job;
+        job.fileName = fileName;
+        jobs.append(job);
+    }
+
+    return read(jobs);
+}
+
+/*!
+    Reads the given \a devices, opening the closed ones.
+
+    \note The devices are read from worker threads, so they must not be used anywhere
+          else until the function returns and they must not depend on an event loop,
+          as sockets do. Files and buffers are fine.
+*/
+OpenSearchBatchReader::Results OpenSearchBatchReader::readDevices(const QList<QIODevice*> &devices)
+{
+    Results jobs;
+
+    foreach (QIODevice *device, devices) {
+        Result job;
+        job.device = device;
+        jobs.append(job);
+    }
+
+    return read(jobs);
+}
+
+OpenSearchBatchReader::Results OpenSearchBatchReader::read(const Results &jobs)
+{
+    // Engines refer to the shared image cache, make sure it is not created in a worker thread.
+    OpenSearchImageCache::instance();
+
+    QThread *thread = m_targetThread ? m_targetThread : QThread::currentThread();
+    return QtConcurrent::blockingMapped<Results>(jobs, ReadJob(thread));
+}
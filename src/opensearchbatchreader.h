@@ -0,0 +1,65 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHBATCHREADER_H
+#define OPENSEARCHBATCHREADER_H
+
+#include <qlist.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+class QIODevice;
+class QThread;
+
+class OpenSearchEngine;
+
+class OpenSearchBatchReader
+{
+public:
+    struct Result
+    {
+        Result() : device(0), engine(0) {}
+
+        bool hasError() const { return !errorString.isEmpty(); }
+
+        QString fileName;
+        QIODevice *device;
+        OpenSearchEngine *engine;
+        QString errorString;
+    };
+    typedef QList<Result> Results;
+
+    OpenSearchBatchReader();
+    ~OpenSearchBatchReader();
+
+    QThread *targetThread() const;
+    void setTargetThread(QThread *thread);
+
+    Results readDirectory(const QString &path,
+                          const QStringList &nameFilters = QStringList(QLatin1String("*.xml")));
+    Results readFiles(const QStringList &fileNames);
+    Results readDevices(const QList<QIODevice*> &devices);
+
+private:
+    Results read(const Results &jobs);
+
+    QThread *m_targetThread;
+};
+
+#endif // OPENSEARCHBATCHREADER_H
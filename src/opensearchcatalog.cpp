@@ -0,0 +1,388 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchcatalog.h"
+
+#include "opensearchdescription.h"
+#include "opensearchengine.h"
+#include "opensearchreader.h"
+
+#include <qbuffer.h>
+#include <qcryptographichash.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qfilesystemwatcher.h>
+#include <qtconcurrentmap.h>
+#include <qtimer.h>
+
+namespace {
+
+struct ScanJob
+{
+    ScanJob() : size(-1), readable(false), modified(false), ok(false) {}
+
+    QString fileName;
+    qint64 size;
+    QDateTime lastModified;
+    QByteArray previousChecksum;
+
+    bool readable;
+    bool modified;
+    bool ok;
+    QByteArray checksum;
+    OpenSearchDescription description;
+    QString errorString;
+};
+
+// Reads the file, and parses it only if its contents have changed.
+ScanJob scanFile(const ScanJob &job)
+{
+    ScanJob result = job;
+
+    QFile file(job.fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    QByteArray data = file.readAll();
+    result.readable = true;
+    result.checksum = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    result.modified = (result.checksum != job.previousChecksum);
+    if (!result.modified)
+        return result;
+
+    QBuffer buffer(&data);
+    OpenSearchReader reader;
+    result.ok = reader.read(&buffer, &result.description);
+    if (!result.ok)
+        result.errorString = reader.errorString();
+
+    return result;
+}
+
+}
+
+/*!
+    \class OpenSearchCatalog
+    \brief A directory of search engine descriptions, kept up to date
+
+    OpenSearchCatalog holds one engine per description file in a directory, see path(),
+    and watches the directory for changes. When files are added, modified or removed,
+    the catalog is reloaded after reloadDelay(), and only what has changed is reported.
+    engineAdded() is emitted for the engines of new files and engineRemoved() for the
+    ones of removed files. The engines of files whose description has changed are
+    updated in place with OpenSearchEngine::setOpenSearchDescription(), so that they keep
+    their image and connections, and engineChanged() is emitted for them.
+
+    Files whose size and modification time have not changed are not read again, unless
+    the watcher has reported them as modified. Files that are read again are parsed only
+    if their checksum differs, and their engine is left alone if the description is equal
+    to the current one. Files that cannot be parsed, possibly because they are being
+    written, are reported with fileError() and leave their engine as it was.
+
+    The engines are owned by the catalog. Removed engines are deleted later, once control
+    returns to the event loop. The files are parsed in parallel by the threads of the
+    global QThreadPool.
+
+    \sa OpenSearchBatchReader, OpenSearchEngineManager
+*/
+
+/*!
+    \fn void OpenSearchCatalog::engineAdded(OpenSearchEngine *engine)
+
+    This signal is emitted when the \a engine has been read from a new file.
+*/
+
+/*!
+    \fn void OpenSearchCatalog::engineChanged(OpenSearchEngine *engine)
+
+    This signal is emitted when the description of the \a engine has been updated
+    from its modified file.
+*/
+
+/*!
+    \fn void OpenSearchCatalog::engineRemoved(OpenSearchEngine *engine)
+
+    This signal is emitted when the file of the \a engine has been removed. The engine
+    is deleted later.
+*/
+
+/*!
+    \fn void OpenSearchCatalog::fileError(const QString &fileName, const QString &errorString)
+
+    This signal is emitted when the file with the given \a fileName cannot be read
+    or is not a well formed description, as described by \a errorString.
+*/
+
+/*!
+    Constructs an empty catalog with a given \a parent.
+*/
+OpenSearchCatalog::OpenSearchCatalog(QObject *parent)
+    : QObject(parent)
+    , m_nameFilters(QLatin1String("*.xml"))
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_reloadDelay(100)
+    , m_reloadTimer(new QTimer(this))
+{
+    m_reloadTimer->setSingleShot(true);
+    connect(m_reloadTimer, SIGNAL(timeout()), this, SLOT(reload()));
+
+    connect(m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged()));
+    connect(m_watcher, SIGNAL(fileChanged(QString)), this, SLOT(fileChanged(QString)));
+}
+
+/*!
+    Destroys the catalog and its engines.
+*/
+OpenSearchCatalog::~OpenSearchCatalog()
+{
+}
+
+/*!
+    \property path
+    \brief the directory holding the description files
+
+    Setting a new path reloads the catalog right away: the engines of the previous
+    directory are removed and the ones of the new directory are added.
+*/
+QString OpenSearchCatalog::path() const
+{
+    return m_path;
+}
+
+void OpenSearchCatalog::setPath(const QString &path)
+{
+    QString absolutePath = path.isEmpty() ? QString() : QDir(path).absolutePath();
+    if (absolutePath == m_path)
+        return;
+
+    if (!m_watcher->directories().isEmpty())
+        m_watcher->removePaths(m_watcher->directories());
+
+    m_path = absolutePath;
+    reload();
+}
+
+/*!
+    \property nameFilters
+    \brief the patterns the names of the description files match
+
+    The default is "*.xml". Setting new filters reloads the catalog right away.
+*/
+QStringList OpenSearchCatalog::nameFilters() const
+{
+    return m_nameFilters;
+}
+
+void OpenSearchCatalog::setNameFilters(const QStringList &nameFilters)
+{
+    if (nameFilters == m_nameFilters)
+        return;
+
+    m_nameFilters = nameFilters;
+    reload();
+}
+
+/*!
+    \property reloadDelay
+    \brief the time, in milliseconds, between a change of the directory and the reload
+
+    Changes reported until then are handled by the same reload, which lets the files
+    that are being written settle. The default is 100 milliseconds.
+*/
+int OpenSearchCatalog::reloadDelay() const
+{
+    return m_reloadDelay;
+}
+
+void OpenSearchCatalog::setReloadDelay(int msecs)
+{
+    m_reloadDelay = qMax(0, msecs);
+}
+
+/*!
+    Returns the engines of the catalog, in the order of their file names.
+*/
+QList<OpenSearchEngine*> OpenSearchCatalog::engines() const
+{
+    QList<OpenSearchEngine*> engines;
+
+    foreach (const Entry &entry, m_entries) {
+        if (entry.engine)
+            engines.append(entry.engine);
+    }
+
+    return engines;
+}
+
+/*!
+    Returns the engine read from the file with a given \a fileName, either absolute or
+    relative to path(), or 0 if there is none.
+*/
+OpenSearchEngine *OpenSearchCatalog::engine(const QString &fileName) const
+{
+    if (m_path.isEmpty())
+        return 0;
+
+    return m_entries.value(QDir(m_path).absoluteFilePath(fileName)).engine;
+}
+
+/*!
+    Returns the absolute name of the file the \a engine has been read from, or an empty
+    string if the engine does not belong to the catalog.
+*/
+QString OpenSearchCatalog::fileName(OpenSearchEngine *engine) const
+{
+    QMap<QString, Entry>::const_iterator end = m_entries.constEnd();
+    for (QMap<QString, Entry>::const_iterator i = m_entries.constBegin(); i != end; ++i) {
+        if (engine && i->engine == engine)
+            return i.key();
+    }
+
+    return QString();
+}
+
+/*!
+    Checks the directory for changes right away, instead of waiting for the watcher.
+*/
+void OpenSearchCatalog::reload()
+{
+    m_reloadTimer->stop();
+
+    QStringList fileNames;
+    if (!m_path.isEmpty()) {
+        QDir directory(m_path);
+        if (m_watcher->directories().isEmpty() && directory.exists())
+            m_watcher->addPath(m_path);
+
+        QStringList entries = directory.entryList(m_nameFilters, QDir::Files | QDir::Readable, QDir::Name);
+        foreach (const QString &entry, entries)
+            fileNames.append(directory.absoluteFilePath(entry));
+    }
+
+    QSet<QString> changedFiles = m_changedFiles;
+    m_changedFiles.clear();
+
+    // The files that are gone are removed first, then the others are checked in order.
+    QSet<QString> currentFiles = fileNames.toSet();
+    foreach (const QString &fileName, m_entries.keys()) {
+        if (!currentFiles.contains(fileName))
+            removeEntry(fileName);
+    }
+
+    QList<ScanJob> jobs;
+    foreach (const QString &fileName, fileNames) {
+        QFileInfo info(fileName);
+        QMap<QString, Entry>::const_iterator i = m_entries.constFind(fileName);
+
+        // Modification times are coarse, only the watcher can tell about quick rewrites.
+        if (i != m_entries.constEnd() && !changedFiles.contains(fileName)
+            && i->size == info.size() && i->lastModified == info.lastModified())
+            continue;
+
+        ScanJob job;
+        job.fileName = fileName;
+        job.size = info.size();
+        job.lastModified = info.lastModified();
+        if (i != m_entries.constEnd())
+            job.previousChecksum = i->checksum;
+        jobs.append(job);
+    }
+
+    QList<ScanJob> results = QtConcurrent::blockingMapped<QList<ScanJob> >(jobs, scanFile);
+
+    foreach (const ScanJob &result, results) {
+        if (!result.readable) {
+            emit fileError(result.fileName, result.errorString);
+            continue;
+        }
+
+        Entry &entry = m_entries[result.fileName];
+        entry.size = result.size;
+        entry.lastModified = result.lastModified;
+        entry.checksum = result.checksum;
+
+        if (!result.modified)
+            continue;
+
+        if (!result.ok) {
+            emit fileError(result.fileName, result.errorString);
+            continue;
+        }
+
+        if (!entry.engine) {
+            entry.engine = new OpenSearchEngine(result.description, this);
+            emit engineAdded(entry.engine);
+            continue;
+        }
+
+        // The description is always applied, the comparison leaves out the tags. The
+        // engine keeps its image as long as the image URL is the same.
+        OpenSearchDescription previous = entry.engine->openSearchDescription();
+        entry.engine->setOpenSearchDescription(result.description);
+
+        if (previous != result.description || previous.tags() != result.description.tags())
+            emit engineChanged(entry.engine);
+    }
+
+    // Files replaced by renaming are not watched anymore.
+    QStringList watchedFiles = m_watcher->files();
+    QStringList unwatchedFiles;
+    foreach (const QString &fileName, fileNames) {
+        if (!watchedFiles.contains(fileName))
+            unwatchedFiles.append(fileName);
+    }
+
+    if (!unwatchedFiles.isEmpty())
+        m_watcher->addPaths(unwatchedFiles);
+}
+
+void OpenSearchCatalog::directoryChanged()
+{
+    scheduleReload();
+}
+
+void OpenSearchCatalog::fileChanged(const QString &fileName)
+{
+    m_changedFiles.insert(fileName);
+    scheduleReload();
+}
+
+void OpenSearchCatalog::removeEntry(const QString &fileName)
+{
+    Entry entry = m_entries.take(fileName);
+
+    if (m_watcher->files().contains(fileName))
+        m_watcher->removePath(fileName);
+
+    if (!entry.engine)
+        return;
+
+    emit engineRemoved(entry.engine);
+    entry.engine->deleteLater();
+}
+
+void OpenSearchCatalog::scheduleReload()
+{
+    // Later changes do not postpone the reload, so that a busy directory is still reloaded.
+    if (!m_reloadTimer->isActive())
+        m_reloadTimer->start(m_reloadDelay);
+}
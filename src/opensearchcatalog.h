@@ -0,0 +1,98 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHCATALOG_H
+#define OPENSEARCHCATALOG_H
+
+#include <qbytearray.h>
+#include <qdatetime.h>
+#include <qlist.h>
+#include <qmap.h>
+#include <qobject.h>
+#include <qset.h>
+#include <qstringlist.h>
+
+class QFileSystemWatcher;
+class QTimer;
+
+class OpenSearchEngine;
+
+class OpenSearchCatalog : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void engineAdded(OpenSearchEngine *engine);
+    void engineChanged(OpenSearchEngine *engine);
+    void engineRemoved(OpenSearchEngine *engine);
+    void fileError(const QString &fileName, const QString &errorString);
+
+public:
+    Q_PROPERTY(QString path READ path WRITE setPath)
+    Q_PROPERTY(QStringList nameFilters READ nameFilters WRITE setNameFilters)
+    Q_PROPERTY(int reloadDelay READ reloadDelay WRITE setReloadDelay)
+
+    OpenSearchCatalog(QObject *parent = 0);
+    ~OpenSearchCatalog();
+
+    QString path() const;
+    void setPath(const QString &path);
+
+    QStringList nameFilters() const;
+    void setNameFilters(const QStringList &nameFilters);
+
+    int reloadDelay() const;
+    void setReloadDelay(int msecs);
+
+    QList<OpenSearchEngine*> engines() const;
+    OpenSearchEngine *engine(const QString &fileName) const;
+    QString fileName(OpenSearchEngine *engine) const;
+
+public slots:
+    void reload();
+
+private slots:
+    void directoryChanged();
+    void fileChanged(const QString &fileName);
+
+private:
+    struct Entry
+    {
+        Entry() : engine(0), size(-1) {}
+
+        OpenSearchEngine *engine;
+        qint64 size;
+        QDateTime lastModified;
+        QByteArray checksum;
+    };
+
+    void removeEntry(const QString &fileName);
+    void scheduleReload();
+
+    QString m_path;
+    QStringList m_nameFilters;
+    QMap<QString, Entry> m_entries;
+    QSet<QString> m_changedFiles;
+
+    QFileSystemWatcher *m_watcher;
+    int m_reloadDelay;
+    QTimer *m_reloadTimer;
+};
+
+#endif // OPENSEARCHCATALOG_H
@@ -0,0 +1,1050 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchdescription.h"
+
+#include "opensearchstringpool.h"
+#include "opensearchurltemplate.h"
+
+#include <qhash.h>
+#include <qpair.h>
+#include <qtconcurrentmap.h>
+
+class OpenSearchDescriptionData : public QSharedData
+{
+public:
+    struct CompiledParameter
+    {
+        QByteArray name;
+        QByteArray encodedName;
+        OpenSearchUrlTemplate value;
+    };
+    typedef QList<CompiledParameter> CompiledParameters;
+
+    struct CompiledUrl
+    {
+        OpenSearchDescription::Url url;
+        OpenSearchUrlTemplate urlTemplate;
+        CompiledParameters parameters;
+    };
+    typedef QPair<QString, QString> UrlKey;
+
+    OpenSearchDescriptionData();
+
+    static OpenSearchDescription::Parameters internParameters(const OpenSearchDescription::Parameters &parameters);
+    static CompiledParameters compileParameters(const OpenSearchDescription::Parameters &parameters);
+    static QByteArray buildUrl(const OpenSearchUrlTemplate &urlTemplate, const CompiledParameters &parameters,
+                               const char *encodedSearchTerm, int encodedSearchTermSize,
+                               const OpenSearchTemplateContext &context);
+    static QByteArray buildPostData(const CompiledParameters &parameters, const QString &searchTerm,
+                                    const OpenSearchTemplateContext &context);
+    static uint hashParameters(const OpenSearchDescription::Parameters &parameters);
+    static qint64 parametersSize(const OpenSearchDescription::Parameters &parameters);
+    static qint64 compiledParametersSize(const CompiledParameters &parameters);
+    static bool isSearchUrl(const QString &type, const QString &rel);
+    static bool isSuggestionsUrl(const QString &type, const QString &rel);
+
+    const CompiledUrl *findUrl(const QString &type, const QString &rel) const;
+
+    QByteArray buildSearchUrl(const char *encodedSearchTerm, int encodedSearchTermSize,
+                              const OpenSearchTemplateContext &context) const;
+    void updateHash();
+
+    QString name;
+    QString description;
+    QString imageUrl;
+    QStringList tags;
+
+    QString searchUrlTemplate;
+    QString suggestionsUrlTemplate;
+    OpenSearchDescription::Parameters searchParameters;
+    OpenSearchDescription::Parameters suggestionsParameters;
+    OpenSearchDescription::RequestMethod searchMethod;
+    OpenSearchDescription::RequestMethod suggestionsMethod;
+
+    OpenSearchUrlTemplate searchTemplate;
+    OpenSearchUrlTemplate suggestionsTemplate;
+    CompiledParameters compiledSearchParameters;
+    CompiledParameters compiledSuggestionsParameters;
+
+    // Any other Url element, indexed by its type and relation. Lookups find the first
+    // one, but all of them are kept, so that the document can be written back as is.
+    QList<CompiledUrl> additionalUrls;
+    QHash<UrlKey, int> urlIndex;
+
+    uint hash;
+};
+
+struct SearchUrlsJob
+{
+    enum { ChunkSize = 1024 };
+
+    static QList<QByteArray> build(const SearchUrlsJob &job)
+    {
+        QList<QByteArray> urls;
+        urls.reserve(job.end - job.begin);
+        for (int i = job.begin; i < job.end; ++i) {
+            const QByteArray &encodedSearchTerm = job.encodedSearchTerms->at(i);
+            urls.append(job.data->buildSearchUrl(encodedSearchTerm.constData(), encodedSearchTerm.size(),
+                                                 *job.context));
+        }
+        return urls;
+    }
+
+    const OpenSearchDescriptionData *data;
+    const QList<QByteArray> *encodedSearchTerms;
+    const OpenSearchTemplateContext *context;
+    int begin;
+    int end;
+};
+
+OpenSearchDescriptionData::OpenSearchDescriptionData()
+    : searchMethod(OpenSearchDescription::GetMethod)
+    , suggestionsMethod(OpenSearchDescription::GetMethod)
+    , hash(0)
+{
+    updateHash();
+}
+
+OpenSearchDescription::Parameters OpenSearchDescriptionData::internParameters(const OpenSearchDescription::Parameters &parameters)
+{
+    OpenSearchDescription::Parameters interned;
+    interned.reserve(parameters.count());
+
+    OpenSearchDescription::Parameters::const_iterator end = parameters.constEnd();
+    OpenSearchDescription::Parameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i) {
+        interned.append(OpenSearchDescription::Parameter(OpenSearchStringPool::intern(i->first),
+                                                         OpenSearchStringPool::intern(i->second)));
+    }
+
+    return interned;
+}
+
+OpenSearchDescriptionData::CompiledParameters OpenSearchDescriptionData::compileParameters(const OpenSearchDescription::Parameters &parameters)
+{
+    CompiledParameters compiled;
+
+    OpenSearchDescription::Parameters::const_iterator end = parameters.constEnd();
+    OpenSearchDescription::Parameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i) {
+        CompiledParameter parameter;
+        parameter.name = OpenSearchStringPool::intern(i->first.toUtf8());
+        OpenSearchUrlTemplate::appendEncoded(&parameter.encodedName, parameter.name,
+                                             OpenSearchUrlTemplate::QueryItemEncoding);
+        parameter.encodedName = OpenSearchStringPool::intern(parameter.encodedName);
+        parameter.value = OpenSearchUrlTemplate(i->second);
+        compiled.append(parameter);
+    }
+
+    return compiled;
+}
+
+QByteArray OpenSearchDescriptionData::buildUrl(const OpenSearchUrlTemplate &urlTemplate, const CompiledParameters &parameters,
+                                               const char *encodedSearchTerm, int encodedSearchTermSize,
+                                               const OpenSearchTemplateContext &context)
+{
+    int size = urlTemplate.estimatedSize(encodedSearchTermSize) + 1;
+    CompiledParameters::const_iterator end = parameters.constEnd();
+    CompiledParameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i)
+        size += i->encodedName.size() + i->value.estimatedSize(encodedSearchTermSize) + 2;
+
+    QByteArray url;
+    url.reserve(size);
+    urlTemplate.expand(&url, encodedSearchTerm, encodedSearchTermSize, OpenSearchUrlTemplate::UrlEncoding, context);
+
+    if (parameters.isEmpty())
+        return url;
+
+    // Additional parameters belong to the query, which precedes the fragment.
+    QByteArray fragment;
+    int fragmentStart = url.indexOf('#');
+    if (fragmentStart != -1) {
+        fragment = url.mid(fragmentStart);
+        url.truncate(fragmentStart);
+    }
+
+    int queryStart = url.indexOf('?');
+    char separator = '&';
+    if (queryStart == -1)
+        separator = '?';
+    else if (queryStart == url.size() - 1)
+        separator = 0;
+
+    for (i = parameters.constBegin(); i != end; ++i) {
+        if (separator)
+            url.append(separator);
+        separator = '&';
+
+        url.append(i->encodedName);
+        url.append('=');
+        i->value.expand(&url, encodedSearchTerm, encodedSearchTermSize,
+                        OpenSearchUrlTemplate::QueryItemEncoding, context);
+    }
+
+    url.append(fragment);
+    return url;
+}
+
+QByteArray OpenSearchDescriptionData::buildPostData(const CompiledParameters &parameters, const QString &searchTerm,
+                                                    const OpenSearchTemplateContext &context)
+{
+    OpenSearchUrlTemplate::EncodedSearchTerm encodedSearchTerm;
+    OpenSearchUrlTemplate::encodeSearchTerm(&encodedSearchTerm, searchTerm);
+    QByteArray data;
+
+    CompiledParameters::const_iterator end = parameters.constEnd();
+    CompiledParameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i) {
+        if (i != parameters.constBegin())
+            data.append('&');
+
+        data.append(i->name);
+        data.append('=');
+        i->value.expand(&data, encodedSearchTerm.constData(), encodedSearchTerm.size(),
+                        OpenSearchUrlTemplate::UrlEncoding, context);
+    }
+
+    return data;
+}
+
+uint OpenSearchDescriptionData::hashParameters(const OpenSearchDescription::Parameters &parameters)
+{
+    uint h = 0;
+
+    OpenSearchDescription::Parameters::const_iterator end = parameters.constEnd();
+    OpenSearchDescription::Parameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i)
+        h = 31 * h + (qHash(i->first) ^ (qHash(i->second) << 1));
+
+    return h;
+}
+
+qint64 OpenSearchDescriptionData::parametersSize(const OpenSearchDescription::Parameters &parameters)
+{
+    qint64 size = parameters.count() * (sizeof(void*) + sizeof(OpenSearchDescription::Parameter));
+
+    OpenSearchDescription::Parameters::const_iterator end = parameters.constEnd();
+    OpenSearchDescription::Parameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i)
+        size += OpenSearchStringPool::sizeOf(i->first) + OpenSearchStringPool::sizeOf(i->second);
+
+    return size;
+}
+
+qint64 OpenSearchDescriptionData::compiledParametersSize(const CompiledParameters &parameters)
+{
+    qint64 size = parameters.count() * (sizeof(void*) + sizeof(CompiledParameter));
+
+    CompiledParameters::const_iterator end = parameters.constEnd();
+    CompiledParameters::const_iterator i = parameters.constBegin();
+    for (; i != end; ++i) {
+        size += OpenSearchStringPool::sizeOf(i->name) + OpenSearchStringPool::sizeOf(i->encodedName);
+        size += i->value.memoryUsage();
+    }
+
+    return size;
+}
+
+bool OpenSearchDescriptionData::isSearchUrl(const QString &type, const QString &rel)
+{
+    return (type == QLatin1String("text/html") && rel == QLatin1String("results"));
+}
+
+bool OpenSearchDescriptionData::isSuggestionsUrl(const QString &type, const QString &rel)
+{
+    return (type == QLatin1String("application/x-suggestions+json")
+            && (rel == QLatin1String("results") || rel == QLatin1String("suggestions")));
+}
+
+const OpenSearchDescriptionData::CompiledUrl *OpenSearchDescriptionData::findUrl(const QString &type,
+                                                                                 const QString &rel) const
+{
+    QHash<UrlKey, int>::const_iterator i = urlIndex.constFind(UrlKey(type, rel));
+    if (i == urlIndex.constEnd())
+        return 0;
+
+    return &additionalUrls.at(i.value());
+}
+
+QByteArray OpenSearchDescriptionData::buildSearchUrl(const char *encodedSearchTerm, int encodedSearchTermSize,
+                                                     const OpenSearchTemplateContext &context) const
+{
+    if (searchUrlTemplate.isEmpty())
+        return QByteArray();
+
+    if (searchMethod == OpenSearchDescription::PostMethod)
+        return buildUrl(searchTemplate, CompiledParameters(), encodedSearchTerm, encodedSearchTermSize, context);
+
+    return buildUrl(searchTemplate, compiledSearchParameters, encodedSearchTerm, encodedSearchTermSize, context);
+}
+
+void OpenSearchDescriptionData::updateHash()
+{
+    // Covers the same fields as operator==, so equal descriptions hash equally.
+    uint h = qHash(name);
+    h = 31 * h + qHash(description);
+    h = 31 * h + qHash(imageUrl);
+    h = 31 * h + qHash(searchUrlTemplate);
+    h = 31 * h + qHash(suggestionsUrlTemplate);
+    h = 31 * h + hashParameters(searchParameters);
+    h = 31 * h + hashParameters(suggestionsParameters);
+    h = 31 * h + uint(searchMethod) * 2 + uint(suggestionsMethod);
+
+    foreach (const CompiledUrl &compiled, additionalUrls) {
+        h = 31 * h + qHash(compiled.url.type) + qHash(compiled.url.rel);
+        h = 31 * h + qHash(compiled.url.urlTemplate) + qHash(compiled.url.method);
+        h = 31 * h + hashParameters(compiled.url.parameters);
+    }
+
+    hash = h;
+}
+
+/*!
+    \class OpenSearchDescription
+    \brief An implicitly shared value holding the description of a search engine
+
+    OpenSearchDescription holds everything an OpenSearch description document says about
+    a search engine: its name(), description(), the URL templates with their parameters
+    and request methods, the imageUrl() and the tags(). It is what OpenSearchReader
+    produces and OpenSearchWriter consumes, while OpenSearchEngine wraps it to perform
+    network requests.
+
+    The class is implicitly shared, so copying it is cheap and the URL templates are only
+    compiled once, when they are set. Modifying a copy detaches it from the others, so
+    one description can be handed to any number of threads, which can call searchUrl()
+    and suggestionsUrl() concurrently without any locking.
+
+    Besides the search and suggestions URLs, a description can hold any number of
+    additionalUrls(), e.g. the RSS or Atom feeds of the results, each with its own
+    parameters and request method. They are looked up by their type and relation with
+    url(), and resultsUrl() builds the URL of the results in any of the resultTypes().
+
+    Comparisons short-circuit on shared data, and then on a hash of the compared fields,
+    which is kept up to date by the setters.
+
+    \sa OpenSearchEngine, OpenSearchReader, OpenSearchWriter
+*/
+
+/*!
+    Constructs an empty description.
+*/
+OpenSearchDescription::OpenSearchDescription()
+    : d(new OpenSearchDescriptionData())
+{
+}
+
+/*!
+    Constructs a copy of \a other, sharing its data.
+*/
+OpenSearchDescription::OpenSearchDescription(const OpenSearchDescription &other)
+    : d(other.d)
+{
+}
+
+/*!
+    A destructor.
+*/
+OpenSearchDescription::~OpenSearchDescription()
+{
+}
+
+/*!
+    Assigns \a other to this description, sharing its data.
+*/
+OpenSearchDescription &OpenSearchDescription::operator=(const OpenSearchDescription &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Returns the name of the engine.
+
+    \sa OpenSearchEngine::name()
+*/
+QString OpenSearchDescription::name() const
+{
+    return d->name;
+}
+
+void OpenSearchDescription::setName(const QString &name)
+{
+    d->name = name;
+    d->updateHash();
+}
+
+/*!
+    Returns the description of the engine.
+
+    \sa OpenSearchEngine::description()
+*/
+QString OpenSearchDescription::description() const
+{
+    return d->description;
+}
+
+void OpenSearchDescription::setDescription(const QString &description)
+{
+    d->description = description;
+    d->updateHash();
+}
+
+/*!
+    Returns the template of the search URL.
+
+    \sa OpenSearchEngine::searchUrlTemplate()
+*/
+QString OpenSearchDescription::searchUrlTemplate() const
+{
+    return d->searchUrlTemplate;
+}
+
+void OpenSearchDescription::setSearchUrlTemplate(const QString &searchUrlTemplate)
+{
+    d->searchUrlTemplate = OpenSearchStringPool::intern(searchUrlTemplate);
+    d->searchTemplate = OpenSearchUrlTemplate(searchUrlTemplate);
+    d->updateHash();
+}
+
+/*!
+    Constructs and returns a search URL with a given \a searchTerm. The search parameters
+    are appended to the query, unless they are posted. The other template parameters are
+    substituted with the values of the \a context.
+
+    \sa OpenSearchEngine::searchUrl(), searchPostData()
+*/
+QUrl OpenSearchDescription::searchUrl(const QString &searchTerm, const OpenSearchTemplateContext &context) const
+{
+    if (d->searchUrlTemplate.isEmpty())
+        return QUrl();
+
+    return QUrl::fromEncoded(encodedSearchUrl(searchTerm, context));
+}
+
+/*!
+    Constructs and returns the percent encoded search URL with a given \a searchTerm,
+    without the cost of parsing it into a QUrl.
+
+    \sa searchUrl(), encodedSearchUrls()
+*/
+QByteArray OpenSearchDescription::encodedSearchUrl(const QString &searchTerm,
+                                                   const OpenSearchTemplateContext &context) const
+{
+    OpenSearchUrlTemplate::EncodedSearchTerm encodedSearchTerm;
+    OpenSearchUrlTemplate::encodeSearchTerm(&encodedSearchTerm, searchTerm);
+    return d->buildSearchUrl(encodedSearchTerm.constData(), encodedSearchTerm.size(), context);
+}
+
+/*!
+    Constructs and returns the percent encoded search URLs for all the \a searchTerms,
+    in the same order.
+
+    \sa encodedSearchUrl()
+*/
+QList<QByteArray> OpenSearchDescription::encodedSearchUrls(const QStringList &searchTerms,
+                                                           const OpenSearchTemplateContext &context) const
+{
+    return encodedSearchUrls(QList<OpenSearchDescription>() << *this, searchTerms, context);
+}
+
+/*!
+    Constructs and returns the percent encoded search URLs of all the \a descriptions for
+    all the \a searchTerms. The list holds the URLs of the first description for every
+    search term, followed by the URLs of the second one, and so on. Descriptions without
+    a search URL template contribute empty URLs.
+
+    Every search term is encoded once for all the descriptions and the compiled templates
+    are expanded directly into the returned URLs. Large batches are split into chunks,
+    which are processed by the global thread pool.
+
+    \sa encodedSearchUrl()
+*/
+QList<QByteArray> OpenSearchDescription::encodedSearchUrls(const QList<OpenSearchDescription> &descriptions,
+                                                           const QStringList &searchTerms,
+                                                           const OpenSearchTemplateContext &context)
+{
+    QList<QByteArray> encodedSearchTerms;
+    encodedSearchTerms.reserve(searchTerms.count());
+    foreach (const QString &searchTerm, searchTerms)
+        encodedSearchTerms.append(OpenSearchUrlTemplate::encodeSearchTerm(searchTerm));
+
+    // The workers share the environment instead of all looking it up.
+    OpenSearchTemplateContext resolvedContext = context;
+    resolvedContext.resolveEnvironment();
+
+    QList<SearchUrlsJob> jobs;
+    foreach (const OpenSearchDescription &description, descriptions) {
+        for (int begin = 0; begin < encodedSearchTerms.count(); begin += SearchUrlsJob::ChunkSize) {
+            SearchUrlsJob job;
+            job.data = description.d.constData();
+            job.encodedSearchTerms = &encodedSearchTerms;
+            job.context = &resolvedContext;
+            job.begin = begin;
+            job.end = qMin(begin + int(SearchUrlsJob::ChunkSize), encodedSearchTerms.count());
+            jobs.append(job);
+        }
+    }
+
+    QList<QList<QByteArray> > chunks;
+    if (jobs.count() > 1) {
+        chunks = QtConcurrent::blockingMapped<QList<QList<QByteArray> > >(jobs, SearchUrlsJob::build);
+    } else {
+        foreach (const SearchUrlsJob &job, jobs)
+            chunks.append(SearchUrlsJob::build(job));
+    }
+
+    QList<QByteArray> urls;
+    urls.reserve(descriptions.count() * searchTerms.count());
+    foreach (const QList<QByteArray> &chunk, chunks)
+        urls += chunk;
+
+    return urls;
+}
+
+/*!
+    Returns the form encoded search parameters for a given \a searchTerm, which are sent
+    as the body of search requests when searchMethod() is "post".
+
+    \sa searchUrl()
+*/
+QByteArray OpenSearchDescription::searchPostData(const QString &searchTerm,
+                                                 const OpenSearchTemplateContext &context) const
+{
+    return OpenSearchDescriptionData::buildPostData(d->compiledSearchParameters, searchTerm, context);
+}
+
+/*!
+    Returns the additional parameters of the search URL.
+
+    \sa OpenSearchEngine::searchParameters()
+*/
+OpenSearchDescription::Parameters OpenSearchDescription::searchParameters() const
+{
+    return d->searchParameters;
+}
+
+void OpenSearchDescription::setSearchParameters(const Parameters &searchParameters)
+{
+    d->searchParameters = OpenSearchDescriptionData::internParameters(searchParameters);
+    d->compiledSearchParameters = OpenSearchDescriptionData::compileParameters(searchParameters);
+    d->updateHash();
+}
+
+/*!
+    Returns the HTTP request method of search requests, either "get", which is
+    the default, or "post". Other methods are ignored when set.
+*/
+QString OpenSearchDescription::searchMethod() const
+{
+    return requestMethodName(d->searchMethod);
+}
+
+void OpenSearchDescription::setSearchMethod(const QString &method)
+{
+    parseRequestMethod(method, &d->searchMethod);
+    d->updateHash();
+}
+
+/*!
+    Returns the HTTP request method of search requests.
+
+    \sa searchMethod()
+*/
+OpenSearchDescription::RequestMethod OpenSearchDescription::searchRequestMethod() const
+{
+    return d->searchMethod;
+}
+
+/*!
+    Returns true if the engine supports contextual suggestions.
+*/
+bool OpenSearchDescription::providesSuggestions() const
+{
+    return !d->suggestionsUrlTemplate.isEmpty();
+}
+
+/*!
+    Returns the template of the suggestions URL.
+
+    \sa OpenSearchEngine::suggestionsUrlTemplate()
+*/
+QString OpenSearchDescription::suggestionsUrlTemplate() const
+{
+    return d->suggestionsUrlTemplate;
+}
+
+void OpenSearchDescription::setSuggestionsUrlTemplate(const QString &suggestionsUrlTemplate)
+{
+    d->suggestionsUrlTemplate = OpenSearchStringPool::intern(suggestionsUrlTemplate);
+    d->suggestionsTemplate = OpenSearchUrlTemplate(suggestionsUrlTemplate);
+    d->updateHash();
+}
+
+/*!
+    Constructs and returns a suggestions URL with a given \a searchTerm. The suggestions
+    parameters are appended to the query, unless they are posted.
+
+    \sa OpenSearchEngine::suggestionsUrl(), suggestionsPostData()
+*/
+QUrl OpenSearchDescription::suggestionsUrl(const QString &searchTerm, const OpenSearchTemplateContext &context) const
+{
+    if (d->suggestionsUrlTemplate.isEmpty())
+        return QUrl();
+
+    OpenSearchDescriptionData::CompiledParameters parameters;
+    if (d->suggestionsMethod != PostMethod)
+        parameters = d->compiledSuggestionsParameters;
+
+    OpenSearchUrlTemplate::EncodedSearchTerm encodedSearchTerm;
+    OpenSearchUrlTemplate::encodeSearchTerm(&encodedSearchTerm, searchTerm);
+    return QUrl::fromEncoded(OpenSearchDescriptionData::buildUrl(d->suggestionsTemplate, parameters,
+                                                                 encodedSearchTerm.constData(),
+                                                                 encodedSearchTerm.size(), context));
+}
+
+/*!
+    Returns the form encoded suggestions parameters for a given \a searchTerm, which are
+    sent as the body of suggestions requests when suggestionsMethod() is "post".
+
+    \sa suggestionsUrl()
+*/
+QByteArray OpenSearchDescription::suggestionsPostData(const QString &searchTerm,
+                                                      const OpenSearchTemplateContext &context) const
+{
+    return OpenSearchDescriptionData::buildPostData(d->compiledSuggestionsParameters, searchTerm, context);
+}
+
+/*!
+    Returns the additional parameters of the suggestions URL.
+
+    \sa OpenSearchEngine::suggestionsParameters()
+*/
+OpenSearchDescription::Parameters OpenSearchDescription::suggestionsParameters() const
+{
+    return d->suggestionsParameters;
+}
+
+void OpenSearchDescription::setSuggestionsParameters(const Parameters &suggestionsParameters)
+{
+    d->suggestionsParameters = OpenSearchDescriptionData::internParameters(suggestionsParameters);
+    d->compiledSuggestionsParameters = OpenSearchDescriptionData::compileParameters(suggestionsParameters);
+    d->updateHash();
+}
+
+/*!
+    Returns the HTTP request method of suggestions requests, either "get", which is
+    the default, or "post". Other methods are ignored when set.
+*/
+QString OpenSearchDescription::suggestionsMethod() const
+{
+    return requestMethodName(d->suggestionsMethod);
+}
+
+void OpenSearchDescription::setSuggestionsMethod(const QString &method)
+{
+    parseRequestMethod(method, &d->suggestionsMethod);
+    d->updateHash();
+}
+
+/*!
+    Returns the HTTP request method of suggestions requests.
+
+    \sa suggestionsMethod()
+*/
+OpenSearchDescription::RequestMethod OpenSearchDescription::suggestionsRequestMethod() const
+{
+    return d->suggestionsMethod;
+}
+
+/*!
+    Returns the name of the request \a method, "get" or "post". The names share one
+    buffer for all the descriptions.
+*/
+QString OpenSearchDescription::requestMethodName(RequestMethod method)
+{
+    return OpenSearchStringPool::intern(QString(QLatin1String(method == PostMethod ? "post" : "get")));
+}
+
+/*!
+    Sets \a method to the request method called \a name, which is case insensitive,
+    and returns true, or returns false if \a name is neither "get" nor "post".
+*/
+bool OpenSearchDescription::parseRequestMethod(const QString &name, RequestMethod *method)
+{
+    RequestMethod requestMethod;
+    if (name.compare(QLatin1String("get"), Qt::CaseInsensitive) == 0)
+        requestMethod = GetMethod;
+    else if (name.compare(QLatin1String("post"), Qt::CaseInsensitive) == 0)
+        requestMethod = PostMethod;
+    else
+        return false;
+
+    if (method)
+        *method = requestMethod;
+    return true;
+}
+
+/*!
+    \class OpenSearchDescription::Url
+    \brief A Url element of an OpenSearch description
+
+    Url holds the MIME \c type of the responses, the relation (\c rel) of the responses
+    to the search request, which is "results" by default, the URL template with its
+    additional parameters and the HTTP request method, "get" by default.
+
+    Methods are compared by operator==(), as they are for the search and suggestions
+    URLs of OpenSearchDescription.
+*/
+
+/*!
+    Constructs an empty URL, with the "results" relation and the "get" method.
+*/
+OpenSearchDescription::Url::Url()
+    : rel(QLatin1String("results"))
+    , method(QLatin1String("get"))
+{
+}
+
+bool OpenSearchDescription::Url::operator==(const Url &other) const
+{
+    return (type == other.type
+            && rel == other.rel
+            && urlTemplate == other.urlTemplate
+            && parameters == other.parameters
+            && method == other.method);
+}
+
+bool OpenSearchDescription::Url::operator!=(const Url &other) const
+{
+    return !(*this == other);
+}
+
+/*!
+    Returns all the URLs of the description: the search URL, the suggestions URL
+    and the additionalUrls(), in this order. Empty URL templates are left out.
+
+    \sa url()
+*/
+OpenSearchDescription::Urls OpenSearchDescription::urls() const
+{
+    Urls urls;
+
+    if (!d->searchUrlTemplate.isEmpty())
+        urls.append(url(QLatin1String("text/html")));
+
+    if (!d->suggestionsUrlTemplate.isEmpty())
+        urls.append(url(QLatin1String("application/x-suggestions+json")));
+
+    return urls + additionalUrls();
+}
+
+/*!
+    Returns the URLs of the description other than the search and suggestions URLs,
+    in the order they have been set.
+
+    \sa urls()
+*/
+OpenSearchDescription::Urls OpenSearchDescription::additionalUrls() const
+{
+    Urls urls;
+    urls.reserve(d->additionalUrls.count());
+    foreach (const OpenSearchDescriptionData::CompiledUrl &compiled, d->additionalUrls)
+        urls.append(compiled.url);
+    return urls;
+}
+
+/*!
+    Sets the additional URLs of the description to \a urls. URLs with an empty template
+    are ignored, an empty relation stands for "results" and unknown request methods for
+    "get".
+
+    \note The search and suggestions URLs are set with setSearchUrlTemplate() and
+          setSuggestionsUrlTemplate(), the URLs of their type and relation that are set
+          here are kept, but not used for building URLs.
+*/
+void OpenSearchDescription::setAdditionalUrls(const Urls &urls)
+{
+    d->additionalUrls.clear();
+    d->urlIndex.clear();
+
+    foreach (const Url &url, urls) {
+        if (url.urlTemplate.isEmpty())
+            continue;
+
+        RequestMethod method = GetMethod;
+        parseRequestMethod(url.method, &method);
+
+        OpenSearchDescriptionData::CompiledUrl compiled;
+        compiled.url.type = OpenSearchStringPool::intern(url.type);
+        compiled.url.rel = url.rel.isEmpty() ? QString(QLatin1String("results")) : url.rel;
+        compiled.url.rel = OpenSearchStringPool::intern(compiled.url.rel);
+        compiled.url.urlTemplate = OpenSearchStringPool::intern(url.urlTemplate);
+        compiled.url.parameters = OpenSearchDescriptionData::internParameters(url.parameters);
+        compiled.url.method = requestMethodName(method);
+        compiled.urlTemplate = OpenSearchUrlTemplate(url.urlTemplate);
+        compiled.parameters = OpenSearchDescriptionData::compileParameters(url.parameters);
+
+        OpenSearchDescriptionData::UrlKey key(compiled.url.type, compiled.url.rel);
+        if (!d->urlIndex.contains(key))
+            d->urlIndex.insert(key, d->additionalUrls.count());
+        d->additionalUrls.append(compiled);
+    }
+
+    d->updateHash();
+}
+
+/*!
+    Returns true if the description has a URL of the given \a type and \a rel.
+
+    \sa url()
+*/
+bool OpenSearchDescription::hasUrl(const QString &type, const QString &rel) const
+{
+    return !url(type, rel).urlTemplate.isEmpty();
+}
+
+/*!
+    Returns the URL of the given MIME \a type and relation \a rel, or an empty URL if
+    there is none. "text/html" results are the search URL and
+    "application/x-suggestions+json" results, or suggestions, the suggestions URL.
+    Otherwise, the first of the additionalUrls() that matches is returned.
+*/
+OpenSearchDescription::Url OpenSearchDescription::url(const QString &type, const QString &rel) const
+{
+    Url url;
+    url.type = type;
+    url.rel = rel;
+
+    if (OpenSearchDescriptionData::isSearchUrl(type, rel)) {
+        url.urlTemplate = d->searchUrlTemplate;
+        url.parameters = d->searchParameters;
+        url.method = requestMethodName(d->searchMethod);
+    } else if (OpenSearchDescriptionData::isSuggestionsUrl(type, rel)) {
+        url.urlTemplate = d->suggestionsUrlTemplate;
+        url.parameters = d->suggestionsParameters;
+        url.method = requestMethodName(d->suggestionsMethod);
+    } else if (const OpenSearchDescriptionData::CompiledUrl *compiled = d->findUrl(type, rel)) {
+        url = compiled->url;
+    }
+
+    return url;
+}
+
+/*!
+    Returns the MIME types the results are available in, starting with "text/html"
+    if there is a search URL.
+
+    \sa resultsUrl()
+*/
+QStringList OpenSearchDescription::resultTypes() const
+{
+    QStringList types;
+
+    if (!d->searchUrlTemplate.isEmpty())
+        types.append(QLatin1String("text/html"));
+
+    foreach (const OpenSearchDescriptionData::CompiledUrl &compiled, d->additionalUrls) {
+        if (compiled.url.rel == QLatin1String("results") && !compiled.url.type.isEmpty()
+            && !types.contains(compiled.url.type))
+            types.append(compiled.url.type);
+    }
+
+    return types;
+}
+
+/*!
+    Constructs and returns the URL of the results of the given MIME \a type, e.g.
+    "application/rss+xml", for a given \a searchTerm, just like searchUrl() does for
+    the "text/html" results. Returns an invalid URL if the results are not available
+    in this type.
+
+    \sa resultTypes(), resultsPostData()
+*/
+QUrl OpenSearchDescription::resultsUrl(const QString &searchTerm, const QString &type,
+                                       const OpenSearchTemplateContext &context) const
+{
+    const QString rel = QLatin1String("results");
+    if (OpenSearchDescriptionData::isSearchUrl(type, rel))
+        return searchUrl(searchTerm, context);
+    if (OpenSearchDescriptionData::isSuggestionsUrl(type, rel))
+        return suggestionsUrl(searchTerm, context);
+
+    const OpenSearchDescriptionData::CompiledUrl *compiled = d->findUrl(type, rel);
+    if (!compiled)
+        return QUrl();
+
+    OpenSearchDescriptionData::CompiledParameters parameters;
+    if (compiled->url.method != QLatin1String("post"))
+        parameters = compiled->parameters;
+
+    OpenSearchUrlTemplate::EncodedSearchTerm encodedSearchTerm;
+    OpenSearchUrlTemplate::encodeSearchTerm(&encodedSearchTerm, searchTerm);
+    return QUrl::fromEncoded(OpenSearchDescriptionData::buildUrl(compiled->urlTemplate, parameters,
+                                                                 encodedSearchTerm.constData(),
+                                                                 encodedSearchTerm.size(), context));
+}
+
+/*!
+    Returns the form encoded parameters of the results of the given MIME \a type for
+    a given \a searchTerm, which are sent as the body of the request when the method
+    of the URL is "post".
+
+    \sa resultsUrl()
+*/
+QByteArray OpenSearchDescription::resultsPostData(const QString &searchTerm, const QString &type,
+                                                  const OpenSearchTemplateContext &context) const
+{
+    const QString rel = QLatin1String("results");
+    if (OpenSearchDescriptionData::isSearchUrl(type, rel))
+        return searchPostData(searchTerm, context);
+    if (OpenSearchDescriptionData::isSuggestionsUrl(type, rel))
+        return suggestionsPostData(searchTerm, context);
+
+    const OpenSearchDescriptionData::CompiledUrl *compiled = d->findUrl(type, rel);
+    if (!compiled)
+        return QByteArray();
+
+    return OpenSearchDescriptionData::buildPostData(compiled->parameters, searchTerm, context);
+}
+
+/*!
+    Returns the image URL of the engine.
+
+    \sa OpenSearchEngine::imageUrl()
+*/
+QString OpenSearchDescription::imageUrl() const
+{
+    return d->imageUrl;
+}
+
+void OpenSearchDescription::setImageUrl(const QString &imageUrl)
+{
+    d->imageUrl = imageUrl;
+    d->updateHash();
+}
+
+/*!
+    Returns the keywords of the engine.
+*/
+QStringList OpenSearchDescription::tags() const
+{
+    return d->tags;
+}
+
+void OpenSearchDescription::setTags(const QStringList &tags)
+{
+    d->tags = OpenSearchStringPool::intern(tags);
+}
+
+/*!
+    Returns true if the description has a name and a search URL template.
+*/
+bool OpenSearchDescription::isValid() const
+{
+    return (!d->name.isEmpty() && !d->searchUrlTemplate.isEmpty());
+}
+
+/*!
+    Returns the hash of the fields compared by operator==().
+*/
+uint OpenSearchDescription::hash() const
+{
+    return d->hash;
+}
+
+/*!
+    Returns the approximate number of bytes held by the description, including its
+    compiled URL templates. The strings shared through OpenSearchStringPool are left out,
+    as they are paid for once for all the descriptions. So is the data shared with other
+    copies of the description.
+
+    \sa OpenSearchStringPool::memoryUsage()
+*/
+qint64 OpenSearchDescription::memoryUsage() const
+{
+    qint64 size = sizeof(OpenSearchDescriptionData);
+    size += OpenSearchStringPool::sizeOf(d->name);
+    size += OpenSearchStringPool::sizeOf(d->description);
+    size += OpenSearchStringPool::sizeOf(d->imageUrl);
+    size += d->tags.count() * sizeof(void*);
+    foreach (const QString &tag, d->tags)
+        size += OpenSearchStringPool::sizeOf(tag);
+
+    size += OpenSearchStringPool::sizeOf(d->searchUrlTemplate);
+    size += OpenSearchStringPool::sizeOf(d->suggestionsUrlTemplate);
+    size += OpenSearchDescriptionData::parametersSize(d->searchParameters);
+    size += OpenSearchDescriptionData::parametersSize(d->suggestionsParameters);
+    size += d->searchTemplate.memoryUsage() + d->suggestionsTemplate.memoryUsage();
+    size += OpenSearchDescriptionData::compiledParametersSize(d->compiledSearchParameters);
+    size += OpenSearchDescriptionData::compiledParametersSize(d->compiledSuggestionsParameters);
+
+    foreach (const OpenSearchDescriptionData::CompiledUrl &compiled, d->additionalUrls) {
+        size += sizeof(void*) + sizeof(OpenSearchDescriptionData::CompiledUrl);
+        size += OpenSearchStringPool::sizeOf(compiled.url.type);
+        size += OpenSearchStringPool::sizeOf(compiled.url.rel);
+        size += OpenSearchStringPool::sizeOf(compiled.url.urlTemplate);
+        size += OpenSearchDescriptionData::parametersSize(compiled.url.parameters);
+        size += compiled.urlTemplate.memoryUsage();
+        size += OpenSearchDescriptionData::compiledParametersSize(compiled.parameters);
+    }
+    size += d->urlIndex.count() * (sizeof(void*) + sizeof(OpenSearchDescriptionData::UrlKey) + sizeof(int));
+
+    return size;
+}
+
+/*!
+    Returns true if \a other has the same name, description, image URL, URL templates,
+    parameters and request methods, including the ones of the additional URLs.
+*/
+bool OpenSearchDescription::operator==(const OpenSearchDescription &other) const
+{
+    if (d == other.d)
+        return true;
+
+    if (d->hash != other.d->hash)
+        return false;
+
+    return (d->name == other.d->name
+            && d->description == other.d->description
+            && d->imageUrl == other.d->imageUrl
+            && d->searchUrlTemplate == other.d->searchUrlTemplate
+            && d->suggestionsUrlTemplate == other.d->suggestionsUrlTemplate
+            && d->searchParameters == other.d->searchParameters
+            && d->suggestionsParameters == other.d->suggestionsParameters
+            && d->searchMethod == other.d->searchMethod
+            && d->suggestionsMethod == other.d->suggestionsMethod
+            && additionalUrls() == other.additionalUrls());
+}
+
+bool OpenSearchDescription::operator!=(const OpenSearchDescription &other) const
+{
+    return !(*this == other);
+}
+
+/*!
+    \relates OpenSearchDescription
+
+    Returns the hash of the \a description, so that it can be used as a QHash key.
+*/
+uint qHash(const OpenSearchDescription &description)
+{
+    return description.hash();
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHDESCRIPTION_H
+#define OPENSEARCHDESCRIPTION_H
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qmetatype.h>
+#include <qpair.h>
+#include <qshareddata.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qurl.h>
+
+#include "opensearchtemplatecontext.h"
+
+class OpenSearchDescriptionData;
+class OpenSearchDescription
+{
+public:
+    typedef QPair<QString, QString> Parameter;
+    typedef QList<Parameter> Parameters;
+
+    enum RequestMethod {
+        GetMethod,
+        PostMethod
+    };
+
+    struct Url
+    {
+        Url();
+
+        QString type;
+        QString rel;
+        QString urlTemplate;
+        Parameters parameters;
+        QString method;
+
+        bool operator==(const Url &other) const;
+        bool operator!=(const Url &other) const;
+    };
+    typedef QList<Url> Urls;
+
+    OpenSearchDescription();
+    OpenSearchDescription(const OpenSearchDescription &other);
+    ~OpenSearchDescription();
+
+    OpenSearchDescription &operator=(const OpenSearchDescription &other);
+
+    QString name() const;
+    void setName(const QString &name);
+
+    QString description() const;
+    void setDescription(const QString &description);
+
+    QString searchUrlTemplate() const;
+    void setSearchUrlTemplate(const QString &searchUrlTemplate);
+    QUrl searchUrl(const QString &searchTerm,
+                   const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    QByteArray encodedSearchUrl(const QString &searchTerm,
+                                const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    QList<QByteArray> encodedSearchUrls(const QStringList &searchTerms,
+                                        const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    static QList<QByteArray> encodedSearchUrls(const QList<OpenSearchDescription> &descriptions,
+                                               const QStringList &searchTerms,
+                                               const OpenSearchTemplateContext &context = OpenSearchTemplateContext());
+    QByteArray searchPostData(const QString &searchTerm,
+                              const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+
+    Parameters searchParameters() const;
+    void setSearchParameters(const Parameters &searchParameters);
+
+    QString searchMethod() const;
+    void setSearchMethod(const QString &method);
+    RequestMethod searchRequestMethod() const;
+
+    bool providesSuggestions() const;
+
+    QString suggestionsUrlTemplate() const;
+    void setSuggestionsUrlTemplate(const QString &suggestionsUrlTemplate);
+    QUrl suggestionsUrl(const QString &searchTerm,
+                        const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    QByteArray suggestionsPostData(const QString &searchTerm,
+                                   const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+
+    Parameters suggestionsParameters() const;
+    void setSuggestionsParameters(const Parameters &suggestionsParameters);
+
+    QString suggestionsMethod() const;
+    void setSuggestionsMethod(const QString &method);
+    RequestMethod suggestionsRequestMethod() const;
+
+    static QString requestMethodName(RequestMethod method);
+    static bool parseRequestMethod(const QString &name, RequestMethod *method);
+
+    Urls urls() const;
+    Urls additionalUrls() const;
+    void setAdditionalUrls(const Urls &urls);
+
+    bool hasUrl(const QString &type, const QString &rel = QLatin1String("results")) const;
+    Url url(const QString &type, const QString &rel = QLatin1String("results")) const;
+
+    QStringList resultTypes() const;
+    QUrl resultsUrl(const QString &searchTerm, const QString &type,
+                    const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    QByteArray resultsPostData(const QString &searchTerm, const QString &type,
+                               const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+
+    QString imageUrl() const;
+    void setImageUrl(const QString &url);
+
+    QStringList tags() const;
+    void setTags(const QStringList &tags);
+
+    bool isValid() const;
+    uint hash() const;
+    qint64 memoryUsage() const;
+
+    bool operator==(const OpenSearchDescription &other) const;
+    bool operator!=(const OpenSearchDescription &other) const;
+
+private:
+    QSharedDataPointer<OpenSearchDescriptionData> d;
+};
+
+uint qHash(const OpenSearchDescription &description);
+
+Q_DECLARE_METATYPE(OpenSearchDescription)
+
+#endif // OPENSEARCHDESCRIPTION_H
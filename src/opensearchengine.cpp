@@ -19,57 +19,282 @@
 
 #include "opensearchengine.h"
 
+#include "opensearchdescription.h"
 #include "opensearchenginedelegate.h"
-
+#include "opensearchengineobserver.h"
+#include "opensearchimagecache.h"
+#include "opensearchrequestscheduler.h"
+#include "opensearchsuggestionscache.h"
+#include "opensearchsuggestionsindex.h"
+#include "opensearchsuggestionsparser.h"
+#include "opensearchurltemplate.h"
+
+#include <qatomic.h>
 #include <qbuffer.h>
 #include <qcoreapplication.h>
+#include <qdatetime.h>
+#include <qelapsedtimer.h>
+#include <qfuturewatcher.h>
+#include <qhash.h>
 #include <qlocale.h>
+#include <qmetatype.h>
 #include <qnetworkaccessmanager.h>
 #include <qnetworkrequest.h>
 #include <qnetworkreply.h>
-#include <qregexp.h>
-#include <qscriptengine.h>
-#include <qscriptvalue.h>
+#include <qpointer.h>
+#include <qset.h>
 #include <qstringlist.h>
+#include <qtconcurrentrun.h>
+#include <qtimer.h>
+
+// The operations performing the requests, indexed by OpenSearchDescription::RequestMethod.
+static const QNetworkAccessManager::Operation requestOperations[] = {
+    QNetworkAccessManager::GetOperation,
+    QNetworkAccessManager::PostOperation
+};
+
+// The payloads of the signals, so that they can be connected across threads and spied on
+// without the user registering them first.
+static void registerMetaTypes()
+{
+    static QBasicAtomicInt registered = Q_BASIC_ATOMIC_INITIALIZER(0);
+    if (!registered.testAndSetRelaxed(0, 1))
+        return;
+
+    qRegisterMetaType<OpenSearchResult>("OpenSearchResult");
+    qRegisterMetaType<OpenSearchResults>("OpenSearchResults");
+}
+
+struct OpenSearchSuggestionsRequest
+{
+    OpenSearchSuggestionsRequest()
+        : reply(0)
+        , parser(0)
+        , sequence(0)
+        , emitted(-1)
+    {}
+
+    QNetworkReply *reply;
+    OpenSearchSuggestionsParser *parser;
+    QString searchTerm;
+    int sequence;
+    int emitted;
+
+    QElapsedTimer clock;
+    OpenSearchEngineObserver::SuggestionsStatistics statistics;
+};
 
 class OpenSearchEnginePrivate
 {
 public:
     OpenSearchEnginePrivate();
 
-    QString name;
-    QString description;
+    QString suggestionsCacheKey() const;
+    QStringList indexedSuggestions(const QString &searchTerm, const QStringList &suggestions) const;
 
-    QString imageUrl;
-    QImage image;
+    static QImage decodeDataUrl(const QString &url, const QSize &maximumSize);
+    void encodeImageUrl();
 
-    QStringList tags;
+    static qint64 elapsedMicroseconds(const QElapsedTimer &timer);
+    void reportSuggestionsRequest(OpenSearchEngine *engine, OpenSearchSuggestionsRequest *request,
+                                  OpenSearchEngineObserver::Outcome outcome);
 
-    QString searchUrlTemplate;
-    QString suggestionsUrlTemplate;
-    OpenSearchEngine::Parameters searchParameters;
-    OpenSearchEngine::Parameters suggestionsParameters;
-    QString searchMethod;
-    QString suggestionsMethod;
+    OpenSearchSuggestionsRequest *suggestionsRequest(QObject *reply) const;
+    void dropSuggestionsRequest(OpenSearchEngine *engine, OpenSearchSuggestionsRequest *request,
+                                OpenSearchEngineObserver::Outcome outcome);
 
-    QMap<QString, QNetworkAccessManager::Operation> requestMethods;
+    OpenSearchDescription openSearchDescription;
+
+    QImage image;
+    bool imageUrlPending;
+    QSize maximumImageSize;
+    QHash<QFutureWatcher<QImage>*, QString> imageDecodings;
 
     QNetworkAccessManager *networkAccessManager;
-    QNetworkReply *suggestionsReply;
 
-    QScriptEngine *scriptEngine;
+    QNetworkReply *resultsReply;
+    OpenSearchResultsParser *resultsParser;
+    int resultsTotal;
+    int suggestionsBatchSize;
+
+    // Running requests, the oldest first.
+    QList<OpenSearchSuggestionsRequest*> suggestionsRequests;
+    int maximumSuggestionsRequests;
+    int suggestionsSequence;
+    int deliveredSuggestionsSequence;
+
+    int suggestionsDelay;
+    int suggestionsMaximumDelay;
+    QTimer *suggestionsTimer;
+    QTime suggestionsPendingSince;
+    QString pendingSuggestionsTerm;
+
+    int suggestionsWarmInterval;
+    QTimer *suggestionsWarmTimer;
+    int suggestionsHostLookupId;
+    QNetworkReply *suggestionsWarmReply;
+    bool suggestionsRequested;
+
+    OpenSearchSuggestionsCache *suggestionsCache;
+    OpenSearchSuggestionsIndex *suggestionsIndex;
+    OpenSearchImageCache *imageCache;
+
+    // The scheduler may be destroyed while a request is waiting in its queue.
+    QPointer<OpenSearchRequestScheduler> requestScheduler;
+    int scheduledSuggestionsTicket;
+    QString scheduledSuggestionsTerm;
+    QUrl scheduledSuggestionsUrl;
+    int scheduledImageTicket;
+    QUrl scheduledImageUrl;
+
+    OpenSearchRequestPolicy requestPolicies[3];
 
     OpenSearchEngineDelegate *delegate;
+    OpenSearchEngineObserver *observer;
 };
 
 OpenSearchEnginePrivate::OpenSearchEnginePrivate()
-    : searchMethod(QLatin1String("get"))
-    , suggestionsMethod(QLatin1String("get"))
+    : imageUrlPending(false)
     , networkAccessManager(0)
-    , suggestionsReply(0)
-    , scriptEngine(0)
+    , resultsReply(0)
+    , resultsParser(0)
+    , resultsTotal(-1)
+    , suggestionsBatchSize(0)
+    , maximumSuggestionsRequests(1)
+    , suggestionsSequence(0)
+    , deliveredSuggestionsSequence(0)
+    , suggestionsDelay(0)
+    , suggestionsMaximumDelay(0)
+    , suggestionsTimer(0)
+    , suggestionsWarmInterval(0)
+    , suggestionsWarmTimer(0)
+    , suggestionsHostLookupId(-1)
+    , suggestionsWarmReply(0)
+    , suggestionsRequested(false)
+    , suggestionsCache(0)
+    , suggestionsIndex(0)
+    , imageCache(OpenSearchImageCache::instance())
+    , scheduledSuggestionsTicket(0)
+    , scheduledImageTicket(0)
     , delegate(0)
-{}
+    , observer(0)
+{
+    requestPolicies[OpenSearchEngine::SuggestionsRequest].setPriority(QNetworkRequest::HighPriority);
+    requestPolicies[OpenSearchEngine::ImageRequest].setPriority(QNetworkRequest::LowPriority);
+}
+
+QString OpenSearchEnginePrivate::suggestionsCacheKey() const
+{
+    QString key = openSearchDescription.suggestionsMethod() + QLatin1Char(' ')
+                  + openSearchDescription.suggestionsUrlTemplate();
+
+    OpenSearchEngine::Parameters suggestionsParameters = openSearchDescription.suggestionsParameters();
+    OpenSearchEngine::Parameters::const_iterator end = suggestionsParameters.constEnd();
+    OpenSearchEngine::Parameters::const_iterator i = suggestionsParameters.constBegin();
+    for (; i != end; ++i)
+        key += QLatin1Char(' ') + i->first + QLatin1Char('=') + i->second;
+
+    return key;
+}
+
+// The received suggestions come first, followed by the indexed ones they do not contain.
+QStringList OpenSearchEnginePrivate::indexedSuggestions(const QString &searchTerm, const QStringList &suggestions) const
+{
+    if (!suggestionsIndex)
+        return suggestions;
+
+    QStringList indexed = suggestionsIndex->lookup(searchTerm);
+    if (indexed.isEmpty())
+        return suggestions;
+
+    QSet<QString> seen;
+    foreach (const QString &suggestion, suggestions)
+        seen.insert(OpenSearchSuggestionsCache::normalizedTerm(suggestion));
+
+    QStringList merged = suggestions;
+    foreach (const QString &suggestion, indexed) {
+        if (!seen.contains(OpenSearchSuggestionsCache::normalizedTerm(suggestion)))
+            merged.append(suggestion);
+    }
+
+    return merged;
+}
+
+QImage OpenSearchEnginePrivate::decodeDataUrl(const QString &url, const QSize &maximumSize)
+{
+    // data:[<mediatype>][;base64],<data>
+    int comma = url.indexOf(QLatin1Char(','));
+    if (comma == -1)
+        return QImage();
+
+    QString header = url.mid(5, comma - 5);
+    QByteArray payload = url.mid(comma + 1).toLatin1();
+
+    QByteArray data;
+    if (header.endsWith(QLatin1String(";base64"), Qt::CaseInsensitive))
+        data = QByteArray::fromBase64(payload);
+    else
+        data = QByteArray::fromPercentEncoding(payload);
+
+    return OpenSearchImageCache::decodeImage(data, maximumSize);
+}
+
+qint64 OpenSearchEnginePrivate::elapsedMicroseconds(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1000;
+}
+
+void OpenSearchEnginePrivate::reportSuggestionsRequest(OpenSearchEngine *engine,
+                                                       OpenSearchSuggestionsRequest *request,
+                                                       OpenSearchEngineObserver::Outcome outcome)
+{
+    if (!observer)
+        return;
+
+    OpenSearchEngineObserver::SuggestionsStatistics &statistics = request->statistics;
+    statistics.outcome = outcome;
+    if (statistics.transferTime < 0 && outcome != OpenSearchEngineObserver::Cached)
+        statistics.transferTime = elapsedMicroseconds(request->clock);
+
+    observer->suggestionsRequestFinished(engine, statistics);
+}
+
+OpenSearchSuggestionsRequest *OpenSearchEnginePrivate::suggestionsRequest(QObject *reply) const
+{
+    foreach (OpenSearchSuggestionsRequest *request, suggestionsRequests) {
+        if (request->reply == reply)
+            return request;
+    }
+
+    return 0;
+}
+
+void OpenSearchEnginePrivate::dropSuggestionsRequest(OpenSearchEngine *engine,
+                                                     OpenSearchSuggestionsRequest *request,
+                                                     OpenSearchEngineObserver::Outcome outcome)
+{
+    suggestionsRequests.removeOne(request);
+    reportSuggestionsRequest(engine, request, outcome);
+
+    request->reply->disconnect(engine);
+    request->reply->abort();
+    request->reply->deleteLater();
+
+    OpenSearchSuggestionsParser::release(request->parser);
+    delete request;
+}
+
+void OpenSearchEnginePrivate::encodeImageUrl()
+{
+    imageUrlPending = false;
+
+    QBuffer imageBuffer;
+    imageBuffer.open(QBuffer::ReadWrite);
+    if (image.save(&imageBuffer, "PNG")) {
+        openSearchDescription.setImageUrl(QString(QLatin1String("data:image/png;base64,%1"))
+                                          .arg(QLatin1String(imageBuffer.buffer().toBase64())));
+    }
+}
 
 /*!
     \class OpenSearchEngine
@@ -115,7 +340,11 @@ OpenSearchEnginePrivate::OpenSearchEnginePrivate()
     Without that, both images delivered from remote locations and contextual suggestions
     will be disabled.
 
-    \sa OpenSearchReader, OpenSearchWriter
+    The data read from the description document is held by an implicitly shared
+    OpenSearchDescription, see openSearchDescription(). Unlike the engine, it can be
+    copied cheaply and used from other threads.
+
+    \sa OpenSearchDescription, OpenSearchReader, OpenSearchWriter
 */
 
 /*!
@@ -125,8 +354,18 @@ OpenSearchEngine::OpenSearchEngine(QObject *parent)
     : QObject(parent)
     , d(new OpenSearchEnginePrivate())
 {
-    d->requestMethods.insert(QLatin1String("get"), QNetworkAccessManager::GetOperation);
-    d->requestMethods.insert(QLatin1String("post"), QNetworkAccessManager::PostOperation);
+    registerMetaTypes();
+}
+
+/*!
+    Constructs an engine with a given \a parent, described by \a description.
+*/
+OpenSearchEngine::OpenSearchEngine(const OpenSearchDescription &description, QObject *parent)
+    : QObject(parent)
+    , d(new OpenSearchEnginePrivate())
+{
+    registerMetaTypes();
+    d->openSearchDescription = description;
 }
 
 /*!
@@ -134,28 +373,52 @@ OpenSearchEngine::OpenSearchEngine(QObject *parent)
 */
 OpenSearchEngine::~OpenSearchEngine()
 {
-    if (d->scriptEngine)
-        d->scriptEngine->deleteLater();
+    if (d->requestScheduler) {
+        d->requestScheduler->cancel(d->scheduledSuggestionsTicket);
+        d->requestScheduler->cancel(d->scheduledImageTicket);
+    }
+
+    while (!d->suggestionsRequests.isEmpty())
+        d->dropSuggestionsRequest(this, d->suggestionsRequests.first(), OpenSearchEngineObserver::Aborted);
+
+    abortSearchResults();
+    finishSuggestions();
     delete d;
 }
 
 QString OpenSearchEngine::parseTemplate(const QString &searchTerm, const QString &searchTemplate)
 {
-    QString language = QLocale().name();
-    // Simple conversion to RFC 3066.
-    language = language.replace(QLatin1Char('_'), QLatin1Char('-'));
+    return OpenSearchUrlTemplate(searchTemplate).expand(searchTerm);
+}
+
+/*!
+    Returns the description of the engine, which shares its data with the engine
+    until either of them is modified.
+
+    \sa setOpenSearchDescription()
+*/
+OpenSearchDescription OpenSearchEngine::openSearchDescription() const
+{
+    if (d->imageUrlPending)
+        d->encodeImageUrl();
+
+    return d->openSearchDescription;
+}
+
+/*!
+    Replaces all the data of the engine with \a description. An image set with setImage()
+    is discarded, the image of the new description is loaded when it is requested.
 
-    QString result = searchTemplate;
-    result.replace(QLatin1String("{count}"), QLatin1String("20"));
-    result.replace(QLatin1String("{startIndex}"), QLatin1String("0"));
-    result.replace(QLatin1String("{startPage}"), QLatin1String("0"));
-    result.replace(QLatin1String("{language}"), language);
-    result.replace(QLatin1String("{inputEncoding}"), QLatin1String("UTF-8"));
-    result.replace(QLatin1String("{outputEncoding}"), QLatin1String("UTF-8"));
-    result.replace(QRegExp(QLatin1String("\\{([^\\}]*:|)source\\??\\}")), QCoreApplication::applicationName());
-    result.replace(QLatin1String("{searchTerms}"), QLatin1String(QUrl::toPercentEncoding(searchTerm)));
+    \sa openSearchDescription()
+*/
+void OpenSearchEngine::setOpenSearchDescription(const OpenSearchDescription &description)
+{
+    if (d->openSearchDescription.imageUrl() != description.imageUrl() || d->imageUrlPending) {
+        d->image = QImage();
+        d->imageUrlPending = false;
+    }
 
-    return result;
+    d->openSearchDescription = description;
 }
 
 /*!
@@ -166,12 +429,12 @@ QString OpenSearchEngine::parseTemplate(const QString &searchTerm, const QString
 */
 QString OpenSearchEngine::name() const
 {
-    return d->name;
+    return d->openSearchDescription.name();
 }
 
 void OpenSearchEngine::setName(const QString &name)
 {
-    d->name = name;
+    d->openSearchDescription.setName(name);
 }
 
 /*!
@@ -182,12 +445,12 @@ void OpenSearchEngine::setName(const QString &name)
 */
 QString OpenSearchEngine::description() const
 {
-    return d->description;
+    return d->openSearchDescription.description();
 }
 
 void OpenSearchEngine::setDescription(const QString &description)
 {
-    d->description = description;
+    d->openSearchDescription.setDescription(description);
 }
 
 /*!
@@ -198,12 +461,12 @@ void OpenSearchEngine::setDescription(const QString &description)
 */
 QString OpenSearchEngine::searchUrlTemplate() const
 {
-    return d->searchUrlTemplate;
+    return d->openSearchDescription.searchUrlTemplate();
 }
 
 void OpenSearchEngine::setSearchUrlTemplate(const QString &searchUrlTemplate)
 {
-    d->searchUrlTemplate = searchUrlTemplate;
+    d->openSearchDescription.setSearchUrlTemplate(searchUrlTemplate);
 }
 
 /*!
@@ -217,11 +480,11 @@ void OpenSearchEngine::setSearchUrlTemplate(const QString &searchUrlTemplate)
     \header \o parameter
             \o value
     \row    \o "{count}"
-            \o "20"
+            \o "OpenSearchTemplateContext::count(), 20 by default"
     \row    \o "{startIndex}"
-            \o "0"
+            \o "OpenSearchTemplateContext::startIndex(), 0 by default"
     \row    \o "{startPage}"
-            \o "0"
+            \o "OpenSearchTemplateContext::startPage(), 0 by default"
     \row    \o "{language}"
             \o "the default language code (RFC 3066)"
     \row    \o "{inputEncoding}"
@@ -234,23 +497,16 @@ void OpenSearchEngine::setSearchUrlTemplate(const QString &searchUrlTemplate)
             \o "the string supplied by the user"
     \endtable
 
+    The per-request values are taken from the \a context, the language code and the
+    application name are cached, see OpenSearchTemplateContext.
+
+    To construct many URLs at once, see OpenSearchDescription::encodedSearchUrls().
+
     \sa searchUrlTemplate(), searchParameters(), suggestionsUrl()
 */
-QUrl OpenSearchEngine::searchUrl(const QString &searchTerm) const
+QUrl OpenSearchEngine::searchUrl(const QString &searchTerm, const OpenSearchTemplateContext &context) const
 {
-    if (d->searchUrlTemplate.isEmpty())
-        return QUrl();
-
-    QUrl retVal = QUrl::fromEncoded(parseTemplate(searchTerm, d->searchUrlTemplate).toUtf8());
-
-    if (d->searchMethod != QLatin1String("post")) {
-        Parameters::const_iterator end = d->searchParameters.constEnd();
-        Parameters::const_iterator i = d->searchParameters.constBegin();
-        for (; i != end; ++i)
-            retVal.addQueryItem(i->first, parseTemplate(searchTerm, i->second));
-    }
-
-    return retVal;
+    return d->openSearchDescription.searchUrl(searchTerm, context);
 }
 
 /*!
@@ -259,7 +515,7 @@ QUrl OpenSearchEngine::searchUrl(const QString &searchTerm) const
 */
 bool OpenSearchEngine::providesSuggestions() const
 {
-    return !d->suggestionsUrlTemplate.isEmpty();
+    return d->openSearchDescription.providesSuggestions();
 }
 
 /*!
@@ -270,12 +526,12 @@ bool OpenSearchEngine::providesSuggestions() const
 */
 QString OpenSearchEngine::suggestionsUrlTemplate() const
 {
-    return d->suggestionsUrlTemplate;
+    return d->openSearchDescription.suggestionsUrlTemplate();
 }
 
 void OpenSearchEngine::setSuggestionsUrlTemplate(const QString &suggestionsUrlTemplate)
 {
-    d->suggestionsUrlTemplate = suggestionsUrlTemplate;
+    d->openSearchDescription.setSuggestionsUrlTemplate(suggestionsUrlTemplate);
 }
 
 /*!
@@ -288,21 +544,42 @@ void OpenSearchEngine::setSuggestionsUrlTemplate(const QString &suggestionsUrlTe
 
     \sa suggestionsUrlTemplate(), suggestionsParameters(), searchUrl()
 */
-QUrl OpenSearchEngine::suggestionsUrl(const QString &searchTerm) const
+QUrl OpenSearchEngine::suggestionsUrl(const QString &searchTerm, const OpenSearchTemplateContext &context) const
 {
-    if (d->suggestionsUrlTemplate.isEmpty())
-        return QUrl();
+    return d->openSearchDescription.suggestionsUrl(searchTerm, context);
+}
 
-    QUrl retVal = QUrl::fromEncoded(parseTemplate(searchTerm, d->suggestionsUrlTemplate).toUtf8());
+/*!
+    Returns the MIME types the search results are available in, such as "text/html",
+    "application/rss+xml" or "application/atom+xml".
 
-    if (d->suggestionsMethod != QLatin1String("post")) {
-        Parameters::const_iterator end = d->suggestionsParameters.constEnd();
-        Parameters::const_iterator i = d->suggestionsParameters.constBegin();
-        for (; i != end; ++i)
-            retVal.addQueryItem(i->first, parseTemplate(searchTerm, i->second));
-    }
+    \sa resultsUrl(), OpenSearchDescription::additionalUrls()
+*/
+QStringList OpenSearchEngine::resultTypes() const
+{
+    return d->openSearchDescription.resultTypes();
+}
 
-    return retVal;
+/*!
+    Returns true if the search results are available in the given MIME \a type.
+*/
+bool OpenSearchEngine::providesResults(const QString &type) const
+{
+    return d->openSearchDescription.hasUrl(type);
+}
+
+/*!
+    Constructs the URL of the search results of the given MIME \a type for a given
+    \a searchTerm, e.g. to get machine-readable "application/rss+xml" results instead of
+    the "text/html" ones searchUrl() points to. Returns an invalid URL if the results are
+    not available in this type.
+
+    \sa resultTypes(), searchUrl()
+*/
+QUrl OpenSearchEngine::resultsUrl(const QString &searchTerm, const QString &type,
+                                  const OpenSearchTemplateContext &context) const
+{
+    return d->openSearchDescription.resultsUrl(searchTerm, type, context);
 }
 
 /*!
@@ -314,12 +591,12 @@ QUrl OpenSearchEngine::suggestionsUrl(const QString &searchTerm) const
 */
 OpenSearchEngine::Parameters OpenSearchEngine::searchParameters() const
 {
-    return d->searchParameters;
+    return d->openSearchDescription.searchParameters();
 }
 
 void OpenSearchEngine::setSearchParameters(const Parameters &searchParameters)
 {
-    d->searchParameters = searchParameters;
+    d->openSearchDescription.setSearchParameters(searchParameters);
 }
 
 /*!
@@ -331,12 +608,12 @@ void OpenSearchEngine::setSearchParameters(const Parameters &searchParameters)
 */
 OpenSearchEngine::Parameters OpenSearchEngine::suggestionsParameters() const
 {
-    return d->suggestionsParameters;
+    return d->openSearchDescription.suggestionsParameters();
 }
 
 void OpenSearchEngine::setSuggestionsParameters(const Parameters &suggestionsParameters)
 {
-    d->suggestionsParameters = suggestionsParameters;
+    d->openSearchDescription.setSuggestionsParameters(suggestionsParameters);
 }
 
 /*!
@@ -345,16 +622,12 @@ void OpenSearchEngine::setSuggestionsParameters(const Parameters &suggestionsPar
 */
 QString OpenSearchEngine::searchMethod() const
 {
-    return d->searchMethod;
+    return d->openSearchDescription.searchMethod();
 }
 
 void OpenSearchEngine::setSearchMethod(const QString &method)
 {
-    QString requestMethod = method.toLower();
-    if (!d->requestMethods.contains(requestMethod))
-        return;
-
-    d->searchMethod = requestMethod;
+    d->openSearchDescription.setSearchMethod(method);
 }
 
 /*!
@@ -363,16 +636,139 @@ void OpenSearchEngine::setSearchMethod(const QString &method)
 */
 QString OpenSearchEngine::suggestionsMethod() const
 {
-    return d->suggestionsMethod;
+    return d->openSearchDescription.suggestionsMethod();
 }
 
 void OpenSearchEngine::setSuggestionsMethod(const QString &method)
 {
-    QString requestMethod = method.toLower();
-    if (!d->requestMethods.contains(requestMethod))
-        return;
+    d->openSearchDescription.setSuggestionsMethod(method);
+}
+
+/*!
+    \property suggestionsBatchSize
+    \brief the number of suggestions after which they are delivered before the whole reply arrives
+
+    Suggestion replies are parsed as they arrive from the network. When the property
+    is greater than 0, suggestions() is emitted as soon as that many suggestions have
+    been decoded, and then once again with the complete list when the reply has been
+    received, unless the first batch already contained all of them.
+
+    The default value is 0, which means suggestions are only delivered once the whole
+    reply has been received.
+
+    \sa requestSuggestions(), suggestions()
+*/
+int OpenSearchEngine::suggestionsBatchSize() const
+{
+    return d->suggestionsBatchSize;
+}
+
+void OpenSearchEngine::setSuggestionsBatchSize(int size)
+{
+    d->suggestionsBatchSize = qMax(0, size);
+}
+
+/*!
+    \property maximumSuggestionsRequests
+    \brief the number of suggestions requests that can be running at the same time
+
+    By default, every requestSuggestions() aborts the request that is still running.
+    On high latency links, a user typing steadily might then never see any suggestions.
+
+    When the property is greater than 1, up to that many requests overlap, the oldest
+    one being aborted to make room for a new one. Each request is tagged with a
+    sequence number and suggestions() is only emitted with results newer than the ones
+    emitted last. The replies to the requests sent before those are dropped without
+    being parsed.
+
+    The default value is 1.
+
+    \sa requestSuggestions(), suggestions()
+*/
+int OpenSearchEngine::maximumSuggestionsRequests() const
+{
+    return d->maximumSuggestionsRequests;
+}
+
+void OpenSearchEngine::setMaximumSuggestionsRequests(int count)
+{
+    d->maximumSuggestionsRequests = qMax(1, count);
+}
+
+/*!
+    \property suggestionsDelay
+    \brief the quiet period, in milliseconds, after which suggestions are requested
+
+    When the property is greater than 0, requestSuggestions() does not send a request
+    right away. Instead, it waits until no other request has been made for the given
+    period, and then only requests suggestions for the most recent search term. This
+    avoids sending requests, which would be aborted anyway, while the user is typing.
+
+    The default value is 0, which means suggestions are requested immediately.
+
+    \sa suggestionsMaximumDelay(), requestSuggestions()
+*/
+int OpenSearchEngine::suggestionsDelay() const
+{
+    return d->suggestionsDelay;
+}
+
+void OpenSearchEngine::setSuggestionsDelay(int delay)
+{
+    d->suggestionsDelay = qMax(0, delay);
+}
+
+/*!
+    \property suggestionsMaximumDelay
+    \brief the maximum time, in milliseconds, a suggestions request can be postponed for
+
+    When suggestionsDelay() is set and search terms keep coming in before the quiet
+    period ends, the request for the most recent one is sent once that much time has
+    passed since the first postponed request.
+
+    The default value is 0, which means there is no limit.
+
+    \sa suggestionsDelay(), requestSuggestions()
+*/
+int OpenSearchEngine::suggestionsMaximumDelay() const
+{
+    return d->suggestionsMaximumDelay;
+}
+
+void OpenSearchEngine::setSuggestionsMaximumDelay(int delay)
+{
+    d->suggestionsMaximumDelay = qMax(0, delay);
+}
+
+/*!
+    \property suggestionsWarmInterval
+    \brief the interval, in milliseconds, at which the connection to the suggestions host is kept warm
+
+    When set, after prepareForSuggestions() has been called, a HEAD request to the path
+    of the suggestions URL is sent at this interval until finishSuggestions() is called,
+    so that the server does not close the idle connection while the user pauses typing.
+    Intervals during which a suggestions request has been sent are skipped.
+
+    The default value is 0, which means that the connection is only warmed up once and
+    no periodic request is sent unless asked for.
+
+    \sa prepareForSuggestions()
+*/
+int OpenSearchEngine::suggestionsWarmInterval() const
+{
+    return d->suggestionsWarmInterval;
+}
+
+void OpenSearchEngine::setSuggestionsWarmInterval(int interval)
+{
+    d->suggestionsWarmInterval = qMax(0, interval);
 
-    d->suggestionsMethod = requestMethod;
+    if (d->suggestionsWarmTimer && d->suggestionsWarmTimer->isActive()) {
+        if (d->suggestionsWarmInterval > 0)
+            d->suggestionsWarmTimer->start(d->suggestionsWarmInterval);
+        else
+            d->suggestionsWarmTimer->stop();
+    }
 }
 
 /*!
@@ -380,7 +776,11 @@ void OpenSearchEngine::setSuggestionsMethod(const QString &method)
     \brief the image URL of the engine
 
     When setting a new image URL, it won't be loaded immediately. The first request will be
-    deferred until image() is called for the first time.
+    deferred until image() is called for the first time. Data URLs are decoded in process,
+    without any network requests.
+
+    When the image has been set with setImage(), the data URL holding it is only
+    constructed when the image URL is requested for the first time.
 
     \note To be able to request external images, you need to provide a network access manager,
           which will be used for network operations.
@@ -389,23 +789,89 @@ void OpenSearchEngine::setSuggestionsMethod(const QString &method)
 */
 QString OpenSearchEngine::imageUrl() const
 {
-    return d->imageUrl;
+    if (d->imageUrlPending)
+        d->encodeImageUrl();
+
+    return d->openSearchDescription.imageUrl();
 }
 
 void OpenSearchEngine::setImageUrl(const QString &imageUrl)
 {
-    d->imageUrl = imageUrl;
+    d->imageUrlPending = false;
+    d->openSearchDescription.setImageUrl(imageUrl);
 }
 
 void OpenSearchEngine::loadImage() const
 {
-    if (!d->networkAccessManager || d->imageUrl.isEmpty())
+    QString imageUrl = d->openSearchDescription.imageUrl();
+    if (!d->networkAccessManager || imageUrl.isEmpty())
+        return;
+
+    if (d->imageCache) {
+        connect(d->imageCache, SIGNAL(imageLoaded(QString)),
+                this, SLOT(cachedImageLoaded(QString)), Qt::UniqueConnection);
+        d->imageCache->load(imageUrl, d->networkAccessManager, d->requestPolicies[ImageRequest],
+                            d->requestScheduler);
+        return;
+    }
+
+    if (d->scheduledImageTicket)
         return;
 
-    QNetworkReply *reply = d->networkAccessManager->get(QNetworkRequest(QUrl::fromEncoded(d->imageUrl.toUtf8())));
+    QUrl url = QUrl::fromEncoded(imageUrl.toUtf8());
+    if (d->requestScheduler && !d->requestScheduler->tryAcquire(url)) {
+        OpenSearchEngine *engine = const_cast<OpenSearchEngine*>(this);
+        d->scheduledImageTicket = d->requestScheduler->enqueue(url, engine, "sendScheduledImageRequest");
+        d->scheduledImageUrl = url;
+        return;
+    }
+
+    sendImageRequest();
+}
+
+void OpenSearchEngine::sendImageRequest() const
+{
+    QNetworkRequest request(QUrl::fromEncoded(d->openSearchDescription.imageUrl().toUtf8()));
+    d->requestPolicies[ImageRequest].apply(&request);
+
+    QNetworkReply *reply = d->networkAccessManager->get(request);
+    d->requestPolicies[ImageRequest].watch(reply);
+    if (d->requestScheduler)
+        d->requestScheduler->watch(reply);
     connect(reply, SIGNAL(finished()), this, SLOT(imageObtained()));
 }
 
+void OpenSearchEngine::sendScheduledImageRequest(int ticket)
+{
+    // The slot has been taken for the ticket, it is given back whenever nothing is sent.
+    if (ticket != d->scheduledImageTicket) {
+        if (d->requestScheduler)
+            d->requestScheduler->release(ticket);
+        return;
+    }
+
+    QUrl url = d->scheduledImageUrl;
+    d->scheduledImageTicket = 0;
+    d->scheduledImageUrl.clear();
+
+    // The image may have been set, or its URL changed, while the request was waiting.
+    QString imageUrl = d->openSearchDescription.imageUrl();
+    if (!d->image.isNull() || imageUrl.isEmpty() || !d->networkAccessManager) {
+        d->requestScheduler->release(ticket);
+        return;
+    }
+
+    // A new URL on another host needs a slot of that host.
+    if (OpenSearchRequestScheduler::hostKey(QUrl::fromEncoded(imageUrl.toUtf8()))
+        != OpenSearchRequestScheduler::hostKey(url)) {
+        d->requestScheduler->release(ticket);
+        loadImage();
+        return;
+    }
+
+    sendImageRequest();
+}
+
 void OpenSearchEngine::imageObtained()
 {
     QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
@@ -421,7 +887,39 @@ void OpenSearchEngine::imageObtained()
     if (response.isEmpty())
         return;
 
-    d->image.loadFromData(response);
+    // Decoding large icons would stall the thread of the engine, usually the GUI one.
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    d->imageDecodings.insert(watcher, d->openSearchDescription.imageUrl());
+    connect(watcher, SIGNAL(finished()), this, SLOT(imageDecoded()));
+    watcher->setFuture(QtConcurrent::run(&OpenSearchImageCache::decodeImage, response, d->maximumImageSize));
+}
+
+void OpenSearchEngine::imageDecoded()
+{
+    QFutureWatcher<QImage> *watcher = static_cast<QFutureWatcher<QImage>*>(sender());
+    if (!d->imageDecodings.contains(watcher))
+        return;
+
+    QString url = d->imageDecodings.take(watcher);
+    QImage image = watcher->result();
+    watcher->deleteLater();
+
+    // The image may have been replaced in the meantime.
+    if (image.isNull() || !d->image.isNull() || d->imageUrlPending
+        || url != d->openSearchDescription.imageUrl())
+        return;
+
+    d->image = image;
+    emit imageChanged();
+}
+
+void OpenSearchEngine::cachedImageLoaded(const QString &url)
+{
+    if (!d->imageCache || url != d->openSearchDescription.imageUrl())
+        return;
+
+    disconnect(d->imageCache, SIGNAL(imageLoaded(QString)), this, SLOT(cachedImageLoaded(QString)));
+    d->image = d->imageCache->image(url);
     emit imageChanged();
 }
 
@@ -430,44 +928,78 @@ void OpenSearchEngine::imageObtained()
     \brief the image of the engine
 
     When no image URL has been set and an image will be set explicitly, a new data URL
-    will be constructed, holding the image data encoded with Base64.
+    will be constructed, holding the image data encoded with Base64, once imageUrl()
+    is called.
 
-    \sa imageUrl()
+    If an image cache is set, which is the default, images are shared with all the other
+    engines using the same cache and image URL.
+
+    \sa imageUrl(), imageCache()
 */
 QImage OpenSearchEngine::image() const
 {
-    if (d->image.isNull())
+    if (d->image.isNull() && !d->imageUrlPending) {
+        QString imageUrl = d->openSearchDescription.imageUrl();
+        if (imageUrl.startsWith(QLatin1String("data:"), Qt::CaseInsensitive)) {
+            d->image = OpenSearchEnginePrivate::decodeDataUrl(imageUrl, d->maximumImageSize);
+            return d->image;
+        }
+
+        if (d->imageCache)
+            d->image = d->imageCache->image(imageUrl);
         loadImage();
+    }
     return d->image;
 }
 
 void OpenSearchEngine::setImage(const QImage &image)
 {
-    if (d->imageUrl.isEmpty()) {
-        QBuffer imageBuffer;
-        imageBuffer.open(QBuffer::ReadWrite);
-        if (image.save(&imageBuffer, "PNG")) {
-            d->imageUrl = QString(QLatin1String("data:image/png;base64,%1"))
-                         .arg(QLatin1String(imageBuffer.buffer().toBase64()));
-        }
-    }
+    // Encoding the image is deferred until imageUrl() is called.
+    if (d->openSearchDescription.imageUrl().isEmpty())
+        d->imageUrlPending = true;
 
     d->image = image;
     emit imageChanged();
 }
 
+/*!
+    \property maximumImageSize
+    \brief the maximum size of the image of the engine
+
+    Downloaded images are decoded in the global thread pool and imageChanged() is emitted
+    once they have been decoded. Images larger than this size are scaled down while being
+    decoded, keeping their aspect ratio, so that the full image is not kept in memory.
+    It also applies to data URLs, which are decoded right away.
+
+    The default is an invalid size, which means that images keep their original size.
+
+    \note Images shared through an image cache are scaled according to
+          OpenSearchImageCache::maximumImageSize() instead.
+
+    \sa image(), imageCache()
+*/
+QSize OpenSearchEngine::maximumImageSize() const
+{
+    return d->maximumImageSize;
+}
+
+void OpenSearchEngine::setMaximumImageSize(const QSize &size)
+{
+    d->maximumImageSize = size;
+}
+
 /*!
     \property tags
     \brief a set of words that are used as keywords to identify and categorize this search content
 */
 QStringList OpenSearchEngine::tags() const
 {
-    return d->tags;
+    return d->openSearchDescription.tags();
 }
 
 void OpenSearchEngine::setTags(const QStringList &tags)
 {
-    d->tags = tags;
+    d->openSearchDescription.setTags(tags);
 }
 
 /*!
@@ -476,134 +1008,650 @@ void OpenSearchEngine::setTags(const QStringList &tags)
 */
 bool OpenSearchEngine::isValid() const
 {
-    return (!d->name.isEmpty() && !d->searchUrlTemplate.isEmpty());
+    return d->openSearchDescription.isValid();
+}
+
+/*!
+    Returns the approximate number of bytes held by the engine, including its
+    description and its image, to keep an eye on the footprint of large catalogs.
+
+    \sa OpenSearchDescription::memoryUsage()
+*/
+qint64 OpenSearchEngine::memoryUsage() const
+{
+    qint64 size = sizeof(OpenSearchEngine) + sizeof(OpenSearchEnginePrivate);
+    size += d->openSearchDescription.memoryUsage();
+    size += d->image.byteCount();
+    size += d->suggestionsRequests.count() * (sizeof(void*) + sizeof(OpenSearchSuggestionsRequest));
+    if (d->resultsParser)
+        size += sizeof(OpenSearchResultsParser);
+    return size;
 }
 
 bool OpenSearchEngine::operator==(const OpenSearchEngine &other) const
 {
-    return (d->name == other.d->name
-            && d->description == other.d->description
-            && d->imageUrl == other.d->imageUrl
-            && d->searchUrlTemplate == other.d->searchUrlTemplate
-            && d->suggestionsUrlTemplate == other.d->suggestionsUrlTemplate
-            && d->searchParameters == other.d->searchParameters
-            && d->suggestionsParameters == other.d->suggestionsParameters);
+    return (openSearchDescription() == other.openSearchDescription());
 }
 
 bool OpenSearchEngine::operator<(const OpenSearchEngine &other) const
 {
-    return (d->name < other.d->name);
+    return (name() < other.name());
 }
 
 /*!
-    Requests contextual suggestions on the search engine, for a given \a searchTerm.
+    Prepares the engine for upcoming suggestions requests, e.g. when a search field gains
+    focus: the host of the suggestions URL is resolved and a connection to it is opened
+    through the network access manager, so that the first request does not pay for DNS,
+    TCP and TLS.
 
-    If succeeded, suggestions() signal will be emitted once the suggestions are received.
+    If suggestionsWarmInterval() is set, the connection is kept warm until
+    finishSuggestions() is called.
 
-    \note To be able to request suggestions, you need to provide a network access manager,
-          which will be used for network operations.
+    \note Qt 4 cannot open a connection on its own, a HEAD request to the path of the
+          suggestions URL, without any query, is sent instead.
 
-    \sa requestSearchResults()
+    \sa finishSuggestions(), requestSuggestions()
 */
-void OpenSearchEngine::requestSuggestions(const QString &searchTerm)
+void OpenSearchEngine::prepareForSuggestions()
 {
-    if (searchTerm.isEmpty() || !providesSuggestions())
+    if (!providesSuggestions() || !d->networkAccessManager)
         return;
 
-    Q_ASSERT(d->networkAccessManager);
-
-    if (!d->networkAccessManager)
-        return;
+    if (d->suggestionsHostLookupId == -1 && !d->suggestionsWarmReply) {
+        QString host = suggestionsUrl(QString()).host();
+        if (host.isEmpty())
+            return;
 
-    if (d->suggestionsReply) {
-        d->suggestionsReply->disconnect(this);
-        d->suggestionsReply->abort();
-        d->suggestionsReply->deleteLater();
-        d->suggestionsReply = 0;
+        d->suggestionsHostLookupId = QHostInfo::lookupHost(host, this, SLOT(suggestionsHostFound(QHostInfo)));
     }
 
-    Q_ASSERT(d->requestMethods.contains(d->suggestionsMethod));
-    if (d->suggestionsMethod == QLatin1String("get")) {
-        d->suggestionsReply = d->networkAccessManager->get(QNetworkRequest(suggestionsUrl(searchTerm)));
-    } else {
-        QStringList parameters;
-        Parameters::const_iterator end = d->suggestionsParameters.constEnd();
-        Parameters::const_iterator i = d->suggestionsParameters.constBegin();
-        for (; i != end; ++i)
-            parameters.append(i->first + QLatin1String("=") + parseTemplate(searchTerm, i->second));
+    if (d->suggestionsWarmInterval <= 0)
+        return;
 
-        QByteArray data = parameters.join(QLatin1String("&")).toUtf8();
-        d->suggestionsReply = d->networkAccessManager->post(QNetworkRequest(suggestionsUrl(searchTerm)), data);
+    if (!d->suggestionsWarmTimer) {
+        d->suggestionsWarmTimer = new QTimer(this);
+        connect(d->suggestionsWarmTimer, SIGNAL(timeout()), this, SLOT(keepSuggestionsConnectionWarm()));
     }
 
-    connect(d->suggestionsReply, SIGNAL(finished()), this, SLOT(suggestionsObtained()));
+    d->suggestionsRequested = false;
+    if (!d->suggestionsWarmTimer->isActive())
+        d->suggestionsWarmTimer->start(d->suggestionsWarmInterval);
 }
 
 /*!
-    Requests search results on the search engine, for a given \a searchTerm.
-
-    The default implementation does nothing, to supply your own you need to create your own
-    OpenSearchEngineDelegate subclass and supply it to the engine. Then the function will call
-    the performSearchRequest() method of the delegate, which can then handle the request
-    in a custom way.
+    Stops keeping the connection to the suggestions host warm, e.g. when a search field
+    loses focus.
 
-    \sa requestSuggestions(), delegate()
+    \sa prepareForSuggestions()
 */
-void OpenSearchEngine::requestSearchResults(const QString &searchTerm)
+void OpenSearchEngine::finishSuggestions()
 {
-    if (!d->delegate || searchTerm.isEmpty())
-        return;
-
-    Q_ASSERT(d->requestMethods.contains(d->searchMethod));
-
-    QNetworkRequest request(QUrl(searchUrl(searchTerm)));
-    QByteArray data;
-    QNetworkAccessManager::Operation operation = d->requestMethods.value(d->searchMethod);
-
-    if (operation == QNetworkAccessManager::PostOperation) {
-        QStringList parameters;
-        Parameters::const_iterator end = d->searchParameters.constEnd();
-        Parameters::const_iterator i = d->searchParameters.constBegin();
-        for (; i != end; ++i)
-            parameters.append(i->first + QLatin1String("=") + parseTemplate(searchTerm, i->second));
+    if (d->suggestionsWarmTimer)
+        d->suggestionsWarmTimer->stop();
 
-        data = parameters.join(QLatin1String("&")).toUtf8();
+    if (d->suggestionsHostLookupId != -1) {
+        QHostInfo::abortHostLookup(d->suggestionsHostLookupId);
+        d->suggestionsHostLookupId = -1;
     }
 
-    d->delegate->performSearchRequest(request, operation, data);
+    if (d->suggestionsWarmReply) {
+        d->suggestionsWarmReply->disconnect(this);
+        d->suggestionsWarmReply->abort();
+        d->suggestionsWarmReply->deleteLater();
+        d->suggestionsWarmReply = 0;
+    }
 }
 
-void OpenSearchEngine::suggestionsObtained()
+void OpenSearchEngine::suggestionsHostFound(const QHostInfo &info)
 {
-    QString response(QString::fromUtf8(d->suggestionsReply->readAll()));
-    response = response.trimmed();
+    if (info.lookupId() != d->suggestionsHostLookupId)
+        return;
 
-    d->suggestionsReply->close();
-    d->suggestionsReply->deleteLater();
-    d->suggestionsReply = 0;
+    d->suggestionsHostLookupId = -1;
 
-    if (response.isEmpty())
+    if (info.error() != QHostInfo::NoError || !providesSuggestions() || !d->networkAccessManager)
         return;
 
-    if (!response.startsWith(QLatin1Char('[')) || !response.endsWith(QLatin1Char(']')))
+    warmSuggestionsConnection();
+}
+
+void OpenSearchEngine::warmSuggestionsConnection()
+{
+    if (d->suggestionsWarmReply)
         return;
 
-    if (!d->scriptEngine)
-        d->scriptEngine = new QScriptEngine();
+    // The suggestions endpoint itself, the root of the host may be served elsewhere
+    // or not be meant to be requested at all.
+    QUrl suggestionsUrl = this->suggestionsUrl(QString());
+    QUrl url;
+    url.setScheme(suggestionsUrl.scheme());
+    url.setHost(suggestionsUrl.host());
+    url.setPort(suggestionsUrl.port());
+    url.setPath(suggestionsUrl.path().isEmpty() ? QString(QLatin1String("/")) : suggestionsUrl.path());
+
+    OpenSearchRequestPolicy policy = d->requestPolicies[SuggestionsRequest];
+    policy.setKeepAlive(true);
+
+    QNetworkRequest request(url);
+    policy.apply(&request);
+
+    d->suggestionsWarmReply = d->networkAccessManager->head(request);
+    policy.watch(d->suggestionsWarmReply);
+    connect(d->suggestionsWarmReply, SIGNAL(finished()), this, SLOT(suggestionsConnectionWarmed()));
+}
 
-    // Evaluate the JSON response using QtScript.
-    if (!d->scriptEngine->canEvaluate(response))
+void OpenSearchEngine::suggestionsConnectionWarmed()
+{
+    if (!d->suggestionsWarmReply)
         return;
 
-    QScriptValue responseParts = d->scriptEngine->evaluate(response);
+    d->suggestionsWarmReply->close();
+    d->suggestionsWarmReply->deleteLater();
+    d->suggestionsWarmReply = 0;
+}
+
+void OpenSearchEngine::keepSuggestionsConnectionWarm()
+{
+    bool requested = d->suggestionsRequested;
+    d->suggestionsRequested = false;
+
+    if (requested || !providesSuggestions() || !d->networkAccessManager)
+        return;
+
+    warmSuggestionsConnection();
+}
+
+/*!
+    Requests contextual suggestions on the search engine, for a given \a searchTerm.
+
+    If succeeded, suggestions() signal will be emitted once the suggestions are received.
+
+    If suggestionsDelay() is set, the request is postponed and coalesced with the
+    following ones, so that only the most recent search term is sent.
 
-    if (!responseParts.property(1).isArray())
+    \note To be able to request suggestions, you need to provide a network access manager,
+          which will be used for network operations.
+
+    \sa requestSearchResults(), suggestionsDelay()
+*/
+void OpenSearchEngine::requestSuggestions(const QString &searchTerm)
+{
+    if (searchTerm.isEmpty() || !providesSuggestions())
         return;
 
-    QStringList suggestionsList;
-    qScriptValueToSequence(responseParts.property(1), suggestionsList);
+    Q_ASSERT(d->networkAccessManager || d->suggestionsIndex);
+
+    if (d->suggestionsCache) {
+        QStringList cachedSuggestions;
+        if (d->suggestionsCache->lookup(d->suggestionsCacheKey(), searchTerm, &cachedSuggestions)) {
+            abortSuggestionsRequest();
+
+            OpenSearchSuggestionsRequest cached;
+            cached.statistics.searchTerm = searchTerm;
+            cached.statistics.resultCount = cachedSuggestions.count();
+            d->reportSuggestionsRequest(this, &cached, OpenSearchEngineObserver::Cached);
+
+            QMetaObject::invokeMethod(this, "deliverSuggestions", Qt::QueuedConnection,
+                                      Q_ARG(QString, searchTerm),
+                                      Q_ARG(QStringList, cachedSuggestions),
+                                      Q_ARG(int, ++d->suggestionsSequence));
+            QMetaObject::invokeMethod(this, "suggestionsFinished", Qt::QueuedConnection,
+                                      Q_ARG(QString, searchTerm), Q_ARG(bool, true));
+            return;
+        }
+    }
+
+    // The local index answers right away, the received suggestions are merged in later.
+    QStringList indexedSuggestions;
+    if (d->suggestionsIndex) {
+        indexedSuggestions = d->suggestionsIndex->lookup(searchTerm);
+        if (!indexedSuggestions.isEmpty()) {
+            QMetaObject::invokeMethod(this, "deliverSuggestions", Qt::QueuedConnection,
+                                      Q_ARG(QString, searchTerm),
+                                      Q_ARG(QStringList, indexedSuggestions),
+                                      Q_ARG(int, ++d->suggestionsSequence));
+        }
+    }
+
+    if (!d->networkAccessManager) {
+        QMetaObject::invokeMethod(this, "suggestionsFinished", Qt::QueuedConnection,
+                                  Q_ARG(QString, searchTerm), Q_ARG(bool, !indexedSuggestions.isEmpty()));
+        return;
+    }
+
+    if (d->suggestionsDelay <= 0) {
+        sendSuggestionsRequest(searchTerm);
+        return;
+    }
+
+    if (!d->suggestionsTimer) {
+        d->suggestionsTimer = new QTimer(this);
+        d->suggestionsTimer->setSingleShot(true);
+        connect(d->suggestionsTimer, SIGNAL(timeout()), this, SLOT(sendPendingSuggestionsRequest()));
+    }
+
+    if (!d->suggestionsTimer->isActive())
+        d->suggestionsPendingSince.start();
+
+    int delay = d->suggestionsDelay;
+    if (d->suggestionsMaximumDelay > 0)
+        delay = qBound(0, d->suggestionsMaximumDelay - d->suggestionsPendingSince.elapsed(), delay);
+
+    d->pendingSuggestionsTerm = searchTerm;
+    d->suggestionsTimer->start(delay);
+}
+
+void OpenSearchEngine::sendPendingSuggestionsRequest()
+{
+    QString searchTerm = d->pendingSuggestionsTerm;
+    d->pendingSuggestionsTerm.clear();
+
+    if (searchTerm.isEmpty() || !providesSuggestions() || !d->networkAccessManager) {
+        if (!searchTerm.isEmpty())
+            emit suggestionsFinished(searchTerm, false);
+        return;
+    }
+
+    sendSuggestionsRequest(searchTerm);
+}
+
+void OpenSearchEngine::deliverSuggestions(const QString &searchTerm, const QStringList &suggestionsList,
+                                          int sequence)
+{
+    // Results older than the ones already shown would replace newer ones.
+    if (sequence < d->deliveredSuggestionsSequence)
+        return;
+
+    d->deliveredSuggestionsSequence = sequence;
+
+    // The requests sent before are stale now, there is no point in parsing their replies.
+    while (!d->suggestionsRequests.isEmpty() && d->suggestionsRequests.first()->sequence < sequence)
+        d->dropSuggestionsRequest(this, d->suggestionsRequests.first(), OpenSearchEngineObserver::Superseded);
 
     emit suggestions(suggestionsList);
+    emit suggestions(searchTerm, suggestionsList);
+}
+
+void OpenSearchEngine::sendScheduledSuggestionsRequest(int ticket)
+{
+    if (ticket != d->scheduledSuggestionsTicket) {
+        if (d->requestScheduler)
+            d->requestScheduler->release(ticket);
+        return;
+    }
+
+    QString searchTerm = d->scheduledSuggestionsTerm;
+    QUrl url = d->scheduledSuggestionsUrl;
+    d->scheduledSuggestionsTicket = 0;
+    d->scheduledSuggestionsTerm.clear();
+    d->scheduledSuggestionsUrl.clear();
+
+    if (searchTerm.isEmpty() || !providesSuggestions() || !d->networkAccessManager) {
+        d->requestScheduler->release(ticket);
+        if (!searchTerm.isEmpty())
+            emit suggestionsFinished(searchTerm, false);
+        return;
+    }
+
+    // The slot belongs to the host the request has been queued for. If the template has
+    // moved to another host meanwhile, the request asks that host for a slot of its own.
+    if (OpenSearchRequestScheduler::hostKey(suggestionsUrl(searchTerm))
+        != OpenSearchRequestScheduler::hostKey(url)) {
+        d->requestScheduler->release(ticket);
+        sendSuggestionsRequest(searchTerm);
+        return;
+    }
+
+    sendSuggestionsRequest(searchTerm, true);
+}
+
+void OpenSearchEngine::abortSuggestionsRequest()
+{
+    if (d->suggestionsTimer)
+        d->suggestionsTimer->stop();
+    d->pendingSuggestionsTerm.clear();
+
+    if (d->scheduledSuggestionsTicket && d->requestScheduler)
+        d->requestScheduler->cancel(d->scheduledSuggestionsTicket);
+    d->scheduledSuggestionsTicket = 0;
+    d->scheduledSuggestionsTerm.clear();
+    d->scheduledSuggestionsUrl.clear();
+
+    while (!d->suggestionsRequests.isEmpty())
+        d->dropSuggestionsRequest(this, d->suggestionsRequests.first(), OpenSearchEngineObserver::Superseded);
+}
+
+void OpenSearchEngine::sendSuggestionsRequest(const QString &searchTerm, bool scheduled)
+{
+    if (d->suggestionsTimer)
+        d->suggestionsTimer->stop();
+    d->pendingSuggestionsTerm.clear();
+
+    QUrl url = suggestionsUrl(searchTerm);
+
+    // Over the budget of the host, only the latest term waits for its turn, the cache
+    // and the index have already answered.
+    if (d->requestScheduler && !scheduled && !d->requestScheduler->tryAcquire(url)) {
+        if (!d->scheduledSuggestionsTicket) {
+            d->scheduledSuggestionsTicket = d->requestScheduler->enqueue(url, this, "sendScheduledSuggestionsRequest");
+            d->scheduledSuggestionsUrl = url;
+        }
+
+        if (d->scheduledSuggestionsTicket) {
+            d->scheduledSuggestionsTerm = searchTerm;
+        } else {
+            OpenSearchSuggestionsRequest throttled;
+            throttled.statistics.searchTerm = searchTerm;
+            throttled.clock.start();
+            d->reportSuggestionsRequest(this, &throttled, OpenSearchEngineObserver::Throttled);
+
+            // Queued like the answers of the cache and the index, which may still be on their way.
+            QMetaObject::invokeMethod(this, "suggestionsFinished", Qt::QueuedConnection,
+                                      Q_ARG(QString, searchTerm), Q_ARG(bool, false));
+        }
+        return;
+    }
+
+    // Make room for the new request, the oldest ones are the least likely to be shown.
+    while (d->suggestionsRequests.count() >= d->maximumSuggestionsRequests)
+        d->dropSuggestionsRequest(this, d->suggestionsRequests.first(), OpenSearchEngineObserver::Superseded);
+
+    OpenSearchSuggestionsRequest *suggestionsRequest = new OpenSearchSuggestionsRequest;
+    OpenSearchEngineObserver::SuggestionsStatistics &statistics = suggestionsRequest->statistics;
+    statistics.searchTerm = searchTerm;
+    suggestionsRequest->clock.start();
+
+    QNetworkRequest request(url);
+    d->requestPolicies[SuggestionsRequest].apply(&request);
+    if (d->openSearchDescription.suggestionsRequestMethod() == OpenSearchDescription::GetMethod) {
+        statistics.expansionTime = OpenSearchEnginePrivate::elapsedMicroseconds(suggestionsRequest->clock);
+        suggestionsRequest->reply = d->networkAccessManager->get(request);
+    } else {
+        QByteArray data = d->openSearchDescription.suggestionsPostData(searchTerm);
+        statistics.expansionTime = OpenSearchEnginePrivate::elapsedMicroseconds(suggestionsRequest->clock);
+        suggestionsRequest->reply = d->networkAccessManager->post(request, data);
+    }
+    d->requestPolicies[SuggestionsRequest].watch(suggestionsRequest->reply);
+    if (d->requestScheduler)
+        d->requestScheduler->watch(suggestionsRequest->reply);
+
+    suggestionsRequest->searchTerm = searchTerm;
+    suggestionsRequest->sequence = ++d->suggestionsSequence;
+    suggestionsRequest->parser = OpenSearchSuggestionsParser::acquire();
+    d->suggestionsRequests.append(suggestionsRequest);
+    d->suggestionsRequested = true;
+
+    connect(suggestionsRequest->reply, SIGNAL(readyRead()), this, SLOT(suggestionsDataAvailable()));
+    connect(suggestionsRequest->reply, SIGNAL(finished()), this, SLOT(suggestionsObtained()));
+}
+
+/*!
+    Requests search results on the search engine, for a given \a searchTerm. The \a context
+    selects the page of results.
+
+    The default implementation does nothing, to supply your own you need to create your own
+    OpenSearchEngineDelegate subclass and supply it to the engine. Then the function will call
+    the performSearchRequest() method of the delegate, which can then handle the request
+    in a custom way.
+
+    \sa requestSuggestions(), delegate()
+*/
+void OpenSearchEngine::requestSearchResults(const QString &searchTerm, const OpenSearchTemplateContext &context)
+{
+    if (!d->delegate || searchTerm.isEmpty())
+        return;
+
+    QNetworkRequest request(searchUrl(searchTerm, context));
+    d->requestPolicies[SearchRequest].apply(&request);
+    QByteArray data;
+    QNetworkAccessManager::Operation operation = requestOperations[d->openSearchDescription.searchRequestMethod()];
+
+    if (operation == QNetworkAccessManager::PostOperation)
+        data = d->openSearchDescription.searchPostData(searchTerm, context);
+
+    d->delegate->performSearchRequest(request, operation, data);
+}
+
+/*!
+    Fetches the search results for a given \a searchTerm, using the built-in pipeline
+    instead of the delegate. The \a context selects the page of results, through the
+    {count} and {startIndex} template parameters.
+
+    The results are requested in the given MIME \a type, which has to be one of
+    resultTypes() in the RSS or Atom format. By default, "application/atom+xml" is
+    preferred over "application/rss+xml". Nothing is requested if neither is provided.
+
+    The reply is parsed while it is being received and searchResults() is emitted with
+    every batch of results as soon as they have been parsed. searchResultsFinished() is
+    emitted at the end, after which searchResultsTotal() tells how many results there
+    are in total. A results request that is still running is aborted, without any
+    further signals.
+
+    \sa abortSearchResults(), requestSearchResults(), OpenSearchResultsParser
+*/
+void OpenSearchEngine::fetchSearchResults(const QString &searchTerm, const OpenSearchTemplateContext &context,
+                                          const QString &type)
+{
+    abortSearchResults();
+
+    if (!d->networkAccessManager || searchTerm.isEmpty())
+        return;
+
+    QString resultsType = type;
+    if (resultsType.isEmpty()) {
+        if (providesResults(QLatin1String("application/atom+xml")))
+            resultsType = QLatin1String("application/atom+xml");
+        else
+            resultsType = QLatin1String("application/rss+xml");
+    }
+
+    OpenSearchDescription::Url url = d->openSearchDescription.url(resultsType);
+    if (url.urlTemplate.isEmpty())
+        return;
+
+    QNetworkRequest request(d->openSearchDescription.resultsUrl(searchTerm, resultsType, context));
+    request.setRawHeader("Accept", resultsType.toLatin1());
+    d->requestPolicies[SearchRequest].apply(&request);
+
+    if (url.method == QLatin1String("post")) {
+        QByteArray data = d->openSearchDescription.resultsPostData(searchTerm, resultsType, context);
+        request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("application/x-www-form-urlencoded"));
+        d->resultsReply = d->networkAccessManager->post(request, data);
+    } else {
+        d->resultsReply = d->networkAccessManager->get(request);
+    }
+    d->requestPolicies[SearchRequest].watch(d->resultsReply);
+
+    // Parsers are only allocated while fetching, engines mostly sit idle in large catalogs.
+    d->resultsParser = new OpenSearchResultsParser;
+    d->resultsTotal = -1;
+
+    connect(d->resultsReply, SIGNAL(readyRead()), this, SLOT(searchResultsDataAvailable()));
+    connect(d->resultsReply, SIGNAL(finished()), this, SLOT(searchResultsObtained()));
+}
+
+/*!
+    Aborts the search results request started with fetchSearchResults(), if any.
+    No signals are emitted for it anymore.
+*/
+void OpenSearchEngine::abortSearchResults()
+{
+    if (!d->resultsReply)
+        return;
+
+    d->resultsReply->disconnect(this);
+    d->resultsReply->abort();
+    d->resultsReply->deleteLater();
+    d->resultsReply = 0;
+
+    delete d->resultsParser;
+    d->resultsParser = 0;
+}
+
+/*!
+    Returns true if a search results request started with fetchSearchResults()
+    is running.
+*/
+bool OpenSearchEngine::isFetchingSearchResults() const
+{
+    return (d->resultsReply != 0);
+}
+
+/*!
+    Returns the total number of results reported by the last response to
+    fetchSearchResults(), or -1 if it is unknown.
+*/
+int OpenSearchEngine::searchResultsTotal() const
+{
+    return d->resultsTotal;
+}
+
+void OpenSearchEngine::searchResultsDataAvailable()
+{
+    QNetworkReply *reply = d->resultsReply;
+    if (!reply || d->resultsParser->hasError())
+        return;
+
+    char buffer[4096];
+    qint64 size;
+    while ((size = reply->read(buffer, sizeof(buffer))) > 0) {
+        if (!d->resultsParser->addData(buffer, int(size)))
+            break;
+    }
+
+    if (!d->resultsParser->hasResults())
+        return;
+
+    d->resultsTotal = d->resultsParser->totalResults();
+    emit searchResults(d->resultsParser->takeResults());
+}
+
+void OpenSearchEngine::searchResultsObtained()
+{
+    QNetworkReply *reply = d->resultsReply;
+    searchResultsDataAvailable();
+
+    // A slot connected to searchResults() may have started another request.
+    if (!reply || reply != d->resultsReply)
+        return;
+
+    bool ok = (reply->error() == QNetworkReply::NoError && d->resultsParser->finish());
+
+    reply->close();
+    reply->deleteLater();
+    d->resultsReply = 0;
+
+    d->resultsTotal = d->resultsParser->totalResults();
+    delete d->resultsParser;
+    d->resultsParser = 0;
+
+    emit searchResultsFinished(ok);
+}
+
+void OpenSearchEngine::suggestionsDataAvailable()
+{
+    OpenSearchSuggestionsRequest *request = d->suggestionsRequest(sender());
+    if (!request)
+        return;
+
+    // A reply overtaken by a newer one is not worth parsing.
+    if (request->sequence < d->deliveredSuggestionsSequence) {
+        d->dropSuggestionsRequest(this, request, OpenSearchEngineObserver::Superseded);
+        return;
+    }
+
+    readSuggestions(request);
+}
+
+void OpenSearchEngine::readSuggestions(OpenSearchSuggestionsRequest *request)
+{
+    if (request->parser->hasError())
+        return;
+
+    OpenSearchEngineObserver::SuggestionsStatistics &statistics = request->statistics;
+    QElapsedTimer parseClock;
+
+    char buffer[4096];
+    qint64 size;
+    while ((size = request->reply->read(buffer, sizeof(buffer))) > 0) {
+        if (statistics.timeToFirstByte < 0)
+            statistics.timeToFirstByte = OpenSearchEnginePrivate::elapsedMicroseconds(request->clock);
+        statistics.bytesReceived += size;
+
+        parseClock.start();
+        bool ok = request->parser->addData(buffer, int(size));
+        statistics.parseTime += OpenSearchEnginePrivate::elapsedMicroseconds(parseClock);
+
+        if (!ok)
+            return;
+    }
+
+    if (d->suggestionsBatchSize <= 0 || request->emitted != -1)
+        return;
+
+    QStringList suggestionsList = request->parser->suggestions();
+    if (suggestionsList.count() < d->suggestionsBatchSize)
+        return;
+
+    // A slot connected to suggestions() may drop the request.
+    request->emitted = suggestionsList.count();
+    deliverSuggestions(QString(request->searchTerm), d->indexedSuggestions(request->searchTerm, suggestionsList),
+                       request->sequence);
+}
+
+void OpenSearchEngine::suggestionsObtained()
+{
+    OpenSearchSuggestionsRequest *request = d->suggestionsRequest(sender());
+    if (!request)
+        return;
+
+    if (request->sequence < d->deliveredSuggestionsSequence) {
+        d->dropSuggestionsRequest(this, request, OpenSearchEngineObserver::Superseded);
+        return;
+    }
+
+    // Taken off the list first, so that a slot connected to suggestions() cannot drop it.
+    d->suggestionsRequests.removeOne(request);
+    readSuggestions(request);
+
+    bool canceled = (request->reply->error() == QNetworkReply::OperationCanceledError);
+    request->statistics.transferTime = OpenSearchEnginePrivate::elapsedMicroseconds(request->clock);
+
+    request->reply->close();
+    request->reply->deleteLater();
+
+    QElapsedTimer parseClock;
+    parseClock.start();
+    bool ok = request->parser->finish();
+    request->statistics.parseTime += OpenSearchEnginePrivate::elapsedMicroseconds(parseClock);
+
+    // The parser goes back to the context of the thread, where the other engines can use it.
+    QStringList suggestionsList = request->parser->suggestions();
+    OpenSearchSuggestionsParser::release(request->parser);
+
+    QString searchTerm = request->searchTerm;
+    int sequence = request->sequence;
+    bool emitted = (request->emitted == suggestionsList.count());
+
+    if (ok) {
+        if (d->suggestionsCache)
+            d->suggestionsCache->insert(d->suggestionsCacheKey(), searchTerm, suggestionsList);
+        if (d->suggestionsIndex)
+            d->suggestionsIndex->insert(suggestionsList);
+
+        request->statistics.resultCount = suggestionsList.count();
+        d->reportSuggestionsRequest(this, request, OpenSearchEngineObserver::Finished);
+    } else {
+        d->reportSuggestionsRequest(this, request, canceled ? OpenSearchEngineObserver::Aborted
+                                                            : OpenSearchEngineObserver::Failed);
+    }
+
+    delete request;
+
+    if (ok && !emitted)
+        deliverSuggestions(searchTerm, d->indexedSuggestions(searchTerm, suggestionsList), sequence);
+
+    emit suggestionsFinished(searchTerm, ok);
 }
 
 /*!
@@ -640,6 +1688,178 @@ void OpenSearchEngine::setDelegate(OpenSearchEngineDelegate *delegate)
     d->delegate = delegate;
 }
 
+/*!
+    \property observer
+    \brief the observer that is notified about the requests of the engine
+
+    The observer receives the measurements of every suggestions request. By default,
+    there is no observer.
+
+    \sa OpenSearchEngineObserver
+*/
+OpenSearchEngineObserver *OpenSearchEngine::observer() const
+{
+    return d->observer;
+}
+
+void OpenSearchEngine::setObserver(OpenSearchEngineObserver *observer)
+{
+    d->observer = observer;
+}
+
+/*!
+    \enum OpenSearchEngine::RequestType
+
+    This enum describes the kinds of requests created by the engine.
+
+    \value SearchRequest The search request handed to the delegate by requestSearchResults().
+    \value SuggestionsRequest The requests sent by requestSuggestions().
+    \value ImageRequest The requests downloading image().
+*/
+
+/*!
+    Returns the policy applied to the requests of the given \a type.
+
+    By default, suggestions requests have a high priority, image requests a low one
+    and search requests a normal one. All of them allow pipelining, ask for the
+    connection to be kept alive and do not time out.
+
+    \sa OpenSearchRequestPolicy
+*/
+OpenSearchRequestPolicy OpenSearchEngine::requestPolicy(RequestType type) const
+{
+    return d->requestPolicies[type];
+}
+
+/*!
+    Sets the \a policy applied to the requests of the given \a type.
+
+    \note The timeout does not apply to search requests, which are performed by the delegate.
+*/
+void OpenSearchEngine::setRequestPolicy(RequestType type, const OpenSearchRequestPolicy &policy)
+{
+    d->requestPolicies[type] = policy;
+}
+
+/*!
+    \property suggestionsCache
+    \brief the cache that is used to answer repeated suggestion queries
+
+    When a cache is set, requestSuggestions() looks the search term up in it first.
+    On a hit, suggestions() is emitted on the next turn of the event loop and no
+    network request is made. Received suggestions are stored in the cache.
+
+    The cache is not owned by the engine, it can be shared by multiple engines.
+    By default, no cache is used.
+
+    \sa OpenSearchSuggestionsCache
+*/
+OpenSearchSuggestionsCache *OpenSearchEngine::suggestionsCache() const
+{
+    return d->suggestionsCache;
+}
+
+void OpenSearchEngine::setSuggestionsCache(OpenSearchSuggestionsCache *cache)
+{
+    d->suggestionsCache = cache;
+}
+
+/*!
+    \property suggestionsIndex
+    \brief the local index that answers suggestion queries before the network
+
+    When an index is set, requestSuggestions() emits suggestions() with the matching
+    indexed terms on the next turn of the event loop, if there are any, and the
+    suggestions received later are emitted with the indexed terms they do not contain
+    appended. The answer of the index is provisional: suggestionsFinished() is only
+    emitted after the received suggestions, which is what OpenSearchEngineManager waits
+    for. Without a network access manager, only the index is used. Received suggestions
+    are added to the index.
+
+    The index is not owned by the engine, it can be shared by multiple engines.
+    By default, no index is used.
+
+    \sa OpenSearchSuggestionsIndex
+*/
+OpenSearchSuggestionsIndex *OpenSearchEngine::suggestionsIndex() const
+{
+    return d->suggestionsIndex;
+}
+
+void OpenSearchEngine::setSuggestionsIndex(OpenSearchSuggestionsIndex *index)
+{
+    d->suggestionsIndex = index;
+}
+
+/*!
+    \property imageCache
+    \brief the cache that is used to load and share images of engines
+
+    By default, the process-wide OpenSearchImageCache::instance() is used. When set to 0,
+    the engine downloads its image on its own.
+
+    The cache is not owned by the engine.
+
+    \sa image(), OpenSearchImageCache
+*/
+OpenSearchImageCache *OpenSearchEngine::imageCache() const
+{
+    return d->imageCache;
+}
+
+void OpenSearchEngine::setImageCache(OpenSearchImageCache *cache)
+{
+    if (d->imageCache)
+        disconnect(d->imageCache, SIGNAL(imageLoaded(QString)), this, SLOT(cachedImageLoaded(QString)));
+
+    d->imageCache = cache;
+}
+
+/*!
+    \property requestScheduler
+    \brief the scheduler that limits the requests sent to the host of the engine
+
+    When a scheduler is set, suggestions and image requests take a slot from it before
+    they are sent. If the host is over its budget, the request for the most recent search
+    term waits in the queue of the scheduler until it is its turn, replacing the term
+    waiting before, if any. When the queue is full, the request is dropped and reported
+    to the observer as OpenSearchEngineObserver::Throttled; the suggestions cache and
+    the index still answer it. Search results requests are not limited.
+
+    The scheduler is not owned by the engine, it is meant to be shared by all the engines
+    using the same hosts. By default, no scheduler is used.
+
+    \sa OpenSearchRequestScheduler
+*/
+OpenSearchRequestScheduler *OpenSearchEngine::requestScheduler() const
+{
+    return d->requestScheduler;
+}
+
+void OpenSearchEngine::setRequestScheduler(OpenSearchRequestScheduler *scheduler)
+{
+    if (d->requestScheduler == scheduler)
+        return;
+
+    if (d->requestScheduler) {
+        d->requestScheduler->cancel(d->scheduledSuggestionsTicket);
+        d->requestScheduler->cancel(d->scheduledImageTicket);
+    }
+
+    // The waiting term is sent right away if the new scheduler allows it.
+    QString searchTerm = d->scheduledSuggestionsTerm;
+    d->scheduledSuggestionsTicket = 0;
+    d->scheduledSuggestionsTerm.clear();
+    d->scheduledSuggestionsUrl.clear();
+    d->scheduledImageTicket = 0;
+    d->scheduledImageUrl.clear();
+
+    d->requestScheduler = scheduler;
+
+    if (!searchTerm.isEmpty() && d->networkAccessManager && providesSuggestions())
+        sendSuggestionsRequest(searchTerm);
+}
+
 /*!
     \fn void OpenSearchEngine::imageChanged()
 
@@ -655,5 +1875,33 @@ void OpenSearchEngine::setDelegate(OpenSearchEngineDelegate *delegate)
     by the search engine. To request suggestions, use requestSuggestions().
     The suggestion set is specified by \a suggestions.
 
-    \sa requestSuggestions()
+    If suggestionsBatchSize is set, the signal can be emitted twice for one request,
+    first with a partial set and then with the complete one.
+
+    \sa requestSuggestions(), suggestionsBatchSize()
+*/
+
+/*!
+    \fn void OpenSearchEngine::suggestions(const QString &searchTerm, const QStringList &suggestions)
+    \overload
+
+    This signal is emitted together with the one above, with the \a searchTerm the
+    \a suggestions have been requested for. With maximumSuggestionsRequests set, they
+    may answer a term the user has typed before the current one.
+
+    \sa maximumSuggestionsRequests()
+*/
+
+/*!
+    \fn void OpenSearchEngine::suggestionsFinished(const QString &searchTerm, bool success)
+
+    This signal is emitted once the request for \a searchTerm has ended, after the last
+    suggestions() for it. \a success is false if the reply has failed or could not be
+    parsed, or if the request has been throttled, see requestScheduler(). Until then,
+    suggestions() may be emitted again with a more complete set, e.g. the received
+    suggestions after the ones of the index, or after a batch.
+
+    Requests replaced by a newer one, usually for a newer term, end without this signal.
+
+    \sa requestSuggestions(), suggestionsBatchSize()
 */
@@ -20,6 +20,7 @@
 #ifndef OPENSEARCHENGINE_H
 #define OPENSEARCHENGINE_H
 
+#include <qhostinfo.h>
 #include <qpair.h>
 #include <qimage.h>
 #include <qmap.h>
@@ -27,11 +28,20 @@
 #include <qstringlist.h>
 #include <qurl.h>
 
+#include "opensearchdescription.h"
+#include "opensearchrequestpolicy.h"
+#include "opensearchresultsparser.h"
+
 class QNetworkAccessManager;
 class QNetworkReply;
-class QScriptEngine;
 
 class OpenSearchEngineDelegate;
+class OpenSearchEngineObserver;
+class OpenSearchImageCache;
+class OpenSearchRequestScheduler;
+class OpenSearchSuggestionsCache;
+class OpenSearchSuggestionsIndex;
+struct OpenSearchSuggestionsRequest;
 class OpenSearchEnginePrivate;
 class OpenSearchEngine : public QObject
 {
@@ -40,10 +50,20 @@ class OpenSearchEngine : public QObject
 signals:
     void imageChanged();
     void suggestions(const QStringList &suggestions);
+    void suggestions(const QString &searchTerm, const QStringList &suggestions);
+    void suggestionsFinished(const QString &searchTerm, bool success);
+    void searchResults(const OpenSearchResults &results);
+    void searchResultsFinished(bool success);
 
 public:
-    typedef QPair<QString, QString> Parameter;
-    typedef QList<Parameter> Parameters;
+    typedef OpenSearchDescription::Parameter Parameter;
+    typedef OpenSearchDescription::Parameters Parameters;
+
+    enum RequestType {
+        SearchRequest,
+        SuggestionsRequest,
+        ImageRequest
+    };
 
     Q_PROPERTY(QString name READ name WRITE setName)
     Q_PROPERTY(QString description READ description WRITE setDescription)
@@ -54,14 +74,24 @@ public:
     Q_PROPERTY(Parameters suggestionsParameters READ suggestionsParameters WRITE setSuggestionsParameters)
     Q_PROPERTY(QString suggestionsMethod READ suggestionsMethod WRITE setSuggestionsMethod)
     Q_PROPERTY(bool providesSuggestions READ providesSuggestions)
+    Q_PROPERTY(int suggestionsBatchSize READ suggestionsBatchSize WRITE setSuggestionsBatchSize)
+    Q_PROPERTY(int maximumSuggestionsRequests READ maximumSuggestionsRequests WRITE setMaximumSuggestionsRequests)
+    Q_PROPERTY(int suggestionsDelay READ suggestionsDelay WRITE setSuggestionsDelay)
+    Q_PROPERTY(int suggestionsMaximumDelay READ suggestionsMaximumDelay WRITE setSuggestionsMaximumDelay)
+    Q_PROPERTY(int suggestionsWarmInterval READ suggestionsWarmInterval WRITE setSuggestionsWarmInterval)
     Q_PROPERTY(QString imageUrl READ imageUrl WRITE setImageUrl)
+    Q_PROPERTY(QSize maximumImageSize READ maximumImageSize WRITE setMaximumImageSize)
     Q_PROPERTY(QStringList tags READ tags WRITE setTags)
     Q_PROPERTY(bool valid READ isValid)
     Q_PROPERTY(QNetworkAccessManager* networkAccessManager READ networkAccessManager WRITE setNetworkAccessManager)
 
     OpenSearchEngine(QObject *parent = 0);
+    OpenSearchEngine(const OpenSearchDescription &description, QObject *parent = 0);
     ~OpenSearchEngine();
 
+    OpenSearchDescription openSearchDescription() const;
+    void setOpenSearchDescription(const OpenSearchDescription &description);
+
     QString name() const;
     void setName(const QString &name);
 
@@ -70,13 +100,15 @@ public:
 
     QString searchUrlTemplate() const;
     void setSearchUrlTemplate(const QString &searchUrl);
-    QUrl searchUrl(const QString &searchTerm) const;
+    QUrl searchUrl(const QString &searchTerm,
+                   const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
 
     bool providesSuggestions() const;
 
     QString suggestionsUrlTemplate() const;
     void setSuggestionsUrlTemplate(const QString &suggestionsUrl);
-    QUrl suggestionsUrl(const QString &searchTerm) const;
+    QUrl suggestionsUrl(const QString &searchTerm,
+                        const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
 
     Parameters searchParameters() const;
     void setSearchParameters(const Parameters &searchParameters);
@@ -90,16 +122,43 @@ public:
     QString suggestionsMethod() const;
     void setSuggestionsMethod(const QString &method);
 
+    QStringList resultTypes() const;
+    bool providesResults(const QString &type) const;
+    QUrl resultsUrl(const QString &searchTerm, const QString &type,
+                    const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+
+    bool isFetchingSearchResults() const;
+    int searchResultsTotal() const;
+
+    int suggestionsBatchSize() const;
+    void setSuggestionsBatchSize(int size);
+
+    int maximumSuggestionsRequests() const;
+    void setMaximumSuggestionsRequests(int count);
+
+    int suggestionsDelay() const;
+    void setSuggestionsDelay(int delay);
+
+    int suggestionsMaximumDelay() const;
+    void setSuggestionsMaximumDelay(int delay);
+
+    int suggestionsWarmInterval() const;
+    void setSuggestionsWarmInterval(int interval);
+
     QString imageUrl() const;
     void setImageUrl(const QString &url);
 
     QImage image() const;
     void setImage(const QImage &image);
 
+    QSize maximumImageSize() const;
+    void setMaximumImageSize(const QSize &size);
+
     QStringList tags() const;
     void setTags(const QStringList &tags);
 
     bool isValid() const;
+    qint64 memoryUsage() const;
 
     QNetworkAccessManager *networkAccessManager() const;
     void setNetworkAccessManager(QNetworkAccessManager *networkAccessManager);
@@ -107,12 +166,37 @@ public:
     OpenSearchEngineDelegate *delegate() const;
     void setDelegate(OpenSearchEngineDelegate *delegate);
 
+    OpenSearchEngineObserver *observer() const;
+    void setObserver(OpenSearchEngineObserver *observer);
+
+    OpenSearchRequestPolicy requestPolicy(RequestType type) const;
+    void setRequestPolicy(RequestType type, const OpenSearchRequestPolicy &policy);
+
+    OpenSearchSuggestionsCache *suggestionsCache() const;
+    void setSuggestionsCache(OpenSearchSuggestionsCache *cache);
+
+    OpenSearchSuggestionsIndex *suggestionsIndex() const;
+    void setSuggestionsIndex(OpenSearchSuggestionsIndex *index);
+
+    OpenSearchImageCache *imageCache() const;
+    void setImageCache(OpenSearchImageCache *cache);
+
+    OpenSearchRequestScheduler *requestScheduler() const;
+    void setRequestScheduler(OpenSearchRequestScheduler *scheduler);
+
     bool operator==(const OpenSearchEngine &other) const;
     bool operator<(const OpenSearchEngine &other) const;
 
 public slots:
+    void prepareForSuggestions();
+    void finishSuggestions();
     void requestSuggestions(const QString &searchTerm);
-    void requestSearchResults(const QString &searchTerm);
+    void requestSearchResults(const QString &searchTerm,
+                              const OpenSearchTemplateContext &context = OpenSearchTemplateContext());
+    void fetchSearchResults(const QString &searchTerm,
+                            const OpenSearchTemplateContext &context = OpenSearchTemplateContext(),
+                            const QString &type = QString());
+    void abortSearchResults();
 
 protected:
     static QString parseTemplate(const QString &searchTerm, const QString &searchTemplate);
@@ -120,9 +204,27 @@ protected:
 
 private slots:
     void imageObtained();
+    void imageDecoded();
+    void cachedImageLoaded(const QString &url);
+    void sendScheduledImageRequest(int ticket);
+    void sendPendingSuggestionsRequest();
+    void sendScheduledSuggestionsRequest(int ticket);
+    void deliverSuggestions(const QString &searchTerm, const QStringList &suggestions, int sequence);
+    void suggestionsDataAvailable();
     void suggestionsObtained();
+    void searchResultsDataAvailable();
+    void searchResultsObtained();
+    void suggestionsHostFound(const QHostInfo &info);
+    void suggestionsConnectionWarmed();
+    void keepSuggestionsConnectionWarm();
 
 private:
+    void abortSuggestionsRequest();
+    void sendSuggestionsRequest(const QString &searchTerm, bool scheduled = false);
+    void sendImageRequest() const;
+    void readSuggestions(OpenSearchSuggestionsRequest *request);
+    void warmSuggestionsConnection();
+
     OpenSearchEnginePrivate *d;
 };
 
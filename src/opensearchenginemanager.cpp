@@ -0,0 +1,267 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchenginemanager.h"
+
+#include "opensearchengine.h"
+
+#include <qnetworkaccessmanager.h>
+#include <qtimer.h>
+
+/*!
+    \class OpenSearchEngineManager
+    \brief A set of search engines queried for suggestions at once
+
+    OpenSearchEngineManager holds a set of engines, which share one network access
+    manager. requestSuggestions() sends the search term to all of the engines that
+    provide suggestions in parallel, and suggestions() is emitted once with the merged
+    results, either when all of them have finished their requests, successfully or not,
+    or when the deadline() expires, whatever comes first. That way, a single slow engine
+    cannot hold up the others. Until an engine has finished, the suggestions it emits
+    replace the ones it has emitted before, e.g. the answer of its index or a batch.
+
+    The merged list contains the suggestions of each engine, in the order the engines
+    have been added, without the duplicates, which are compared case insensitively.
+
+    The engines are not owned by the manager. They are removed from it automatically
+    when they are destroyed.
+
+    \sa OpenSearchEngine::requestSuggestions()
+*/
+
+/*!
+    \fn void OpenSearchEngineManager::suggestions(const QString &searchTerm, const QStringList &suggestions)
+
+    This signal is emitted with the merged \a suggestions for \a searchTerm, once every
+    engine has replied or the deadline has expired.
+
+    \sa requestSuggestions()
+*/
+
+/*!
+    Constructs an empty manager with a given \a parent.
+*/
+OpenSearchEngineManager::OpenSearchEngineManager(QObject *parent)
+    : QObject(parent)
+    , m_networkAccessManager(new QNetworkAccessManager(this))
+    , m_deadline(1000)
+    , m_deadlineTimer(new QTimer(this))
+{
+    m_deadlineTimer->setSingleShot(true);
+    connect(m_deadlineTimer, SIGNAL(timeout()), this, SLOT(finishSuggestionsRequest()));
+}
+
+/*!
+    Destroys the manager, leaving the engines alone.
+*/
+OpenSearchEngineManager::~OpenSearchEngineManager()
+{
+    foreach (OpenSearchEngine *engine, m_engines)
+        engine->disconnect(this);
+}
+
+/*!
+    Returns the engines of the manager, in the order they have been added.
+*/
+QList<OpenSearchEngine*> OpenSearchEngineManager::engines() const
+{
+    return m_engines;
+}
+
+/*!
+    Adds the \a engine to the manager and makes it use networkAccessManager().
+*/
+void OpenSearchEngineManager::addEngine(OpenSearchEngine *engine)
+{
+    if (!engine || m_engines.contains(engine))
+        return;
+
+    m_engines.append(engine);
+    engine->setNetworkAccessManager(m_networkAccessManager);
+
+    connect(engine, SIGNAL(suggestions(QString,QStringList)), this, SLOT(engineSuggestions(QString,QStringList)));
+    connect(engine, SIGNAL(suggestionsFinished(QString,bool)), this, SLOT(engineSuggestionsFinished(QString,bool)));
+    connect(engine, SIGNAL(destroyed(QObject*)), this, SLOT(engineDestroyed(QObject*)));
+}
+
+/*!
+    Removes the \a engine from the manager. A pending request does not wait for it anymore.
+*/
+void OpenSearchEngineManager::removeEngine(OpenSearchEngine *engine)
+{
+    if (!m_engines.removeOne(engine))
+        return;
+
+    engine->disconnect(this);
+    m_suggestions.remove(engine);
+
+    if (m_pendingEngines.remove(engine) && m_pendingEngines.isEmpty())
+        finishSuggestionsRequest();
+}
+
+/*!
+    \property networkAccessManager
+    \brief the network access manager shared by all the engines
+
+    By default, the manager creates its own network access manager. Setting a new one
+    sets it on every engine of the manager.
+*/
+QNetworkAccessManager *OpenSearchEngineManager::networkAccessManager() const
+{
+    return m_networkAccessManager;
+}
+
+void OpenSearchEngineManager::setNetworkAccessManager(QNetworkAccessManager *networkAccessManager)
+{
+    if (m_networkAccessManager && m_networkAccessManager->parent() == this)
+        m_networkAccessManager->deleteLater();
+
+    m_networkAccessManager = networkAccessManager;
+
+    foreach (OpenSearchEngine *engine, m_engines)
+        engine->setNetworkAccessManager(m_networkAccessManager);
+}
+
+/*!
+    \property deadline
+    \brief the time, in milliseconds, the merged suggestions wait for the engines
+
+    The suggestions of the engines that have not replied until then are left out.
+    The default is 1000 milliseconds, 0 means that all the engines are waited for.
+*/
+int OpenSearchEngineManager::deadline() const
+{
+    return m_deadline;
+}
+
+void OpenSearchEngineManager::setDeadline(int msecs)
+{
+    m_deadline = qMax(0, msecs);
+}
+
+/*!
+    Returns true if suggestions have been requested and have not been emitted yet.
+*/
+bool OpenSearchEngineManager::isRequestPending() const
+{
+    return !m_pendingEngines.isEmpty();
+}
+
+/*!
+    Requests suggestions for \a searchTerm from all the engines that provide them.
+    A request that is still pending is abandoned.
+
+    suggestions() will be emitted with the merged results.
+*/
+void OpenSearchEngineManager::requestSuggestions(const QString &searchTerm)
+{
+    m_deadlineTimer->stop();
+    m_pendingEngines.clear();
+    m_suggestions.clear();
+    m_searchTerm = searchTerm;
+
+    if (searchTerm.isEmpty())
+        return;
+
+    foreach (OpenSearchEngine *engine, m_engines) {
+        if (engine->providesSuggestions() && engine->networkAccessManager())
+            m_pendingEngines.insert(engine);
+    }
+
+    if (m_pendingEngines.isEmpty())
+        return;
+
+    if (m_deadline > 0)
+        m_deadlineTimer->start(m_deadline);
+
+    foreach (OpenSearchEngine *engine, m_engines) {
+        if (m_pendingEngines.contains(engine))
+            engine->requestSuggestions(searchTerm);
+    }
+}
+
+void OpenSearchEngineManager::engineSuggestions(const QString &searchTerm, const QStringList &suggestions)
+{
+    OpenSearchEngine *engine = static_cast<OpenSearchEngine*>(sender());
+    if (!m_pendingEngines.contains(engine))
+        return;
+
+    // Engines running overlapping requests may still answer a previous term.
+    if (searchTerm != m_searchTerm)
+        return;
+
+    // Engines answering from their index, or in batches, update their results until they finish.
+    m_suggestions.insert(engine, suggestions);
+}
+
+void OpenSearchEngineManager::engineSuggestionsFinished(const QString &searchTerm, bool success)
+{
+    Q_UNUSED(success);
+
+    OpenSearchEngine *engine = static_cast<OpenSearchEngine*>(sender());
+    if (searchTerm != m_searchTerm || !m_pendingEngines.remove(engine))
+        return;
+
+    // Failed engines keep the suggestions they have emitted before, if any.
+    if (m_pendingEngines.isEmpty())
+        finishSuggestionsRequest();
+}
+
+void OpenSearchEngineManager::engineDestroyed(QObject *object)
+{
+    OpenSearchEngine *engine = static_cast<OpenSearchEngine*>(object);
+    m_engines.removeOne(engine);
+    m_suggestions.remove(engine);
+
+    if (m_pendingEngines.remove(engine) && m_pendingEngines.isEmpty())
+        finishSuggestionsRequest();
+}
+
+void OpenSearchEngineManager::finishSuggestionsRequest()
+{
+    m_deadlineTimer->stop();
+    m_pendingEngines.clear();
+
+    if (m_searchTerm.isEmpty())
+        return;
+
+    QStringList merged;
+    QSet<QString> seen;
+
+    foreach (OpenSearchEngine *engine, m_engines) {
+        QHash<OpenSearchEngine*, QStringList>::const_iterator i = m_suggestions.constFind(engine);
+        if (i == m_suggestions.constEnd())
+            continue;
+
+        foreach (const QString &suggestion, i.value()) {
+            QString key = suggestion.toLower();
+            if (seen.contains(key))
+                continue;
+
+            seen.insert(key);
+            merged.append(suggestion);
+        }
+    }
+
+    QString searchTerm = m_searchTerm;
+    m_searchTerm.clear();
+    m_suggestions.clear();
+
+    emit suggestions(searchTerm, merged);
+}
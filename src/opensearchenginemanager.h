@@ -0,0 +1,80 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHENGINEMANAGER_H
+#define OPENSEARCHENGINEMANAGER_H
+
+#include <qhash.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qset.h>
+#include <qstringlist.h>
+
+class QNetworkAccessManager;
+class QTimer;
+
+class OpenSearchEngine;
+
+class OpenSearchEngineManager : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void suggestions(const QString &searchTerm, const QStringList &suggestions);
+
+public:
+    Q_PROPERTY(int deadline READ deadline WRITE setDeadline)
+    Q_PROPERTY(QNetworkAccessManager* networkAccessManager READ networkAccessManager WRITE setNetworkAccessManager)
+
+    OpenSearchEngineManager(QObject *parent = 0);
+    ~OpenSearchEngineManager();
+
+    QList<OpenSearchEngine*> engines() const;
+    void addEngine(OpenSearchEngine *engine);
+    void removeEngine(OpenSearchEngine *engine);
+
+    QNetworkAccessManager *networkAccessManager() const;
+    void setNetworkAccessManager(QNetworkAccessManager *networkAccessManager);
+
+    int deadline() const;
+    void setDeadline(int msecs);
+
+    bool isRequestPending() const;
+
+public slots:
+    void requestSuggestions(const QString &searchTerm);
+
+private slots:
+    void engineSuggestions(const QString &searchTerm, const QStringList &suggestions);
+    void engineSuggestionsFinished(const QString &searchTerm, bool success);
+    void engineDestroyed(QObject *object);
+    void finishSuggestionsRequest();
+
+private:
+    QList<OpenSearchEngine*> m_engines;
+    QNetworkAccessManager *m_networkAccessManager;
+
+    int m_deadline;
+    QTimer *m_deadlineTimer;
+    QString m_searchTerm;
+    QSet<OpenSearchEngine*> m_pendingEngines;
+    QHash<OpenSearchEngine*, QStringList> m_suggestions;
+};
+
+#endif // OPENSEARCHENGINEMANAGER_H
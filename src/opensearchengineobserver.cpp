@@ -0,0 +1,90 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include "opensearchengineobserver.h"
+
+/*!
+    \class OpenSearchEngineObserver
+    \brief An abstract class receiving measurements of the requests of engines.
+
+    OpenSearchEngineObserver is an abstract class that can be subclassed and set on
+    an OpenSearchEngine with OpenSearchEngine::setObserver(), e.g. to export latency
+    and traffic metrics for each provider.
+
+    Currently subclasses are notified about every suggestions request by reimplementing
+    the suggestionsRequestFinished() method.
+
+    \sa OpenSearchEngine, OpenSearchEngineDelegate
+*/
+
+/*!
+    \enum OpenSearchEngineObserver::Outcome
+
+    This enum describes how a suggestions request has ended.
+
+    \value Finished The reply has been received and parsed.
+    \value Failed The reply could not be parsed.
+    \value Aborted The request has been cancelled, e.g. because the engine has been destroyed.
+    \value Superseded The request has been replaced by a newer one, or by cached suggestions.
+    \value Cached The suggestions have been taken from the suggestions cache, without any request.
+    \value Throttled The request has not been sent because the queue of its host was full,
+           see OpenSearchEngine::requestScheduler().
+*/
+
+/*!
+    \class OpenSearchEngineObserver::SuggestionsStatistics
+    \brief Measurements of a single suggestions request
+
+    All times are measured in microseconds with a monotonic clock, from the moment
+    the request started to be built. Times that do not apply, e.g. the time to the
+    first byte if nothing has been received, are -1.
+
+    \list
+    \o expansionTime - building the URL and the POST data from the templates
+    \o timeToFirstByte - until the first bytes of the reply have been read
+    \o transferTime - until the reply has finished, or has been abandoned
+    \o parseTime - the time spent in the parser, in total
+    \o bytesReceived - the size of the received reply body
+    \o resultCount - the number of suggestions delivered
+    \endlist
+*/
+
+/*!
+    Constructs the observer.
+*/
+OpenSearchEngineObserver::OpenSearchEngineObserver()
+{
+}
+
+/*!
+    Destructs the observer.
+*/
+OpenSearchEngineObserver::~OpenSearchEngineObserver()
+{
+}
+
+/*!
+    \fn void suggestionsRequestFinished(OpenSearchEngine *engine,
+    const SuggestionsStatistics &statistics) = 0
+
+    This method is called once per OpenSearchEngine::requestSuggestions() call that has
+    sent a request or has been answered from the cache, with the \a statistics of the
+    request of the \a engine, just before the suggestions are delivered.
+*/
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef OPENSEARCHENGINEOBSERVER_H
+#define OPENSEARCHENGINEOBSERVER_H
+
+#include <qstring.h>
+
+class OpenSearchEngine;
+
+class OpenSearchEngineObserver
+{
+public:
+    enum Outcome {
+        Finished,
+        Failed,
+        Aborted,
+        Superseded,
+        Cached,
+        Throttled
+    };
+
+    struct SuggestionsStatistics
+    {
+        SuggestionsStatistics()
+            : outcome(Finished)
+            , expansionTime(-1)
+            , timeToFirstByte(-1)
+            , transferTime(-1)
+            , parseTime(0)
+            , bytesReceived(0)
+            , resultCount(0)
+        {}
+
+        QString searchTerm;
+        Outcome outcome;
+        qint64 expansionTime;
+        qint64 timeToFirstByte;
+        qint64 transferTime;
+        qint64 parseTime;
+        qint64 bytesReceived;
+        int resultCount;
+    };
+
+    OpenSearchEngineObserver();
+    virtual ~OpenSearchEngineObserver();
+
+    virtual void suggestionsRequestFinished(OpenSearchEngine *engine,
+                                            const SuggestionsStatistics &statistics) = 0;
+};
+
+#endif // OPENSEARCHENGINEOBSERVER_H
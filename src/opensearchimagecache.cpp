@@ -0,0 +1,520 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchimagecache.h"
+
+#include "opensearchrequestscheduler.h"
+
+#include <qbuffer.h>
+#include <qcryptographichash.h>
+#include <qdatastream.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfuturewatcher.h>
+#include <qimagereader.h>
+#include <qnetworkaccessmanager.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+#include <qtconcurrentrun.h>
+#include <qurl.h>
+
+Q_GLOBAL_STATIC(OpenSearchImageCache, globalImageCache)
+
+static const quint32 metaDataVersion = 1;
+
+/*!
+    \class OpenSearchImageCache
+    \brief A cache of search engine images shared by many engines
+
+    OpenSearchImageCache holds the images of search engines, keyed by their image URLs,
+    so that engines with the same image share a single copy of it, and it is downloaded
+    only once. While an image is being downloaded, further requests for it are ignored.
+    If the download fails, the image is not requested again for failureTimeToLive().
+
+    Downloaded images are decoded with decodeImage() in the global thread pool, so that
+    large icons do not block the thread the cache lives in. An image is still loading
+    until it has been decoded, and imageLoaded() is emitted from the thread of the cache.
+    Images larger than maximumImageSize() are scaled down while they are decoded.
+
+    When a cacheDirectory() is set, decoded images are also stored on disk and read
+    back from there later, e.g. after the application has been restarted. Images older
+    than revalidationInterval() are still used, but they are revalidated with the
+    server using the ETag and Last-Modified headers sent along with them.
+
+    By default, all engines use the cache returned by instance().
+
+    \sa OpenSearchEngine::image(), OpenSearchEngine::setImageCache()
+*/
+
+/*!
+    \fn void OpenSearchImageCache::imageLoaded(const QString &url)
+
+    This signal is emitted when the image with the given \a url has been loaded
+    or updated.
+*/
+
+/*!
+    Constructs a cache with a given \a parent.
+*/
+OpenSearchImageCache::OpenSearchImageCache(QObject *parent)
+    : QObject(parent)
+    , m_revalidationInterval(7 * 24 * 60 * 60)
+    , m_failureTimeToLive(60 * 60)
+{
+}
+
+/*!
+    Destroys the cache, aborting pending downloads.
+*/
+OpenSearchImageCache::~OpenSearchImageCache()
+{
+    QHash<int, Request>::const_iterator scheduledEnd = m_scheduledRequests.constEnd();
+    QHash<int, Request>::const_iterator scheduled = m_scheduledRequests.constBegin();
+    for (; scheduled != scheduledEnd; ++scheduled) {
+        if (scheduled->scheduler)
+            scheduled->scheduler->cancel(scheduled.key());
+    }
+
+    QHash<QNetworkReply*, QString>::const_iterator end = m_replies.constEnd();
+    QHash<QNetworkReply*, QString>::const_iterator i = m_replies.constBegin();
+    for (; i != end; ++i) {
+        i.key()->disconnect(this);
+        i.key()->abort();
+        i.key()->deleteLater();
+    }
+}
+
+/*!
+    Returns the process-wide cache, which is used by default by all engines.
+*/
+OpenSearchImageCache *OpenSearchImageCache::instance()
+{
+    return globalImageCache();
+}
+
+/*!
+    Returns the directory the images are stored in. An empty string, which
+    is the default, means the images are only kept in memory.
+*/
+QString OpenSearchImageCache::cacheDirectory() const
+{
+    return m_cacheDirectory;
+}
+
+/*!
+    Sets the directory the images are stored in to \a directory.
+    It will be created if it does not exist.
+*/
+void OpenSearchImageCache::setCacheDirectory(const QString &directory)
+{
+    m_cacheDirectory = directory;
+
+    if (!m_cacheDirectory.isEmpty())
+        QDir().mkpath(m_cacheDirectory);
+}
+
+/*!
+    Returns the time, in seconds, after which cached images are revalidated with
+    the server. The default is one week.
+*/
+int OpenSearchImageCache::revalidationInterval() const
+{
+    return m_revalidationInterval;
+}
+
+/*!
+    Sets the time after which cached images are revalidated to \a secs seconds.
+*/
+void OpenSearchImageCache::setRevalidationInterval(int secs)
+{
+    m_revalidationInterval = qMax(0, secs);
+}
+
+/*!
+    Returns the time, in seconds, for which an image that could not be loaded
+    is not requested again. The default is one hour.
+*/
+int OpenSearchImageCache::failureTimeToLive() const
+{
+    return m_failureTimeToLive;
+}
+
+/*!
+    Sets the time for which failed images are not requested again to \a secs seconds.
+*/
+void OpenSearchImageCache::setFailureTimeToLive(int secs)
+{
+    m_failureTimeToLive = qMax(0, secs);
+}
+
+/*!
+    Returns the maximum size of the downloaded images. Larger images are scaled down,
+    keeping their aspect ratio. An invalid size, which is the default, means that
+    images are kept at their original size.
+*/
+QSize OpenSearchImageCache::maximumImageSize() const
+{
+    return m_maximumImageSize;
+}
+
+/*!
+    Sets the maximum size of the downloaded images to \a size. Images that are
+    already cached are not affected.
+*/
+void OpenSearchImageCache::setMaximumImageSize(const QSize &size)
+{
+    m_maximumImageSize = size;
+}
+
+/*!
+    Returns the cached image with the given \a url, reading it from the cache
+    directory if necessary, or a null image if there is none.
+
+    It never performs network requests, use load() to download the image.
+*/
+QImage OpenSearchImageCache::image(const QString &url)
+{
+    if (url.isEmpty())
+        return QImage();
+
+    return entry(url)->image;
+}
+
+/*!
+    Returns true if the image with the given \a url could not be loaded recently.
+*/
+bool OpenSearchImageCache::hasFailed(const QString &url) const
+{
+    QHash<QString, Entry>::const_iterator i = m_entries.constFind(url);
+    return (i != m_entries.constEnd() && i->failed);
+}
+
+/*!
+    Returns true if the image with the given \a url is being downloaded.
+*/
+bool OpenSearchImageCache::isLoading(const QString &url) const
+{
+    return m_loading.contains(url);
+}
+
+/*!
+    Downloads the image with the given \a url using the \a manager, unless it is
+    already being downloaded, it is cached and does not need to be revalidated yet,
+    or it has failed to load recently. The request follows the given \a policy.
+
+    If a \a scheduler is given and the host of the image is over its budget, the
+    request waits in the queue of the scheduler, and the image counts as loading
+    meanwhile. It is not loaded at all if the queue is full.
+
+    imageLoaded() is emitted once the image has been loaded.
+*/
+void OpenSearchImageCache::load(const QString &url, QNetworkAccessManager *manager,
+                                const OpenSearchRequestPolicy &policy, OpenSearchRequestScheduler *scheduler)
+{
+    if (url.isEmpty() || !manager || m_loading.contains(url))
+        return;
+
+    Entry *cached = entry(url);
+
+    if (cached->validated.isValid()) {
+        int age = cached->validated.secsTo(QDateTime::currentDateTime());
+        if (cached->failed && age < m_failureTimeToLive)
+            return;
+        if (!cached->failed && !cached->image.isNull() && age < m_revalidationInterval)
+            return;
+    }
+
+    if (scheduler && !scheduler->tryAcquire(QUrl::fromEncoded(url.toUtf8()))) {
+        int ticket = scheduler->enqueue(QUrl::fromEncoded(url.toUtf8()), this, "sendScheduledRequest");
+        if (!ticket)
+            return;
+
+        Request scheduled;
+        scheduled.url = url;
+        scheduled.manager = manager;
+        scheduled.policy = policy;
+        scheduled.scheduler = scheduler;
+        m_scheduledRequests.insert(ticket, scheduled);
+        m_loading.insert(url);
+
+        if (!m_schedulers.contains(scheduler)) {
+            m_schedulers.append(scheduler);
+            connect(scheduler, SIGNAL(destroyed(QObject*)), this, SLOT(schedulerDestroyed(QObject*)));
+        }
+        return;
+    }
+
+    sendRequest(url, manager, policy, scheduler);
+}
+
+/*!
+    Removes all images from memory. Images stored in the cache directory are kept.
+*/
+void OpenSearchImageCache::clear()
+{
+    m_entries.clear();
+}
+
+/*!
+    Decodes the image held by \a data. If \a maximumSize is valid and the image is larger,
+    it is scaled down to fit into it, keeping its aspect ratio. Formats that support it,
+    such as JPEG, are scaled while being decoded, so that the full image is never held.
+
+    It is thread-safe and can be called from any thread.
+*/
+QImage OpenSearchImageCache::decodeImage(const QByteArray &data, const QSize &maximumSize)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    QSize size = reader.size();
+    bool scaled = false;
+
+    if (maximumSize.isValid() && size.isValid()
+        && (size.width() > maximumSize.width() || size.height() > maximumSize.height())) {
+        reader.setScaledSize(size.scaled(maximumSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1)));
+        scaled = true;
+    }
+
+    QImage image = reader.read();
+
+    // Not every format reports its size up front.
+    if (!scaled && !image.isNull() && maximumSize.isValid()
+        && (image.width() > maximumSize.width() || image.height() > maximumSize.height()))
+        image = image.scaled(maximumSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    return image;
+}
+
+void OpenSearchImageCache::sendRequest(const QString &url, QNetworkAccessManager *manager,
+                                       const OpenSearchRequestPolicy &policy, OpenSearchRequestScheduler *scheduler)
+{
+    Entry *cached = entry(url);
+
+    QNetworkRequest request(QUrl::fromEncoded(url.toUtf8()));
+    policy.apply(&request);
+    if (!cached->image.isNull()) {
+        if (!cached->entityTag.isEmpty())
+            request.setRawHeader("If-None-Match", cached->entityTag);
+        if (!cached->lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", cached->lastModified);
+    }
+
+    QNetworkReply *reply = manager->get(request);
+    policy.watch(reply);
+    if (scheduler)
+        scheduler->watch(reply);
+    m_replies.insert(reply, url);
+    m_loading.insert(url);
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(replyDestroyed(QObject*)));
+}
+
+void OpenSearchImageCache::sendScheduledRequest(int ticket)
+{
+    // The slot has been taken for the ticket, it is given back by the scheduler that has
+    // granted it, the others ignore the ticket.
+    if (!m_scheduledRequests.contains(ticket)) {
+        foreach (OpenSearchRequestScheduler *scheduler, m_schedulers) {
+            if (scheduler)
+                scheduler->release(ticket);
+        }
+        return;
+    }
+
+    Request scheduled = m_scheduledRequests.take(ticket);
+    m_loading.remove(scheduled.url);
+
+    // The network access manager may have been destroyed while the request was waiting.
+    if (!scheduled.manager) {
+        if (scheduled.scheduler)
+            scheduled.scheduler->release(ticket);
+        return;
+    }
+
+    sendRequest(scheduled.url, scheduled.manager, scheduled.policy, scheduled.scheduler);
+}
+
+void OpenSearchImageCache::schedulerDestroyed(QObject *object)
+{
+    for (int i = m_schedulers.count() - 1; i >= 0; --i) {
+        if (!m_schedulers.at(i) || m_schedulers.at(i).data() == object)
+            m_schedulers.removeAt(i);
+    }
+
+    // The requests waiting in the queues of the scheduler will never be sent.
+    QHash<int, Request>::iterator i = m_scheduledRequests.begin();
+    while (i != m_scheduledRequests.end()) {
+        if (!i->scheduler || i->scheduler == object) {
+            m_loading.remove(i->url);
+            i = m_scheduledRequests.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void OpenSearchImageCache::replyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !m_replies.contains(reply))
+        return;
+
+    QString url = m_replies.take(reply);
+
+    QByteArray response = reply->readAll();
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QNetworkReply::NetworkError error = reply->error();
+    QByteArray entityTag = reply->rawHeader("ETag");
+    QByteArray lastModified = reply->rawHeader("Last-Modified");
+
+    reply->close();
+    reply->deleteLater();
+
+    Entry *cached = entry(url);
+    cached->validated = QDateTime::currentDateTime();
+
+    if (status == 304 && !cached->image.isNull()) {
+        m_loading.remove(url);
+        writeEntry(url, *cached, false);
+        return;
+    }
+
+    if (error != QNetworkReply::NoError || response.isEmpty()) {
+        m_loading.remove(url);
+        // A stale image is still better than none.
+        cached->failed = cached->image.isNull();
+        return;
+    }
+
+    Decoding decoding;
+    decoding.url = url;
+    decoding.entityTag = entityTag;
+    decoding.lastModified = lastModified;
+
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    m_decodings.insert(watcher, decoding);
+    connect(watcher, SIGNAL(finished()), this, SLOT(imageDecoded()));
+    watcher->setFuture(QtConcurrent::run(&OpenSearchImageCache::decodeImage, response, m_maximumImageSize));
+}
+
+void OpenSearchImageCache::replyDestroyed(QObject *object)
+{
+    // Replies are deleted along with their network access manager, the image can be
+    // loaded again later.
+    QNetworkReply *reply = static_cast<QNetworkReply*>(object);
+    if (m_replies.contains(reply))
+        m_loading.remove(m_replies.take(reply));
+}
+
+void OpenSearchImageCache::imageDecoded()
+{
+    QFutureWatcher<QImage> *watcher = static_cast<QFutureWatcher<QImage>*>(sender());
+    if (!m_decodings.contains(watcher))
+        return;
+
+    Decoding decoding = m_decodings.take(watcher);
+    QImage image = watcher->result();
+    watcher->deleteLater();
+
+    const QString &url = decoding.url;
+    m_loading.remove(url);
+
+    Entry *cached = entry(url);
+    if (image.isNull()) {
+        cached->failed = cached->image.isNull();
+        return;
+    }
+
+    cached->image = image;
+    cached->entityTag = decoding.entityTag;
+    cached->lastModified = decoding.lastModified;
+    cached->failed = false;
+    writeEntry(url, *cached, true);
+
+    emit imageLoaded(url);
+}
+
+OpenSearchImageCache::Entry *OpenSearchImageCache::entry(const QString &url)
+{
+    QHash<QString, Entry>::iterator i = m_entries.find(url);
+    if (i != m_entries.end())
+        return &i.value();
+
+    Entry cached;
+    readEntry(url, &cached);
+    return &m_entries.insert(url, cached).value();
+}
+
+QString OpenSearchImageCache::filePath(const QString &url) const
+{
+    QByteArray hash = QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_cacheDirectory + QLatin1Char('/') + QLatin1String(hash.constData());
+}
+
+bool OpenSearchImageCache::readEntry(const QString &url, Entry *entry) const
+{
+    if (m_cacheDirectory.isEmpty())
+        return false;
+
+    QString path = filePath(url);
+    QFile metaData(path + QLatin1String(".meta"));
+    if (!metaData.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&metaData);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 version;
+    QString storedUrl;
+    Entry stored;
+    stream >> version;
+    if (version != metaDataVersion)
+        return false;
+
+    stream >> storedUrl >> stored.entityTag >> stored.lastModified >> stored.validated;
+    if (stream.status() != QDataStream::Ok || storedUrl != url)
+        return false;
+
+    if (!stored.image.load(path + QLatin1String(".png"), "PNG"))
+        return false;
+
+    *entry = stored;
+    return true;
+}
+
+void OpenSearchImageCache::writeEntry(const QString &url, const Entry &entry, bool includeImage) const
+{
+    if (m_cacheDirectory.isEmpty() || url.startsWith(QLatin1String("data:")))
+        return;
+
+    QString path = filePath(url);
+    if (includeImage && !entry.image.save(path + QLatin1String(".png"), "PNG"))
+        return;
+
+    QFile metaData(path + QLatin1String(".meta"));
+    if (!metaData.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&metaData);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << metaDataVersion << url << entry.entityTag << entry.lastModified << entry.validated;
+}
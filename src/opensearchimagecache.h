@@ -0,0 +1,130 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHIMAGECACHE_H
+#define OPENSEARCHIMAGECACHE_H
+
+#include <qdatetime.h>
+#include <qhash.h>
+#include <qimage.h>
+#include <qobject.h>
+#include <qpointer.h>
+#include <qset.h>
+#include <qsize.h>
+#include <qstring.h>
+
+#include "opensearchrequestpolicy.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+template <typename T> class QFutureWatcher;
+
+class OpenSearchRequestScheduler;
+
+class OpenSearchImageCache : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void imageLoaded(const QString &url);
+
+public:
+    OpenSearchImageCache(QObject *parent = 0);
+    ~OpenSearchImageCache();
+
+    static OpenSearchImageCache *instance();
+
+    QString cacheDirectory() const;
+    void setCacheDirectory(const QString &directory);
+
+    int revalidationInterval() const;
+    void setRevalidationInterval(int secs);
+
+    int failureTimeToLive() const;
+    void setFailureTimeToLive(int secs);
+
+    QSize maximumImageSize() const;
+    void setMaximumImageSize(const QSize &size);
+
+    QImage image(const QString &url);
+    bool hasFailed(const QString &url) const;
+    bool isLoading(const QString &url) const;
+
+    void load(const QString &url, QNetworkAccessManager *manager,
+              const OpenSearchRequestPolicy &policy = OpenSearchRequestPolicy(QNetworkRequest::LowPriority),
+              OpenSearchRequestScheduler *scheduler = 0);
+    void clear();
+
+    static QImage decodeImage(const QByteArray &data, const QSize &maximumSize = QSize());
+
+private slots:
+    void sendScheduledRequest(int ticket);
+    void schedulerDestroyed(QObject *object);
+    void replyFinished();
+    void replyDestroyed(QObject *object);
+    void imageDecoded();
+
+private:
+    struct Entry
+    {
+        Entry() : failed(false) {}
+
+        QImage image;
+        QByteArray entityTag;
+        QByteArray lastModified;
+        QDateTime validated;
+        bool failed;
+    };
+
+    struct Decoding
+    {
+        QString url;
+        QByteArray entityTag;
+        QByteArray lastModified;
+    };
+
+    struct Request
+    {
+        QString url;
+        QPointer<QNetworkAccessManager> manager;
+        OpenSearchRequestPolicy policy;
+        QPointer<OpenSearchRequestScheduler> scheduler;
+    };
+
+    Entry *entry(const QString &url);
+    void sendRequest(const QString &url, QNetworkAccessManager *manager,
+                     const OpenSearchRequestPolicy &policy, OpenSearchRequestScheduler *scheduler);
+    QString filePath(const QString &url) const;
+    bool readEntry(const QString &url, Entry *entry) const;
+    void writeEntry(const QString &url, const Entry &entry, bool includeImage) const;
+
+    QHash<QString, Entry> m_entries;
+    QHash<QNetworkReply*, QString> m_replies;
+    QSet<QString> m_loading;
+    QHash<int, Request> m_scheduledRequests;
+    QList<QPointer<OpenSearchRequestScheduler> > m_schedulers;
+    QHash<QFutureWatcher<QImage>*, Decoding> m_decodings;
+
+    QString m_cacheDirectory;
+    int m_revalidationInterval;
+    int m_failureTimeToLive;
+    QSize m_maximumImageSize;
+};
+
+#endif // OPENSEARCHIMAGECACHE_H
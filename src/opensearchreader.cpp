@@ -23,6 +23,91 @@
 
 #include <qiodevice.h>
 
+namespace {
+
+enum ElementType {
+    UnknownElement,
+    OpenSearchDescriptionElement,
+    ShortNameElement,
+    DescriptionElement,
+    UrlElement,
+    ParameterElement,
+    ImageElement,
+    TagsElement
+};
+
+enum UrlType {
+    UnknownUrl,
+    SearchUrl,
+    SuggestionsUrl
+};
+
+// Element names are told apart by their length first, so that
+// most of them are matched with a single comparison.
+ElementType elementType(const QStringRef &name)
+{
+    switch (name.size()) {
+    case 3:
+        if (name == QLatin1String("Url"))
+            return UrlElement;
+        break;
+    case 4:
+        if (name == QLatin1String("Tags"))
+            return TagsElement;
+        break;
+    case 5:
+        if (name == QLatin1String("Image"))
+            return ImageElement;
+        if (name == QLatin1String("Param"))
+            return ParameterElement;
+        break;
+    case 9:
+        if (name == QLatin1String("ShortName"))
+            return ShortNameElement;
+        if (name == QLatin1String("Parameter"))
+            return ParameterElement;
+        break;
+    case 11:
+        if (name == QLatin1String("Description"))
+            return DescriptionElement;
+        break;
+    case 21:
+        if (name == QLatin1String("OpenSearchDescription"))
+            return OpenSearchDescriptionElement;
+        break;
+    default:
+        break;
+    }
+
+    return UnknownElement;
+}
+
+UrlType urlType(const QStringRef &type)
+{
+    switch (type.size()) {
+    case 0:
+        return SearchUrl;
+    case 9:
+        if (type == QLatin1String("text/html"))
+            return SearchUrl;
+        break;
+    case 21:
+        if (type == QLatin1String("application/xhtml+xml"))
+            return SearchUrl;
+        break;
+    case 30:
+        if (type == QLatin1String("application/x-suggestions+json"))
+            return SuggestionsUrl;
+        break;
+    default:
+        break;
+    }
+
+    return UnknownUrl;
+}
+
+}
+
 /*!
     \class OpenSearchReader
     \brief A class reading a search engine description from an external source
@@ -47,7 +132,10 @@
 */
 OpenSearchReader::OpenSearchReader()
     : QXmlStreamReader()
-    , m_engine(0)
+    , m_inDescription(false)
+    , m_element(UnknownElement)
+    , m_skipDepth(0)
+    , m_urlType(UnknownUrl)
 {
 }
 
@@ -69,7 +157,27 @@ OpenSearchReader::OpenSearchReader()
 */
 OpenSearchEngine *OpenSearchReader::read(QIODevice *device)
 {
-    m_engine = 0;
+    OpenSearchDescription description;
+    read(device, &description);
+    return new OpenSearchEngine(description);
+}
+
+/*!
+    Reads an OpenSearch description from the \a device into \a description, which is
+    reset first. Unlike read(), it does not create any QObject, so it can be used from
+    any thread.
+
+    If the \a device is closed, it will be opened.
+
+    \return true on success and false if the document is bad formed or is not an
+            OpenSearch description; \a description holds what has been read anyway.
+
+    \sa OpenSearchDescription
+*/
+bool OpenSearchReader::read(QIODevice *device, OpenSearchDescription *description)
+{
+    m_description = OpenSearchDescription();
+    m_inDescription = false;
     clear();
 
     if (!device->isOpen())
@@ -77,153 +185,290 @@ OpenSearchEngine *OpenSearchReader::read(QIODevice *device)
 
     setDevice(device);
     readDocument();
-    return m_engine;
+
+    *description = m_description;
+    m_description = OpenSearchDescription();
+    return !hasError();
 }
 
-#include <qdebug.h>
+/*!
+    Reads the next OpenSearch description embedded in a bundle, such as an Atom or RSS
+    feed, into \a description. The device has to be set with QXmlStreamReader::setDevice()
+    or filled with QXmlStreamReader::addData() before, and is opened if it is closed.
 
-void OpenSearchReader::readDocument()
-{
-    m_engine = new OpenSearchEngine();
+    Descriptions are found at any depth of the document, everything else is skipped.
+    Only the document being read is kept in memory, so feeds of any size can be read
+    one description after another, in a single pass:
 
-    while (!isStartElement() && !atEnd())
-        readNext();
+    \code
+    OpenSearchReader reader;
+    reader.setDevice(&file);
 
-    if (name() != QLatin1String("OpenSearchDescription")
-        || namespaceUri() != QLatin1String("http://a9.com/-/spec/opensearch/1.1/")) {
-        raiseError(QObject::tr("The file is not an OpenSearch 1.1 file."));
-        return;
-    }
+    OpenSearchDescription description;
+    while (reader.readNextDescription(&description))
+        engines.append(new OpenSearchEngine(description));
 
-    while (!atEnd()) {
-        readNext();
+    if (reader.hasError())
+        qWarning() << reader.errorString();
+    \endcode
 
-        if (isEndElement())
-            break;
+    If the data ends in the middle of a description, false is returned and error() is
+    QXmlStreamReader::PrematureEndOfDocumentError. Once more data has been added with
+    addData(), or has arrived on a sequential device such as a QNetworkReply, the next
+    call resumes that description where it stopped, so the data can be split anywhere.
 
-        if (!isStartElement())
+    \return true if a description has been read and false at the end of the bundle,
+            at a premature end of the data or on errors.
+
+    \sa read()
+*/
+bool OpenSearchReader::readNextDescription(OpenSearchDescription *description)
+{
+    if (device() && !device()->isOpen())
+        device()->open(QIODevice::ReadOnly);
+
+    forever {
+        // After a premature end, reading resumes where it stopped once more data is there.
+        if (atEnd() && error() != PrematureEndOfDocumentError)
+            return false;
+
+        readNext();
+        if (hasError())
+            return false;
+
+        if (!m_inDescription) {
+            if (isStartElement() && isDescriptionElement())
+                startDescription();
             continue;
+        }
 
-        if (name() == QLatin1String("ShortName"))
-            readName();
-        else if (name() == QLatin1String("Description"))
-            readDescription();
-        else if (name() == QLatin1String("Url"))
-            readUrl();
-        else if (name() == QLatin1String("Image"))
-            readImage();
-        else if (name() == QLatin1String("Tags"))
-            readTags();
-        else
-            skipSubtree();
+        if (readDescriptionToken()) {
+            *description = m_description;
+            m_description = OpenSearchDescription();
+            return true;
+        }
     }
 }
 
-void OpenSearchReader::readName()
+void OpenSearchReader::readDocument()
 {
-    Q_ASSERT(isStartElement() && name() == QLatin1String("ShortName"));
-    m_engine->setName(readElementText());
+    while (!isStartElement() && !atEnd())
+        readNext();
+
+    if (!isDescriptionElement()) {
+        raiseError(QObject::tr("The file is not an OpenSearch 1.1 file."));
+        return;
+    }
+
+    readDescriptionElement();
 }
 
-void OpenSearchReader::readDescription()
+bool OpenSearchReader::isDescriptionElement() const
 {
-    Q_ASSERT(isStartElement() && name() == QLatin1String("Description"));
-    m_engine->setDescription(readElementText());
+    return (elementType(name()) == OpenSearchDescriptionElement
+            && namespaceUri() == QLatin1String("http://a9.com/-/spec/opensearch/1.1/"));
 }
 
-void OpenSearchReader::readUrl()
+void OpenSearchReader::readDescriptionElement()
 {
-    Q_ASSERT(isStartElement() && name() == QLatin1String("Url"));
-
-    QString type = attributes().value(QLatin1String("type")).toString();
-    QString url = attributes().value(QLatin1String("template")).toString();
-    QString method = attributes().value(QLatin1String("method")).toString();
+    startDescription();
 
-    if (type.isEmpty() || type == QLatin1String("application/xhtml+xml"))
-        type = QLatin1String("text/html");
+    while (!atEnd()) {
+        readNext();
 
-    if (url.isEmpty()) {
-        skipSubtree();
-        return;
+        if (readDescriptionToken())
+            return;
     }
 
-    if (type == QLatin1String("application/x-suggestions+json")
-        && !m_engine->suggestionsUrlTemplate().isEmpty()) {
-        skipSubtree();
-        return;
-    }
+    // What has been read of a broken document is kept.
+    finishDescription();
+}
 
-    if (type == QLatin1String("text/html")
-        && !m_engine->searchUrlTemplate().isEmpty()) {
-        skipSubtree();
-        return;
-    }
+void OpenSearchReader::startDescription()
+{
+    Q_ASSERT(isStartElement() && isDescriptionElement());
 
-    OpenSearchEngine::Parameters parameters;
+    m_description = OpenSearchDescription();
+    m_additionalUrls.clear();
+    m_inDescription = true;
+    m_element = UnknownElement;
+    m_skipDepth = 0;
+}
 
-    while (!atEnd()) {
-        readNext();
+// Handles the token that has just been read inside the description, one at a time, so
+// that reading can stop anywhere. Returns true at the end of the description.
+bool OpenSearchReader::readDescriptionToken()
+{
+    // Counting the depth instead of recursing keeps deeply nested
+    // extensions from exhausting the stack.
+    if (m_skipDepth > 0) {
+        if (isStartElement())
+            ++m_skipDepth;
+        else if (isEndElement())
+            --m_skipDepth;
+        return false;
+    }
 
-        if (isEndElement())
-            break;
+    switch (m_element) {
+    case UnknownElement:
+        if (isEndElement()) {
+            finishDescription();
+            return true;
+        }
 
         if (!isStartElement())
-            continue;
-
-        if (name() == QLatin1String("Param") || name() == QLatin1String("Parameter"))
-            readParameter(&parameters);
-        else
-            skipSubtree();
+            return false;
+
+        m_element = elementType(name());
+        switch (m_element) {
+        case ShortNameElement:
+        case DescriptionElement:
+        case ImageElement:
+        case TagsElement:
+            m_text.clear();
+            break;
+        case UrlElement:
+            startUrl();
+            break;
+        default:
+            m_element = UnknownElement;
+            m_skipDepth = 1;
+            break;
+        }
+        return false;
+
+    case UrlElement:
+        if (isEndElement()) {
+            finishUrl();
+        } else if (isStartElement()) {
+            if (elementType(name()) == ParameterElement)
+                readParameter();
+            m_skipDepth = 1;
+        }
+        return false;
+
+    default:
+        if (isCharacters() || isEntityReference())
+            m_text += text();
+        else if (isEndElement())
+            finishText();
+        else if (isStartElement())
+            raiseError(QObject::tr("Expected character data."));
+        return false;
     }
+}
 
-    if (type == QLatin1String("application/x-suggestions+json")) {
-        m_engine->setSuggestionsUrlTemplate(url);
-        m_engine->setSuggestionsParameters(parameters);
-        m_engine->setSuggestionsMethod(method);
-    } else if (type == QLatin1String("text/html")) {
-        m_engine->setSearchUrlTemplate(url);
-        m_engine->setSearchParameters(parameters);
-        m_engine->setSearchMethod(method);
+void OpenSearchReader::finishDescription()
+{
+    if (!m_inDescription)
+        return;
+
+    // A broken document may end inside an element.
+    if (m_element == UrlElement)
+        finishUrl();
+    else if (m_element != UnknownElement)
+        finishText();
+
+    // Compiling the URLs at once keeps the description from being updated for each of them.
+    if (!m_additionalUrls.isEmpty()) {
+        m_description.setAdditionalUrls(m_additionalUrls);
+        m_additionalUrls.clear();
     }
+
+    m_inDescription = false;
 }
 
-void OpenSearchReader::readParameter(OpenSearchEngine::Parameters *parameters)
+void OpenSearchReader::startUrl()
 {
-    Q_ASSERT(isStartElement() && (name() == QLatin1String("Param") || name() == QLatin1String("Parameter")));
+    Q_ASSERT(isStartElement() && elementType(name()) == UrlElement);
 
-    QString key = attributes().value(QLatin1String("name")).toString();
-    QString value = attributes().value(QLatin1String("value")).toString();
+    // The references are only valid until the next token is read, they are
+    // copied once the element is known to be used.
+    const QXmlStreamAttributes xmlAttributes = attributes();
+    const QStringRef urlTemplate = xmlAttributes.value(QLatin1String("template"));
 
-    if (key.isEmpty() || value.isEmpty())
+    if (urlTemplate.isEmpty()) {
+        m_element = UnknownElement;
+        m_skipDepth = 1;
         return;
+    }
 
-    parameters->append(OpenSearchEngine::Parameter(key, value));
-    readNext();
-}
+    const QStringRef typeName = xmlAttributes.value(QLatin1String("type"));
+    const QStringRef rel = xmlAttributes.value(QLatin1String("rel"));
+    UrlType type = urlType(typeName);
+    bool results = (rel.isEmpty() || rel == QLatin1String("results"));
+
+    // The first search and suggestions URLs are the ones used by the engine,
+    // any other URL is kept along.
+    if (type == SearchUrl && results && m_description.searchUrlTemplate().isEmpty())
+        m_urlType = SearchUrl;
+    else if (type == SuggestionsUrl && (results || rel == QLatin1String("suggestions"))
+             && m_description.suggestionsUrlTemplate().isEmpty())
+        m_urlType = SuggestionsUrl;
+    else
+        m_urlType = UnknownUrl;
+
+    m_url = OpenSearchDescription::Url();
+    if (m_urlType == UnknownUrl) {
+        m_url.type = typeName.toString();
+        if (!rel.isEmpty())
+            m_url.rel = rel.toString();
+    }
 
-void OpenSearchReader::readImage()
-{
-    Q_ASSERT(isStartElement() && name() == QLatin1String("Image"));
-    m_engine->setImageUrl(readElementText());
+    m_url.urlTemplate = urlTemplate.toString();
+    m_url.method = xmlAttributes.value(QLatin1String("method")).toString();
 }
 
-void OpenSearchReader::readTags()
+void OpenSearchReader::finishUrl()
 {
-    Q_ASSERT(isStartElement() && name() == QLatin1String("Tags"));
-    m_engine->setTags(readElementText().split(QLatin1Char(' '), QString::SkipEmptyParts));
+    m_element = UnknownElement;
+
+    if (m_urlType == SuggestionsUrl) {
+        m_description.setSuggestionsUrlTemplate(m_url.urlTemplate);
+        m_description.setSuggestionsParameters(m_url.parameters);
+        m_description.setSuggestionsMethod(m_url.method);
+    } else if (m_urlType == SearchUrl) {
+        m_description.setSearchUrlTemplate(m_url.urlTemplate);
+        m_description.setSearchParameters(m_url.parameters);
+        m_description.setSearchMethod(m_url.method);
+    } else {
+        if (m_url.method.isEmpty())
+            m_url.method = OpenSearchDescription::Url().method;
+        m_additionalUrls.append(m_url);
+    }
 }
 
-void OpenSearchReader::skipSubtree()
+void OpenSearchReader::readParameter()
 {
-    Q_ASSERT(isStartElement());
+    Q_ASSERT(isStartElement() && elementType(name()) == ParameterElement);
 
-    while (!atEnd()) {
-        readNext();
+    const QXmlStreamAttributes xmlAttributes = attributes();
+    const QStringRef key = xmlAttributes.value(QLatin1String("name"));
+    const QStringRef value = xmlAttributes.value(QLatin1String("value"));
 
-        if (isEndElement())
-            break;
+    if (!key.isEmpty() && !value.isEmpty())
+        m_url.parameters.append(OpenSearchDescription::Parameter(key.toString(), value.toString()));
+}
 
-        if (isStartElement())
-            skipSubtree();
+void OpenSearchReader::finishText()
+{
+    switch (m_element) {
+    case ShortNameElement:
+        m_description.setName(m_text);
+        break;
+    case DescriptionElement:
+        m_description.setDescription(m_text);
+        break;
+    case ImageElement:
+        m_description.setImageUrl(m_text);
+        break;
+    case TagsElement:
+        m_description.setTags(m_text.split(QLatin1Char(' '), QString::SkipEmptyParts));
+        break;
+    default:
+        break;
     }
+
+    m_element = UnknownElement;
+    m_text.clear();
 }
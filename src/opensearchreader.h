@@ -29,19 +29,33 @@ class OpenSearchReader : public QXmlStreamReader
 public:
     OpenSearchReader();
     OpenSearchEngine *read(QIODevice *device);
+    bool read(QIODevice *device, OpenSearchDescription *description);
+    bool readNextDescription(OpenSearchDescription *description);
 
 private:
     void readDocument();
-    void readName();
-    void readDescription();
-    void readUrl();
-    void readParameter(OpenSearchEngine::Parameters *parameters);
-    void readImage();
-    void readTags();
-    void skipSubtree();
+    bool isDescriptionElement() const;
+    void readDescriptionElement();
+    void startDescription();
+    bool readDescriptionToken();
+    void finishDescription();
+    void startUrl();
+    void finishUrl();
+    void readParameter();
+    void finishText();
 
 private:
-    OpenSearchEngine *m_engine;
+    OpenSearchDescription m_description;
+    OpenSearchDescription::Urls m_additionalUrls;
+
+    // Where the description being read is, so that reading can resume after a premature
+    // end of the data, once more has been added.
+    bool m_inDescription;
+    int m_element;
+    int m_skipDepth;
+    QString m_text;
+    int m_urlType;
+    OpenSearchDescription::Url m_url;
 };
 
 #endif // OPENSEARCHREADER_H
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include "opensearchrequestpolicy.h"
+
+#include <qnetworkreply.h>
+#include <qtimer.h>
+
+/*!
+    \class OpenSearchRequestPolicy
+    \brief A set of options applied to the network requests of engines
+
+    OpenSearchRequestPolicy describes how the requests of one kind, e.g. suggestions
+    or image requests, are sent: their priority(), whether HTTP pipelining is allowed,
+    whether the connection should be kept alive and reused, and a timeout() after which
+    the reply is aborted.
+
+    By default, engines send suggestions requests with a high priority and image requests
+    with a low one, so that icon downloads do not delay latency critical requests.
+
+    \note The HTTP stack of Qt 4 does not support HTTP/2, pipelining and persistent
+          connections are the closest equivalent it provides.
+
+    \sa OpenSearchEngine::setRequestPolicy()
+*/
+
+/*!
+    Constructs a policy with a given \a priority and \a timeout, in milliseconds, which
+    allows pipelining and keeps connections alive.
+*/
+OpenSearchRequestPolicy::OpenSearchRequestPolicy(QNetworkRequest::Priority priority, int timeout)
+    : m_priority(priority)
+    , m_timeout(qMax(0, timeout))
+    , m_pipeliningAllowed(true)
+    , m_keepAlive(true)
+{
+}
+
+/*!
+    Returns the priority of the requests.
+*/
+QNetworkRequest::Priority OpenSearchRequestPolicy::priority() const
+{
+    return m_priority;
+}
+
+/*!
+    Sets the priority of the requests to \a priority.
+*/
+void OpenSearchRequestPolicy::setPriority(QNetworkRequest::Priority priority)
+{
+    m_priority = priority;
+}
+
+/*!
+    Returns the time, in milliseconds, after which replies are aborted.
+    0 means that there is no timeout.
+*/
+int OpenSearchRequestPolicy::timeout() const
+{
+    return m_timeout;
+}
+
+/*!
+    Sets the time after which replies are aborted to \a msecs milliseconds.
+*/
+void OpenSearchRequestPolicy::setTimeout(int msecs)
+{
+    m_timeout = qMax(0, msecs);
+}
+
+/*!
+    Returns true if the requests may be pipelined with others on the same connection.
+*/
+bool OpenSearchRequestPolicy::isPipeliningAllowed() const
+{
+    return m_pipeliningAllowed;
+}
+
+/*!
+    Allows or disallows HTTP pipelining, according to \a allowed.
+*/
+void OpenSearchRequestPolicy::setPipeliningAllowed(bool allowed)
+{
+    m_pipeliningAllowed = allowed;
+}
+
+/*!
+    Returns true if the requests ask the server to keep the connection open.
+*/
+bool OpenSearchRequestPolicy::keepAlive() const
+{
+    return m_keepAlive;
+}
+
+/*!
+    Enables or disables the connection reuse hint, according to \a keepAlive.
+*/
+void OpenSearchRequestPolicy::setKeepAlive(bool keepAlive)
+{
+    m_keepAlive = keepAlive;
+}
+
+/*!
+    Sets the priority, the attributes and the headers described by the policy on \a request.
+*/
+void OpenSearchRequestPolicy::apply(QNetworkRequest *request) const
+{
+    request->setPriority(m_priority);
+    request->setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, m_pipeliningAllowed);
+    request->setRawHeader("Connection", m_keepAlive ? "keep-alive" : "close");
+}
+
+/*!
+    Aborts the \a reply if it does not finish within timeout().
+*/
+void OpenSearchRequestPolicy::watch(QNetworkReply *reply) const
+{
+    if (!reply || m_timeout <= 0 || reply->isFinished())
+        return;
+
+    QTimer *timer = new QTimer(reply);
+    timer->setSingleShot(true);
+    QObject::connect(timer, SIGNAL(timeout()), reply, SLOT(abort()));
+    QObject::connect(reply, SIGNAL(finished()), timer, SLOT(stop()));
+    timer->start(m_timeout);
+}
+
+/*!
+    Returns true if the policy is equal to \a other.
+*/
+bool OpenSearchRequestPolicy::operator==(const OpenSearchRequestPolicy &other) const
+{
+    return (m_priority == other.m_priority
+            && m_timeout == other.m_timeout
+            && m_pipeliningAllowed == other.m_pipeliningAllowed
+            && m_keepAlive == other.m_keepAlive);
+}
+
+/*!
+    Returns true if the policy is not equal to \a other.
+*/
+bool OpenSearchRequestPolicy::operator!=(const OpenSearchRequestPolicy &other) const
+{
+    return !operator==(other);
+}
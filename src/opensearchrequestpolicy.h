@@ -0,0 +1,59 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef OPENSEARCHREQUESTPOLICY_H
+#define OPENSEARCHREQUESTPOLICY_H
+
+#include <qnetworkrequest.h>
+
+class QNetworkReply;
+
+class OpenSearchRequestPolicy
+{
+public:
+    OpenSearchRequestPolicy(QNetworkRequest::Priority priority = QNetworkRequest::NormalPriority,
+                            int timeout = 0);
+
+    QNetworkRequest::Priority priority() const;
+    void setPriority(QNetworkRequest::Priority priority);
+
+    int timeout() const;
+    void setTimeout(int msecs);
+
+    bool isPipeliningAllowed() const;
+    void setPipeliningAllowed(bool allowed);
+
+    bool keepAlive() const;
+    void setKeepAlive(bool keepAlive);
+
+    void apply(QNetworkRequest *request) const;
+    void watch(QNetworkReply *reply) const;
+
+    bool operator==(const OpenSearchRequestPolicy &other) const;
+    bool operator!=(const OpenSearchRequestPolicy &other) const;
+
+private:
+    QNetworkRequest::Priority m_priority;
+    int m_timeout;
+    bool m_pipeliningAllowed;
+    bool m_keepAlive;
+};
+
+#endif // OPENSEARCHREQUESTPOLICY_H
@@ -0,0 +1,558 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchrequestscheduler.h"
+
+#include <qatomic.h>
+#include <qdatetime.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+#include <qstringlist.h>
+#include <qtimer.h>
+#include <qurl.h>
+
+#include <limits.h>
+
+// Tickets are unique across all the schedulers, so that receivers can use more than one.
+static QAtomicInt nextTicket(1);
+
+/*!
+    \class OpenSearchRequestScheduler
+    \brief A shared budget for the network requests sent to each host
+
+    OpenSearchRequestScheduler stands in front of the network requests of engines that
+    share it, see OpenSearchEngine::setRequestScheduler(), so that engines using the same
+    backend host cannot flood it together. For each host, identified by the scheme, the
+    name and the port of the URLs, it enforces:
+
+    a maximum number of requests running at once, see maximumConnectionsPerHost();
+
+    a token bucket, refilled with requestRate() tokens per second up to burstSize(), one
+    token being taken by each request;
+
+    a pause after the host has replied with 429 Too Many Requests or 503 Service
+    Unavailable, as long as its Retry-After header asks, or backoff() otherwise, doubled
+    with each such reply in a row, but never longer than maximumBackoff().
+
+    A request is sent right away if tryAcquire() succeeds. Otherwise it can wait in the
+    queue of the host with enqueue(): once it is its turn, the receiver is called with the
+    ticket, and sends the request then. Tickets are unique across all the schedulers.
+    When the queue is full, the request is dropped and
+    counted in droppedRequests(). The replies have to be handed to watch(), which makes
+    room for the next request once they have finished, and reads their status code. A
+    receiver that does not send its request after all calls release() instead.
+
+    Engines queue suggestions requests, so that only the most recent search term waits,
+    whereas the suggestions cache and the local index answer right away. Images are queued
+    as well.
+
+    \sa OpenSearchRequestPolicy
+*/
+
+/*!
+    Constructs a scheduler with a given \a parent, which allows 6 requests per host at
+    once, the limit of the HTTP stack of Qt, without any rate limit.
+*/
+OpenSearchRequestScheduler::OpenSearchRequestScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_processingTime(0)
+    , m_grantedTicket(0)
+    , m_maximumConnectionsPerHost(6)
+    , m_requestRate(0)
+    , m_burstSize(4)
+    , m_maximumQueueLength(8)
+    , m_backoff(1000)
+    , m_maximumBackoff(60000)
+    , m_droppedRequests(0)
+    , m_backoffs(0)
+{
+    m_clock.start();
+
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(processQueues()));
+}
+
+/*!
+    Destroys the scheduler. The requests waiting in the queues are never sent.
+*/
+OpenSearchRequestScheduler::~OpenSearchRequestScheduler()
+{
+}
+
+/*!
+    \property maximumConnectionsPerHost
+    \brief the maximum number of requests running at once for each host
+
+    0 means that there is no limit. The default is 6.
+*/
+int OpenSearchRequestScheduler::maximumConnectionsPerHost() const
+{
+    return m_maximumConnectionsPerHost;
+}
+
+void OpenSearchRequestScheduler::setMaximumConnectionsPerHost(int count)
+{
+    m_maximumConnectionsPerHost = qMax(0, count);
+    scheduleProcessing(0);
+}
+
+/*!
+    \property requestRate
+    \brief the sustained number of requests per second allowed for each host
+
+    0 means that there is no limit, which is the default.
+
+    \sa burstSize()
+*/
+qreal OpenSearchRequestScheduler::requestRate() const
+{
+    return m_requestRate;
+}
+
+void OpenSearchRequestScheduler::setRequestRate(qreal rate)
+{
+    m_requestRate = qMax(qreal(0), rate);
+    scheduleProcessing(0);
+}
+
+/*!
+    \property burstSize
+    \brief the number of requests that can be sent at once to a host that has been idle
+
+    It only matters when there is a requestRate(). The default is 4.
+*/
+int OpenSearchRequestScheduler::burstSize() const
+{
+    return m_burstSize;
+}
+
+void OpenSearchRequestScheduler::setBurstSize(int size)
+{
+    m_burstSize = qMax(1, size);
+}
+
+/*!
+    \property maximumQueueLength
+    \brief the maximum number of requests waiting for each host
+
+    Requests enqueued beyond it are dropped. The default is 8.
+*/
+int OpenSearchRequestScheduler::maximumQueueLength() const
+{
+    return m_maximumQueueLength;
+}
+
+void OpenSearchRequestScheduler::setMaximumQueueLength(int length)
+{
+    m_maximumQueueLength = qMax(0, length);
+}
+
+/*!
+    \property backoff
+    \brief the pause, in milliseconds, after a 429 or 503 reply without Retry-After
+
+    It doubles with each such reply in a row from the same host. The default is 1000.
+*/
+int OpenSearchRequestScheduler::backoff() const
+{
+    return m_backoff;
+}
+
+void OpenSearchRequestScheduler::setBackoff(int msecs)
+{
+    m_backoff = qMax(0, msecs);
+}
+
+/*!
+    \property maximumBackoff
+    \brief the longest pause, in milliseconds, whatever the Retry-After header says
+
+    The default is 60000.
+*/
+int OpenSearchRequestScheduler::maximumBackoff() const
+{
+    return m_maximumBackoff;
+}
+
+void OpenSearchRequestScheduler::setMaximumBackoff(int msecs)
+{
+    m_maximumBackoff = qMax(0, msecs);
+}
+
+/*!
+    Takes a slot for a request to the host of \a url if one is available right away and
+    no other request is waiting for the host.
+
+    \return true if the request can be sent, in which case its reply has to be passed to
+            watch(), and false otherwise.
+
+    \sa enqueue()
+*/
+bool OpenSearchRequestScheduler::tryAcquire(const QUrl &url)
+{
+    Host &host = m_hosts[hostKey(url)];
+
+    // The waiting requests go first.
+    if (!host.queue.isEmpty() || waitTime(&host, m_clock.elapsed()) != 0)
+        return false;
+
+    take(&host);
+    return true;
+}
+
+/*!
+    Queues a request to the host of \a url. Once a slot is available for it, the
+    \a member slot of the \a receiver is called with the ticket as its only argument, an
+    int, and the request has to be sent from it, or release() called, with the URL or
+    with the ticket. Receivers that
+    have been destroyed in the meantime are skipped.
+
+    \return the ticket identifying the request in the queue, or 0 if the queue of the
+            host is full and the request has been dropped.
+
+    \sa cancel(), tryAcquire()
+*/
+int OpenSearchRequestScheduler::enqueue(const QUrl &url, const QObject *receiver, const char *member)
+{
+    Host &host = m_hosts[hostKey(url)];
+
+    if (!receiver || !member || host.queue.count() >= m_maximumQueueLength) {
+        ++m_droppedRequests;
+        return 0;
+    }
+
+    Waiter waiter;
+    waiter.ticket = nextTicket.fetchAndAddRelaxed(1) & INT_MAX;
+    if (!waiter.ticket)
+        waiter.ticket = nextTicket.fetchAndAddRelaxed(1) & INT_MAX;
+    waiter.receiver = const_cast<QObject*>(receiver);
+    waiter.member = member;
+    host.queue.append(waiter);
+
+    scheduleProcessing(0);
+    return waiter.ticket;
+}
+
+/*!
+    Removes the request with a given \a ticket from its queue, if it is still waiting.
+*/
+void OpenSearchRequestScheduler::cancel(int ticket)
+{
+    QHash<QString, Host>::iterator end = m_hosts.end();
+    for (QHash<QString, Host>::iterator i = m_hosts.begin(); i != end; ++i) {
+        QList<Waiter> &queue = i->queue;
+        for (int j = 0; j < queue.count(); ++j) {
+            if (queue.at(j).ticket == ticket) {
+                queue.removeAt(j);
+                return;
+            }
+        }
+    }
+}
+
+/*!
+    Gives back the slot taken for a request to the host of \a url that has not been sent.
+*/
+void OpenSearchRequestScheduler::release(const QUrl &url)
+{
+    finish(hostKey(url), 0, QByteArray());
+}
+
+/*!
+    Gives back the slot taken for the request with a given \a ticket, from the member it
+    has been handed to, when the request is not sent after all, e.g. because the receiver
+    has given up on it. Does nothing for any other ticket, so that a receiver does not need
+    to know the host of a request it does not remember.
+*/
+void OpenSearchRequestScheduler::release(int ticket)
+{
+    if (!ticket || ticket != m_grantedTicket)
+        return;
+
+    m_grantedTicket = 0;
+    finish(m_grantedKey, 0, QByteArray());
+}
+
+/*!
+    Keeps track of the \a reply of a request sent after tryAcquire() or enqueue(). Once
+    it has finished, or has been destroyed, its slot is given back. Replies with the
+    status code 429 or 503 pause the requests to the host.
+*/
+void OpenSearchRequestScheduler::watch(QNetworkReply *reply)
+{
+    if (!reply)
+        return;
+
+    QString key = hostKey(reply->url());
+    if (reply->isFinished()) {
+        finish(key, reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(),
+               reply->rawHeader("Retry-After"));
+        return;
+    }
+
+    m_replies.insert(reply, key);
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(replyDestroyed(QObject*)));
+}
+
+/*!
+    Returns true if the requests to the host of \a url are paused after a 429 or 503 reply.
+*/
+bool OpenSearchRequestScheduler::isBackingOff(const QUrl &url) const
+{
+    return m_hosts.value(hostKey(url)).backoffUntil > m_clock.elapsed();
+}
+
+/*!
+    Returns the number of requests to the host of \a url that are running.
+*/
+int OpenSearchRequestScheduler::activeRequests(const QUrl &url) const
+{
+    return m_hosts.value(hostKey(url)).active;
+}
+
+/*!
+    Returns the number of requests waiting in the queues of all the hosts.
+*/
+int OpenSearchRequestScheduler::queueLength() const
+{
+    int length = 0;
+    foreach (const Host &host, m_hosts)
+        length += host.queue.count();
+    return length;
+}
+
+/*!
+    Returns the number of requests waiting for the host of \a url.
+*/
+int OpenSearchRequestScheduler::queueLength(const QUrl &url) const
+{
+    return m_hosts.value(hostKey(url)).queue.count();
+}
+
+/*!
+    Returns the number of requests that have been dropped because the queue of their
+    host was full.
+*/
+int OpenSearchRequestScheduler::droppedRequests() const
+{
+    return m_droppedRequests;
+}
+
+/*!
+    Returns the number of 429 and 503 replies that have paused the requests to their host.
+*/
+int OpenSearchRequestScheduler::backoffs() const
+{
+    return m_backoffs;
+}
+
+/*!
+    Resets the droppedRequests() and backoffs() counters.
+*/
+void OpenSearchRequestScheduler::resetStatistics()
+{
+    m_droppedRequests = 0;
+    m_backoffs = 0;
+}
+
+/*!
+    Returns the key identifying the host of \a url: its scheme, name and port.
+*/
+QString OpenSearchRequestScheduler::hostKey(const QUrl &url)
+{
+    QString scheme = url.scheme().toLower();
+    int port = url.port(scheme == QLatin1String("https") ? 443 : 80);
+    return scheme + QLatin1String("://") + url.host().toLower() + QLatin1Char(':') + QString::number(port);
+}
+
+/*!
+    Returns the pause, in milliseconds, requested by the Retry-After header \a value,
+    either a number of seconds or an HTTP date, relative to \a now. Dates in the past
+    give 0.
+
+    \return the pause, or -1 if the value is malformed.
+*/
+int OpenSearchRequestScheduler::parseRetryAfter(const QByteArray &value, const QDateTime &now)
+{
+    QByteArray simplified = value.simplified();
+    if (simplified.isEmpty())
+        return -1;
+
+    bool ok;
+    int secs = simplified.toInt(&ok);
+    if (ok)
+        return secs < 0 ? -1 : qMin(secs, INT_MAX / 1000) * 1000;
+
+    // An HTTP date, e.g. "Wed, 21 Oct 2015 07:28:00 GMT", with English names whatever the locale.
+    static const QByteArray months("JanFebMarAprMayJunJulAugSepOctNovDec");
+
+    QList<QByteArray> parts = simplified.split(' ');
+    if (parts.count() != 6 || parts.at(5) != "GMT" || parts.at(2).length() != 3)
+        return -1;
+
+    int month = months.indexOf(parts.at(2));
+    if (month < 0 || month % 3)
+        return -1;
+
+    int day = parts.at(1).toInt(&ok);
+    if (!ok)
+        return -1;
+
+    int year = parts.at(3).toInt(&ok);
+    if (!ok)
+        return -1;
+
+    QTime time = QTime::fromString(QString::fromLatin1(parts.at(4)), QLatin1String("hh:mm:ss"));
+    QDateTime date(QDate(year, month / 3 + 1, day), time, Qt::UTC);
+    if (!date.isValid())
+        return -1;
+
+    secs = now.toUTC().secsTo(date);
+    return qMin(qMax(0, secs), INT_MAX / 1000) * 1000;
+}
+
+void OpenSearchRequestScheduler::replyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || !m_replies.contains(reply))
+        return;
+
+    QString key = m_replies.take(reply);
+    reply->disconnect(this);
+
+    finish(key, reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(),
+           reply->rawHeader("Retry-After"));
+}
+
+void OpenSearchRequestScheduler::replyDestroyed(QObject *object)
+{
+    // Replies destroyed before they have finished do not tell anything about the host.
+    if (m_replies.contains(object))
+        finish(m_replies.take(object), 0, QByteArray());
+}
+
+void OpenSearchRequestScheduler::processQueues()
+{
+    qint64 now = m_clock.elapsed();
+    qint64 next = -1;
+
+    // Receivers may enqueue or cancel requests, the hosts are looked up again each time.
+    foreach (const QString &key, m_hosts.keys()) {
+        forever {
+            QHash<QString, Host>::iterator i = m_hosts.find(key);
+            if (i == m_hosts.end() || i->queue.isEmpty())
+                break;
+
+            qint64 wait = waitTime(&i.value(), now);
+            if (wait != 0) {
+                if (wait > 0 && (next < 0 || wait < next))
+                    next = wait;
+                break;
+            }
+
+            Waiter waiter = i->queue.takeFirst();
+            if (!waiter.receiver)
+                continue;
+
+            take(&i.value());
+            m_grantedTicket = waiter.ticket;
+            m_grantedKey = key;
+            bool invoked = QMetaObject::invokeMethod(waiter.receiver, waiter.member.constData(),
+                                                     Qt::DirectConnection, Q_ARG(int, waiter.ticket));
+            m_grantedTicket = 0;
+            if (!invoked)
+                finish(key, 0, QByteArray());
+        }
+    }
+
+    if (next >= 0)
+        scheduleProcessing(next);
+}
+
+void OpenSearchRequestScheduler::refill(Host *host, qint64 now) const
+{
+    if (host->tokens < 0) {
+        host->tokens = m_burstSize;
+    } else {
+        host->tokens = qMin(qreal(m_burstSize), host->tokens + (now - host->refilled) * m_requestRate / 1000);
+    }
+
+    host->refilled = now;
+}
+
+// Returns 0 if a request can be sent to the host now, the time until it can otherwise,
+// or -1 if it has to wait until a running request has finished.
+qint64 OpenSearchRequestScheduler::waitTime(Host *host, qint64 now) const
+{
+    if (host->backoffUntil > now)
+        return host->backoffUntil - now;
+
+    if (m_maximumConnectionsPerHost > 0 && host->active >= m_maximumConnectionsPerHost)
+        return -1;
+
+    if (m_requestRate > 0) {
+        refill(host, now);
+        if (host->tokens < 1)
+            return qMax(qint64(1), qint64((1 - host->tokens) * 1000 / m_requestRate + 1));
+    }
+
+    return 0;
+}
+
+void OpenSearchRequestScheduler::take(Host *host)
+{
+    ++host->active;
+
+    if (m_requestRate > 0) {
+        refill(host, m_clock.elapsed());
+        host->tokens = qMax(qreal(0), host->tokens - 1);
+    }
+}
+
+void OpenSearchRequestScheduler::finish(const QString &key, int statusCode, const QByteArray &retryAfter)
+{
+    Host &host = m_hosts[key];
+    host.active = qMax(0, host.active - 1);
+
+    if (statusCode == 429 || statusCode == 503) {
+        qint64 delay = parseRetryAfter(retryAfter);
+        if (delay < 0)
+            delay = qint64(m_backoff) << qMin(host.failures, 16);
+
+        ++host.failures;
+        host.backoffUntil = m_clock.elapsed() + qMin(delay, qint64(m_maximumBackoff));
+        ++m_backoffs;
+    } else if (statusCode > 0) {
+        host.failures = 0;
+    }
+
+    scheduleProcessing(0);
+}
+
+void OpenSearchRequestScheduler::scheduleProcessing(qint64 msecs)
+{
+    qint64 time = m_clock.elapsed() + msecs;
+    if (m_timer->isActive() && m_processingTime <= time)
+        return;
+
+    m_processingTime = time;
+    m_timer->start(int(qMin(msecs, qint64(INT_MAX))));
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHREQUESTSCHEDULER_H
+#define OPENSEARCHREQUESTSCHEDULER_H
+
+#include <qbytearray.h>
+#include <qdatetime.h>
+#include <qelapsedtimer.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qpointer.h>
+#include <qstring.h>
+
+class QNetworkReply;
+class QTimer;
+class QUrl;
+
+class OpenSearchRequestScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    Q_PROPERTY(int maximumConnectionsPerHost READ maximumConnectionsPerHost WRITE setMaximumConnectionsPerHost)
+    Q_PROPERTY(qreal requestRate READ requestRate WRITE setRequestRate)
+    Q_PROPERTY(int burstSize READ burstSize WRITE setBurstSize)
+    Q_PROPERTY(int maximumQueueLength READ maximumQueueLength WRITE setMaximumQueueLength)
+    Q_PROPERTY(int backoff READ backoff WRITE setBackoff)
+    Q_PROPERTY(int maximumBackoff READ maximumBackoff WRITE setMaximumBackoff)
+
+    OpenSearchRequestScheduler(QObject *parent = 0);
+    ~OpenSearchRequestScheduler();
+
+    int maximumConnectionsPerHost() const;
+    void setMaximumConnectionsPerHost(int count);
+
+    qreal requestRate() const;
+    void setRequestRate(qreal rate);
+
+    int burstSize() const;
+    void setBurstSize(int size);
+
+    int maximumQueueLength() const;
+    void setMaximumQueueLength(int length);
+
+    int backoff() const;
+    void setBackoff(int msecs);
+
+    int maximumBackoff() const;
+    void setMaximumBackoff(int msecs);
+
+    bool tryAcquire(const QUrl &url);
+    int enqueue(const QUrl &url, const QObject *receiver, const char *member);
+    void cancel(int ticket);
+    void release(const QUrl &url);
+    void release(int ticket);
+    void watch(QNetworkReply *reply);
+
+    bool isBackingOff(const QUrl &url) const;
+    int activeRequests(const QUrl &url) const;
+    int queueLength() const;
+    int queueLength(const QUrl &url) const;
+    int droppedRequests() const;
+    int backoffs() const;
+    void resetStatistics();
+
+    static QString hostKey(const QUrl &url);
+    static int parseRetryAfter(const QByteArray &value, const QDateTime &now = QDateTime::currentDateTime());
+
+private slots:
+    void replyFinished();
+    void replyDestroyed(QObject *object);
+    void processQueues();
+
+private:
+    struct Waiter
+    {
+        int ticket;
+        QPointer<QObject> receiver;
+        QByteArray member;
+    };
+
+    struct Host
+    {
+        Host() : active(0), tokens(-1), refilled(0), backoffUntil(0), failures(0) {}
+
+        int active;
+        qreal tokens;
+        qint64 refilled;
+        qint64 backoffUntil;
+        int failures;
+        QList<Waiter> queue;
+    };
+
+    void refill(Host *host, qint64 now) const;
+    qint64 waitTime(Host *host, qint64 now) const;
+    void take(Host *host);
+    void finish(const QString &key, int statusCode, const QByteArray &retryAfter);
+    void scheduleProcessing(qint64 msecs);
+
+    QHash<QString, Host> m_hosts;
+    QHash<QObject*, QString> m_replies;
+    QElapsedTimer m_clock;
+    QTimer *m_timer;
+    qint64 m_processingTime;
+
+    // The request whose receiver is being called.
+    int m_grantedTicket;
+    QString m_grantedKey;
+
+    int m_maximumConnectionsPerHost;
+    qreal m_requestRate;
+    int m_burstSize;
+    int m_maximumQueueLength;
+    int m_backoff;
+    int m_maximumBackoff;
+
+    int m_droppedRequests;
+    int m_backoffs;
+};
+
+#endif // OPENSEARCHREQUESTSCHEDULER_H
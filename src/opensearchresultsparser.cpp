@@ -0,0 +1,356 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include "opensearchresultsparser.h"
+
+static const char atomNamespace[] = "http://www.w3.org/2005/Atom";
+static const char rssNamespace[] = "http://purl.org/rss/1.0/";
+static const char openSearchNamespace[] = "http://a9.com/-/spec/opensearch/1.1/";
+
+/*!
+    \class OpenSearchResult
+    \brief A single item of the search results
+
+    OpenSearchResult holds the \c title, the \c link and the \c snippet of an item of
+    the search results, as found in an RSS item or an Atom entry. The snippet is taken
+    from the description of an RSS item, or from the summary of an Atom entry, falling
+    back to its content. It is kept as it is sent, so it may contain markup.
+
+    \sa OpenSearchResultsParser
+*/
+
+bool OpenSearchResult::operator==(const OpenSearchResult &other) const
+{
+    return (title == other.title && link == other.link && snippet == other.snippet);
+}
+
+bool OpenSearchResult::operator!=(const OpenSearchResult &other) const
+{
+    return !(*this == other);
+}
+
+/*!
+    \class OpenSearchResultsParser
+    \brief A class parsing search results in the RSS and Atom formats
+
+    OpenSearchResultsParser is a streaming parser for the results of search requests
+    made with the "application/rss+xml" or "application/atom+xml" URLs of an engine.
+
+    Data can be supplied in arbitrary chunks with addData(), the results that have been
+    parsed completely can be taken with takeResults() right away, while the rest of the
+    response is still being received. Only the results that have not been taken yet are
+    kept in memory. Once all data has been supplied, finish() tells whether the response
+    was well formed.
+
+    The OpenSearch response elements, which tell the totalResults(), the startIndex()
+    and the itemsPerPage() of the page, are read as well.
+
+    For more information see:
+    http://www.opensearch.org/Specifications/OpenSearch/1.1#OpenSearch_response_elements
+
+    \sa OpenSearchEngine::fetchSearchResults()
+*/
+
+/*!
+    Constructs a new parser.
+*/
+OpenSearchResultsParser::OpenSearchResultsParser()
+{
+    reset();
+}
+
+/*!
+    Resets the parser, so that it can be used to parse another response.
+*/
+void OpenSearchResultsParser::reset()
+{
+    m_reader.clear();
+    m_depth = 0;
+    m_itemDepth = 0;
+    m_itemNamespace.clear();
+    m_field = NoField;
+    m_fieldDepth = 0;
+    m_text.clear();
+    m_complete = false;
+    m_result = OpenSearchResult();
+    m_linkFromAttribute = false;
+    m_results.clear();
+    m_totalResults = -1;
+    m_startIndex = -1;
+    m_itemsPerPage = -1;
+}
+
+/*!
+    Parses the next chunk of the response, held by \a data.
+
+    \return false if the response turned out not to be well formed.
+*/
+bool OpenSearchResultsParser::addData(const QByteArray &data)
+{
+    if (hasError())
+        return false;
+
+    m_reader.addData(data);
+    parse();
+    return !hasError();
+}
+
+/*!
+    \overload
+
+    Parses \a size bytes of the response pointed to by \a data.
+*/
+bool OpenSearchResultsParser::addData(const char *data, int size)
+{
+    return addData(QByteArray::fromRawData(data, size));
+}
+
+/*!
+    Tells whether the whole response has been parsed and was well formed.
+*/
+bool OpenSearchResultsParser::finish()
+{
+    return (m_complete && !hasError());
+}
+
+/*!
+    Returns true if the response turned out not to be well formed.
+*/
+bool OpenSearchResultsParser::hasError() const
+{
+    return (m_reader.hasError() && m_reader.error() != QXmlStreamReader::PrematureEndOfDocumentError);
+}
+
+/*!
+    Returns the description of the error, if hasError() is true.
+*/
+QString OpenSearchResultsParser::errorString() const
+{
+    return hasError() ? m_reader.errorString() : QString();
+}
+
+/*!
+    Returns true if the whole response has been parsed.
+*/
+bool OpenSearchResultsParser::atEnd() const
+{
+    return m_complete;
+}
+
+/*!
+    Returns true if there are parsed results that have not been taken yet.
+*/
+bool OpenSearchResultsParser::hasResults() const
+{
+    return !m_results.isEmpty();
+}
+
+/*!
+    Returns the results that have been parsed since the last call and forgets them.
+*/
+OpenSearchResults OpenSearchResultsParser::takeResults()
+{
+    OpenSearchResults results = m_results;
+    m_results.clear();
+    return results;
+}
+
+/*!
+    Returns the number of results available for the search, or -1 if the response
+    did not tell.
+*/
+int OpenSearchResultsParser::totalResults() const
+{
+    return m_totalResults;
+}
+
+/*!
+    Returns the index of the first result of the page, or -1 if the response did not tell.
+*/
+int OpenSearchResultsParser::startIndex() const
+{
+    return m_startIndex;
+}
+
+/*!
+    Returns the number of results per page, or -1 if the response did not tell.
+*/
+int OpenSearchResultsParser::itemsPerPage() const
+{
+    return m_itemsPerPage;
+}
+
+/*!
+    Parses the complete response held by \a data and returns the list of results.
+
+    If \a ok is not 0, it is set to whether the response was well formed.
+*/
+OpenSearchResults OpenSearchResultsParser::parse(const QByteArray &data, bool *ok)
+{
+    OpenSearchResultsParser parser;
+    parser.addData(data);
+
+    bool success = parser.finish();
+    if (ok)
+        *ok = success;
+
+    return success ? parser.takeResults() : OpenSearchResults();
+}
+
+void OpenSearchResultsParser::parse()
+{
+    // The reader resumes after a premature end of the document, once more data is added.
+    forever {
+        m_reader.readNext();
+        if (m_reader.hasError())
+            return;
+
+        switch (m_reader.tokenType()) {
+        case QXmlStreamReader::StartElement:
+            startElement();
+            break;
+        case QXmlStreamReader::EndElement:
+            endElement();
+            break;
+        case QXmlStreamReader::Characters:
+            if (m_field != NoField)
+                m_text += m_reader.text();
+            break;
+        case QXmlStreamReader::EndDocument:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+void OpenSearchResultsParser::startElement()
+{
+    ++m_depth;
+
+    // The text of markup nested in a field, e.g. XHTML content, belongs to the field.
+    if (m_field != NoField)
+        return;
+
+    const QStringRef name = m_reader.name();
+    const QStringRef namespaceUri = m_reader.namespaceUri();
+
+    if (!m_itemDepth) {
+        if ((name == QLatin1String("item")
+             && (namespaceUri.isEmpty() || namespaceUri == QLatin1String(rssNamespace)))
+            || (name == QLatin1String("entry") && namespaceUri == QLatin1String(atomNamespace))) {
+            m_itemDepth = m_depth;
+            m_itemNamespace = namespaceUri.toString();
+            m_result = OpenSearchResult();
+            m_linkFromAttribute = false;
+        } else if (namespaceUri == QLatin1String(openSearchNamespace)) {
+            if (name == QLatin1String("totalResults"))
+                m_field = TotalResultsField;
+            else if (name == QLatin1String("startIndex"))
+                m_field = StartIndexField;
+            else if (name == QLatin1String("itemsPerPage"))
+                m_field = ItemsPerPageField;
+        }
+    } else if (m_depth == m_itemDepth + 1) {
+        if (name == QLatin1String("link") && namespaceUri == QLatin1String(atomNamespace)) {
+            // Atom links, which RSS items may use too, point to the result with an attribute.
+            const QXmlStreamAttributes attributes = m_reader.attributes();
+            const QStringRef rel = attributes.value(QLatin1String("rel"));
+            const QStringRef href = attributes.value(QLatin1String("href"));
+            if (!m_linkFromAttribute && !href.isEmpty()
+                && (rel.isEmpty() || rel == QLatin1String("alternate"))) {
+                m_result.link = QUrl(href.toString());
+                m_linkFromAttribute = true;
+            }
+        } else if (namespaceUri == m_itemNamespace) {
+            if (name == QLatin1String("title"))
+                m_field = TitleField;
+            else if (name == QLatin1String("link"))
+                m_field = LinkField;
+            else if (name == QLatin1String("description") || name == QLatin1String("summary"))
+                m_field = SnippetField;
+            else if (name == QLatin1String("content"))
+                m_field = ContentField;
+        }
+    }
+
+    if (m_field != NoField) {
+        m_fieldDepth = m_depth;
+        m_text.clear();
+    }
+}
+
+void OpenSearchResultsParser::endElement()
+{
+    if (m_field != NoField && m_depth == m_fieldDepth)
+        finishField();
+
+    if (m_itemDepth && m_depth == m_itemDepth) {
+        m_results.append(m_result);
+        m_itemDepth = 0;
+    }
+
+    if (--m_depth == 0)
+        m_complete = true;
+}
+
+void OpenSearchResultsParser::finishField()
+{
+    QString text = m_text.trimmed();
+    bool ok;
+
+    switch (m_field) {
+    case TitleField:
+        m_result.title = text;
+        break;
+    case LinkField:
+        if (!m_linkFromAttribute)
+            m_result.link = QUrl(text);
+        break;
+    case SnippetField:
+        m_result.snippet = text;
+        break;
+    case ContentField:
+        // Summaries are preferred over the full content.
+        if (m_result.snippet.isEmpty())
+            m_result.snippet = text;
+        break;
+    case TotalResultsField:
+        m_totalResults = text.toInt(&ok);
+        if (!ok)
+            m_totalResults = -1;
+        break;
+    case StartIndexField:
+        m_startIndex = text.toInt(&ok);
+        if (!ok)
+            m_startIndex = -1;
+        break;
+    case ItemsPerPageField:
+        m_itemsPerPage = text.toInt(&ok);
+        if (!ok)
+            m_itemsPerPage = -1;
+        break;
+    case NoField:
+        break;
+    }
+
+    m_field = NoField;
+    m_text.clear();
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef OPENSEARCHRESULTSPARSER_H
+#define OPENSEARCHRESULTSPARSER_H
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qmetatype.h>
+#include <qstring.h>
+#include <qurl.h>
+#include <qxmlstream.h>
+
+struct OpenSearchResult
+{
+    QString title;
+    QUrl link;
+    QString snippet;
+
+    bool operator==(const OpenSearchResult &other) const;
+    bool operator!=(const OpenSearchResult &other) const;
+};
+
+typedef QList<OpenSearchResult> OpenSearchResults;
+
+class OpenSearchResultsParser
+{
+public:
+    OpenSearchResultsParser();
+
+    void reset();
+
+    bool addData(const QByteArray &data);
+    bool addData(const char *data, int size);
+    bool finish();
+
+    bool hasError() const;
+    QString errorString() const;
+    bool atEnd() const;
+
+    bool hasResults() const;
+    OpenSearchResults takeResults();
+
+    int totalResults() const;
+    int startIndex() const;
+    int itemsPerPage() const;
+
+    static OpenSearchResults parse(const QByteArray &data, bool *ok = 0);
+
+private:
+    enum Field {
+        NoField,
+        TitleField,
+        LinkField,
+        SnippetField,
+        ContentField,
+        TotalResultsField,
+        StartIndexField,
+        ItemsPerPageField
+    };
+
+    void parse();
+    void startElement();
+    void endElement();
+    void finishField();
+
+    QXmlStreamReader m_reader;
+    int m_depth;
+    int m_itemDepth;
+    QString m_itemNamespace;
+    Field m_field;
+    int m_fieldDepth;
+    QString m_text;
+    bool m_complete;
+
+    OpenSearchResult m_result;
+    bool m_linkFromAttribute;
+    OpenSearchResults m_results;
+
+    int m_totalResults;
+    int m_startIndex;
+    int m_itemsPerPage;
+};
+
+Q_DECLARE_METATYPE(OpenSearchResult)
+Q_DECLARE_METATYPE(OpenSearchResults)
+
+#endif // OPENSEARCHRESULTSPARSER_H
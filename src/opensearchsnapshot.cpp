@@ -0,0 +1,586 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchsnapshot.h"
+
+#include "opensearchbatchreader.h"
+#include "opensearchengine.h"
+
+#include <qcryptographichash.h>
+#include <qdatetime.h>
+#include <qendian.h>
+#include <qfileinfo.h>
+#include <qhash.h>
+#include <qiodevice.h>
+
+// All integers are stored in little endian, strings in UTF-16LE.
+//
+// Header:      magic "OSSC", version, engine count, parameter count,
+//              source checksum (64 bits), string table offset, string table size,
+//              additional URL count
+// Engines:     FieldCount string references, followed by the index and count of the
+//              search parameters, of the suggestions parameters and of the additional URLs
+// Parameters:  name and value string references
+// URLs:        type, rel, template and method string references, followed by the index
+//              and count of the parameters
+// Strings:     every distinct string once, references are (byte offset, length)
+
+static const char magic[] = { 'O', 'S', 'S', 'C' };
+
+static const int headerSize = 36;
+static const int referenceSize = 8;
+static const int parameterSize = 2 * referenceSize;
+static const int urlSize = 5 * referenceSize;
+
+static inline quint32 readUInt32(const uchar *data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+static inline void appendUInt32(QByteArray *data, quint32 value)
+{
+    uchar buffer[4];
+    qToLittleEndian<quint32>(value, buffer);
+    data->append(reinterpret_cast<const char*>(buffer), 4);
+}
+
+namespace {
+
+class StringTable
+{
+public:
+    void append(QByteArray *data, const QString &string)
+    {
+        QHash<QString, quint32>::const_iterator i = m_offsets.constFind(string);
+        quint32 offset;
+
+        if (i != m_offsets.constEnd()) {
+            offset = i.value();
+        } else {
+            offset = m_data.size();
+            m_offsets.insert(string, offset);
+
+            const ushort *unicode = string.utf16();
+            for (int j = 0; j < string.length(); ++j) {
+                uchar buffer[2];
+                qToLittleEndian<quint16>(unicode[j], buffer);
+                m_data.append(reinterpret_cast<const char*>(buffer), 2);
+            }
+
+            // Keep the table aligned, so that the strings can be read in place.
+            if (m_data.size() % 4)
+                m_data.append(2, '\0');
+        }
+
+        appendUInt32(data, offset);
+        appendUInt32(data, string.length());
+    }
+
+    const QByteArray &data() const
+    {
+        return m_data;
+    }
+
+private:
+    QHash<QString, quint32> m_offsets;
+    QByteArray m_data;
+};
+
+}
+
+static void appendParameters(QByteArray *data, QByteArray *parameters, quint32 *parameterCount,
+                             StringTable *strings, const OpenSearchEngine::Parameters &list)
+{
+    appendUInt32(data, *parameterCount);
+    appendUInt32(data, list.count());
+
+    OpenSearchEngine::Parameters::const_iterator end = list.constEnd();
+    OpenSearchEngine::Parameters::const_iterator i = list.constBegin();
+    for (; i != end; ++i) {
+        strings->append(parameters, i->first);
+        strings->append(parameters, i->second);
+        ++*parameterCount;
+    }
+}
+
+/*!
+    \class OpenSearchSnapshot
+    \brief A compact binary catalog of search engines
+
+    OpenSearchSnapshot stores a list of already parsed engines in a binary file, which
+    can be memory mapped and read back much faster than the XML descriptions they come
+    from. Nothing is decoded when the snapshot is opened, apart from validating its
+    structure, strings are only built when requested with e.g. name() or engine().
+
+    Each snapshot carries a format version and a checksum() of the names, sizes and
+    modification times of the descriptions it has been built from, so that it can be
+    recognized as stale with isUpToDate() and rebuilt from the XML files.
+    loadEngines() does all of that at once.
+
+    \sa OpenSearchWriter::writeSnapshot(), OpenSearchReader
+*/
+
+/*!
+    Constructs an empty snapshot.
+*/
+OpenSearchSnapshot::OpenSearchSnapshot()
+    : m_data(0)
+    , m_size(0)
+{
+}
+
+/*!
+    Destroys the snapshot, unmapping the file.
+*/
+OpenSearchSnapshot::~OpenSearchSnapshot()
+{
+    close();
+}
+
+/*!
+    Maps the snapshot stored in the file with a given \a fileName into memory.
+
+    \return true on success and false if the file cannot be mapped, has been written
+            with another version of the format or is malformed.
+*/
+bool OpenSearchSnapshot::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if (m_size >= headerSize)
+        m_data = m_file.map(0, m_size);
+
+    if (!m_data || !validate()) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+    Unmaps and closes the snapshot file.
+*/
+void OpenSearchSnapshot::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+
+    m_file.close();
+    m_data = 0;
+    m_size = 0;
+}
+
+/*!
+    Returns true if a valid snapshot is open.
+*/
+bool OpenSearchSnapshot::isOpen() const
+{
+    return m_data;
+}
+
+/*!
+    Returns the checksum of the source files that has been stored with the snapshot.
+
+    \sa checksum()
+*/
+quint64 OpenSearchSnapshot::sourceChecksum() const
+{
+    if (!m_data)
+        return 0;
+
+    return qFromLittleEndian<quint64>(m_data + 16);
+}
+
+/*!
+    Returns true if the snapshot is open and has been written for the files with
+    the given \a sourceFileNames in their current state.
+*/
+bool OpenSearchSnapshot::isUpToDate(const QStringList &sourceFileNames) const
+{
+    return (m_data && sourceChecksum() == checksum(sourceFileNames));
+}
+
+/*!
+    Returns the number of engines in the snapshot.
+*/
+int OpenSearchSnapshot::count() const
+{
+    return m_data ? readUInt32(m_data + 8) : 0;
+}
+
+/*!
+    Returns the name of the engine at \a index.
+*/
+QString OpenSearchSnapshot::name(int index) const
+{
+    return field(index, Name);
+}
+
+/*!
+    Returns the description of the engine at \a index.
+*/
+QString OpenSearchSnapshot::description(int index) const
+{
+    return field(index, Description);
+}
+
+/*!
+    Returns the search URL template of the engine at \a index.
+*/
+QString OpenSearchSnapshot::searchUrlTemplate(int index) const
+{
+    return field(index, SearchUrlTemplate);
+}
+
+/*!
+    Returns the suggestions URL template of the engine at \a index.
+*/
+QString OpenSearchSnapshot::suggestionsUrlTemplate(int index) const
+{
+    return field(index, SuggestionsUrlTemplate);
+}
+
+/*!
+    Returns the image URL of the engine at \a index.
+*/
+QString OpenSearchSnapshot::imageUrl(int index) const
+{
+    return field(index, ImageUrl);
+}
+
+/*!
+    Returns the tags of the engine at \a index.
+*/
+QStringList OpenSearchSnapshot::tags(int index) const
+{
+    return field(index, Tags).split(QLatin1Char(' '), QString::SkipEmptyParts);
+}
+
+/*!
+    Constructs the engine at \a index with a given \a parent.
+
+    \return a new OpenSearchEngine object, or 0 if \a index is out of range
+
+    \note The lifetime of the returned object is up to the user, it does not depend
+          on the snapshot.
+*/
+OpenSearchEngine *OpenSearchSnapshot::engine(int index, QObject *parent) const
+{
+    const uchar *data = record(index);
+    if (!data)
+        return 0;
+
+    OpenSearchEngine *engine = new OpenSearchEngine(parent);
+    engine->setName(string(data + Name * referenceSize));
+    engine->setDescription(string(data + Description * referenceSize));
+    engine->setSearchUrlTemplate(string(data + SearchUrlTemplate * referenceSize));
+    engine->setSearchMethod(string(data + SearchMethod * referenceSize));
+    engine->setSearchParameters(parameters(data + (FieldCount + SearchParameters) * referenceSize));
+    engine->setSuggestionsUrlTemplate(string(data + SuggestionsUrlTemplate * referenceSize));
+    engine->setSuggestionsMethod(string(data + SuggestionsMethod * referenceSize));
+    engine->setSuggestionsParameters(parameters(data + (FieldCount + SuggestionsParameters) * referenceSize));
+    engine->setImageUrl(string(data + ImageUrl * referenceSize));
+    engine->setTags(tags(index));
+
+    OpenSearchDescription::Urls urls = additionalUrls(data + (FieldCount + AdditionalUrls) * referenceSize);
+    if (!urls.isEmpty()) {
+        OpenSearchDescription description = engine->openSearchDescription();
+        description.setAdditionalUrls(urls);
+        engine->setOpenSearchDescription(description);
+    }
+    return engine;
+}
+
+/*!
+    Writes a snapshot of \a engines to the \a device, along with \a sourceChecksum,
+    usually computed with checksum() from the files the engines have been read from.
+
+    If the \a device is closed, it will be opened.
+
+    \return true on success and false on failure.
+
+    \sa OpenSearchWriter::writeSnapshot()
+*/
+bool OpenSearchSnapshot::write(QIODevice *device, const QList<OpenSearchEngine*> &engines, quint64 sourceChecksum)
+{
+    if (!device->isOpen()) {
+        if (!device->open(QIODevice::WriteOnly))
+            return false;
+    }
+
+    StringTable strings;
+    QByteArray records;
+    QByteArray parameters;
+    QByteArray urls;
+    quint32 parameterCount = 0;
+    quint32 urlCount = 0;
+    quint32 engineCount = 0;
+
+    foreach (OpenSearchEngine *engine, engines) {
+        if (!engine)
+            continue;
+
+        strings.append(&records, engine->name());
+        strings.append(&records, engine->description());
+        strings.append(&records, engine->searchUrlTemplate());
+        strings.append(&records, engine->searchMethod());
+        strings.append(&records, engine->suggestionsUrlTemplate());
+        strings.append(&records, engine->suggestionsMethod());
+        strings.append(&records, engine->imageUrl());
+        strings.append(&records, engine->tags().join(QLatin1String(" ")));
+
+        const OpenSearchEngine::Parameters lists[] = {
+            engine->searchParameters(),
+            engine->suggestionsParameters()
+        };
+
+        for (int i = 0; i < 2; ++i)
+            appendParameters(&records, &parameters, &parameterCount, &strings, lists[i]);
+
+        const OpenSearchDescription::Urls additionalUrls = engine->openSearchDescription().additionalUrls();
+        appendUInt32(&records, urlCount);
+        appendUInt32(&records, additionalUrls.count());
+
+        foreach (const OpenSearchDescription::Url &url, additionalUrls) {
+            strings.append(&urls, url.type);
+            strings.append(&urls, url.rel);
+            strings.append(&urls, url.urlTemplate);
+            strings.append(&urls, url.method);
+            appendParameters(&urls, &parameters, &parameterCount, &strings, url.parameters);
+            ++urlCount;
+        }
+
+        ++engineCount;
+    }
+
+    QByteArray header(magic, sizeof(magic));
+    appendUInt32(&header, Version);
+    appendUInt32(&header, engineCount);
+    appendUInt32(&header, parameterCount);
+
+    uchar checksum[8];
+    qToLittleEndian<quint64>(sourceChecksum, checksum);
+    header.append(reinterpret_cast<const char*>(checksum), 8);
+
+    appendUInt32(&header, headerSize + records.size() + parameters.size() + urls.size());
+    appendUInt32(&header, strings.data().size());
+    appendUInt32(&header, urlCount);
+
+    return (device->write(header) == header.size()
+            && device->write(records) == records.size()
+            && device->write(parameters) == parameters.size()
+            && device->write(urls) == urls.size()
+            && device->write(strings.data()) == strings.data().size());
+}
+
+/*!
+    Returns a checksum of the names, sizes and modification times of the files with
+    the given \a sourceFileNames, in the given order.
+*/
+quint64 OpenSearchSnapshot::checksum(const QStringList &sourceFileNames)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    foreach (const QString &fileName, sourceFileNames) {
+        QFileInfo info(fileName);
+        QByteArray data = fileName.toUtf8();
+        data.append('\0');
+        data.append(QByteArray::number(info.size()));
+        data.append('\0');
+        data.append(QByteArray::number(info.lastModified().toTime_t()));
+        data.append('\0');
+        hash.addData(data);
+    }
+
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(hash.result().constData()));
+}
+
+/*!
+    Returns the engines described by the files with the given \a sourceFileNames.
+
+    They are read from the snapshot stored in \a snapshotFileName if it is up to date.
+    Otherwise, the files are read with OpenSearchBatchReader, skipping the malformed ones,
+    and the snapshot is rewritten for the next time.
+
+    \note The lifetime of the returned objects is up to the user.
+*/
+QList<OpenSearchEngine*> OpenSearchSnapshot::loadEngines(const QString &snapshotFileName,
+                                                         const QStringList &sourceFileNames)
+{
+    QList<OpenSearchEngine*> engines;
+    quint64 sourceChecksum = checksum(sourceFileNames);
+
+    OpenSearchSnapshot snapshot;
+    if (snapshot.open(snapshotFileName) && snapshot.sourceChecksum() == sourceChecksum) {
+        for (int i = 0; i < snapshot.count(); ++i)
+            engines.append(snapshot.engine(i));
+        return engines;
+    }
+    snapshot.close();
+
+    OpenSearchBatchReader reader;
+    OpenSearchBatchReader::Results results = reader.readFiles(sourceFileNames);
+    foreach (const OpenSearchBatchReader::Result &result, results) {
+        if (result.engine)
+            engines.append(result.engine);
+    }
+
+    QFile file(snapshotFileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        write(&file, engines, sourceChecksum);
+
+    return engines;
+}
+
+bool OpenSearchSnapshot::validate() const
+{
+    if (qstrncmp(reinterpret_cast<const char*>(m_data), magic, sizeof(magic)) != 0 || readUInt32(m_data + 4) != Version)
+        return false;
+
+    qint64 engineCount = readUInt32(m_data + 8);
+    qint64 parameterCount = readUInt32(m_data + 12);
+    qint64 stringTableOffset = readUInt32(m_data + 24);
+    qint64 stringTableSize = readUInt32(m_data + 28);
+    qint64 urlCount = readUInt32(m_data + 32);
+    qint64 recordSize = (FieldCount + RangeCount) * referenceSize;
+
+    if (stringTableOffset != headerSize + engineCount * recordSize + parameterCount * parameterSize
+                             + urlCount * urlSize
+        || stringTableOffset + stringTableSize > m_size)
+        return false;
+
+    // Check every reference once, so that the accessors do not need to.
+    const uchar *references = m_data + headerSize;
+    for (qint64 i = 0; i < engineCount; ++i, references += recordSize) {
+        for (int j = 0; j < FieldCount; ++j) {
+            const uchar *reference = references + j * referenceSize;
+            if (readUInt32(reference) % 2
+                || qint64(readUInt32(reference)) + 2 * qint64(readUInt32(reference + 4)) > stringTableSize)
+                return false;
+        }
+
+        for (int j = SearchParameters; j < RangeCount; ++j) {
+            const uchar *reference = references + (FieldCount + j) * referenceSize;
+            if (qint64(readUInt32(reference)) + readUInt32(reference + 4)
+                > (j == AdditionalUrls ? urlCount : parameterCount))
+                return false;
+        }
+    }
+
+    for (qint64 i = 0; i < 2 * parameterCount; ++i, references += referenceSize) {
+        if (readUInt32(references) % 2
+            || qint64(readUInt32(references)) + 2 * qint64(readUInt32(references + 4)) > stringTableSize)
+            return false;
+    }
+
+    for (qint64 i = 0; i < urlCount; ++i, references += urlSize) {
+        for (int j = 0; j < 4; ++j) {
+            const uchar *reference = references + j * referenceSize;
+            if (readUInt32(reference) % 2
+                || qint64(readUInt32(reference)) + 2 * qint64(readUInt32(reference + 4)) > stringTableSize)
+                return false;
+        }
+
+        const uchar *reference = references + 4 * referenceSize;
+        if (qint64(readUInt32(reference)) + readUInt32(reference + 4) > parameterCount)
+            return false;
+    }
+
+    return true;
+}
+
+const uchar *OpenSearchSnapshot::record(int index) const
+{
+    if (index < 0 || index >= count())
+        return 0;
+
+    return m_data + headerSize + index * (FieldCount + RangeCount) * referenceSize;
+}
+
+QString OpenSearchSnapshot::string(const uchar *reference) const
+{
+    quint32 length = readUInt32(reference + 4);
+    if (!length)
+        return QString();
+
+    const uchar *data = m_data + readUInt32(m_data + 24) + readUInt32(reference);
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return QString(reinterpret_cast<const QChar*>(data), length);
+#else
+    QString string;
+    string.resize(length);
+    QChar *unicode = string.data();
+    for (quint32 i = 0; i < length; ++i)
+        unicode[i] = QChar(qFromLittleEndian<quint16>(data + 2 * i));
+    return string;
+#endif
+}
+
+QString OpenSearchSnapshot::field(int index, Field field) const
+{
+    const uchar *data = record(index);
+    if (!data)
+        return QString();
+
+    return string(data + field * referenceSize);
+}
+
+OpenSearchEngine::Parameters OpenSearchSnapshot::parameters(const uchar *reference) const
+{
+    OpenSearchEngine::Parameters parameters;
+
+    quint32 first = readUInt32(reference);
+    quint32 size = readUInt32(reference + 4);
+    const uchar *data = m_data + headerSize + count() * (FieldCount + RangeCount) * referenceSize
+                        + first * parameterSize;
+
+    for (quint32 i = 0; i < size; ++i, data += parameterSize)
+        parameters.append(OpenSearchEngine::Parameter(string(data), string(data + referenceSize)));
+
+    return parameters;
+}
+
+OpenSearchDescription::Urls OpenSearchSnapshot::additionalUrls(const uchar *reference) const
+{
+    OpenSearchDescription::Urls urls;
+
+    quint32 first = readUInt32(reference);
+    quint32 size = readUInt32(reference + 4);
+    const uchar *data = m_data + headerSize + count() * (FieldCount + RangeCount) * referenceSize
+                        + readUInt32(m_data + 12) * parameterSize + first * urlSize;
+
+    for (quint32 i = 0; i < size; ++i, data += urlSize) {
+        OpenSearchDescription::Url url;
+        url.type = string(data);
+        url.rel = string(data + referenceSize);
+        url.urlTemplate = string(data + 2 * referenceSize);
+        url.method = string(data + 3 * referenceSize);
+        url.parameters = parameters(data + 4 * referenceSize);
+        urls.append(url);
+    }
+
+    return urls;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHSNAPSHOT_H
+#define OPENSEARCHSNAPSHOT_H
+
+#include <qfile.h>
+#include <qlist.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+#include "opensearchengine.h"
+
+class QIODevice;
+class QObject;
+
+class OpenSearchSnapshot
+{
+public:
+    enum { Version = 2 };
+
+    OpenSearchSnapshot();
+    ~OpenSearchSnapshot();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+
+    quint64 sourceChecksum() const;
+    bool isUpToDate(const QStringList &sourceFileNames) const;
+
+    int count() const;
+    QString name(int index) const;
+    QString description(int index) const;
+    QString searchUrlTemplate(int index) const;
+    QString suggestionsUrlTemplate(int index) const;
+    QString imageUrl(int index) const;
+    QStringList tags(int index) const;
+
+    OpenSearchEngine *engine(int index, QObject *parent = 0) const;
+
+    static bool write(QIODevice *device, const QList<OpenSearchEngine*> &engines, quint64 sourceChecksum = 0);
+    static quint64 checksum(const QStringList &sourceFileNames);
+    static QList<OpenSearchEngine*> loadEngines(const QString &snapshotFileName,
+                                                const QStringList &sourceFileNames);
+
+private:
+    enum Field {
+        Name,
+        Description,
+        SearchUrlTemplate,
+        SearchMethod,
+        SuggestionsUrlTemplate,
+        SuggestionsMethod,
+        ImageUrl,
+        Tags,
+        FieldCount
+    };
+
+    enum Range {
+        SearchParameters,
+        SuggestionsParameters,
+        AdditionalUrls,
+        RangeCount
+    };
+
+    bool validate() const;
+    const uchar *record(int index) const;
+    QString string(const uchar *reference) const;
+    QString field(int index, Field field) const;
+    OpenSearchEngine::Parameters parameters(const uchar *reference) const;
+    OpenSearchDescription::Urls additionalUrls(const uchar *reference) const;
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+};
+
+#endif // OPENSEARCHSNAPSHOT_H
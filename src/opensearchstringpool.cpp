@@ -0,0 +1,220 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include "opensearchstringpool.h"
+
+#include <qmutex.h>
+#include <qset.h>
+
+namespace {
+
+struct StringPool
+{
+    QMutex mutex;
+    QSet<QString> strings;
+    QSet<QByteArray> data;
+};
+
+}
+
+Q_GLOBAL_STATIC(StringPool, stringPool)
+
+/*!
+    \class OpenSearchStringPool
+    \brief A process-wide pool of the strings shared by many descriptions
+
+    Large catalogs hold thousands of descriptions, which repeat the same strings over
+    and over: parameter names and values, MIME types, request methods, tags, and the
+    URL templates of the engines that only differ in their language. intern() returns
+    the copy of a string held by the pool, so that equal strings share one buffer
+    through implicit sharing instead of each description allocating its own.
+
+    OpenSearchDescription interns those strings when they are set, as well as the pieces
+    of its compiled URL templates. The pool is safe to use from any thread.
+
+    Pooled strings are kept until releaseUnused() is called, which frees the ones that
+    are not referenced anywhere else anymore, e.g. after a catalog has been unloaded.
+*/
+
+/*!
+    Returns the pooled copy of \a string, adding it to the pool first if necessary.
+*/
+QString OpenSearchStringPool::intern(const QString &string)
+{
+    StringPool *pool = stringPool();
+    if (string.isEmpty() || !pool)
+        return string;
+
+    QMutexLocker locker(&pool->mutex);
+    QSet<QString>::const_iterator i = pool->strings.constFind(string);
+    if (i != pool->strings.constEnd())
+        return *i;
+
+    pool->strings.insert(string);
+    return string;
+}
+
+/*!
+    \overload
+
+    Returns the list of the pooled copies of \a strings.
+*/
+QStringList OpenSearchStringPool::intern(const QStringList &strings)
+{
+    QStringList interned;
+    interned.reserve(strings.count());
+    foreach (const QString &string, strings)
+        interned.append(intern(string));
+    return interned;
+}
+
+/*!
+    \overload
+
+    Returns the pooled copy of \a data, adding it to the pool first if necessary.
+    The data must not have been created with QByteArray::fromRawData().
+*/
+QByteArray OpenSearchStringPool::intern(const QByteArray &data)
+{
+    StringPool *pool = stringPool();
+    if (data.isEmpty() || !pool)
+        return data;
+
+    QMutexLocker locker(&pool->mutex);
+    QSet<QByteArray>::const_iterator i = pool->data.constFind(data);
+    if (i != pool->data.constEnd())
+        return *i;
+
+    pool->data.insert(data);
+    return data;
+}
+
+/*!
+    Returns true if \a string shares its buffer with the pool.
+*/
+bool OpenSearchStringPool::contains(const QString &string)
+{
+    StringPool *pool = stringPool();
+    if (string.isEmpty() || !pool)
+        return false;
+
+    QMutexLocker locker(&pool->mutex);
+    QSet<QString>::const_iterator i = pool->strings.constFind(string);
+    return (i != pool->strings.constEnd() && i->constData() == string.constData());
+}
+
+/*!
+    \overload
+*/
+bool OpenSearchStringPool::contains(const QByteArray &data)
+{
+    StringPool *pool = stringPool();
+    if (data.isEmpty() || !pool)
+        return false;
+
+    QMutexLocker locker(&pool->mutex);
+    QSet<QByteArray>::const_iterator i = pool->data.constFind(data);
+    return (i != pool->data.constEnd() && i->constData() == data.constData());
+}
+
+/*!
+    Returns the number of bytes allocated for \a string, or 0 if it is pooled, in which
+    case it is accounted for by memoryUsage().
+*/
+qint64 OpenSearchStringPool::sizeOf(const QString &string)
+{
+    if (string.isEmpty() || contains(string))
+        return 0;
+
+    return string.capacity() * sizeof(QChar);
+}
+
+/*!
+    \overload
+*/
+qint64 OpenSearchStringPool::sizeOf(const QByteArray &data)
+{
+    if (data.isEmpty() || contains(data))
+        return 0;
+
+    return data.capacity();
+}
+
+/*!
+    Returns the number of strings in the pool.
+*/
+int OpenSearchStringPool::count()
+{
+    StringPool *pool = stringPool();
+    if (!pool)
+        return 0;
+
+    QMutexLocker locker(&pool->mutex);
+    return pool->strings.count() + pool->data.count();
+}
+
+/*!
+    Returns the approximate number of bytes held by the pool.
+*/
+qint64 OpenSearchStringPool::memoryUsage()
+{
+    StringPool *pool = stringPool();
+    if (!pool)
+        return 0;
+
+    QMutexLocker locker(&pool->mutex);
+
+    // Every entry takes a node of the hash, besides its buffer.
+    qint64 size = (pool->strings.count() + pool->data.count()) * 3 * sizeof(void*);
+    foreach (const QString &string, pool->strings)
+        size += string.capacity() * sizeof(QChar);
+    foreach (const QByteArray &data, pool->data)
+        size += data.capacity();
+
+    return size;
+}
+
+/*!
+    Removes the strings that are only referenced by the pool.
+*/
+void OpenSearchStringPool::releaseUnused()
+{
+    StringPool *pool = stringPool();
+    if (!pool)
+        return;
+
+    QMutexLocker locker(&pool->mutex);
+
+    QSet<QString>::iterator i = pool->strings.begin();
+    while (i != pool->strings.end()) {
+        if (i->isDetached())
+            i = pool->strings.erase(i);
+        else
+            ++i;
+    }
+
+    QSet<QByteArray>::iterator j = pool->data.begin();
+    while (j != pool->data.end()) {
+        if (j->isDetached())
+            j = pool->data.erase(j);
+        else
+            ++j;
+    }
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchsuggestionscache.h"
+
+/*!
+    \class OpenSearchSuggestionsCache
+    \brief An in-memory cache of contextual suggestions
+
+    OpenSearchSuggestionsCache keeps the most recently received suggestions, keyed
+    by the engine they come from and the normalized search term. It can be set on
+    one or more engines with OpenSearchEngine::setSuggestionsCache(), which will then
+    answer repeated queries from the cache, without performing any network requests.
+
+    The cache holds at most maximumSize() entries, evicting the least recently used
+    ones first, and entries older than timeToLive() are not used.
+
+    Optionally, when there is no entry for a search term, the cache can filter the
+    suggestions cached for one of its prefixes instead, see setPrefixFiltering().
+
+    \sa OpenSearchEngine::requestSuggestions()
+*/
+
+/*!
+    Constructs a cache holding at most \a maximumSize entries, each of them valid for
+    \a timeToLive milliseconds.
+*/
+OpenSearchSuggestionsCache::OpenSearchSuggestionsCache(int maximumSize, int timeToLive)
+    : m_entries(maximumSize)
+    , m_timeToLive(timeToLive)
+    , m_prefixFiltering(false)
+    , m_hits(0)
+    , m_misses(0)
+{
+    m_clock.start();
+}
+
+/*!
+    Destroys the cache.
+*/
+OpenSearchSuggestionsCache::~OpenSearchSuggestionsCache()
+{
+}
+
+/*!
+    Returns the maximum number of entries held by the cache.
+*/
+int OpenSearchSuggestionsCache::maximumSize() const
+{
+    return m_entries.maxCost();
+}
+
+/*!
+    Sets the maximum number of entries held by the cache to \a size, evicting
+    the least recently used entries if necessary.
+*/
+void OpenSearchSuggestionsCache::setMaximumSize(int size)
+{
+    m_entries.setMaxCost(qMax(0, size));
+}
+
+/*!
+    Returns the time, in milliseconds, for which entries are considered valid.
+    0 means that entries never expire.
+*/
+int OpenSearchSuggestionsCache::timeToLive() const
+{
+    return m_timeToLive;
+}
+
+/*!
+    Sets the time for which entries are considered valid to \a msecs milliseconds.
+*/
+void OpenSearchSuggestionsCache::setTimeToLive(int msecs)
+{
+    m_timeToLive = qMax(0, msecs);
+}
+
+/*!
+    Returns true if cached suggestions for prefixes of a search term are used
+    when the term itself is not cached.
+*/
+bool OpenSearchSuggestionsCache::prefixFiltering() const
+{
+    return m_prefixFiltering;
+}
+
+/*!
+    Enables or disables prefix filtering, according to \a enabled.
+
+    When enabled, a lookup for e.g. "weath" that is not cached is answered with the
+    suggestions cached for the longest prefix, such as "wea", which start with "weath".
+    As engines only return a limited number of suggestions, the result can be less
+    complete than what the engine would return. The default is disabled.
+*/
+void OpenSearchSuggestionsCache::setPrefixFiltering(bool enabled)
+{
+    m_prefixFiltering = enabled;
+}
+
+/*!
+    Looks up the suggestions cached for \a searchTerm and the engine identified by
+    \a engineKey. If found, they are stored in \a suggestions.
+
+    \return true on a cache hit and false otherwise.
+*/
+bool OpenSearchSuggestionsCache::lookup(const QString &engineKey, const QString &searchTerm, QStringList *suggestions)
+{
+    QString term = normalizedTerm(searchTerm);
+
+    if (Entry *cached = entry(key(engineKey, term))) {
+        ++m_hits;
+        *suggestions = cached->suggestions;
+        return true;
+    }
+
+    if (m_prefixFiltering) {
+        for (int length = term.length() - 1; length > 0; --length) {
+            Entry *cached = entry(key(engineKey, term.left(length)));
+            if (!cached)
+                continue;
+
+            QStringList filtered;
+            QStringList::const_iterator end = cached->suggestions.constEnd();
+            QStringList::const_iterator i = cached->suggestions.constBegin();
+            for (; i != end; ++i) {
+                if (i->startsWith(term, Qt::CaseInsensitive))
+                    filtered.append(*i);
+            }
+
+            // The longest cached prefix decides, an empty result is not trusted.
+            if (filtered.isEmpty())
+                break;
+
+            ++m_hits;
+            *suggestions = filtered;
+            return true;
+        }
+    }
+
+    ++m_misses;
+    return false;
+}
+
+/*!
+    Stores \a suggestions received for \a searchTerm from the engine identified
+    by \a engineKey.
+*/
+void OpenSearchSuggestionsCache::insert(const QString &engineKey, const QString &searchTerm, const QStringList &suggestions)
+{
+    Entry *cached = new Entry;
+    cached->suggestions = suggestions;
+    cached->timestamp = m_clock.elapsed();
+    m_entries.insert(key(engineKey, normalizedTerm(searchTerm)), cached);
+}
+
+/*!
+    Removes all entries from the cache.
+*/
+void OpenSearchSuggestionsCache::clear()
+{
+    m_entries.clear();
+}
+
+/*!
+    Returns the number of entries in the cache, including expired ones that
+    have not been removed yet.
+*/
+int OpenSearchSuggestionsCache::count() const
+{
+    return m_entries.count();
+}
+
+/*!
+    Returns the number of lookups that have been answered from the cache.
+*/
+int OpenSearchSuggestionsCache::hits() const
+{
+    return m_hits;
+}
+
+/*!
+    Returns the number of lookups that could not be answered from the cache.
+*/
+int OpenSearchSuggestionsCache::misses() const
+{
+    return m_misses;
+}
+
+/*!
+    Resets the hits() and misses() counters.
+*/
+void OpenSearchSuggestionsCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+/*!
+    Returns the normalized form of \a searchTerm, which is used as the cache key:
+    with whitespace simplified and converted to lower case.
+*/
+QString OpenSearchSuggestionsCache::normalizedTerm(const QString &searchTerm)
+{
+    return searchTerm.simplified().toLower();
+}
+
+QString OpenSearchSuggestionsCache::key(const QString &engineKey, const QString &normalizedTerm)
+{
+    return engineKey + QLatin1Char('\n') + normalizedTerm;
+}
+
+OpenSearchSuggestionsCache::Entry *OpenSearchSuggestionsCache::entry(const QString &key)
+{
+    Entry *cached = m_entries.object(key);
+    if (!cached)
+        return 0;
+
+    if (m_timeToLive > 0 && m_clock.elapsed() - cached->timestamp > m_timeToLive) {
+        m_entries.remove(key);
+        return 0;
+    }
+
+    return cached;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHSUGGESTIONSCACHE_H
+#define OPENSEARCHSUGGESTIONSCACHE_H
+
+#include <qcache.h>
+#include <qelapsedtimer.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+class OpenSearchSuggestionsCache
+{
+public:
+    OpenSearchSuggestionsCache(int maximumSize = 256, int timeToLive = 5 * 60 * 1000);
+    ~OpenSearchSuggestionsCache();
+
+    int maximumSize() const;
+    void setMaximumSize(int size);
+
+    int timeToLive() const;
+    void setTimeToLive(int msecs);
+
+    bool prefixFiltering() const;
+    void setPrefixFiltering(bool enabled);
+
+    bool lookup(const QString &engineKey, const QString &searchTerm, QStringList *suggestions);
+    void insert(const QString &engineKey, const QString &searchTerm, const QStringList &suggestions);
+    void clear();
+
+    int count() const;
+    int hits() const;
+    int misses() const;
+    void resetStatistics();
+
+    static QString normalizedTerm(const QString &searchTerm);
+
+private:
+    struct Entry
+    {
+        QStringList suggestions;
+        qint64 timestamp;
+    };
+
+    static QString key(const QString &engineKey, const QString &normalizedTerm);
+    Entry *entry(const QString &key);
+
+    QCache<QString, Entry> m_entries;
+    QElapsedTimer m_clock;
+    int m_timeToLive;
+    bool m_prefixFiltering;
+    int m_hits;
+    int m_misses;
+};
+
+#endif // OPENSEARCHSUGGESTIONSCACHE_H
@@ -0,0 +1,731 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchsuggestionsindex.h"
+
+#include "opensearchsuggestionscache.h"
+
+#include <qalgorithms.h>
+#include <qendian.h>
+#include <qiodevice.h>
+#include <qvector.h>
+
+// All integers are stored in little endian, strings in UTF-16LE.
+//
+// Header:      magic "OSSI", version, term count, string table offset, string table size
+// Terms:       key and text string references, followed by the weight, sorted by key
+// Strings:     references are (byte offset, length), a text equal to its key is stored once
+
+static const char magic[] = { 'O', 'S', 'S', 'I' };
+
+static const int headerSize = 20;
+static const int referenceSize = 8;
+static const int recordSize = 2 * referenceSize + 4;
+
+static const quint32 maximumWeight = 0x7fffffff;
+
+static inline quint32 readUInt32(const uchar *data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+static inline void appendUInt32(QByteArray *data, quint32 value)
+{
+    uchar buffer[4];
+    qToLittleEndian<quint32>(value, buffer);
+    data->append(reinterpret_cast<const char*>(buffer), 4);
+}
+
+static void appendString(QByteArray *data, const QString &string)
+{
+    const ushort *unicode = string.utf16();
+    for (int i = 0; i < string.length(); ++i) {
+        uchar buffer[2];
+        qToLittleEndian<quint16>(unicode[i], buffer);
+        data->append(reinterpret_cast<const char*>(buffer), 2);
+    }
+}
+
+static inline quint32 addWeights(quint32 weight, quint32 other)
+{
+    return qMin(maximumWeight, weight + other);
+}
+
+// Returns the lowest of the \a count heaviest \a weights, and in \a ties, how many of
+// the weights equal to it are among them.
+static quint32 cutoffWeight(QVector<quint32> weights, int count, int *ties)
+{
+    *ties = 0;
+    if (count <= 0)
+        return maximumWeight + 1;
+    if (weights.count() <= count)
+        return 0;
+
+    qSort(weights.begin(), weights.end(), qGreater<quint32>());
+    quint32 cutoff = weights.at(count - 1);
+
+    int first = count - 1;
+    while (first > 0 && weights.at(first - 1) == cutoff)
+        --first;
+    *ties = count - first;
+
+    return cutoff;
+}
+
+static inline bool isKept(quint32 weight, quint32 cutoff, int *ties)
+{
+    if (weight > cutoff)
+        return true;
+    if (weight < cutoff || *ties <= 0)
+        return false;
+
+    --*ties;
+    return true;
+}
+
+/*!
+    \class OpenSearchSuggestionsIndex
+    \brief A local index of suggested search terms, answering prefix lookups
+
+    OpenSearchSuggestionsIndex keeps search terms with a weight, such as how many
+    times they have been suggested, and returns the heaviest ones starting with a given
+    prefix. When set on an engine with OpenSearchEngine::setSuggestionsIndex(), it
+    answers requestSuggestions() right away, before the network replies, or instead of
+    it when there is no network access manager. The suggestions received from the engine
+    are added to the index.
+
+    Terms are compared in their normalized form, see
+    OpenSearchSuggestionsCache::normalizedTerm(), and returned the way they have been
+    added first.
+
+    The index can be stored in a file with save() and mapped back into memory with
+    open(), so that it does not use any memory until it is looked up. Terms added
+    later are kept in memory, at most maximumSize() of them, until the next save().
+    A list of terms can be imported with import().
+
+    The index is not thread safe.
+
+    \sa OpenSearchSuggestionsCache
+*/
+
+/*!
+    Constructs an empty index keeping at most \a maximumSize terms.
+*/
+OpenSearchSuggestionsIndex::OpenSearchSuggestionsIndex(int maximumSize)
+    : m_maximumSize(qMax(0, maximumSize))
+    , m_maximumResults(10)
+    , m_data(0)
+    , m_size(0)
+{
+}
+
+/*!
+    Destroys the index, unmapping its file. The terms that have not been saved are lost.
+*/
+OpenSearchSuggestionsIndex::~OpenSearchSuggestionsIndex()
+{
+    close();
+}
+
+/*!
+    Returns the maximum number of terms kept in memory, and written by save().
+*/
+int OpenSearchSuggestionsIndex::maximumSize() const
+{
+    return m_maximumSize;
+}
+
+/*!
+    Sets the maximum number of terms to \a size. When there are more terms in memory,
+    the lightest ones are removed, leaving room for a quarter more.
+*/
+void OpenSearchSuggestionsIndex::setMaximumSize(int size)
+{
+    m_maximumSize = qMax(0, size);
+
+    if (m_terms.count() > m_maximumSize)
+        prune();
+}
+
+/*!
+    Returns the maximum number of terms returned by lookup(). The default is 10.
+*/
+int OpenSearchSuggestionsIndex::maximumResults() const
+{
+    return m_maximumResults;
+}
+
+/*!
+    Sets the maximum number of terms returned by lookup() to \a count.
+*/
+void OpenSearchSuggestionsIndex::setMaximumResults(int count)
+{
+    m_maximumResults = qMax(0, count);
+}
+
+/*!
+    Returns the heaviest terms starting with \a prefix, at most maximumResults() of them,
+    the heaviest first. Terms of the same weight are returned in alphabetical order.
+*/
+QStringList OpenSearchSuggestionsIndex::lookup(const QString &prefix) const
+{
+    QString key = OpenSearchSuggestionsCache::normalizedTerm(prefix);
+    if (key.isEmpty() || m_maximumResults <= 0)
+        return QStringList();
+
+    QList<Match> matches;
+
+    // The file and the memory are both sorted, the terms matching the prefix follow each other.
+    int count = recordCount();
+    int i = lowerBound(key);
+    QMap<QString, Term>::const_iterator j = m_terms.lowerBound(key);
+    QMap<QString, Term>::const_iterator end = m_terms.constEnd();
+
+    forever {
+        bool inFile = (i < count && keyStartsWith(i, key));
+        bool inMemory = (j != end && j.key().startsWith(key));
+        if (!inFile && !inMemory)
+            break;
+
+        int order = (inFile && inMemory) ? compareKey(i, j.key()) : (inFile ? -1 : 1);
+
+        Match match;
+        match.weight = 0;
+        match.record = -1;
+
+        if (order <= 0) {
+            match.record = i++;
+            match.weight = readUInt32(record(match.record) + 2 * referenceSize);
+        }
+
+        if (order >= 0) {
+            if (match.record == -1)
+                match.text = j->text;
+            match.weight = addWeights(match.weight, j->weight);
+            ++j;
+        }
+
+        if (matches.count() == m_maximumResults && match.weight <= matches.last().weight)
+            continue;
+
+        int position = matches.count();
+        while (position > 0 && matches.at(position - 1).weight < match.weight)
+            --position;
+
+        matches.insert(position, match);
+        if (matches.count() > m_maximumResults)
+            matches.removeLast();
+    }
+
+    QStringList terms;
+    foreach (const Match &match, matches)
+        terms.append(match.record == -1 ? match.text : string(record(match.record) + referenceSize));
+
+    return terms;
+}
+
+/*!
+    Adds \a weight to the \a term, adding the term if it is not in the index yet.
+*/
+void OpenSearchSuggestionsIndex::insert(const QString &term, int weight)
+{
+    if (weight <= 0)
+        return;
+
+    QString key = OpenSearchSuggestionsCache::normalizedTerm(term);
+    if (key.isEmpty())
+        return;
+
+    QMap<QString, Term>::iterator i = m_terms.find(key);
+    if (i != m_terms.end()) {
+        i->weight = addWeights(i->weight, weight);
+        return;
+    }
+
+    Term added;
+    added.text = term.simplified();
+    added.weight = qMin(maximumWeight, quint32(weight));
+    m_terms.insert(key, added);
+
+    if (m_terms.count() > m_maximumSize)
+        prune();
+}
+
+/*!
+    \overload
+
+    Adds each of the \a terms once, as done with the suggestions received by engines.
+*/
+void OpenSearchSuggestionsIndex::insert(const QStringList &terms)
+{
+    foreach (const QString &term, terms)
+        insert(term);
+}
+
+/*!
+    Imports the terms listed in the \a device, which is a UTF-8 text with one term per
+    line, optionally followed by a tab and its weight. Empty lines and lines starting
+    with # are skipped.
+
+    If the \a device is closed, it will be opened.
+
+    \return the number of terms that have been imported.
+*/
+int OpenSearchSuggestionsIndex::import(QIODevice *device)
+{
+    if (!device->isOpen()) {
+        if (!device->open(QIODevice::ReadOnly | QIODevice::Text))
+            return 0;
+    }
+
+    int imported = 0;
+
+    while (!device->atEnd()) {
+        QString line = QString::fromUtf8(device->readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            continue;
+
+        int weight = 1;
+        int tab = line.lastIndexOf(QLatin1Char('\t'));
+        if (tab != -1) {
+            bool ok;
+            int value = line.mid(tab + 1).toInt(&ok);
+            if (ok) {
+                weight = value;
+                line.truncate(tab);
+            }
+        }
+
+        if (weight <= 0 || OpenSearchSuggestionsCache::normalizedTerm(line).isEmpty())
+            continue;
+
+        insert(line, weight);
+        ++imported;
+    }
+
+    return imported;
+}
+
+/*!
+    Removes all the terms from the index, closing its file, if any. The file is left intact.
+*/
+void OpenSearchSuggestionsIndex::clear()
+{
+    close();
+    m_terms.clear();
+}
+
+/*!
+    Returns the number of distinct terms in the index, both in its file and in memory.
+*/
+int OpenSearchSuggestionsIndex::count() const
+{
+    int count = recordCount();
+
+    QMap<QString, Term>::const_iterator end = m_terms.constEnd();
+    for (QMap<QString, Term>::const_iterator i = m_terms.constBegin(); i != end; ++i) {
+        if (find(i.key()) == -1)
+            ++count;
+    }
+
+    return count;
+}
+
+/*!
+    Returns true if the index contains the \a term.
+*/
+bool OpenSearchSuggestionsIndex::contains(const QString &term) const
+{
+    QString key = OpenSearchSuggestionsCache::normalizedTerm(term);
+    return m_terms.contains(key) || find(key) != -1;
+}
+
+/*!
+    Returns the weight of the \a term, or 0 if it is not in the index.
+*/
+int OpenSearchSuggestionsIndex::weight(const QString &term) const
+{
+    QString key = OpenSearchSuggestionsCache::normalizedTerm(term);
+    quint32 weight = 0;
+
+    int index = find(key);
+    if (index != -1)
+        weight = readUInt32(record(index) + 2 * referenceSize);
+
+    QMap<QString, Term>::const_iterator i = m_terms.constFind(key);
+    if (i != m_terms.constEnd())
+        weight = addWeights(weight, i->weight);
+
+    return weight;
+}
+
+/*!
+    Maps the index stored in the file with a given \a fileName into memory, in place of
+    the file that is currently open. The terms kept in memory are left alone.
+
+    \return true on success and false if the file cannot be mapped, has been written
+            with another version of the format or is malformed.
+
+    \sa save()
+*/
+bool OpenSearchSuggestionsIndex::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if (m_size >= headerSize)
+        m_data = m_file.map(0, m_size);
+
+    if (!m_data || !validate()) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+    Unmaps and closes the file of the index. Its terms are not looked up anymore.
+*/
+void OpenSearchSuggestionsIndex::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+
+    m_file.close();
+    m_data = 0;
+    m_size = 0;
+}
+
+/*!
+    Returns true if a valid index file is open.
+*/
+bool OpenSearchSuggestionsIndex::isOpen() const
+{
+    return m_data;
+}
+
+/*!
+    Writes the terms of the open file and the ones kept in memory, at most maximumSize()
+    of the heaviest, to the file with a given \a fileName, which is then opened in place
+    of the current one. The terms are not kept in memory anymore.
+
+    The previous file is only replaced once the new one has been written completely.
+
+    \return true on success and false on failure, in which case the previous file and
+            the terms in memory are left as they were.
+
+    \sa open()
+*/
+bool OpenSearchSuggestionsIndex::save(const QString &fileName)
+{
+    QStringList keys;
+    QList<Term> terms;
+    QVector<quint32> weights;
+
+    int count = recordCount();
+    int i = 0;
+    QMap<QString, Term>::const_iterator j = m_terms.constBegin();
+    QMap<QString, Term>::const_iterator end = m_terms.constEnd();
+
+    while (i < count || j != end) {
+        int order = (i < count && j != end) ? compareKey(i, j.key()) : (i < count ? -1 : 1);
+
+        QString key;
+        Term term;
+        term.weight = 0;
+
+        if (order <= 0) {
+            const uchar *data = record(i++);
+            key = string(data);
+            term.text = string(data + referenceSize);
+            term.weight = readUInt32(data + 2 * referenceSize);
+        }
+
+        if (order >= 0) {
+            if (order > 0) {
+                key = j.key();
+                term.text = j->text;
+            }
+            term.weight = addWeights(term.weight, j->weight);
+            ++j;
+        }
+
+        keys.append(key);
+        terms.append(term);
+        weights.append(term.weight);
+    }
+
+    int ties;
+    quint32 cutoff = cutoffWeight(weights, m_maximumSize, &ties);
+    weights.clear();
+
+    QByteArray records;
+    QByteArray strings;
+    quint32 termCount = 0;
+
+    for (int k = 0; k < keys.count(); ++k) {
+        const QString &key = keys.at(k);
+        const Term &term = terms.at(k);
+        if (!isKept(term.weight, cutoff, &ties))
+            continue;
+
+        quint32 keyOffset = strings.size();
+        appendString(&strings, key);
+
+        quint32 textOffset = keyOffset;
+        if (term.text != key) {
+            textOffset = strings.size();
+            appendString(&strings, term.text);
+        }
+
+        appendUInt32(&records, keyOffset);
+        appendUInt32(&records, key.length());
+        appendUInt32(&records, textOffset);
+        appendUInt32(&records, term.text.length());
+        appendUInt32(&records, term.weight);
+        ++termCount;
+    }
+
+    QByteArray header(magic, sizeof(magic));
+    appendUInt32(&header, Version);
+    appendUInt32(&header, termCount);
+    appendUInt32(&header, headerSize + records.size());
+    appendUInt32(&header, strings.size());
+
+    // Written next to the target first, which may be the file that is mapped.
+    QFile file(fileName + QLatin1String(".new"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    bool ok = (file.write(header) == header.size()
+               && file.write(records) == records.size()
+               && file.write(strings) == strings.size());
+    file.close();
+
+    if (!ok || file.error() != QFile::NoError) {
+        file.remove();
+        return false;
+    }
+
+    // The previous file is moved aside rather than removed, so that it can be put back
+    // if the new one cannot take its place. The mapping stays valid meanwhile.
+    QString backupFileName = fileName + QLatin1String(".old");
+    bool replacing = QFile::exists(fileName);
+    QFile::remove(backupFileName);
+    if (replacing && !QFile::rename(fileName, backupFileName)) {
+        file.remove();
+        return false;
+    }
+
+    if (!file.rename(fileName)) {
+        file.remove();
+        if (replacing)
+            QFile::rename(backupFileName, fileName);
+        return false;
+    }
+
+    QString previousFileName = isOpen() ? m_file.fileName() : QString();
+    close();
+    if (!open(fileName)) {
+        QFile::remove(fileName);
+        if (replacing)
+            QFile::rename(backupFileName, fileName);
+        if (!previousFileName.isEmpty())
+            open(previousFileName);
+        return false;
+    }
+
+    QFile::remove(backupFileName);
+    m_terms.clear();
+    return true;
+}
+
+bool OpenSearchSuggestionsIndex::validate() const
+{
+    if (qstrncmp(reinterpret_cast<const char*>(m_data), magic, sizeof(magic)) != 0 || readUInt32(m_data + 4) != Version)
+        return false;
+
+    qint64 termCount = readUInt32(m_data + 8);
+    qint64 stringTableOffset = readUInt32(m_data + 12);
+    qint64 stringTableSize = readUInt32(m_data + 16);
+
+    if (stringTableOffset != headerSize + termCount * recordSize
+        || stringTableOffset + stringTableSize > m_size)
+        return false;
+
+    // Check every reference once, so that the lookups do not need to.
+    const uchar *references = m_data + headerSize;
+    for (qint64 i = 0; i < termCount; ++i, references += recordSize) {
+        for (int j = 0; j < 2; ++j) {
+            const uchar *reference = references + j * referenceSize;
+            if (readUInt32(reference) % 2
+                || qint64(readUInt32(reference)) + 2 * qint64(readUInt32(reference + 4)) > stringTableSize)
+                return false;
+        }
+
+        // The lookups rely on the keys being sorted, which is checked in place.
+        if (!readUInt32(references + 4) || (i > 0 && compareKeys(i - 1, i) >= 0))
+            return false;
+    }
+
+    return true;
+}
+
+int OpenSearchSuggestionsIndex::recordCount() const
+{
+    if (!m_data)
+        return 0;
+
+    return readUInt32(m_data + 8);
+}
+
+const uchar *OpenSearchSuggestionsIndex::record(int index) const
+{
+    return m_data + headerSize + index * recordSize;
+}
+
+QString OpenSearchSuggestionsIndex::string(const uchar *reference) const
+{
+    quint32 length = readUInt32(reference + 4);
+    if (!length)
+        return QString();
+
+    const uchar *data = m_data + readUInt32(m_data + 12) + readUInt32(reference);
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return QString(reinterpret_cast<const QChar*>(data), length);
+#else
+    QString string;
+    string.resize(length);
+    QChar *unicode = string.data();
+    for (quint32 i = 0; i < length; ++i)
+        unicode[i] = QChar(qFromLittleEndian<quint16>(data + 2 * i));
+    return string;
+#endif
+}
+
+// Compares the key of the term at \a index with \a key, without building a string.
+int OpenSearchSuggestionsIndex::compareKey(int index, const QString &key) const
+{
+    const uchar *reference = record(index);
+    const uchar *data = m_data + readUInt32(m_data + 12) + readUInt32(reference);
+    int length = readUInt32(reference + 4);
+
+    const ushort *unicode = key.utf16();
+    int common = qMin(length, key.length());
+    for (int i = 0; i < common; ++i) {
+        ushort c = qFromLittleEndian<quint16>(data + 2 * i);
+        if (c != unicode[i])
+            return c < unicode[i] ? -1 : 1;
+    }
+
+    return length - key.length();
+}
+
+int OpenSearchSuggestionsIndex::compareKeys(int first, int second) const
+{
+    const uchar *strings = m_data + readUInt32(m_data + 12);
+    const uchar *firstReference = record(first);
+    const uchar *secondReference = record(second);
+    const uchar *firstData = strings + readUInt32(firstReference);
+    const uchar *secondData = strings + readUInt32(secondReference);
+    int firstLength = readUInt32(firstReference + 4);
+    int secondLength = readUInt32(secondReference + 4);
+
+    int common = qMin(firstLength, secondLength);
+    for (int i = 0; i < common; ++i) {
+        ushort c = qFromLittleEndian<quint16>(firstData + 2 * i);
+        ushort d = qFromLittleEndian<quint16>(secondData + 2 * i);
+        if (c != d)
+            return c < d ? -1 : 1;
+    }
+
+    return firstLength - secondLength;
+}
+
+bool OpenSearchSuggestionsIndex::keyStartsWith(int index, const QString &prefix) const
+{
+    const uchar *reference = record(index);
+    const uchar *data = m_data + readUInt32(m_data + 12) + readUInt32(reference);
+    int length = readUInt32(reference + 4);
+
+    if (length < prefix.length())
+        return false;
+
+    const ushort *unicode = prefix.utf16();
+    for (int i = 0; i < prefix.length(); ++i) {
+        if (qFromLittleEndian<quint16>(data + 2 * i) != unicode[i])
+            return false;
+    }
+
+    return true;
+}
+
+int OpenSearchSuggestionsIndex::lowerBound(const QString &key) const
+{
+    int first = 0;
+    int last = recordCount();
+
+    while (first < last) {
+        int middle = first + (last - first) / 2;
+        if (compareKey(middle, key) < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+int OpenSearchSuggestionsIndex::find(const QString &key) const
+{
+    int index = lowerBound(key);
+    if (index < recordCount() && compareKey(index, key) == 0)
+        return index;
+
+    return -1;
+}
+
+// Keeps the heaviest terms in memory, leaving room for new ones, so that the
+// index is not pruned again for each of them.
+void OpenSearchSuggestionsIndex::prune()
+{
+    QVector<quint32> weights;
+    weights.reserve(m_terms.count());
+
+    QMap<QString, Term>::const_iterator end = m_terms.constEnd();
+    for (QMap<QString, Term>::const_iterator i = m_terms.constBegin(); i != end; ++i)
+        weights.append(i->weight);
+
+    int ties;
+    quint32 cutoff = cutoffWeight(weights, m_maximumSize - m_maximumSize / 4, &ties);
+
+    QMap<QString, Term>::iterator i = m_terms.begin();
+    while (i != m_terms.end()) {
+        if (isKept(i->weight, cutoff, &ties))
+            ++i;
+        else
+            i = m_terms.erase(i);
+    }
+}
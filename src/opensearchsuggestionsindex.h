@@ -0,0 +1,93 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHSUGGESTIONSINDEX_H
+#define OPENSEARCHSUGGESTIONSINDEX_H
+
+#include <qfile.h>
+#include <qmap.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+class QIODevice;
+
+class OpenSearchSuggestionsIndex
+{
+public:
+    enum { Version = 1 };
+
+    OpenSearchSuggestionsIndex(int maximumSize = 10000);
+    ~OpenSearchSuggestionsIndex();
+
+    int maximumSize() const;
+    void setMaximumSize(int size);
+
+    int maximumResults() const;
+    void setMaximumResults(int count);
+
+    QStringList lookup(const QString &prefix) const;
+    void insert(const QString &term, int weight = 1);
+    void insert(const QStringList &terms);
+    int import(QIODevice *device);
+    void clear();
+
+    int count() const;
+    bool contains(const QString &term) const;
+    int weight(const QString &term) const;
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+    bool save(const QString &fileName);
+
+private:
+    struct Term
+    {
+        QString text;
+        quint32 weight;
+    };
+
+    struct Match
+    {
+        quint32 weight;
+        int record;
+        QString text;
+    };
+
+    bool validate() const;
+    int recordCount() const;
+    const uchar *record(int index) const;
+    QString string(const uchar *reference) const;
+    int compareKey(int index, const QString &key) const;
+    int compareKeys(int first, int second) const;
+    bool keyStartsWith(int index, const QString &prefix) const;
+    int lowerBound(const QString &key) const;
+    int find(const QString &key) const;
+    void prune();
+
+    QMap<QString, Term> m_terms;
+    int m_maximumSize;
+    int m_maximumResults;
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+};
+
+#endif // OPENSEARCHSUGGESTIONSINDEX_H
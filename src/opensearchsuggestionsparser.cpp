@@ -0,0 +1,629 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchsuggestionsparser.h"
+
+#include <qlist.h>
+#include <qset.h>
+#include <qthreadstorage.h>
+
+/*!
+    \class OpenSearchSuggestionsParser
+    \brief A class parsing responses to suggestion queries
+
+    OpenSearchSuggestionsParser is a streaming parser for the JSON format of
+    the OpenSearch Suggestions extension:
+
+    \code
+    ["sea", ["sears", "search engines"], ["7,390,000 results", "..."], ["http://...", "..."]]
+    \endcode
+
+    The parser validates the whole response, but only keeps the search term and
+    the list of suggestions, the remaining parts are skipped without being decoded.
+
+    Data can be supplied in arbitrary chunks with addData(), the state of the parser
+    is kept between the calls. Once all data has been supplied, finish() tells whether
+    the response was well formed.
+
+    For more information see:
+    http://www.opensearch.org/Specifications/OpenSearch/Extensions/Suggestions/1.1
+
+    Engines do not own a parser, they acquire() one for each suggestions request and
+    release() it as soon as the request is over. The parsers are kept in a context
+    local to the thread, which is shared by all the engines living on it, so the
+    memory held is bound to the number of requests running at once, rather than to
+    the number of engines that have ever been queried.
+
+    \sa OpenSearchEngine::requestSuggestions()
+*/
+
+namespace {
+
+// Only ever accessed from its own thread, so it needs no locking.
+struct ParserContext
+{
+    ~ParserContext()
+    {
+        // Parsers still in use are deleted when they are released.
+        qDeleteAll(idle);
+    }
+
+    QSet<OpenSearchSuggestionsParser*> parsers;
+    QList<OpenSearchSuggestionsParser*> idle;
+};
+
+}
+
+Q_GLOBAL_STATIC(QThreadStorage<ParserContext*>, parserContexts)
+
+static ParserContext *parserContext()
+{
+    QThreadStorage<ParserContext*> *contexts = parserContexts();
+    if (!contexts)
+        return 0;
+
+    if (!contexts->hasLocalData())
+        contexts->setLocalData(new ParserContext);
+
+    return contexts->localData();
+}
+
+static inline bool isWhitespace(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+static inline bool isLiteralCharacter(char c)
+{
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+            || c == '+' || c == '-' || c == '.');
+}
+
+static inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static bool isValidLiteral(const QByteArray &literal)
+{
+    if (literal == "true" || literal == "false" || literal == "null")
+        return true;
+
+    const char first = literal.at(0);
+    if (first != '-' && (first < '0' || first > '9'))
+        return false;
+
+    bool ok;
+    literal.toDouble(&ok);
+    return ok;
+}
+
+/*!
+    Constructs a new parser.
+*/
+OpenSearchSuggestionsParser::OpenSearchSuggestionsParser()
+{
+    reset();
+}
+
+/*!
+    Resets the parser, so that it can be used to parse another response.
+*/
+void OpenSearchSuggestionsParser::reset()
+{
+    m_state = StartState;
+    m_stack.clear();
+    m_topLevelIndex = 0;
+    m_collecting = false;
+    m_key = false;
+    m_buffer.clear();
+    m_unicode = 0;
+    m_unicodeDigits = 0;
+    m_highSurrogate = 0;
+    m_suggestionsComplete = false;
+    m_searchTerm.clear();
+    m_suggestions.clear();
+}
+
+/*!
+    Parses the next chunk of the response, held by \a data.
+
+    \return false if the response turned out not to be well formed.
+*/
+bool OpenSearchSuggestionsParser::addData(const QByteArray &data)
+{
+    return addData(data.constData(), data.size());
+}
+
+/*!
+    \overload
+
+    Parses \a size bytes of the response pointed to by \a data.
+*/
+bool OpenSearchSuggestionsParser::addData(const char *data, int size)
+{
+    const char *i = data;
+    const char *end = data + size;
+
+    while (i != end && m_state != ErrorState) {
+        const char c = *i;
+
+        switch (m_state) {
+        case StringState:
+            if (c == '"') {
+                finishString();
+            } else if (c == '\\') {
+                m_state = EscapeState;
+            } else if (uchar(c) < 0x20) {
+                m_state = ErrorState;
+            } else if (m_collecting) {
+                flushSurrogate();
+                m_buffer.append(c);
+            }
+            ++i;
+            continue;
+
+        case EscapeState: {
+            char unescaped = 0;
+            switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                unescaped = c;
+                break;
+            case 'b':
+                unescaped = '\b';
+                break;
+            case 'f':
+                unescaped = '\f';
+                break;
+            case 'n':
+                unescaped = '\n';
+                break;
+            case 'r':
+                unescaped = '\r';
+                break;
+            case 't':
+                unescaped = '\t';
+                break;
+            case 'u':
+                m_unicode = 0;
+                m_unicodeDigits = 0;
+                m_state = UnicodeState;
+                break;
+            default:
+                m_state = ErrorState;
+                break;
+            }
+
+            if (unescaped) {
+                if (m_collecting) {
+                    flushSurrogate();
+                    m_buffer.append(unescaped);
+                }
+                m_state = StringState;
+            }
+            ++i;
+            continue;
+        }
+
+        case UnicodeState: {
+            int digit = hexValue(c);
+            if (digit < 0) {
+                m_state = ErrorState;
+                continue;
+            }
+
+            m_unicode = (m_unicode << 4) | digit;
+            if (++m_unicodeDigits == 4) {
+                if (m_collecting)
+                    appendCodePoint(m_unicode);
+                m_state = StringState;
+            }
+            ++i;
+            continue;
+        }
+
+        case LiteralState:
+            if (isLiteralCharacter(c)) {
+                m_buffer.append(c);
+                ++i;
+            } else {
+                // The character terminating the literal is processed in the next state.
+                finishLiteral();
+            }
+            continue;
+
+        default:
+            break;
+        }
+
+        if (isWhitespace(c)) {
+            ++i;
+            continue;
+        }
+
+        switch (m_state) {
+        case StartState:
+            if (c == '[')
+                beginValue(c);
+            else
+                m_state = ErrorState;
+            break;
+        case ValueOrEndState:
+            if (c == ']') {
+                closeContainer(c);
+                break;
+            }
+            // fall through
+        case ValueState:
+            beginValue(c);
+            break;
+        case KeyOrEndState:
+            if (c == '}') {
+                closeContainer(c);
+                break;
+            }
+            // fall through
+        case KeyState:
+            if (c == '"') {
+                m_key = true;
+                m_collecting = false;
+                m_state = StringState;
+            } else {
+                m_state = ErrorState;
+            }
+            break;
+        case ColonState:
+            m_state = (c == ':') ? ValueState : ErrorState;
+            break;
+        case SeparatorState:
+            if (c == ',') {
+                if (m_stack.size() == 1)
+                    ++m_topLevelIndex;
+                m_state = m_stack.endsWith('[') ? ValueState : KeyState;
+            } else if (c == ']' || c == '}') {
+                closeContainer(c);
+            } else {
+                m_state = ErrorState;
+            }
+            break;
+        default:
+            m_state = ErrorState;
+            break;
+        }
+        ++i;
+    }
+
+    return (m_state != ErrorState);
+}
+
+/*!
+    Tells the parser that the whole response has been supplied.
+
+    \return true if the response was well formed and contained a list of suggestions.
+*/
+bool OpenSearchSuggestionsParser::finish()
+{
+    return (m_state == EndState && m_suggestionsComplete);
+}
+
+/*!
+    Returns true if the response turned out not to be well formed.
+*/
+bool OpenSearchSuggestionsParser::hasError() const
+{
+    return (m_state == ErrorState);
+}
+
+/*!
+    Returns true if the whole response has been parsed.
+*/
+bool OpenSearchSuggestionsParser::atEnd() const
+{
+    return (m_state == EndState);
+}
+
+/*!
+    Returns true if the list of suggestions has been parsed completely. It may happen
+    before the whole response is parsed.
+*/
+bool OpenSearchSuggestionsParser::hasSuggestions() const
+{
+    return m_suggestionsComplete;
+}
+
+/*!
+    Returns the search term that the response refers to.
+*/
+QString OpenSearchSuggestionsParser::searchTerm() const
+{
+    return m_searchTerm;
+}
+
+/*!
+    Returns the suggestions that have been parsed so far.
+*/
+QStringList OpenSearchSuggestionsParser::suggestions() const
+{
+    return m_suggestions;
+}
+
+/*!
+    Parses the complete response held by \a data and returns the list of suggestions.
+
+    If \a ok is not 0, it is set to whether the response was well formed.
+*/
+QStringList OpenSearchSuggestionsParser::parse(const QByteArray &data, bool *ok)
+{
+    OpenSearchSuggestionsParser parser;
+    parser.addData(data);
+
+    bool success = parser.finish();
+    if (ok)
+        *ok = success;
+
+    return success ? parser.suggestions() : QStringList();
+}
+
+/*!
+    Returns a parser, ready to parse a new response, from the context of the current
+    thread. It has to be given back with release() on the same thread.
+
+    \sa release()
+*/
+OpenSearchSuggestionsParser *OpenSearchSuggestionsParser::acquire()
+{
+    ParserContext *context = parserContext();
+    if (!context)
+        return new OpenSearchSuggestionsParser;
+
+    OpenSearchSuggestionsParser *parser;
+    if (!context->idle.isEmpty()) {
+        parser = context->idle.takeLast();
+    } else {
+        parser = new OpenSearchSuggestionsParser;
+        context->parsers.insert(parser);
+    }
+
+    return parser;
+}
+
+/*!
+    Gives the \a parser back to the context of the current thread. The state of the
+    parser is dropped right away, the parser itself is kept for reuse until
+    releaseIdleParsers() is called.
+
+    \sa acquire()
+*/
+void OpenSearchSuggestionsParser::release(OpenSearchSuggestionsParser *parser)
+{
+    if (!parser)
+        return;
+
+    ParserContext *context = parserContext();
+    if (!context || !context->parsers.contains(parser)) {
+        // The context has been destroyed together with its thread.
+        delete parser;
+        return;
+    }
+
+    Q_ASSERT(!context->idle.contains(parser));
+    parser->reset();
+    context->idle.append(parser);
+}
+
+/*!
+    Deletes the parsers of the current thread that are not in use.
+*/
+void OpenSearchSuggestionsParser::releaseIdleParsers()
+{
+    ParserContext *context = parserContext();
+    if (!context)
+        return;
+
+    foreach (OpenSearchSuggestionsParser *parser, context->idle) {
+        context->parsers.remove(parser);
+        delete parser;
+    }
+    context->idle.clear();
+}
+
+/*!
+    Returns the number of parsers of the current thread that are not in use.
+*/
+int OpenSearchSuggestionsParser::idleParserCount()
+{
+    ParserContext *context = parserContext();
+    return context ? context->idle.count() : 0;
+}
+
+/*!
+    Returns the approximate number of bytes held by the parsers of the current thread,
+    both those in use and the idle ones.
+*/
+qint64 OpenSearchSuggestionsParser::memoryUsage()
+{
+    ParserContext *context = parserContext();
+    if (!context)
+        return 0;
+
+    qint64 size = 0;
+    foreach (const OpenSearchSuggestionsParser *parser, context->parsers)
+        size += parser->allocatedSize();
+    return size;
+}
+
+qint64 OpenSearchSuggestionsParser::allocatedSize() const
+{
+    qint64 size = sizeof(*this) + m_stack.capacity() + m_buffer.capacity();
+    size += m_searchTerm.capacity() * sizeof(QChar);
+
+    foreach (const QString &suggestion, m_suggestions)
+        size += sizeof(void*) + suggestion.capacity() * sizeof(QChar);
+
+    return size;
+}
+
+bool OpenSearchSuggestionsParser::isCollecting() const
+{
+    // The search term is the first element of the top-level array and the suggestions
+    // are the elements of the array that comes second.
+    const int depth = m_stack.size();
+    return ((depth == 1 && m_topLevelIndex == 0)
+            || (depth == 2 && m_topLevelIndex == 1 && m_stack.at(1) == '['));
+}
+
+void OpenSearchSuggestionsParser::beginValue(char c)
+{
+    switch (c) {
+    case '[':
+    case '{':
+        m_stack.append(c);
+        m_state = (c == '[') ? ValueOrEndState : KeyOrEndState;
+        break;
+    case '"':
+        m_key = false;
+        m_collecting = isCollecting();
+        m_buffer.clear();
+        m_state = StringState;
+        break;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+            m_collecting = isCollecting();
+            m_buffer.clear();
+            m_buffer.append(c);
+            m_state = LiteralState;
+        } else {
+            m_state = ErrorState;
+        }
+        break;
+    }
+}
+
+void OpenSearchSuggestionsParser::endValue()
+{
+    m_state = m_stack.isEmpty() ? EndState : SeparatorState;
+}
+
+void OpenSearchSuggestionsParser::closeContainer(char c)
+{
+    const char open = (c == ']') ? '[' : '{';
+    if (!m_stack.endsWith(open)) {
+        m_state = ErrorState;
+        return;
+    }
+
+    if (m_stack.size() == 2 && m_topLevelIndex == 1 && open == '[')
+        m_suggestionsComplete = true;
+
+    m_stack.chop(1);
+    endValue();
+}
+
+void OpenSearchSuggestionsParser::finishString()
+{
+    if (m_key) {
+        m_state = ColonState;
+        return;
+    }
+
+    if (m_collecting) {
+        flushSurrogate();
+        appendValue();
+    }
+    endValue();
+}
+
+void OpenSearchSuggestionsParser::finishLiteral()
+{
+    if (!isValidLiteral(m_buffer)) {
+        m_state = ErrorState;
+        return;
+    }
+
+    if (m_collecting)
+        appendValue();
+    m_buffer.clear();
+    endValue();
+}
+
+void OpenSearchSuggestionsParser::appendValue()
+{
+    QString value = QString::fromUtf8(m_buffer.constData(), m_buffer.size());
+    m_buffer.clear();
+
+    if (m_stack.size() == 1)
+        m_searchTerm = value;
+    else
+        m_suggestions.append(value);
+}
+
+void OpenSearchSuggestionsParser::appendCodePoint(uint codePoint)
+{
+    if (m_highSurrogate) {
+        if ((codePoint & 0xfc00) == 0xdc00) {
+            codePoint = 0x10000 + ((m_highSurrogate - 0xd800) << 10) + (codePoint - 0xdc00);
+            m_highSurrogate = 0;
+        } else {
+            flushSurrogate();
+        }
+    }
+
+    if ((codePoint & 0xfc00) == 0xd800) {
+        m_highSurrogate = codePoint;
+        return;
+    }
+
+    // An unpaired low surrogate.
+    if ((codePoint & 0xfc00) == 0xdc00)
+        codePoint = 0xfffd;
+
+    if (codePoint < 0x80) {
+        m_buffer.append(char(codePoint));
+    } else if (codePoint < 0x800) {
+        m_buffer.append(char(0xc0 | (codePoint >> 6)));
+        m_buffer.append(char(0x80 | (codePoint & 0x3f)));
+    } else if (codePoint < 0x10000) {
+        m_buffer.append(char(0xe0 | (codePoint >> 12)));
+        m_buffer.append(char(0x80 | ((codePoint >> 6) & 0x3f)));
+        m_buffer.append(char(0x80 | (codePoint & 0x3f)));
+    } else {
+        m_buffer.append(char(0xf0 | (codePoint >> 18)));
+        m_buffer.append(char(0x80 | ((codePoint >> 12) & 0x3f)));
+        m_buffer.append(char(0x80 | ((codePoint >> 6) & 0x3f)));
+        m_buffer.append(char(0x80 | (codePoint & 0x3f)));
+    }
+}
+
+void OpenSearchSuggestionsParser::flushSurrogate()
+{
+    if (!m_highSurrogate)
+        return;
+
+    // An unpaired high surrogate.
+    m_highSurrogate = 0;
+    appendCodePoint(0xfffd);
+}
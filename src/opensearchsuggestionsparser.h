@@ -0,0 +1,96 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHSUGGESTIONSPARSER_H
+#define OPENSEARCHSUGGESTIONSPARSER_H
+
+#include <qbytearray.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+class OpenSearchSuggestionsParser
+{
+public:
+    OpenSearchSuggestionsParser();
+
+    void reset();
+
+    bool addData(const QByteArray &data);
+    bool addData(const char *data, int size);
+    bool finish();
+
+    bool hasError() const;
+    bool atEnd() const;
+    bool hasSuggestions() const;
+
+    QString searchTerm() const;
+    QStringList suggestions() const;
+
+    static QStringList parse(const QByteArray &data, bool *ok = 0);
+
+    static OpenSearchSuggestionsParser *acquire();
+    static void release(OpenSearchSuggestionsParser *parser);
+    static void releaseIdleParsers();
+    static int idleParserCount();
+    static qint64 memoryUsage();
+
+private:
+    enum State {
+        StartState,
+        ValueState,
+        ValueOrEndState,
+        KeyState,
+        KeyOrEndState,
+        ColonState,
+        SeparatorState,
+        StringState,
+        EscapeState,
+        UnicodeState,
+        LiteralState,
+        EndState,
+        ErrorState
+    };
+
+    bool isCollecting() const;
+    void beginValue(char c);
+    void endValue();
+    void closeContainer(char c);
+    void finishString();
+    void finishLiteral();
+    void appendCodePoint(uint codePoint);
+    void flushSurrogate();
+    void appendValue();
+    qint64 allocatedSize() const;
+
+    State m_state;
+    QByteArray m_stack;
+    int m_topLevelIndex;
+    bool m_collecting;
+    bool m_key;
+    QByteArray m_buffer;
+    uint m_unicode;
+    int m_unicodeDigits;
+    uint m_highSurrogate;
+    bool m_suggestionsComplete;
+
+    QString m_searchTerm;
+    QStringList m_suggestions;
+};
+
+#endif // OPENSEARCHSUGGESTIONSPARSER_H
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchtemplatecontext.h"
+
+#include <qcoreapplication.h>
+#include <qevent.h>
+#include <qlocale.h>
+#include <qmutex.h>
+#include <qthread.h>
+
+namespace {
+
+// The values substituted for {language} and {source}, which only change when
+// the locale or the application name does.
+class Environment : public QObject
+{
+public:
+    Environment()
+        : m_valid(false)
+        , m_filterInstalled(false)
+    {
+        if (QCoreApplication *application = QCoreApplication::instance())
+            moveToThread(application->thread());
+    }
+
+    QByteArray languageCode()
+    {
+        QMutexLocker locker(&m_mutex);
+        update();
+        return m_languageCode;
+    }
+
+    QByteArray source()
+    {
+        QMutexLocker locker(&m_mutex);
+        update();
+        return m_source;
+    }
+
+    void invalidate()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_valid = false;
+    }
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event)
+    {
+        if (event->type() == QEvent::LocaleChange)
+            invalidate();
+
+        return QObject::eventFilter(object, event);
+    }
+
+private:
+    void update()
+    {
+        installFilter();
+
+        // Comparing locales and shared strings is much cheaper than building the codes,
+        // and it catches QLocale::setDefault() and QCoreApplication::setApplicationName(),
+        // which do not send any events.
+        QLocale locale;
+        if (!m_valid || locale != m_locale) {
+            m_locale = locale;
+            // Simple conversion to RFC 3066.
+            m_languageCode = locale.name().replace(QLatin1Char('_'), QLatin1Char('-')).toUtf8();
+        }
+
+        QString applicationName = QCoreApplication::applicationName();
+        if (!m_valid || applicationName != m_applicationName) {
+            m_applicationName = applicationName;
+            m_source = applicationName.toUtf8();
+        }
+
+        m_valid = true;
+    }
+
+    void installFilter()
+    {
+        // System locale changes are only announced to the application object.
+        QCoreApplication *application = QCoreApplication::instance();
+        if (m_filterInstalled || !application || thread() != application->thread()
+            || QThread::currentThread() != application->thread())
+            return;
+
+        application->installEventFilter(this);
+        m_filterInstalled = true;
+    }
+
+    QMutex m_mutex;
+    bool m_valid;
+    bool m_filterInstalled;
+    QLocale m_locale;
+    QString m_applicationName;
+    QByteArray m_languageCode;
+    QByteArray m_source;
+};
+
+}
+
+Q_GLOBAL_STATIC(Environment, environment)
+
+/*!
+    \class OpenSearchTemplateContext
+    \brief The values substituted for the template parameters of URL templates
+
+    OpenSearchTemplateContext holds the per-request values of the "{count}",
+    "{startIndex}" and "{startPage}" template parameters, so that search URLs can be
+    constructed for any page of results.
+
+    The "{language}" and "{source}" parameters are taken from the environment, which is
+    cached for all the engines. The cached values are recomputed when the default locale
+    or the application name changes, or when the application receives a
+    QEvent::LocaleChange event. invalidateEnvironment() forces that explicitly.
+
+    Checking the environment costs a lock, so every expansion of a template does it at
+    most once. A context that is used for many expansions, e.g. a batch of URLs, can take
+    the values once with resolveEnvironment().
+
+    \sa OpenSearchEngine::searchUrl(), OpenSearchDescription::searchUrl()
+*/
+
+/*!
+    Constructs a context requesting \a count results, starting with the result at
+    \a startIndex on the page \a startPage.
+*/
+OpenSearchTemplateContext::OpenSearchTemplateContext(int count, int startIndex, int startPage)
+    : m_count(qMax(0, count))
+    , m_startIndex(qMax(0, startIndex))
+    , m_startPage(qMax(0, startPage))
+    , m_environmentResolved(false)
+{
+}
+
+/*!
+    Returns the number of results per page, substituted for "{count}". The default is 20.
+*/
+int OpenSearchTemplateContext::count() const
+{
+    return m_count;
+}
+
+/*!
+    Sets the number of results per page to \a count.
+*/
+void OpenSearchTemplateContext::setCount(int count)
+{
+    m_count = qMax(0, count);
+}
+
+/*!
+    Returns the index of the first result, substituted for "{startIndex}". The default is 0.
+*/
+int OpenSearchTemplateContext::startIndex() const
+{
+    return m_startIndex;
+}
+
+/*!
+    Sets the index of the first result to \a index.
+*/
+void OpenSearchTemplateContext::setStartIndex(int index)
+{
+    m_startIndex = qMax(0, index);
+}
+
+/*!
+    Returns the page of results, substituted for "{startPage}". The default is 0.
+*/
+int OpenSearchTemplateContext::startPage() const
+{
+    return m_startPage;
+}
+
+/*!
+    Sets the page of results to \a page.
+*/
+void OpenSearchTemplateContext::setStartPage(int page)
+{
+    m_startPage = qMax(0, page);
+}
+
+/*!
+    Returns the language code of the default locale (RFC 3066), substituted for
+    "{language}".
+*/
+QByteArray OpenSearchTemplateContext::languageCode()
+{
+    return environment()->languageCode();
+}
+
+/*!
+    Returns the application name, substituted for "{source}".
+*/
+QByteArray OpenSearchTemplateContext::source()
+{
+    return environment()->source();
+}
+
+/*!
+    Drops the cached language code and application name, they will be computed again
+    the next time they are needed.
+*/
+void OpenSearchTemplateContext::invalidateEnvironment()
+{
+    environment()->invalidate();
+}
+
+/*!
+    Takes the current languageCode() and source(), which are then used for all the
+    expansions done with this context instead of being looked up each time. Changes of
+    the environment made afterwards are not seen.
+
+    \sa resolvedLanguageCode(), resolvedSource()
+*/
+void OpenSearchTemplateContext::resolveEnvironment()
+{
+    m_languageCode = languageCode();
+    m_source = source();
+    m_environmentResolved = true;
+}
+
+/*!
+    Returns the language code taken by resolveEnvironment(), or the current languageCode()
+    if the environment has not been resolved.
+*/
+QByteArray OpenSearchTemplateContext::resolvedLanguageCode() const
+{
+    return m_environmentResolved ? m_languageCode : languageCode();
+}
+
+/*!
+    Returns the source taken by resolveEnvironment(), or the current source() if the
+    environment has not been resolved.
+*/
+QByteArray OpenSearchTemplateContext::resolvedSource() const
+{
+    return m_environmentResolved ? m_source : source();
+}
+
+bool OpenSearchTemplateContext::operator==(const OpenSearchTemplateContext &other) const
+{
+    return (m_count == other.m_count
+            && m_startIndex == other.m_startIndex
+            && m_startPage == other.m_startPage);
+}
+
+bool OpenSearchTemplateContext::operator!=(const OpenSearchTemplateContext &other) const
+{
+    return !(*this == other);
+}
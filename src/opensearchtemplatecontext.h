@@ -0,0 +1,60 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHTEMPLATECONTEXT_H
+#define OPENSEARCHTEMPLATECONTEXT_H
+
+#include <qbytearray.h>
+
+class OpenSearchTemplateContext
+{
+public:
+    OpenSearchTemplateContext(int count = 20, int startIndex = 0, int startPage = 0);
+
+    int count() const;
+    void setCount(int count);
+
+    int startIndex() const;
+    void setStartIndex(int index);
+
+    int startPage() const;
+    void setStartPage(int page);
+
+    static QByteArray languageCode();
+    static QByteArray source();
+    static void invalidateEnvironment();
+
+    void resolveEnvironment();
+    QByteArray resolvedLanguageCode() const;
+    QByteArray resolvedSource() const;
+
+    bool operator==(const OpenSearchTemplateContext &other) const;
+    bool operator!=(const OpenSearchTemplateContext &other) const;
+
+private:
+    int m_count;
+    int m_startIndex;
+    int m_startPage;
+
+    bool m_environmentResolved;
+    QByteArray m_languageCode;
+    QByteArray m_source;
+};
+
+#endif // OPENSEARCHTEMPLATECONTEXT_H
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "opensearchurltemplate.h"
+
+#include "opensearchstringpool.h"
+
+
+/*!
+    \class OpenSearchUrlTemplate
+    \brief A precompiled OpenSearch URL template
+
+    OpenSearchUrlTemplate splits a URL template into literal pieces and template
+    parameters once, so that constructing URLs later on is a single pass over the
+    pieces, writing into a buffer that can be sized in advance.
+
+    It is used internally by OpenSearchEngine, which compiles its templates whenever
+    they are set, instead of processing them again for every URL it constructs.
+
+    \sa OpenSearchEngine::searchUrl(), OpenSearchEngine::suggestionsUrl()
+*/
+
+/*!
+    \enum OpenSearchUrlTemplate::Encoding
+
+    \value UrlEncoding the literal parts of the template are copied as they are,
+           which is suitable for the template of the URL itself
+    \value QueryItemEncoding the literal parts of the template are percent-encoded
+           the same way QUrl::addQueryItem() does, which is suitable for values of
+           additional parameters
+*/
+
+enum CharacterClass {
+    // Left alone by QUrl::toPercentEncoding().
+    Unreserved = 0x1,
+    // Left alone by QUrl::addQueryItem().
+    QueryItemSafe = 0x2
+};
+
+// The classes of the ASCII characters, the other bytes are always encoded.
+static const uchar characterClasses[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 2, 0, 0, 2, 0, 0, 2, 2, 2, 2, 2, 2, 3, 3, 2,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 0, 0, 0, 2,
+    2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 3,
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 3, 0,
+};
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static inline bool hasClass(uint c, CharacterClass characterClass)
+{
+    return c < 128 && (characterClasses[c] & characterClass);
+}
+
+static inline char *appendEscaped(char *output, uint c)
+{
+    *output++ = '%';
+    *output++ = hexDigits[c >> 4];
+    *output++ = hexDigits[c & 0xf];
+    return output;
+}
+
+// Converts UTF-16 to UTF-8 and percent-encodes it in one pass. The output must have
+// room for MaximumEncodedSize bytes per UTF-16 code unit.
+static char *encodeUtf16(char *output, const ushort *i, const ushort *end)
+{
+    for (; i != end; ++i) {
+        uint c = *i;
+
+        if (c < 0x80) {
+            if (characterClasses[c] & Unreserved)
+                *output++ = char(c);
+            else
+                output = appendEscaped(output, c);
+            continue;
+        }
+
+        if (c < 0x800) {
+            output = appendEscaped(output, 0xc0 | (c >> 6));
+        } else if ((c & 0xfc00) == 0xd800 && i + 1 != end && (i[1] & 0xfc00) == 0xdc00) {
+            c = 0x10000 + ((c - 0xd800) << 10) + (*++i - 0xdc00);
+            output = appendEscaped(output, 0xf0 | (c >> 18));
+            output = appendEscaped(output, 0x80 | ((c >> 12) & 0x3f));
+            output = appendEscaped(output, 0x80 | ((c >> 6) & 0x3f));
+        } else if ((c & 0xf800) == 0xd800) {
+            // A lone surrogate, which QString::toUtf8() replaces with '?'.
+            output = appendEscaped(output, '?');
+            continue;
+        } else {
+            output = appendEscaped(output, 0xe0 | (c >> 12));
+            output = appendEscaped(output, 0x80 | ((c >> 6) & 0x3f));
+        }
+        output = appendEscaped(output, 0x80 | (c & 0x3f));
+    }
+
+    return output;
+}
+
+/*!
+    Constructs an empty template.
+*/
+OpenSearchUrlTemplate::OpenSearchUrlTemplate()
+    : m_literalSize(0)
+    , m_placeholderCount(0)
+    , m_searchTermsCount(0)
+{
+}
+
+/*!
+    Constructs a template by compiling \a searchTemplate.
+
+    Unknown template parameters are kept as literal text.
+*/
+OpenSearchUrlTemplate::OpenSearchUrlTemplate(const QString &searchTemplate)
+    : m_literalSize(0)
+    , m_placeholderCount(0)
+    , m_searchTermsCount(0)
+{
+    const int length = searchTemplate.length();
+    int literalStart = 0;
+    int position = 0;
+
+    while (position < length) {
+        int open = searchTemplate.indexOf(QLatin1Char('{'), position);
+        if (open == -1)
+            break;
+
+        int close = searchTemplate.indexOf(QLatin1Char('}'), open + 1);
+        if (close == -1)
+            break;
+
+        PieceType type = placeholderType(searchTemplate.mid(open + 1, close - open - 1));
+        if (type == Literal) {
+            position = open + 1;
+            continue;
+        }
+
+        appendLiteral(searchTemplate.mid(literalStart, open - literalStart));
+
+        Piece piece;
+        piece.type = type;
+        m_pieces.append(piece);
+
+        ++m_placeholderCount;
+        if (type == SearchTerms)
+            ++m_searchTermsCount;
+
+        position = close + 1;
+        literalStart = position;
+    }
+
+    appendLiteral(searchTemplate.mid(literalStart));
+}
+
+OpenSearchUrlTemplate::PieceType OpenSearchUrlTemplate::placeholderType(const QString &name)
+{
+    if (name == QLatin1String("searchTerms"))
+        return SearchTerms;
+    if (name == QLatin1String("count"))
+        return Count;
+    if (name == QLatin1String("startIndex"))
+        return StartIndex;
+    if (name == QLatin1String("startPage"))
+        return StartPage;
+    if (name == QLatin1String("language"))
+        return Language;
+    if (name == QLatin1String("inputEncoding"))
+        return InputEncoding;
+    if (name == QLatin1String("outputEncoding"))
+        return OutputEncoding;
+
+    // {source}, {source?} and the prefixed forms, such as {referrer:source?}
+    QString source = name;
+    if (source.endsWith(QLatin1Char('?')))
+        source.chop(1);
+    if (source == QLatin1String("source") || source.endsWith(QLatin1String(":source")))
+        return Source;
+
+    return Literal;
+}
+
+void OpenSearchUrlTemplate::appendLiteral(const QString &literal)
+{
+    if (literal.isEmpty())
+        return;
+
+    Piece piece;
+    piece.type = Literal;
+    // The localized engines of one provider mostly have the same literals, host included.
+    piece.text = OpenSearchStringPool::intern(literal.toUtf8());
+    m_literalSize += piece.text.size();
+    m_pieces.append(piece);
+}
+
+/*!
+    Returns true if the template has no pieces at all.
+*/
+bool OpenSearchUrlTemplate::isEmpty() const
+{
+    return m_pieces.isEmpty();
+}
+
+/*!
+    Expands the template for a given \a searchTerm and returns the result, substituting
+    the template parameters with the values of the \a context.
+
+    This is what OpenSearchEngine::parseTemplate() returns.
+*/
+QString OpenSearchUrlTemplate::expand(const QString &searchTerm, const OpenSearchTemplateContext &context) const
+{
+    EncodedSearchTerm encodedSearchTerm;
+    encodeSearchTerm(&encodedSearchTerm, searchTerm);
+
+    QByteArray output;
+    output.reserve(estimatedSize(encodedSearchTerm.size()));
+    expand(&output, encodedSearchTerm.constData(), encodedSearchTerm.size(), UrlEncoding, context);
+
+    return QString::fromUtf8(output.constData(), output.size());
+}
+
+/*!
+    Expands the template and appends the result to \a output, substituting the template
+    parameters with the values of the \a context.
+
+    The \a encodedSearchTerm must already be percent-encoded, it is copied verbatim
+    regardless of the \a encoding, which only applies to the remaining pieces.
+*/
+void OpenSearchUrlTemplate::expand(QByteArray *output, const QByteArray &encodedSearchTerm,
+                                   Encoding encoding, const OpenSearchTemplateContext &context) const
+{
+    expand(output, encodedSearchTerm.constData(), encodedSearchTerm.size(), encoding, context);
+}
+
+/*!
+    \overload
+
+    Expands the template with the \a encodedSearchTerm of a given \a size, which does not
+    need to be held by a QByteArray.
+*/
+void OpenSearchUrlTemplate::expand(QByteArray *output, const char *encodedSearchTerm, int size,
+                                   Encoding encoding, const OpenSearchTemplateContext &context) const
+{
+    // The environment is looked up at most once per expansion.
+    QByteArray languageCode;
+    QByteArray source;
+    bool languageCodeResolved = false;
+    bool sourceResolved = false;
+
+    QList<Piece>::const_iterator end = m_pieces.constEnd();
+    QList<Piece>::const_iterator i = m_pieces.constBegin();
+    for (; i != end; ++i) {
+        switch (i->type) {
+        case Literal:
+            appendEncoded(output, i->text, encoding);
+            break;
+        case SearchTerms:
+            output->append(encodedSearchTerm, size);
+            break;
+        case Count:
+            output->append(QByteArray::number(context.count()));
+            break;
+        case StartIndex:
+            output->append(QByteArray::number(context.startIndex()));
+            break;
+        case StartPage:
+            output->append(QByteArray::number(context.startPage()));
+            break;
+        case Language:
+            if (!languageCodeResolved) {
+                languageCode = context.resolvedLanguageCode();
+                languageCodeResolved = true;
+            }
+            appendEncoded(output, languageCode, encoding);
+            break;
+        case InputEncoding:
+        case OutputEncoding:
+            output->append("UTF-8");
+            break;
+        case Source:
+            if (!sourceResolved) {
+                source = context.resolvedSource();
+                sourceResolved = true;
+            }
+            appendEncoded(output, source, encoding);
+            break;
+        }
+    }
+}
+
+/*!
+    Returns the expected size of the expanded template, provided the percent-encoded
+    search term is \a encodedSearchTermSize bytes long.
+*/
+int OpenSearchUrlTemplate::estimatedSize(int encodedSearchTermSize) const
+{
+    return m_literalSize
+           + m_searchTermsCount * encodedSearchTermSize
+           + (m_placeholderCount - m_searchTermsCount) * 16;
+}
+
+/*!
+    Returns the approximate number of bytes held by the compiled template, leaving out
+    the literal pieces shared through OpenSearchStringPool.
+*/
+qint64 OpenSearchUrlTemplate::memoryUsage() const
+{
+    qint64 size = m_pieces.count() * (sizeof(void*) + sizeof(Piece));
+    foreach (const Piece &piece, m_pieces)
+        size += OpenSearchStringPool::sizeOf(piece.text);
+    return size;
+}
+
+/*!
+    Appends \a data to \a output, percent-encoding it if required by the \a encoding.
+*/
+void OpenSearchUrlTemplate::appendEncoded(QByteArray *output, const QByteArray &data, Encoding encoding)
+{
+    if (encoding == UrlEncoding) {
+        output->append(data);
+        return;
+    }
+
+    const char *i = data.constData();
+    const char *end = i + data.size();
+    for (; i != end; ++i) {
+        const uchar c = *i;
+        if (hasClass(c, QueryItemSafe)) {
+            output->append(char(c));
+        } else {
+            char escaped[3];
+            appendEscaped(escaped, c);
+            output->append(escaped, 3);
+        }
+    }
+}
+
+/*!
+    Converts \a searchTerm to UTF-8 and percent-encodes it the same way
+    QUrl::toPercentEncoding() does, straight into \a output, which is replaced.
+
+    A single table lookup decides on every ASCII character and no intermediate
+    QByteArray is created, the buffer only allocates for very long search terms.
+*/
+void OpenSearchUrlTemplate::encodeSearchTerm(EncodedSearchTerm *output, const QString &searchTerm)
+{
+    output->resize(searchTerm.size() * MaximumEncodedSize);
+    const ushort *begin = searchTerm.utf16();
+    char *end = encodeUtf16(output->data(), begin, begin + searchTerm.size());
+    output->resize(end - output->constData());
+}
+
+/*!
+    \overload
+
+    Returns the percent-encoded UTF-8 form of \a searchTerm.
+*/
+QByteArray OpenSearchUrlTemplate::encodeSearchTerm(const QString &searchTerm)
+{
+    EncodedSearchTerm encodedSearchTerm;
+    encodeSearchTerm(&encodedSearchTerm, searchTerm);
+    return QByteArray(encodedSearchTerm.constData(), encodedSearchTerm.size());
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef OPENSEARCHURLTEMPLATE_H
+#define OPENSEARCHURLTEMPLATE_H
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qstring.h>
+#include <qvarlengtharray.h>
+
+#include "opensearchtemplatecontext.h"
+
+class OpenSearchUrlTemplate
+{
+public:
+    enum Encoding {
+        UrlEncoding,
+        QueryItemEncoding
+    };
+
+    // A UTF-16 code unit takes up to three bytes in UTF-8, each encoded with three characters.
+    enum { MaximumEncodedSize = 9 };
+    typedef QVarLengthArray<char, 1024> EncodedSearchTerm;
+
+    OpenSearchUrlTemplate();
+    explicit OpenSearchUrlTemplate(const QString &searchTemplate);
+
+    bool isEmpty() const;
+
+    QString expand(const QString &searchTerm,
+                   const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    void expand(QByteArray *output, const QByteArray &encodedSearchTerm, Encoding encoding = UrlEncoding,
+                const OpenSearchTemplateContext &context = OpenSearchTemplateContext()) const;
+    void expand(QByteArray *output, const char *encodedSearchTerm, int size, Encoding encoding,
+                const OpenSearchTemplateContext &context) const;
+    int estimatedSize(int encodedSearchTermSize) const;
+    qint64 memoryUsage() const;
+
+    static void appendEncoded(QByteArray *output, const QByteArray &data, Encoding encoding);
+    static void encodeSearchTerm(EncodedSearchTerm *output, const QString &searchTerm);
+    static QByteArray encodeSearchTerm(const QString &searchTerm);
+
+private:
+    enum PieceType {
+        Literal,
+        SearchTerms,
+        Count,
+        StartIndex,
+        StartPage,
+        Language,
+        InputEncoding,
+        OutputEncoding,
+        Source
+    };
+
+    struct Piece
+    {
+        PieceType type;
+        QByteArray text;
+    };
+
+    static PieceType placeholderType(const QString &name);
+    void appendLiteral(const QString &literal);
+
+    QList<Piece> m_pieces;
+    int m_literalSize;
+    int m_placeholderCount;
+    int m_searchTermsCount;
+};
+
+#endif // OPENSEARCHURLTEMPLATE_H
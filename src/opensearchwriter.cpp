@@ -19,10 +19,81 @@
 
 #include "opensearchwriter.h"
 
+#include "opensearchdescription.h"
 #include "opensearchengine.h"
+#include "opensearchsnapshot.h"
 
+#include <qbuffer.h>
 #include <qdebug.h>
+#include <qdir.h>
+#include <qfile.h>
 #include <qiodevice.h>
+#include <qset.h>
+#include <qtconcurrentmap.h>
+
+struct OpenSearchWriter::Job
+{
+    // Large enough to amortize a writer, small enough to keep all the threads busy.
+    enum { ChunkSize = 64 };
+
+    static QByteArray writeFragments(const Job &job)
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+
+        OpenSearchWriter writer;
+        writer.setCompact(job.compact);
+        writer.setDevice(&buffer);
+        for (int i = job.begin; i < job.end; ++i)
+            writer.writeDescription(job.descriptions->at(i));
+
+        return data;
+    }
+
+    static QStringList writeFiles(const Job &job)
+    {
+        QStringList written;
+
+        OpenSearchWriter writer;
+        writer.setCompact(job.compact);
+        for (int i = job.begin; i < job.end; ++i) {
+            QFile file(job.fileNames->at(i));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                written.append(QString());
+                continue;
+            }
+
+            writer.write(&file, job.descriptions->at(i));
+            file.close();
+            written.append(file.error() == QFile::NoError ? file.fileName() : QString());
+        }
+
+        return written;
+    }
+
+    static QList<Job> split(const QList<OpenSearchDescription> &descriptions, bool compact,
+                            const QStringList *fileNames = 0)
+    {
+        QList<Job> jobs;
+        for (int begin = 0; begin < descriptions.count(); begin += ChunkSize) {
+            Job job;
+            job.descriptions = &descriptions;
+            job.fileNames = fileNames;
+            job.begin = begin;
+            job.end = qMin(begin + int(ChunkSize), descriptions.count());
+            job.compact = compact;
+            jobs.append(job);
+        }
+        return jobs;
+    }
+
+    const QList<OpenSearchDescription> *descriptions;
+    const QStringList *fileNames;
+    int begin;
+    int end;
+    bool compact;
+};
 
 /*!
     \class OpenSearchWriter
@@ -48,6 +119,27 @@ OpenSearchWriter::OpenSearchWriter()
     setAutoFormatting(true);
 }
 
+/*!
+    Returns true if the documents are written without any indentation or line breaks,
+    which makes them smaller and faster to write. By default, they are indented.
+
+    \sa setCompact()
+*/
+bool OpenSearchWriter::isCompact() const
+{
+    return !autoFormatting();
+}
+
+/*!
+    Turns the compact output on if \a compact is true, or the indented one otherwise.
+
+    \sa isCompact()
+*/
+void OpenSearchWriter::setCompact(bool compact)
+{
+    setAutoFormatting(!compact);
+}
+
 /*!
     Writes an OpenSearch engine description to the \a device, filling the output document
     with all the necessary data.
@@ -61,79 +153,223 @@ bool OpenSearchWriter::write(QIODevice *device, OpenSearchEngine *engine)
     if (!engine)
         return false;
 
+    return write(device, engine->openSearchDescription());
+}
+
+/*!
+    Writes the \a description to the \a device, filling the output document with all
+    the necessary data.
+
+    If the \a device is closed, it will be opened.
+
+    \return true on success and false on failure.
+
+    \sa OpenSearchReader::read()
+*/
+bool OpenSearchWriter::write(QIODevice *device, const OpenSearchDescription &description)
+{
     if (!device->isOpen()) {
         if (!device->open(QIODevice::WriteOnly))
             return false;
     }
 
     setDevice(device);
-    write(engine);
+    write(description);
     return true;
 }
 
-void OpenSearchWriter::write(OpenSearchEngine *engine)
+/*!
+    Writes all the \a descriptions to the \a device as one bundle, which
+    OpenSearchReader::readNextDescription() reads back one description after another.
+    The descriptions are serialized in parallel by the threads of the global QThreadPool,
+    and written in the order of the list.
+
+    If the \a device is closed, it will be opened.
+
+    \return true on success and false on failure.
+
+    \sa writeDirectory()
+*/
+bool OpenSearchWriter::writeBundle(QIODevice *device, const QList<OpenSearchDescription> &descriptions)
 {
-    writeStartDocument();
-    writeStartElement(QLatin1String("OpenSearchDescription"));
-    writeDefaultNamespace(QLatin1String("http://a9.com/-/spec/opensearch/1.1/"));
+    if (!device->isOpen()) {
+        if (!device->open(QIODevice::WriteOnly))
+            return false;
+    }
 
-    if (!engine->name().isEmpty())
-        writeTextElement(QLatin1String("ShortName"), engine->name());
+    QList<Job> jobs = Job::split(descriptions, isCompact());
+    QList<QByteArray> fragments;
+    if (jobs.count() > 1) {
+        fragments = QtConcurrent::blockingMapped<QList<QByteArray> >(jobs, Job::writeFragments);
+    } else {
+        foreach (const Job &job, jobs)
+            fragments.append(Job::writeFragments(job));
+    }
 
-    if (!engine->description().isEmpty())
-        writeTextElement(QLatin1String("Description"), engine->description());
+    // The fragments come with the line breaks preceding their elements, if any.
+    const char *separator = isCompact() ? "" : "\n";
+    bool ok = (device->write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>") != -1);
+    ok = ok && device->write(separator) != -1;
+    ok = ok && device->write("<OpenSearchBundle>") != -1;
+    foreach (const QByteArray &fragment, fragments)
+        ok = ok && device->write(fragment) == fragment.size();
+    ok = ok && device->write(separator) != -1;
+    ok = ok && device->write("</OpenSearchBundle>") != -1;
+    ok = ok && device->write(separator) != -1;
 
-    if (!engine->searchUrlTemplate().isEmpty()) {
-        writeStartElement(QLatin1String("Url"));
-        writeAttribute(QLatin1String("method"), engine->searchMethod());
-        writeAttribute(QLatin1String("type"), QLatin1String("text/html"));
-        writeAttribute(QLatin1String("template"), engine->searchUrlTemplate());
+    return ok;
+}
 
-        if (!engine->searchParameters().empty()) {
-            writeNamespace(QLatin1String("http://a9.com/-/spec/opensearch/extensions/parameters/1.0/"), QLatin1String("p"));
+/*!
+    Writes each of the \a descriptions to its own file in the directory at \a path,
+    which is created if necessary. Files are named after the descriptions, see
+    fileName(), followed by a number when names clash, and are overwritten if they
+    exist. The files are written in parallel by the threads of the global QThreadPool.
 
-            QList<OpenSearchEngine::Parameter>::const_iterator end = engine->searchParameters().constEnd();
-            QList<OpenSearchEngine::Parameter>::const_iterator i = engine->searchParameters().constBegin();
-            for (; i != end; ++i) {
-                writeStartElement(QLatin1String("p:Parameter"));
-                writeAttribute(QLatin1String("name"), i->first);
-                writeAttribute(QLatin1String("value"), i->second);
-                writeEndElement();
-            }
-        }
+    \return the paths of the files, in the order of the descriptions, with an empty
+            string for each description that could not be written.
 
-        writeEndElement();
+    \sa writeBundle(), OpenSearchBatchReader::readDirectory()
+*/
+QStringList OpenSearchWriter::writeDirectory(const QString &path, const QList<OpenSearchDescription> &descriptions)
+{
+    QDir directory(path);
+    if (!directory.mkpath(QLatin1String("."))) {
+        QStringList failed;
+        for (int i = 0; i < descriptions.count(); ++i)
+            failed.append(QString());
+        return failed;
     }
 
-    if (!engine->suggestionsUrlTemplate().isEmpty()) {
-        writeStartElement(QLatin1String("Url"));
-        writeAttribute(QLatin1String("method"), engine->suggestionsMethod());
-        writeAttribute(QLatin1String("type"), QLatin1String("application/x-suggestions+json"));
-        writeAttribute(QLatin1String("template"), engine->suggestionsUrlTemplate());
-
-        if (!engine->suggestionsParameters().empty()) {
-            writeNamespace(QLatin1String("http://a9.com/-/spec/opensearch/extensions/parameters/1.0/"), QLatin1String("p"));
-
-            QList<OpenSearchEngine::Parameter>::const_iterator end = engine->suggestionsParameters().constEnd();
-            QList<OpenSearchEngine::Parameter>::const_iterator i = engine->suggestionsParameters().constBegin();
-            for (; i != end; ++i) {
-                writeStartElement(QLatin1String("p:Parameter"));
-                writeAttribute(QLatin1String("name"), i->first);
-                writeAttribute(QLatin1String("value"), i->second);
-                writeEndElement();
-            }
-        }
+    // Names are compared case insensitively, as some file systems do.
+    QStringList fileNames;
+    QSet<QString> taken;
+    foreach (const OpenSearchDescription &description, descriptions) {
+        QString baseName = fileName(description);
+        QString name = baseName + QLatin1String(".xml");
+        for (int i = 2; taken.contains(name.toLower()); ++i)
+            name = baseName + QLatin1Char('-') + QString::number(i) + QLatin1String(".xml");
 
-        writeEndElement();
+        taken.insert(name.toLower());
+        fileNames.append(directory.filePath(name));
     }
 
-    if (!engine->imageUrl().isEmpty())
-        writeTextElement(QLatin1String("Image"), engine->imageUrl());
+    QList<Job> jobs = Job::split(descriptions, isCompact(), &fileNames);
+    QList<QStringList> written;
+    if (jobs.count() > 1) {
+        written = QtConcurrent::blockingMapped<QList<QStringList> >(jobs, Job::writeFiles);
+    } else {
+        foreach (const Job &job, jobs)
+            written.append(Job::writeFiles(job));
+    }
 
-    if (!engine->tags().isEmpty())
-        writeTextElement(QLatin1String("Tags"), engine->tags().join(QLatin1String(" ")));
+    QStringList files;
+    foreach (const QStringList &chunk, written)
+        files += chunk;
+    return files;
+}
 
-    writeEndElement();
+/*!
+    Returns the base name of the file writeDirectory() writes the \a description to:
+    its name in lower case, with runs of characters other than letters and digits
+    replaced by dashes, or "engine" if that leaves nothing.
+*/
+QString OpenSearchWriter::fileName(const OpenSearchDescription &description)
+{
+    const QString name = description.name();
+
+    QString fileName;
+    fileName.reserve(name.size());
+    foreach (const QChar &c, name) {
+        if (c.isLetterOrNumber())
+            fileName.append(c.toLower());
+        else if (!fileName.isEmpty() && !fileName.endsWith(QLatin1Char('-')))
+            fileName.append(QLatin1Char('-'));
+    }
+
+    while (fileName.endsWith(QLatin1Char('-')))
+        fileName.chop(1);
+
+    if (fileName.isEmpty())
+        return QLatin1String("engine");
+
+    return fileName;
+}
+
+/*!
+    Writes a binary snapshot of \a engines to the \a device, which can be mapped back
+    with OpenSearchSnapshot much faster than the descriptions can be read again.
+    \a sourceChecksum identifies the files the engines come from.
+
+    \return true on success and false on failure.
+
+    \sa OpenSearchSnapshot::write(), OpenSearchSnapshot::checksum()
+*/
+bool OpenSearchWriter::writeSnapshot(QIODevice *device, const QList<OpenSearchEngine*> &engines,
+                                     quint64 sourceChecksum)
+{
+    return OpenSearchSnapshot::write(device, engines, sourceChecksum);
+}
+
+void OpenSearchWriter::write(const OpenSearchDescription &description)
+{
+    writeStartDocument();
+    writeDescription(description);
     writeEndDocument();
 }
 
+void OpenSearchWriter::writeDescription(const OpenSearchDescription &description)
+{
+    writeStartElement(QLatin1String("OpenSearchDescription"));
+    writeDefaultNamespace(QLatin1String("http://a9.com/-/spec/opensearch/1.1/"));
+
+    const QString name = description.name();
+    if (!name.isEmpty())
+        writeTextElement(QLatin1String("ShortName"), name);
+
+    const QString text = description.description();
+    if (!text.isEmpty())
+        writeTextElement(QLatin1String("Description"), text);
+
+    // The search and suggestions URLs come first, followed by the additional ones.
+    // The URLs share their strings and parameter lists with the description.
+    const OpenSearchDescription::Urls urls = description.urls();
+    OpenSearchDescription::Urls::const_iterator end = urls.constEnd();
+    for (OpenSearchDescription::Urls::const_iterator i = urls.constBegin(); i != end; ++i)
+        writeUrl(*i);
+
+    const QString imageUrl = description.imageUrl();
+    if (!imageUrl.isEmpty())
+        writeTextElement(QLatin1String("Image"), imageUrl);
+
+    const QStringList tags = description.tags();
+    if (!tags.isEmpty())
+        writeTextElement(QLatin1String("Tags"), tags.join(QLatin1String(" ")));
+
+    writeEndElement();
+}
+
+void OpenSearchWriter::writeUrl(const OpenSearchDescription::Url &url)
+{
+    writeStartElement(QLatin1String("Url"));
+    writeAttribute(QLatin1String("method"), url.method);
+    writeAttribute(QLatin1String("type"), url.type);
+    if (url.rel != QLatin1String("results"))
+        writeAttribute(QLatin1String("rel"), url.rel);
+    writeAttribute(QLatin1String("template"), url.urlTemplate);
+
+    if (!url.parameters.empty()) {
+        writeNamespace(QLatin1String("http://a9.com/-/spec/opensearch/extensions/parameters/1.0/"), QLatin1String("p"));
+
+        OpenSearchDescription::Parameters::const_iterator end = url.parameters.constEnd();
+        OpenSearchDescription::Parameters::const_iterator i = url.parameters.constBegin();
+        for (; i != end; ++i) {
+            writeStartElement(QLatin1String("p:Parameter"));
+            writeAttribute(QLatin1String("name"), i->first);
+            writeAttribute(QLatin1String("value"), i->second);
+            writeEndElement();
+        }
+    }
+
+    writeEndElement();
+}
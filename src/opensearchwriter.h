@@ -20,8 +20,12 @@
 #ifndef OPENSEARCHWRITER_H
 #define OPENSEARCHWRITER_H
 
+#include <qlist.h>
+#include <qstringlist.h>
 #include <qxmlstream.h>
 
+#include "opensearchdescription.h"
+
 class OpenSearchEngine;
 
 class OpenSearchWriter : public QXmlStreamWriter
@@ -29,11 +33,23 @@ class OpenSearchWriter : public QXmlStreamWriter
 public:
     OpenSearchWriter();
 
+    bool isCompact() const;
+    void setCompact(bool compact);
+
     bool write(QIODevice *device, OpenSearchEngine *engine);
+    bool write(QIODevice *device, const OpenSearchDescription &description);
+    bool writeBundle(QIODevice *device, const QList<OpenSearchDescription> &descriptions);
+    QStringList writeDirectory(const QString &path, const QList<OpenSearchDescription> &descriptions);
+    bool writeSnapshot(QIODevice *device, const QList<OpenSearchEngine*> &engines, quint64 sourceChecksum = 0);
+
+    static QString fileName(const OpenSearchDescription &description);
 
 private:
-    void write(OpenSearchEngine *engine);
+    void write(const OpenSearchDescription &description);
+    void writeDescription(const OpenSearchDescription &description);
+    void writeUrl(const OpenSearchDescription::Url &url);
 
+    struct Job;
 };
 
 #endif // OPENSEARCHWRITER_H
@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = tst_opensearchbatchreader
+
+include(../tests.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_opensearchbatchreader.cpp
+
+RESOURCES += \
+    opensearchbatchreader.qrc
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchbatchreader.h"
+#include "opensearchengine.h"
+
+typedef OpenSearchBatchReader::Result Result;
+typedef OpenSearchBatchReader::Results Results;
+
+class tst_OpenSearchBatchReader : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void readDirectory();
+    void readFiles();
+    void readDevices();
+    void targetThread();
+
+private:
+    void deleteEngines(const Results &results);
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchBatchReader::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchBatchReader::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchBatchReader::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchBatchReader::cleanup()
+{
+}
+
+void tst_OpenSearchBatchReader::deleteEngines(const Results &results)
+{
+    foreach (const Result &result, results)
+        delete result.engine;
+}
+
+void tst_OpenSearchBatchReader::readDirectory()
+{
+    OpenSearchBatchReader reader;
+    Results results = reader.readDirectory(":/engines");
+
+    QCOMPARE(results.count(), 3);
+
+    QCOMPARE(results.at(0).fileName, QString(":/engines/broken.xml"));
+    QVERIFY(results.at(0).hasError());
+    QVERIFY(!results.at(0).engine);
+
+    QCOMPARE(results.at(1).fileName, QString(":/engines/google.xml"));
+    QVERIFY(!results.at(1).hasError());
+    QVERIFY(results.at(1).engine);
+    QCOMPARE(results.at(1).engine->name(), QString("Google"));
+    QCOMPARE(results.at(1).engine->thread(), QThread::currentThread());
+
+    QCOMPARE(results.at(2).fileName, QString(":/engines/wikipedia.xml"));
+    QVERIFY(!results.at(2).hasError());
+    QCOMPARE(results.at(2).engine->name(), QString("Wikipedia (en)"));
+    QCOMPARE(results.at(2).engine->thread(), QThread::currentThread());
+
+    deleteEngines(results);
+
+    results = reader.readDirectory(":/engines", QStringList("*.txt"));
+    QCOMPARE(results.count(), 1);
+    QVERIFY(results.at(0).hasError());
+
+    QVERIFY(reader.readDirectory(":/nonexistent").isEmpty());
+}
+
+void tst_OpenSearchBatchReader::readFiles()
+{
+    QStringList fileNames;
+    for (int i = 0; i < 50; ++i)
+        fileNames << ":/engines/google.xml" << ":/engines/wikipedia.xml";
+    fileNames << ":/engines/nonexistent.xml";
+
+    OpenSearchBatchReader reader;
+    Results results = reader.readFiles(fileNames);
+
+    QCOMPARE(results.count(), fileNames.count());
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(results.at(i).fileName, fileNames.at(i));
+        QVERIFY(results.at(i).engine);
+        QVERIFY(results.at(i).engine->isValid());
+        QCOMPARE(results.at(i).engine->name(), QString(i % 2 ? "Wikipedia (en)" : "Google"));
+    }
+
+    QVERIFY(results.last().hasError());
+    QVERIFY(!results.last().engine);
+
+    deleteEngines(results);
+}
+
+void tst_OpenSearchBatchReader::readDevices()
+{
+    QBuffer buffer1;
+    QBuffer buffer2;
+    buffer1.setData("<OpenSearchDescription xmlns=\"http://a9.com/-/spec/opensearch/1.1/\">"
+                    "<ShortName>Foo</ShortName></OpenSearchDescription>");
+    buffer2.setData("<OpenSearchDescription");
+
+    QList<QIODevice*> devices;
+    devices << &buffer1 << &buffer2;
+
+    OpenSearchBatchReader reader;
+    Results results = reader.readDevices(devices);
+
+    QCOMPARE(results.count(), 2);
+    QCOMPARE(results.at(0).device, static_cast<QIODevice*>(&buffer1));
+    QVERIFY(!results.at(0).hasError());
+    QCOMPARE(results.at(0).engine->name(), QString("Foo"));
+    QCOMPARE(results.at(1).device, static_cast<QIODevice*>(&buffer2));
+    QVERIFY(results.at(1).hasError());
+
+    deleteEngines(results);
+}
+
+void tst_OpenSearchBatchReader::targetThread()
+{
+    QThread thread;
+
+    OpenSearchBatchReader reader;
+    QVERIFY(!reader.targetThread());
+    reader.setTargetThread(&thread);
+    QCOMPARE(reader.targetThread(), &thread);
+
+    Results results = reader.readFiles(QStringList(":/engines/google.xml"));
+    QCOMPARE(results.count(), 1);
+    QCOMPARE(results.at(0).engine->thread(), &thread);
+
+    deleteEngines(results);
+}
+
+QTEST_MAIN(tst_OpenSearchBatchReader)
+
+#include "tst_opensearchbatchreader.moc"
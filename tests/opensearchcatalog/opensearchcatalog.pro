@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = tst_opensearchcatalog
+
+include(../tests.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_opensearchcatalog.cpp
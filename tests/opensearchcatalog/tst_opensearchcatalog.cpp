@@ -0,0 +1,250 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "qtry.h"
+#include "opensearchcatalog.h"
+#include "opensearchengine.h"
+
+Q_DECLARE_METATYPE(OpenSearchEngine*)
+
+class tst_OpenSearchCatalog : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void reload();
+    void setPath();
+    void nameFilters();
+    void watch();
+
+private:
+    QString filePath(const QString &fileName) const;
+    void writeFile(const QString &fileName, const QString &name, const QString &extra = QString());
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchCatalog::initTestCase()
+{
+    qRegisterMetaType<OpenSearchEngine*>("OpenSearchEngine*");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchCatalog::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchCatalog::init()
+{
+    QDir().mkpath(filePath(QString()));
+}
+
+// This will be called after every test function.
+void tst_OpenSearchCatalog::cleanup()
+{
+    QDir directory(filePath(QString()));
+    foreach (const QString &fileName, directory.entryList(QDir::Files))
+        directory.remove(fileName);
+    QDir().rmdir(directory.path());
+}
+
+QString tst_OpenSearchCatalog::filePath(const QString &fileName) const
+{
+    return QDir::tempPath() + QLatin1String("/tst_opensearchcatalog/") + fileName;
+}
+
+void tst_OpenSearchCatalog::writeFile(const QString &fileName, const QString &name, const QString &extra)
+{
+    QFile file(filePath(fileName));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+
+    if (name.isNull()) {
+        file.write("<OpenSearch");
+        return;
+    }
+
+    QString data = QString("<OpenSearchDescription xmlns=\"http://a9.com/-/spec/opensearch/1.1/\">"
+                           "<ShortName>%1</ShortName>"
+                           "<Url type=\"text/html\" template=\"http://%1.barfoo/?q={searchTerms}\"/>"
+                           "</OpenSearchDescription>%2").arg(name, extra);
+    file.write(data.toUtf8());
+}
+
+void tst_OpenSearchCatalog::reload()
+{
+    writeFile("foo.xml", "foo");
+    writeFile("bar.xml", "bar");
+    writeFile("broken.xml", QString());
+
+    OpenSearchCatalog catalog;
+    QSignalSpy addedSpy(&catalog, SIGNAL(engineAdded(OpenSearchEngine*)));
+    QSignalSpy changedSpy(&catalog, SIGNAL(engineChanged(OpenSearchEngine*)));
+    QSignalSpy removedSpy(&catalog, SIGNAL(engineRemoved(OpenSearchEngine*)));
+    QSignalSpy errorSpy(&catalog, SIGNAL(fileError(QString,QString)));
+
+    catalog.setPath(filePath(QString()));
+    QCOMPARE(addedSpy.count(), 2);
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.at(0).at(0).toString(), QFileInfo(filePath("broken.xml")).absoluteFilePath());
+
+    QList<OpenSearchEngine*> engines = catalog.engines();
+    QCOMPARE(engines.count(), 2);
+    QCOMPARE(engines.at(0)->name(), QString("bar"));
+    QCOMPARE(engines.at(1)->name(), QString("foo"));
+    QCOMPARE(catalog.engine("foo.xml"), engines.at(1));
+    QCOMPARE(catalog.engine(filePath("bar.xml")), engines.at(0));
+    QCOMPARE(catalog.engine("broken.xml"), (OpenSearchEngine*)0);
+    QCOMPARE(catalog.fileName(engines.at(1)), QFileInfo(filePath("foo.xml")).absoluteFilePath());
+    QCOMPARE(catalog.fileName(0), QString());
+
+    // Nothing has changed, nothing is reported.
+    catalog.reload();
+    QCOMPARE(addedSpy.count(), 2);
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(changedSpy.count(), 0);
+
+    // A modified file updates its engine in place.
+    OpenSearchEngine *foo = catalog.engine("foo.xml");
+    writeFile("foo.xml", "foobar");
+    catalog.reload();
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.at(0).at(0).value<OpenSearchEngine*>(), foo);
+    QCOMPARE(catalog.engine("foo.xml"), foo);
+    QCOMPARE(foo->name(), QString("foobar"));
+
+    // A different file with the same description does not change the engine.
+    writeFile("foo.xml", "foobar", "\n\n");
+    catalog.reload();
+    QCOMPARE(changedSpy.count(), 1);
+
+    // Changing only the request method is applied too.
+    QFile file(filePath("foo.xml"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("<OpenSearchDescription xmlns=\"http://a9.com/-/spec/opensearch/1.1/\">"
+               "<ShortName>foobar</ShortName>"
+               "<Url type=\"text/html\" method=\"post\" template=\"http://foobar.barfoo/?q={searchTerms}\"/>"
+               "</OpenSearchDescription>");
+    file.close();
+    catalog.reload();
+    QCOMPARE(changedSpy.count(), 2);
+    QCOMPARE(catalog.engine("foo.xml"), foo);
+    QCOMPARE(foo->searchMethod().toLower(), QString("post"));
+
+    // Removed files remove their engines.
+    OpenSearchEngine *bar = catalog.engine("bar.xml");
+    QVERIFY(QFile::remove(filePath("bar.xml")));
+    catalog.reload();
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(removedSpy.at(0).at(0).value<OpenSearchEngine*>(), bar);
+    QCOMPARE(catalog.engines(), QList<OpenSearchEngine*>() << foo);
+
+    // A fixed file adds its engine, a broken one leaves it as it was.
+    writeFile("broken.xml", "baz");
+    writeFile("foo.xml", QString());
+    catalog.reload();
+    QCOMPARE(addedSpy.count(), 3);
+    QCOMPARE(addedSpy.at(2).at(0).value<OpenSearchEngine*>()->name(), QString("baz"));
+    QCOMPARE(errorSpy.count(), 2);
+    QCOMPARE(catalog.engine("foo.xml"), foo);
+    QCOMPARE(foo->name(), QString("foobar"));
+    QCOMPARE(catalog.engines().count(), 2);
+}
+
+void tst_OpenSearchCatalog::setPath()
+{
+    writeFile("foo.xml", "foo");
+
+    OpenSearchCatalog catalog;
+    QCOMPARE(catalog.path(), QString());
+    QCOMPARE(catalog.engines(), QList<OpenSearchEngine*>());
+
+    QSignalSpy removedSpy(&catalog, SIGNAL(engineRemoved(OpenSearchEngine*)));
+
+    catalog.setPath(filePath(QString()));
+    QCOMPARE(catalog.path(), QDir(filePath(QString())).absolutePath());
+    QCOMPARE(catalog.engines().count(), 1);
+
+    QPointer<OpenSearchEngine> engine = catalog.engines().first();
+    catalog.setPath(QString());
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(catalog.engines(), QList<OpenSearchEngine*>());
+
+    // Removed engines are deleted later.
+    QVERIFY(engine);
+    QTRY_VERIFY(!engine);
+}
+
+void tst_OpenSearchCatalog::nameFilters()
+{
+    writeFile("foo.xml", "foo");
+    writeFile("bar.osd", "bar");
+
+    OpenSearchCatalog catalog;
+    QCOMPARE(catalog.nameFilters(), QStringList("*.xml"));
+
+    catalog.setPath(filePath(QString()));
+    QCOMPARE(catalog.engines().count(), 1);
+
+    catalog.setNameFilters(QStringList() << "*.xml" << "*.osd");
+    QCOMPARE(catalog.engines().count(), 2);
+
+    catalog.setNameFilters(QStringList("*.osd"));
+    QCOMPARE(catalog.engines().count(), 1);
+    QCOMPARE(catalog.engines().first()->name(), QString("bar"));
+}
+
+void tst_OpenSearchCatalog::watch()
+{
+    writeFile("foo.xml", "foo");
+
+    OpenSearchCatalog catalog;
+    QCOMPARE(catalog.reloadDelay(), 100);
+    catalog.setReloadDelay(10);
+    catalog.setPath(filePath(QString()));
+
+    QSignalSpy addedSpy(&catalog, SIGNAL(engineAdded(OpenSearchEngine*)));
+    QSignalSpy changedSpy(&catalog, SIGNAL(engineChanged(OpenSearchEngine*)));
+    QSignalSpy removedSpy(&catalog, SIGNAL(engineRemoved(OpenSearchEngine*)));
+
+    writeFile("bar.xml", "bar");
+    QTRY_COMPARE(addedSpy.count(), 1);
+
+    // The watcher reports rewrites that do not change the size or modification time.
+    writeFile("foo.xml", "oof");
+    QTRY_COMPARE(changedSpy.count(), 1);
+    QCOMPARE(catalog.engine("foo.xml")->name(), QString("oof"));
+
+    QVERIFY(QFile::remove(filePath("bar.xml")));
+    QTRY_COMPARE(removedSpy.count(), 1);
+    QCOMPARE(catalog.engines().count(), 1);
+}
+
+QTEST_MAIN(tst_OpenSearchCatalog)
+
+#include "tst_opensearchcatalog.moc"
@@ -0,0 +1,419 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchdescription.h"
+#include "opensearchengine.h"
+#include "opensearchreader.h"
+#include "opensearchstringpool.h"
+#include "opensearchwriter.h"
+
+#include <qtconcurrentmap.h>
+
+typedef OpenSearchDescription::Parameters Parameters;
+typedef OpenSearchDescription::Parameter Parameter;
+
+class tst_OpenSearchDescription : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void opensearchdescription();
+    void sharing();
+    void methods();
+    void urls();
+    void encodedSearchUrls();
+    void additionalUrls();
+    void operatorequal();
+    void memoryUsage();
+    void threads();
+    void engine();
+    void readWrite();
+
+private:
+    OpenSearchDescription m_description;
+};
+
+struct SearchUrlJob
+{
+    typedef QUrl result_type;
+
+    SearchUrlJob(const OpenSearchDescription &description)
+        : description(description)
+    {}
+
+    result_type operator()(const QString &searchTerm) const
+    {
+        return description.searchUrl(searchTerm);
+    }
+
+    OpenSearchDescription description;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchDescription::initTestCase()
+{
+    m_description.setName("Foo");
+    m_description.setDescription("Bar");
+    m_description.setSearchUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    m_description.setSearchParameters(Parameters() << Parameter("a", "b"));
+    m_description.setSuggestionsUrlTemplate("http://foobar.baz/suggest?q={searchTerms}");
+    m_description.setSuggestionsParameters(Parameters() << Parameter("c", "{searchTerms}"));
+    m_description.setSuggestionsMethod("post");
+    m_description.setImageUrl("http://foobar.baz/favicon.png");
+    m_description.setTags(QStringList() << "foo" << "bar");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchDescription::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchDescription::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchDescription::cleanup()
+{
+}
+
+void tst_OpenSearchDescription::opensearchdescription()
+{
+    OpenSearchDescription description;
+    QCOMPARE(description.name(), QString());
+    QCOMPARE(description.description(), QString());
+    QCOMPARE(description.searchUrlTemplate(), QString());
+    QCOMPARE(description.searchUrl("foo"), QUrl());
+    QCOMPARE(description.searchParameters(), Parameters());
+    QCOMPARE(description.searchMethod(), QString("get"));
+    QCOMPARE(description.providesSuggestions(), false);
+    QCOMPARE(description.suggestionsUrlTemplate(), QString());
+    QCOMPARE(description.suggestionsUrl("foo"), QUrl());
+    QCOMPARE(description.suggestionsParameters(), Parameters());
+    QCOMPARE(description.suggestionsMethod(), QString("get"));
+    QCOMPARE(description.imageUrl(), QString());
+    QCOMPARE(description.tags(), QStringList());
+    QCOMPARE(description.isValid(), false);
+    QVERIFY(description == OpenSearchDescription());
+    QCOMPARE(qHash(description), qHash(OpenSearchDescription()));
+}
+
+void tst_OpenSearchDescription::sharing()
+{
+    OpenSearchDescription copy = m_description;
+    QVERIFY(copy == m_description);
+    QCOMPARE(copy.hash(), m_description.hash());
+
+    copy.setName("Baz");
+    QCOMPARE(copy.name(), QString("Baz"));
+    QCOMPARE(m_description.name(), QString("Foo"));
+    QVERIFY(copy != m_description);
+
+    OpenSearchDescription assigned;
+    assigned = copy;
+    QCOMPARE(assigned.name(), QString("Baz"));
+    QCOMPARE(assigned.searchUrl("x"), copy.searchUrl("x"));
+}
+
+void tst_OpenSearchDescription::methods()
+{
+    OpenSearchDescription description;
+    description.setSearchMethod("POST");
+    QCOMPARE(description.searchMethod(), QString("post"));
+    description.setSearchMethod("put");
+    QCOMPARE(description.searchMethod(), QString("post"));
+    description.setSuggestionsMethod("");
+    QCOMPARE(description.suggestionsMethod(), QString("get"));
+
+    QCOMPARE(description.searchRequestMethod(), OpenSearchDescription::PostMethod);
+    QCOMPARE(description.suggestionsRequestMethod(), OpenSearchDescription::GetMethod);
+
+    OpenSearchDescription::RequestMethod method = OpenSearchDescription::GetMethod;
+    QVERIFY(OpenSearchDescription::parseRequestMethod("Post", &method));
+    QCOMPARE(method, OpenSearchDescription::PostMethod);
+    QVERIFY(!OpenSearchDescription::parseRequestMethod("put", &method));
+    QCOMPARE(method, OpenSearchDescription::PostMethod);
+    QCOMPARE(OpenSearchDescription::requestMethodName(OpenSearchDescription::GetMethod), QString("get"));
+
+    // All the descriptions share the names of the methods.
+    QVERIFY(OpenSearchStringPool::contains(description.searchMethod()));
+}
+
+void tst_OpenSearchDescription::urls()
+{
+    QCOMPARE(m_description.searchUrl("foo bar"), QUrl::fromEncoded("http://foobar.baz/?q=foo%20bar&a=b"));
+    QCOMPARE(m_description.searchPostData("foo"), QByteArray("a=b"));
+
+    // Posted parameters are left out of the URL.
+    QVERIFY(m_description.providesSuggestions());
+    QCOMPARE(m_description.suggestionsUrl("foo"), QUrl::fromEncoded("http://foobar.baz/suggest?q=foo"));
+    QCOMPARE(m_description.suggestionsPostData("foo"), QByteArray("c=foo"));
+}
+
+void tst_OpenSearchDescription::encodedSearchUrls()
+{
+    QCOMPARE(m_description.encodedSearchUrl("foo bar"), QByteArray("http://foobar.baz/?q=foo%20bar&a=b"));
+
+    QStringList searchTerms;
+    searchTerms << "foo" << QString::fromUtf8("zażółć") << "a&b";
+    QList<QByteArray> urls = m_description.encodedSearchUrls(searchTerms);
+    QCOMPARE(urls.count(), searchTerms.count());
+    for (int i = 0; i < searchTerms.count(); ++i)
+        QCOMPARE(QUrl::fromEncoded(urls.at(i)), m_description.searchUrl(searchTerms.at(i)));
+
+    OpenSearchDescription posted;
+    posted.setSearchUrlTemplate("http://foo.bar/search?q={searchTerms}");
+    posted.setSearchParameters(Parameters() << Parameter("a", "b"));
+    posted.setSearchMethod("post");
+
+    // Large batches are split into chunks, which must keep the order.
+    searchTerms.clear();
+    for (int i = 0; i < 5000; ++i)
+        searchTerms.append(QString::number(i));
+
+    QList<OpenSearchDescription> descriptions;
+    descriptions << m_description << OpenSearchDescription() << posted;
+    urls = OpenSearchDescription::encodedSearchUrls(descriptions, searchTerms);
+    QCOMPARE(urls.count(), descriptions.count() * searchTerms.count());
+    for (int i = 0; i < descriptions.count(); ++i) {
+        for (int j = 0; j < searchTerms.count(); j += 499)
+            QCOMPARE(urls.at(i * searchTerms.count() + j), descriptions.at(i).encodedSearchUrl(searchTerms.at(j)));
+    }
+    QCOMPARE(urls.at(searchTerms.count()), QByteArray());
+    QCOMPARE(urls.last(), QByteArray("http://foo.bar/search?q=4999"));
+
+    QVERIFY(OpenSearchDescription::encodedSearchUrls(descriptions, QStringList()).isEmpty());
+}
+
+void tst_OpenSearchDescription::additionalUrls()
+{
+    OpenSearchDescription::Url rss;
+    rss.type = QLatin1String("application/rss+xml");
+    rss.urlTemplate = QLatin1String("http://foobar.baz/rss?q={searchTerms}&n={count}");
+    rss.parameters.append(Parameter("a", "b"));
+    QCOMPARE(rss.rel, QString("results"));
+    QCOMPARE(rss.method, QString("get"));
+
+    OpenSearchDescription::Url atom;
+    atom.type = QLatin1String("application/atom+xml");
+    atom.urlTemplate = QLatin1String("http://foobar.baz/atom");
+    atom.parameters.append(Parameter("q", "{searchTerms}"));
+    atom.method = QLatin1String("POST");
+
+    OpenSearchDescription::Url otherRss = rss;
+    otherRss.urlTemplate = QLatin1String("http://foobar.baz/other");
+
+    OpenSearchDescription::Url postRss = rss;
+    postRss.method = QLatin1String("post");
+    QVERIFY(postRss != rss);
+
+    OpenSearchDescription::Url self;
+    self.type = QLatin1String("application/opensearchdescription+xml");
+    self.rel = QString();
+    self.urlTemplate = QLatin1String("http://foobar.baz/opensearch.xml");
+
+    OpenSearchDescription::Url empty;
+    empty.type = QLatin1String("application/json");
+
+    OpenSearchDescription description = m_description;
+    description.setAdditionalUrls(OpenSearchDescription::Urls() << rss << atom << otherRss << self << empty);
+    QVERIFY(description != m_description);
+    QVERIFY(description.hash() != m_description.hash());
+
+    // Empty templates are dropped, relations and methods are normalized.
+    OpenSearchDescription::Urls urls = description.additionalUrls();
+    QCOMPARE(urls.count(), 4);
+    QCOMPARE(urls.at(1).method, QString("post"));
+    QCOMPARE(urls.at(3).rel, QString("results"));
+    QCOMPARE(description.urls().count(), 6);
+    QCOMPARE(description.urls().first().urlTemplate, m_description.searchUrlTemplate());
+
+    QCOMPARE(description.resultTypes(), QStringList() << "text/html" << "application/rss+xml"
+                                                      << "application/atom+xml"
+                                                      << "application/opensearchdescription+xml");
+    QVERIFY(description.hasUrl("application/rss+xml"));
+    QVERIFY(!description.hasUrl("application/rss+xml", "self"));
+    QVERIFY(!description.hasUrl("application/json"));
+
+    OpenSearchDescription postDescription = description;
+    postDescription.setAdditionalUrls(OpenSearchDescription::Urls() << postRss << atom << otherRss << self);
+    QVERIFY(postDescription != description);
+
+    // The first URL of a type wins.
+    QCOMPARE(description.url("application/rss+xml"), rss);
+    QCOMPARE(description.url("text/html").urlTemplate, m_description.searchUrlTemplate());
+    QCOMPARE(description.url("application/x-suggestions+json", "suggestions").method, QString("post"));
+
+    OpenSearchTemplateContext context(10);
+    QCOMPARE(description.resultsUrl("foo bar", "application/rss+xml", context),
+             QUrl::fromEncoded("http://foobar.baz/rss?q=foo%20bar&n=10&a=b"));
+    QCOMPARE(description.resultsUrl("foo", "application/atom+xml"), QUrl::fromEncoded("http://foobar.baz/atom"));
+    QCOMPARE(description.resultsPostData("foo", "application/atom+xml"), QByteArray("q=foo"));
+    QCOMPARE(description.resultsUrl("foo", "text/html"), description.searchUrl("foo"));
+    QCOMPARE(description.resultsUrl("foo", "application/json"), QUrl());
+
+    OpenSearchEngine engine(description);
+    QCOMPARE(engine.resultTypes(), description.resultTypes());
+    QVERIFY(engine.providesResults("application/atom+xml"));
+    QVERIFY(!engine.providesResults("application/json"));
+    QCOMPARE(engine.resultsUrl("foo", "application/rss+xml"), description.resultsUrl("foo", "application/rss+xml"));
+
+    description.setAdditionalUrls(OpenSearchDescription::Urls());
+    QVERIFY(description == m_description);
+}
+
+void tst_OpenSearchDescription::operatorequal()
+{
+    OpenSearchDescription other;
+    other.setName("Foo");
+    other.setDescription("Bar");
+    other.setSearchUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    other.setSearchParameters(Parameters() << Parameter("a", "b"));
+    other.setSuggestionsUrlTemplate("http://foobar.baz/suggest?q={searchTerms}");
+    other.setSuggestionsParameters(Parameters() << Parameter("c", "{searchTerms}"));
+    other.setImageUrl("http://foobar.baz/favicon.png");
+
+    // Methods are compared, tags are not.
+    QVERIFY(other != m_description);
+    other.setSuggestionsMethod("post");
+    QVERIFY(other == m_description);
+    QCOMPARE(other.hash(), m_description.hash());
+
+    other.setSearchMethod("post");
+    QVERIFY(other != m_description);
+    other.setSearchMethod("get");
+    QVERIFY(other == m_description);
+
+    other.setSearchParameters(Parameters() << Parameter("a", "c"));
+    QVERIFY(other != m_description);
+
+    other.setSearchParameters(Parameters() << Parameter("a", "b"));
+    QVERIFY(other == m_description);
+
+    QHash<OpenSearchDescription, int> hash;
+    hash.insert(m_description, 1);
+    QCOMPARE(hash.value(other), 1);
+}
+
+void tst_OpenSearchDescription::memoryUsage()
+{
+    OpenSearchDescription empty;
+    QVERIFY(empty.memoryUsage() > 0);
+
+    // Strings that many descriptions repeat are shared, unique ones are not.
+    OpenSearchDescription first;
+    first.setName(QString("First"));
+    first.setSearchUrlTemplate(QString("http://foobar.baz/?q={searchTerms}"));
+    first.setSearchParameters(Parameters() << Parameter(QString("client"), QString("foo")));
+    first.setTags(QStringList() << QString("web"));
+
+    OpenSearchDescription second;
+    second.setName(QString("Second"));
+    second.setSearchUrlTemplate(QString("http://foobar.baz/?q={searchTerms}"));
+    second.setSearchParameters(Parameters() << Parameter(QString("client"), QString("foo")));
+    second.setTags(QStringList() << QString("web"));
+
+    QCOMPARE(first.searchUrlTemplate().constData(), second.searchUrlTemplate().constData());
+    QCOMPARE(first.searchParameters().at(0).first.constData(), second.searchParameters().at(0).first.constData());
+    QCOMPARE(first.tags().at(0).constData(), second.tags().at(0).constData());
+    QVERIFY(first.name().constData() != second.name().constData());
+    QVERIFY(!OpenSearchStringPool::contains(first.name()));
+
+    // Pooled strings are left out of the usage of each description.
+    qint64 usage = first.memoryUsage();
+    QVERIFY(usage > empty.memoryUsage());
+    first.setDescription(QString(1000, QLatin1Char('x')));
+    QVERIFY(first.memoryUsage() >= usage + 2000);
+    first.setTags(QStringList() << QString("web") << QString("search"));
+    QVERIFY(first.memoryUsage() < usage + 2000 + 100);
+
+    OpenSearchEngine engine(first);
+    QVERIFY(engine.memoryUsage() > first.memoryUsage());
+}
+
+void tst_OpenSearchDescription::threads()
+{
+    QStringList searchTerms;
+    for (int i = 0; i < 100; ++i)
+        searchTerms.append(QString::number(i));
+
+    QList<QUrl> urls = QtConcurrent::blockingMapped<QList<QUrl> >(searchTerms, SearchUrlJob(m_description));
+    QCOMPARE(urls.count(), searchTerms.count());
+    for (int i = 0; i < urls.count(); ++i)
+        QCOMPARE(urls.at(i), m_description.searchUrl(searchTerms.at(i)));
+}
+
+void tst_OpenSearchDescription::engine()
+{
+    OpenSearchEngine engine(m_description);
+    QCOMPARE(engine.name(), QString("Foo"));
+    QCOMPARE(engine.suggestionsMethod(), QString("post"));
+    QCOMPARE(engine.searchUrl("foo"), m_description.searchUrl("foo"));
+    QVERIFY(engine.openSearchDescription() == m_description);
+
+    engine.setName("Baz");
+    QCOMPARE(engine.openSearchDescription().name(), QString("Baz"));
+    QCOMPARE(m_description.name(), QString("Foo"));
+
+    OpenSearchEngine other;
+    other.setOpenSearchDescription(engine.openSearchDescription());
+    QVERIFY(other == engine);
+
+    // Images set explicitly become part of the description.
+    QImage image(16, 16, QImage::Format_ARGB32);
+    image.fill(0);
+    OpenSearchEngine imageEngine;
+    imageEngine.setImage(image);
+    QVERIFY(imageEngine.openSearchDescription().imageUrl().startsWith("data:image/png;base64,"));
+}
+
+void tst_OpenSearchDescription::readWrite()
+{
+    QBuffer buffer;
+    OpenSearchWriter writer;
+    QVERIFY(writer.write(&buffer, m_description));
+    buffer.close();
+
+    OpenSearchReader reader;
+    OpenSearchDescription description;
+    QVERIFY(reader.read(&buffer, &description));
+    QVERIFY(description == m_description);
+    QCOMPARE(description.searchMethod(), m_description.searchMethod());
+    QCOMPARE(description.suggestionsMethod(), m_description.suggestionsMethod());
+    QCOMPARE(description.tags(), m_description.tags());
+
+    QBuffer broken;
+    broken.setData("<OpenSearch");
+    QVERIFY(!reader.read(&broken, &description));
+}
+
+QTEST_MAIN(tst_OpenSearchDescription)
+
+#include "tst_opensearchdescription.moc"
@@ -22,6 +22,10 @@
 #include "qtry.h"
 #include "opensearchengine.h"
 #include "opensearchenginedelegate.h"
+#include "opensearchengineobserver.h"
+#include "opensearchrequestscheduler.h"
+#include "opensearchsuggestionscache.h"
+#include "opensearchsuggestionsindex.h"
 
 #include <qbuffer.h>
 #include <qfile.h>
@@ -66,6 +70,14 @@ private slots:
     void requestSuggestions_data();
     void requestSuggestions();
     void requestSuggestionsCrash();
+    void requestSuggestionsBatch_data();
+    void requestSuggestionsBatch();
+    void requestSuggestionsDelay();
+    void requestSuggestionsMaximumDelay();
+    void requestSuggestionsCache();
+    void requestSuggestionsIndex();
+    void requestSuggestionsOverlapping();
+    void requestSuggestionsScheduler();
     void searchParameters_data();
     void searchParameters();
     void searchUrl_data();
@@ -84,6 +96,9 @@ private slots:
     void languageCodes();
     void requestMethods();
     void delegate();
+    void observer();
+    void requestPolicy();
+    void prepareForSuggestions();
 };
 
 // Subclass that exposes the protected functions.
@@ -108,8 +123,10 @@ class SuggestionsTestNetworkReply : public QNetworkReply
     Q_OBJECT
 
 public:
-    SuggestionsTestNetworkReply(const QNetworkRequest &request, QObject *parent = 0)
+    SuggestionsTestNetworkReply(const QNetworkRequest &request, int chunkSize = 0, int delay = 50, QObject *parent = 0)
         : QNetworkReply(parent)
+        , chunkSize(chunkSize)
+        , published(0)
     {
         setOperation(QNetworkAccessManager::GetOperation);
         setRequest(request);
@@ -120,7 +137,7 @@ public:
         expectedResult.open(QIODevice::ReadOnly);
         setError(QNetworkReply::NoError, tr("No Error"));
 
-        QTimer::singleShot(50, this, SLOT(sendSuggestions()));
+        QTimer::singleShot(delay, this, SLOT(sendSuggestions()));
     }
 
     ~SuggestionsTestNetworkReply()
@@ -130,7 +147,7 @@ public:
 
     qint64 bytesAvailable() const
     {
-        return expectedResult.bytesAvailable() + QNetworkReply::bytesAvailable();
+        return publishedBytesAvailable() + QNetworkReply::bytesAvailable();
     }
 
     void close()
@@ -140,7 +157,7 @@ public:
 
     qint64 readData(char *data, qint64 maxSize)
     {
-        return expectedResult.read(data, maxSize);
+        return expectedResult.read(data, qMin(maxSize, publishedBytesAvailable()));
     }
 
     void abort()
@@ -152,18 +169,38 @@ private slots:
     {
         // Publish result
         setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("text/html"));
-        setHeader(QNetworkRequest::ContentLengthHeader, expectedResult.bytesAvailable());
+        setHeader(QNetworkRequest::ContentLengthHeader, expectedResult.size());
         setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
         setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, QByteArray("Ok"));
 
         emit metaDataChanged();
+        sendChunk();
+    }
+
+    void sendChunk()
+    {
+        published = chunkSize ? qMin(published + chunkSize, expectedResult.size()) : expectedResult.size();
+
         emit readyRead();
-        emit downloadProgress(expectedResult.size(), expectedResult.size());
-        emit finished();
+        emit downloadProgress(published, expectedResult.size());
+
+        if (published < expectedResult.size())
+            QTimer::singleShot(10, this, SLOT(sendChunk()));
+        else
+            emit finished();
     }
 
 private:
+    qint64 publishedBytesAvailable() const
+    {
+        if (!expectedResult.isOpen())
+            return 0;
+        return published - expectedResult.pos();
+    }
+
     QFile expectedResult;
+    qint64 chunkSize;
+    qint64 published;
 };
 
 class SuggestionsTestNetworkAccessManager : public QNetworkAccessManager
@@ -171,12 +208,17 @@ class SuggestionsTestNetworkAccessManager : public QNetworkAccessManager
 public:
     SuggestionsTestNetworkAccessManager(QObject *parent = 0)
         : QNetworkAccessManager(parent)
+        , chunkSize(0)
+        , requestCount(0)
     {
     }
 
     QNetworkRequest lastRequest;
     Operation lastOperation;
     bool lastOutgoingData;
+    int chunkSize;
+    int requestCount;
+    QList<int> delays;
 
 protected:
     QNetworkReply *createRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, QIODevice *outgoingData = 0)
@@ -184,8 +226,10 @@ protected:
         lastOperation = operation;
         lastRequest = request;
         lastOutgoingData = (bool)outgoingData;
+        ++requestCount;
 
-        return new SuggestionsTestNetworkReply(request, 0);
+        int delay = delays.isEmpty() ? 50 : delays.takeFirst();
+        return new SuggestionsTestNetworkReply(request, chunkSize, delay, 0);
     }
 };
 
@@ -218,6 +262,19 @@ class Delegate : public OpenSearchEngineDelegate
         int callsCount;
 };
 
+class Observer : public OpenSearchEngineObserver
+{
+    public:
+        void suggestionsRequestFinished(OpenSearchEngine *engine, const SuggestionsStatistics &requestStatistics)
+        {
+            engines.append(engine);
+            statistics.append(requestStatistics);
+        }
+
+        QList<OpenSearchEngine*> engines;
+        QList<SuggestionsStatistics> statistics;
+};
+
 // This will be called before the first test function is executed.
 // It is only called once.
 void tst_OpenSearchEngine::initTestCase()
@@ -330,20 +387,28 @@ void tst_OpenSearchEngine::image()
     image.save(&imageBuffer, "PNG");
     QString imageUrl = QString("data:image/png;base64,").append(imageBuffer.buffer().toBase64());
     engine.setImageUrl(imageUrl);
-    QCOMPARE(engine.image(), QImage());
 
-    QTRY_COMPARE(spy0.count(), 1);
+    // Data URLs are decoded right away, without any network requests.
+    QCOMPARE(engine.image().size(), QSize(1, 1));
+    QCOMPARE(spy0.count(), 0);
     QCOMPARE(spy1.count(), 0);
-    QVERIFY(engine.image() != QImage());
 
     SubOpenSearchEngine engine2;
     QSignalSpy spy2(&engine2, SIGNAL(imageChanged()));
 
     QVERIFY(engine2.imageUrl().isEmpty());
     engine2.setImage(engine.image());
+    QCOMPARE(engine2.image(), engine.image());
     QCOMPARE(engine2.imageUrl(), imageUrl);
+    QVERIFY(engine2 == engine);
 
     QCOMPARE(spy2.count(), 1);
+
+    SubOpenSearchEngine engine3;
+    engine3.setImageUrl("data:image/png,%ZZ");
+    QCOMPARE(engine3.image(), QImage());
+    engine3.setImageUrl(QString("data:,").append(QUrl::toPercentEncoding(imageBuffer.buffer())));
+    QCOMPARE(engine3.image().size(), QSize(1, 1));
 }
 
 void tst_OpenSearchEngine::imageUrl_data()
@@ -591,6 +656,328 @@ void tst_OpenSearchEngine::requestSuggestionsCrash()
     QCOMPARE(spy.at(0).at(0).toStringList(), suggestions);
 }
 
+void tst_OpenSearchEngine::requestSuggestionsBatch_data()
+{
+    QTest::addColumn<int>("chunkSize");
+    QTest::addColumn<int>("batchSize");
+    QTest::addColumn<int>("firstBatch");
+    QTest::addColumn<int>("signalCount");
+    QTest::newRow("no batch") << 40 << 0 << 6 << 1;
+    QTest::newRow("batch") << 40 << 2 << 2 << 2;
+    QTest::newRow("one chunk") << 0 << 2 << 6 << 1;
+    QTest::newRow("too big") << 40 << 10 << 6 << 1;
+}
+
+void tst_OpenSearchEngine::requestSuggestionsBatch()
+{
+    QFETCH(int, chunkSize);
+    QFETCH(int, batchSize);
+    QFETCH(int, firstBatch);
+    QFETCH(int, signalCount);
+
+    SuggestionsTestNetworkAccessManager manager;
+    manager.chunkSize = chunkSize;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz");
+    engine.setSuggestionsBatchSize(batchSize);
+    QCOMPARE(engine.suggestionsBatchSize(), batchSize);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QStringList const&)));
+
+    engine.requestSuggestions("sea");
+
+    QTRY_COMPARE(spy.count(), signalCount);
+    QTest::qWait(200);
+    QCOMPARE(spy.count(), signalCount);
+
+    QStringList suggestions;
+    suggestions << "sears" << "search engines" << "search engine" << "search" << "sears.com" << "seattle times";
+    QCOMPARE(spy.at(0).at(0).toStringList(), suggestions.mid(0, firstBatch));
+    QCOMPARE(spy.last().at(0).toStringList(), suggestions);
+}
+
+void tst_OpenSearchEngine::requestSuggestionsDelay()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    engine.setSuggestionsDelay(100);
+    QCOMPARE(engine.suggestionsDelay(), 100);
+    QCOMPARE(engine.property("suggestionsDelay").toInt(), 100);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QStringList const&)));
+
+    engine.requestSuggestions("s");
+    engine.requestSuggestions("se");
+    engine.requestSuggestions("sea");
+    QCOMPARE(manager.requestCount, 0);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(manager.requestCount, 1);
+    QCOMPARE(manager.lastRequest.url().queryItemValue("q"), QString("sea"));
+
+    engine.setSuggestionsDelay(0);
+    engine.requestSuggestions("sear");
+    QCOMPARE(manager.requestCount, 2);
+    QTRY_COMPARE(spy.count(), 2);
+
+    // A postponed term that cannot be sent anymore is finished all the same.
+    QSignalSpy finishedSpy(&engine, SIGNAL(suggestionsFinished(QString,bool)));
+    engine.setSuggestionsDelay(100);
+    engine.requestSuggestions("searc");
+    engine.setSuggestionsUrlTemplate(QString());
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toString(), QString("searc"));
+    QCOMPARE(finishedSpy.at(0).at(1).toBool(), false);
+    QCOMPARE(manager.requestCount, 2);
+}
+
+void tst_OpenSearchEngine::requestSuggestionsMaximumDelay()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    engine.setSuggestionsDelay(200);
+    engine.setSuggestionsMaximumDelay(300);
+    QCOMPARE(engine.suggestionsMaximumDelay(), 300);
+
+    // Keep typing for longer than the maximum delay, but faster than the quiet period.
+    QStringList terms = QStringList() << "s" << "se" << "sea" << "sear" << "searc" << "search";
+    for (int i = 0; i < terms.count(); ++i) {
+        engine.requestSuggestions(terms.at(i));
+        QTest::qWait(100);
+    }
+
+    QVERIFY(manager.requestCount >= 1);
+    QVERIFY(manager.requestCount < terms.count());
+}
+
+void tst_OpenSearchEngine::requestSuggestionsCache()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    OpenSearchSuggestionsCache cache;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+
+    QCOMPARE(engine.suggestionsCache(), (OpenSearchSuggestionsCache*)0);
+    engine.setSuggestionsCache(&cache);
+    QCOMPARE(engine.suggestionsCache(), &cache);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QStringList const&)));
+
+    engine.requestSuggestions("sea");
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(manager.requestCount, 1);
+    QCOMPARE(cache.count(), 1);
+
+    engine.requestSuggestions("Sea");
+    QCOMPARE(spy.count(), 1);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(manager.requestCount, 1);
+    QCOMPARE(spy.at(1).at(0).toStringList(), spy.at(0).at(0).toStringList());
+    QCOMPARE(cache.hits(), 1);
+
+    // Another engine with the same suggestions URL shares the entries.
+    SubOpenSearchEngine other;
+    other.setNetworkAccessManager(&manager);
+    other.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    other.setSuggestionsCache(&cache);
+
+    QSignalSpy otherSpy(&other, SIGNAL(suggestions(QStringList const&)));
+    other.requestSuggestions("sea");
+    QTRY_COMPARE(otherSpy.count(), 1);
+    QCOMPARE(manager.requestCount, 1);
+
+    engine.requestSuggestions("sear");
+    QTRY_COMPARE(spy.count(), 3);
+    QCOMPARE(manager.requestCount, 2);
+}
+
+void tst_OpenSearchEngine::requestSuggestionsIndex()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    OpenSearchSuggestionsIndex index;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+
+    QCOMPARE(engine.suggestionsIndex(), (OpenSearchSuggestionsIndex*)0);
+    engine.setSuggestionsIndex(&index);
+    QCOMPARE(engine.suggestionsIndex(), &index);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QString,QStringList)));
+
+    // Nothing to answer from yet, the received suggestions fill the index.
+    engine.requestSuggestions("sea");
+    QTRY_COMPARE(spy.count(), 1);
+    QStringList received = spy.at(0).at(1).toStringList();
+    QCOMPARE(received.count(), 6);
+    QCOMPARE(index.count(), 6);
+
+    // The index answers first, then the received suggestions come with the indexed ones.
+    spy.clear();
+    index.insert("seashells", 5);
+    engine.requestSuggestions("sea");
+    QCOMPARE(spy.count(), 0);
+    QCOMPARE(manager.requestCount, 2);
+
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(0).at(0).toString(), QString("sea"));
+    QCOMPARE(spy.at(0).at(1).toStringList().first(), QString("seashells"));
+    QCOMPARE(spy.at(0).at(1).toStringList().count(), 7);
+    QCOMPARE(spy.at(1).at(1).toStringList(), QStringList(received) << "seashells");
+
+    // Without a network access manager, only the index answers.
+    spy.clear();
+    engine.setNetworkAccessManager(0);
+    engine.requestSuggestions("seat");
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList() << "seattle times");
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(manager.requestCount, 2);
+}
+
+void tst_OpenSearchEngine::requestSuggestionsOverlapping()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+
+    QCOMPARE(engine.maximumSuggestionsRequests(), 1);
+    engine.setMaximumSuggestionsRequests(0);
+    QCOMPARE(engine.maximumSuggestionsRequests(), 1);
+    engine.setMaximumSuggestionsRequests(3);
+    QCOMPARE(engine.property("maximumSuggestionsRequests").toInt(), 3);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QStringList const&)));
+    QSignalSpy termSpy(&engine, SIGNAL(suggestions(QString,QStringList)));
+
+    // Replies arriving in order are all delivered.
+    manager.delays << 50 << 150;
+    engine.requestSuggestions("s");
+    engine.requestSuggestions("se");
+    QCOMPARE(manager.requestCount, 2);
+
+    QTRY_COMPARE(termSpy.count(), 2);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(termSpy.at(0).at(0).toString(), QString("s"));
+    QCOMPARE(termSpy.at(1).at(0).toString(), QString("se"));
+    QCOMPARE(termSpy.at(1).at(1).toStringList(), spy.at(1).at(0).toStringList());
+
+    // A reply overtaken by a newer one is dropped.
+    spy.clear();
+    termSpy.clear();
+    manager.delays << 150 << 250 << 50;
+    engine.requestSuggestions("sea");
+    engine.requestSuggestions("sear");
+    engine.requestSuggestions("searc");
+    QCOMPARE(manager.requestCount, 5);
+
+    QTRY_COMPARE(termSpy.count(), 1);
+    QTest::qWait(400);
+    QCOMPARE(termSpy.count(), 1);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(termSpy.at(0).at(0).toString(), QString("searc"));
+
+    // The oldest request makes room for a new one.
+    termSpy.clear();
+    engine.setMaximumSuggestionsRequests(2);
+    manager.delays << 50 << 50 << 50;
+    engine.requestSuggestions("a");
+    engine.requestSuggestions("ab");
+    engine.requestSuggestions("abc");
+    QCOMPARE(manager.requestCount, 8);
+
+    QTRY_COMPARE(termSpy.count(), 2);
+    QTest::qWait(200);
+    QCOMPARE(termSpy.count(), 2);
+    QCOMPARE(termSpy.at(0).at(0).toString(), QString("ab"));
+    QCOMPARE(termSpy.at(1).at(0).toString(), QString("abc"));
+}
+
+void tst_OpenSearchEngine::requestSuggestionsScheduler()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+    Observer observer;
+
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    engine.setObserver(&observer);
+
+    QCOMPARE(engine.requestScheduler(), (OpenSearchRequestScheduler*)0);
+    engine.setRequestScheduler(&scheduler);
+    QCOMPARE(engine.requestScheduler(), &scheduler);
+
+    // Another engine using the same host takes the only connection.
+    SubOpenSearchEngine other;
+    other.setNetworkAccessManager(&manager);
+    other.setSuggestionsUrlTemplate("http://foobar.baz/other?q={searchTerms}");
+    other.setRequestScheduler(&scheduler);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QString,QStringList)));
+    QSignalSpy otherSpy(&other, SIGNAL(suggestions(QString,QStringList)));
+
+    other.requestSuggestions("s");
+    QCOMPARE(manager.requestCount, 1);
+
+    // Only the latest term waits for its turn.
+    engine.requestSuggestions("se");
+    engine.requestSuggestions("sea");
+    QCOMPARE(manager.requestCount, 1);
+    QCOMPARE(scheduler.queueLength(), 1);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(otherSpy.count(), 1);
+    QCOMPARE(manager.requestCount, 2);
+    QCOMPARE(spy.at(0).at(0).toString(), QString("sea"));
+    QCOMPARE(scheduler.queueLength(), 0);
+    QCOMPARE(scheduler.activeRequests(QUrl("http://foobar.baz/")), 0);
+
+    // When the queue is full, the request is dropped.
+    scheduler.setMaximumQueueLength(0);
+    other.requestSuggestions("a");
+    engine.requestSuggestions("ab");
+    QCOMPARE(manager.requestCount, 3);
+    QCOMPARE(scheduler.droppedRequests(), 1);
+    QCOMPARE(observer.statistics.last().outcome, OpenSearchEngineObserver::Throttled);
+    QCOMPARE(observer.statistics.last().searchTerm, QString("ab"));
+
+    QTRY_COMPARE(otherSpy.count(), 2);
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 1);
+
+    // The request of a destroyed engine does not wait anymore.
+    scheduler.setMaximumQueueLength(8);
+    SubOpenSearchEngine *destroyed = new SubOpenSearchEngine;
+    destroyed->setNetworkAccessManager(&manager);
+    destroyed->setSuggestionsUrlTemplate("http://foobar.baz/destroyed?q={searchTerms}");
+    destroyed->setRequestScheduler(&scheduler);
+    QVERIFY(scheduler.tryAcquire(QUrl("http://foobar.baz/")));
+    destroyed->requestSuggestions("d");
+    QCOMPARE(scheduler.queueLength(), 1);
+    delete destroyed;
+    QCOMPARE(scheduler.queueLength(), 0);
+
+    // A request queued for a host the template has left asks the new host for a slot.
+    engine.requestSuggestions("moved");
+    QCOMPARE(scheduler.queueLength(), 1);
+    engine.setSuggestionsUrlTemplate("http://moved.baz/?q={searchTerms}");
+    int requestCount = manager.requestCount;
+    scheduler.release(QUrl("http://foobar.baz/"));
+    QTRY_COMPARE(manager.requestCount, requestCount + 1);
+    QCOMPARE(manager.lastRequest.url().host(), QString("moved.baz"));
+    QCOMPARE(scheduler.activeRequests(QUrl("http://foobar.baz/")), 0);
+}
+
 void tst_OpenSearchEngine::searchParameters_data()
 {
     QTest::addColumn<Parameters>("searchParameters");
@@ -630,6 +1017,12 @@ void tst_OpenSearchEngine::searchUrl_data()
     QTest::newRow("parameters") << QString("baz") << QString("http://foobar.baz/?q={searchTerms}")
                     << (Parameters() << Parameter("abc", "{searchTerms}") << Parameter("x", "yz"))
                     << QUrl(QString("http://foobar.baz/?q=baz&abc=baz&x=yz"));
+    QTest::newRow("encodedParameters") << QString("c++") << QString("http://foobar.baz/")
+                    << (Parameters() << Parameter("q", "{searchTerms}") << Parameter("l", "a b&c"))
+                    << QUrl::fromEncoded("http://foobar.baz/?q=c%2B%2B&l=a%20b%26c");
+    QTest::newRow("fragment") << QString("baz") << QString("http://foobar.baz/?q={searchTerms}#results")
+                    << (Parameters() << Parameter("x", "yz"))
+                    << QUrl(QString("http://foobar.baz/?q=baz&x=yz#results"));
 }
 
 // public QUrl searchUrl(QString const &searchTerm) const
@@ -783,6 +1176,10 @@ void tst_OpenSearchEngine::parseTemplate_data()
                     << true;
     QTest::newRow("inputEncoding") << QString("c++") << QString("http://foobar.baz/?q={searchTerms}")
                     << QString("http://foobar.baz/?q=c%2B%2B") << true;
+    QString unicode = QString::fromUtf8("zażółć ~-._ \xf0\x9f\x98\x80") + QChar(0xd800);
+    QTest::newRow("unicode") << unicode << QString("http://foobar.baz/?q={searchTerms}")
+                    << QString("http://foobar.baz/?q=%1").arg(QLatin1String(QUrl::toPercentEncoding(unicode)))
+                    << true;
 }
 
 // protected QString parseTemplate(QString const &searchTerm, QString const &searchTemplate) const
@@ -868,6 +1265,7 @@ void tst_OpenSearchEngine::delegate()
     QCOMPARE(delegate.lastOperation, QNetworkAccessManager::GetOperation);
     QCOMPARE(delegate.lastData, QByteArray());
     QNetworkRequest request(QUrl(engine.call_parseTemplate(QString("baz"), engine.searchUrlTemplate())));
+    engine.requestPolicy(OpenSearchEngine::SearchRequest).apply(&request);
     QCOMPARE(delegate.lastRequest, request);
     QVERIFY(delegate.lastRequest.url().hasQueryItem("q"));
     QCOMPARE(delegate.lastRequest.url().queryItemValue("q"), QString("baz"));
@@ -895,6 +1293,7 @@ void tst_OpenSearchEngine::delegate()
     QCOMPARE(delegate.callsCount, 3);
     QCOMPARE(delegate.lastOperation, QNetworkAccessManager::PostOperation);
     request = QNetworkRequest(QUrl(engine.call_parseTemplate(QString("baz"), engine.searchUrlTemplate())));
+    engine.requestPolicy(OpenSearchEngine::SearchRequest).apply(&request);
     QCOMPARE(delegate.lastRequest, request);
     QVERIFY(delegate.lastRequest.url().hasQueryItem("q"));
     QCOMPARE(delegate.lastRequest.url().queryItemValue("q"), QString("baz"));
@@ -905,6 +1304,129 @@ void tst_OpenSearchEngine::delegate()
     QCOMPARE(query, QStringList() << "a=b" << "b=c");
 }
 
+void tst_OpenSearchEngine::observer()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    OpenSearchSuggestionsCache cache;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+
+    QCOMPARE(engine.observer(), (Observer*)0);
+    Observer observer;
+    engine.setObserver(&observer);
+    QCOMPARE(engine.observer(), &observer);
+
+    QSignalSpy spy(&engine, SIGNAL(suggestions(QStringList const&)));
+
+    engine.requestSuggestions("foo");
+    engine.requestSuggestions("sea");
+    QCOMPARE(observer.statistics.count(), 1);
+    QCOMPARE(observer.statistics.at(0).searchTerm, QString("foo"));
+    QCOMPARE(observer.statistics.at(0).outcome, OpenSearchEngineObserver::Superseded);
+    QCOMPARE(observer.statistics.at(0).bytesReceived, qint64(0));
+    QCOMPARE(observer.statistics.at(0).timeToFirstByte, qint64(-1));
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(observer.statistics.count(), 2);
+    QCOMPARE(observer.engines.at(1), static_cast<OpenSearchEngine*>(&engine));
+
+    OpenSearchEngineObserver::SuggestionsStatistics statistics = observer.statistics.at(1);
+    QCOMPARE(statistics.searchTerm, QString("sea"));
+    QCOMPARE(statistics.outcome, OpenSearchEngineObserver::Finished);
+    QCOMPARE(statistics.bytesReceived, QFile(":/suggestions.txt").size());
+    QCOMPARE(statistics.resultCount, 6);
+    QVERIFY(statistics.expansionTime >= 0);
+    QVERIFY(statistics.timeToFirstByte >= statistics.expansionTime);
+    QVERIFY(statistics.transferTime >= statistics.timeToFirstByte);
+    QVERIFY(statistics.parseTime >= 0);
+
+    engine.setSuggestionsCache(&cache);
+    engine.requestSuggestions("sea");
+    QTRY_COMPARE(spy.count(), 2);
+    engine.requestSuggestions("sea");
+    QCOMPARE(observer.statistics.count(), 4);
+    QCOMPARE(observer.statistics.at(3).outcome, OpenSearchEngineObserver::Cached);
+    QCOMPARE(observer.statistics.at(3).resultCount, 6);
+    QCOMPARE(observer.statistics.at(3).transferTime, qint64(-1));
+
+    engine.setObserver(0);
+    engine.requestSuggestions("sear");
+    QTRY_COMPARE(spy.count(), 4);
+    QCOMPARE(observer.statistics.count(), 4);
+}
+
+void tst_OpenSearchEngine::requestPolicy()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setSearchUrlTemplate("http://foobar.baz/?q={searchTerms}");
+    engine.setSuggestionsUrlTemplate("http://foobar.baz/?q={searchTerms}");
+
+    QCOMPARE(engine.requestPolicy(OpenSearchEngine::SearchRequest).priority(), QNetworkRequest::NormalPriority);
+    QCOMPARE(engine.requestPolicy(OpenSearchEngine::SuggestionsRequest).priority(), QNetworkRequest::HighPriority);
+    QCOMPARE(engine.requestPolicy(OpenSearchEngine::ImageRequest).priority(), QNetworkRequest::LowPriority);
+
+    engine.requestSuggestions("sea");
+    QCOMPARE(manager.lastRequest.priority(), QNetworkRequest::HighPriority);
+    QCOMPARE(manager.lastRequest.attribute(QNetworkRequest::HttpPipeliningAllowedAttribute).toBool(), true);
+    QCOMPARE(manager.lastRequest.rawHeader("Connection"), QByteArray("keep-alive"));
+
+    OpenSearchRequestPolicy policy(QNetworkRequest::LowPriority);
+    policy.setKeepAlive(false);
+    policy.setPipeliningAllowed(false);
+    engine.setRequestPolicy(OpenSearchEngine::SuggestionsRequest, policy);
+    QVERIFY(engine.requestPolicy(OpenSearchEngine::SuggestionsRequest) == policy);
+
+    engine.requestSuggestions("sear");
+    QCOMPARE(manager.lastRequest.priority(), QNetworkRequest::LowPriority);
+    QCOMPARE(manager.lastRequest.attribute(QNetworkRequest::HttpPipeliningAllowedAttribute).toBool(), false);
+    QCOMPARE(manager.lastRequest.rawHeader("Connection"), QByteArray("close"));
+
+    Delegate delegate;
+    engine.setDelegate(&delegate);
+    engine.setRequestPolicy(OpenSearchEngine::SearchRequest, policy);
+    engine.requestSearchResults("baz");
+    QCOMPARE(delegate.lastRequest.priority(), QNetworkRequest::LowPriority);
+    QCOMPARE(delegate.lastRequest.rawHeader("Connection"), QByteArray("close"));
+}
+
+void tst_OpenSearchEngine::prepareForSuggestions()
+{
+    SuggestionsTestNetworkAccessManager manager;
+    SubOpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+
+    // Nothing to prepare for.
+    engine.prepareForSuggestions();
+    QTest::qWait(100);
+    QCOMPARE(manager.requestCount, 0);
+
+    engine.setSuggestionsUrlTemplate("http://localhost:8080/suggest?q={searchTerms}");
+    engine.prepareForSuggestions();
+    engine.prepareForSuggestions();
+    QTRY_COMPARE(manager.requestCount, 1);
+    QCOMPARE(manager.lastOperation, QNetworkAccessManager::HeadOperation);
+    QCOMPARE(manager.lastRequest.url(), QUrl("http://localhost:8080/suggest"));
+    QCOMPARE(manager.lastRequest.priority(), QNetworkRequest::HighPriority);
+    QCOMPARE(manager.lastRequest.rawHeader("Connection"), QByteArray("keep-alive"));
+
+    engine.setSuggestionsWarmInterval(-1);
+    QCOMPARE(engine.suggestionsWarmInterval(), 0);
+    engine.setSuggestionsWarmInterval(100);
+    QCOMPARE(engine.property("suggestionsWarmInterval").toInt(), 100);
+
+    QTest::qWait(200);
+    engine.prepareForSuggestions();
+    QTRY_COMPARE(manager.requestCount, 2);
+    QTRY_COMPARE(manager.requestCount, 3);
+    QCOMPARE(manager.lastOperation, QNetworkAccessManager::HeadOperation);
+
+    engine.finishSuggestions();
+    QTest::qWait(300);
+    QCOMPARE(manager.requestCount, 3);
+}
+
 QTEST_MAIN(tst_OpenSearchEngine)
 #include "tst_opensearchengine.moc"
-
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include "opensearchengine.h"
+#include "opensearchenginemanager.h"
+#include "opensearchsuggestionsindex.h"
+
+#include <qnetworkaccessmanager.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+
+class tst_OpenSearchEngineManager : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void addEngine();
+    void networkAccessManager();
+    void requestSuggestions();
+    void deadline();
+    void failedEngine();
+    void suggestionsIndex();
+    void removeEngine();
+};
+
+class DelayedTestNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    DelayedTestNetworkReply(const QNetworkRequest &request, const QByteArray &data, int delay, QObject *parent = 0)
+        : QNetworkReply(parent)
+        , data(data)
+        , position(0)
+    {
+        setOperation(QNetworkAccessManager::GetOperation);
+        setRequest(request);
+        setUrl(request.url());
+        setOpenMode(QIODevice::ReadOnly);
+        setError(QNetworkReply::NoError, tr("No Error"));
+
+        QTimer::singleShot(delay, this, SLOT(sendData()));
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return data.size() - position + QNetworkReply::bytesAvailable();
+    }
+
+    qint64 readData(char *buffer, qint64 maxSize)
+    {
+        qint64 size = qMin(maxSize, qint64(data.size() - position));
+        memcpy(buffer, data.constData() + position, size);
+        position += size;
+        return size;
+    }
+
+    void abort()
+    {
+    }
+
+private slots:
+    void sendData()
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+
+        emit metaDataChanged();
+        emit readyRead();
+        emit finished();
+    }
+
+private:
+    QByteArray data;
+    qint64 position;
+};
+
+class DelayedTestNetworkAccessManager : public QNetworkAccessManager
+{
+public:
+    DelayedTestNetworkAccessManager(QObject *parent = 0)
+        : QNetworkAccessManager(parent)
+        , requestCount(0)
+    {
+    }
+
+    int requestCount;
+
+protected:
+    QNetworkReply *createRequest(QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice * = 0)
+    {
+        ++requestCount;
+
+        QString host = request.url().host();
+        int delay = request.url().path() == QLatin1String("/slow") ? 2000 : 10;
+
+        QByteArray data;
+        if (host == QLatin1String("a.test"))
+            data = "[\"foo\",[\"foo\",\"foo bar\"]]";
+        else if (host == QLatin1String("b.test"))
+            data = "[\"foo\",[\"Foo Bar\",\"foo baz\"]]";
+        else if (host == QLatin1String("broken.test"))
+            data = "[\"foo\",[\"foo broken\"";
+        else
+            data = "[\"foo\",[\"foo slow\"]]";
+
+        return new DelayedTestNetworkReply(request, data, delay, 0);
+    }
+};
+
+static OpenSearchEngine *createEngine(const QString &suggestionsUrlTemplate, QObject *parent)
+{
+    OpenSearchEngine *engine = new OpenSearchEngine(parent);
+    engine->setName(suggestionsUrlTemplate);
+    engine->setSearchUrlTemplate(QLatin1String("http://foobar.baz/?q={searchTerms}"));
+    engine->setSuggestionsUrlTemplate(suggestionsUrlTemplate);
+    return engine;
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchEngineManager::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchEngineManager::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchEngineManager::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchEngineManager::cleanup()
+{
+}
+
+void tst_OpenSearchEngineManager::addEngine()
+{
+    OpenSearchEngineManager manager;
+    QVERIFY(manager.engines().isEmpty());
+    QVERIFY(manager.networkAccessManager());
+
+    OpenSearchEngine *engine1 = createEngine("http://a.test/?q={searchTerms}", this);
+    OpenSearchEngine *engine2 = createEngine("http://b.test/?q={searchTerms}", this);
+    manager.addEngine(engine1);
+    manager.addEngine(engine2);
+    manager.addEngine(engine1);
+    manager.addEngine(0);
+
+    QCOMPARE(manager.engines(), QList<OpenSearchEngine*>() << engine1 << engine2);
+    QCOMPARE(engine1->networkAccessManager(), manager.networkAccessManager());
+    QCOMPARE(engine2->networkAccessManager(), manager.networkAccessManager());
+
+    delete engine1;
+    QCOMPARE(manager.engines(), QList<OpenSearchEngine*>() << engine2);
+    delete engine2;
+    QVERIFY(manager.engines().isEmpty());
+}
+
+void tst_OpenSearchEngineManager::networkAccessManager()
+{
+    OpenSearchEngineManager manager;
+    OpenSearchEngine *engine = createEngine("http://a.test/?q={searchTerms}", &manager);
+    manager.addEngine(engine);
+
+    DelayedTestNetworkAccessManager networkAccessManager;
+    manager.setNetworkAccessManager(&networkAccessManager);
+    QCOMPARE(manager.networkAccessManager(), static_cast<QNetworkAccessManager*>(&networkAccessManager));
+    QCOMPARE(engine->networkAccessManager(), static_cast<QNetworkAccessManager*>(&networkAccessManager));
+}
+
+void tst_OpenSearchEngineManager::requestSuggestions()
+{
+    DelayedTestNetworkAccessManager networkAccessManager;
+    OpenSearchEngineManager manager;
+    manager.setNetworkAccessManager(&networkAccessManager);
+
+    OpenSearchEngine *noSuggestions = createEngine(QString(), &manager);
+    manager.addEngine(createEngine("http://a.test/?q={searchTerms}", &manager));
+    manager.addEngine(noSuggestions);
+    manager.addEngine(createEngine("http://b.test/?q={searchTerms}", &manager));
+
+    QSignalSpy spy(&manager, SIGNAL(suggestions(QString,QStringList)));
+
+    manager.requestSuggestions(QString());
+    QVERIFY(!manager.isRequestPending());
+
+    manager.requestSuggestions("foo");
+    QVERIFY(manager.isRequestPending());
+    QCOMPARE(networkAccessManager.requestCount, 2);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(!manager.isRequestPending());
+    QCOMPARE(spy.at(0).at(0).toString(), QString("foo"));
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList() << "foo" << "foo bar" << "foo baz");
+
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 1);
+}
+
+void tst_OpenSearchEngineManager::deadline()
+{
+    DelayedTestNetworkAccessManager networkAccessManager;
+    OpenSearchEngineManager manager;
+    manager.setNetworkAccessManager(&networkAccessManager);
+    QCOMPARE(manager.deadline(), 1000);
+    manager.setDeadline(200);
+    QCOMPARE(manager.deadline(), 200);
+
+    manager.addEngine(createEngine("http://slow.test/slow?q={searchTerms}", &manager));
+    manager.addEngine(createEngine("http://a.test/?q={searchTerms}", &manager));
+
+    QSignalSpy spy(&manager, SIGNAL(suggestions(QString,QStringList)));
+
+    QTime time;
+    time.start();
+    manager.requestSuggestions("foo");
+
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(time.elapsed() < 1000);
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList() << "foo" << "foo bar");
+}
+
+void tst_OpenSearchEngineManager::failedEngine()
+{
+    DelayedTestNetworkAccessManager networkAccessManager;
+    OpenSearchEngineManager manager;
+    manager.setNetworkAccessManager(&networkAccessManager);
+    manager.setDeadline(0);
+
+    manager.addEngine(createEngine("http://broken.test/?q={searchTerms}", &manager));
+    manager.addEngine(createEngine("http://a.test/?q={searchTerms}", &manager));
+
+    QSignalSpy spy(&manager, SIGNAL(suggestions(QString,QStringList)));
+    manager.requestSuggestions("foo");
+    QCOMPARE(networkAccessManager.requestCount, 2);
+
+    // An engine whose reply cannot be parsed is not waited for.
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(!manager.isRequestPending());
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList() << "foo" << "foo bar");
+}
+
+void tst_OpenSearchEngineManager::suggestionsIndex()
+{
+    DelayedTestNetworkAccessManager networkAccessManager;
+    OpenSearchEngineManager manager;
+    manager.setNetworkAccessManager(&networkAccessManager);
+    manager.setDeadline(0);
+
+    OpenSearchSuggestionsIndex index;
+    index.insert("foo indexed", 1);
+
+    OpenSearchEngine *engine = createEngine("http://slow.test/slow?q={searchTerms}", &manager);
+    engine->setSuggestionsIndex(&index);
+    manager.addEngine(engine);
+
+    QSignalSpy engineSpy(engine, SIGNAL(suggestions(QString,QStringList)));
+    QSignalSpy spy(&manager, SIGNAL(suggestions(QString,QStringList)));
+    manager.requestSuggestions("foo");
+
+    // The answer of the index does not end the request.
+    QTRY_COMPARE(engineSpy.count(), 1);
+    QCOMPARE(engineSpy.at(0).at(1).toStringList(), QStringList() << "foo indexed");
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 0);
+    QVERIFY(manager.isRequestPending());
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList() << "foo slow" << "foo indexed");
+}
+
+void tst_OpenSearchEngineManager::removeEngine()
+{
+    DelayedTestNetworkAccessManager networkAccessManager;
+    OpenSearchEngineManager manager;
+    manager.setNetworkAccessManager(&networkAccessManager);
+    manager.setDeadline(0);
+
+    OpenSearchEngine *slow = createEngine("http://slow.test/slow?q={searchTerms}", &manager);
+    manager.addEngine(createEngine("http://a.test/?q={searchTerms}", &manager));
+    manager.addEngine(slow);
+
+    QSignalSpy spy(&manager, SIGNAL(suggestions(QString,QStringList)));
+    manager.requestSuggestions("foo");
+
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 0);
+
+    // The suggestions are emitted as soon as nothing is waited for anymore.
+    manager.removeEngine(slow);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).toStringList(), QStringList() << "foo" << "foo bar");
+    QCOMPARE(manager.engines().count(), 1);
+}
+
+QTEST_MAIN(tst_OpenSearchEngineManager)
+
+#include "tst_opensearchenginemanager.moc"
@@ -0,0 +1,435 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include "opensearchengine.h"
+#include "opensearchimagecache.h"
+
+#include <qbuffer.h>
+#include <qdir.h>
+#include <qnetworkaccessmanager.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+
+class tst_OpenSearchImageCache : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void load();
+    void failure();
+    void managerDestroyed();
+    void persistence();
+    void revalidation();
+    void sharedBetweenEngines();
+    void decodeImage_data();
+    void decodeImage();
+    void maximumImageSize();
+    void engineWithoutCache();
+
+private:
+    QString cacheDirectory() const;
+};
+
+class ImageTestNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    ImageTestNetworkReply(const QNetworkRequest &request, const QByteArray &data, int status, QObject *parent = 0)
+        : QNetworkReply(parent)
+        , data(data)
+        , position(0)
+        , status(status)
+    {
+        setOperation(QNetworkAccessManager::GetOperation);
+        setRequest(request);
+        setUrl(request.url());
+        setOpenMode(QIODevice::ReadOnly);
+        setError(QNetworkReply::NoError, tr("No Error"));
+
+        QTimer::singleShot(20, this, SLOT(sendImage()));
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return data.size() - position + QNetworkReply::bytesAvailable();
+    }
+
+    qint64 readData(char *buffer, qint64 maxSize)
+    {
+        qint64 size = qMin(maxSize, qint64(data.size() - position));
+        memcpy(buffer, data.constData() + position, size);
+        position += size;
+        return size;
+    }
+
+    void abort()
+    {
+    }
+
+private slots:
+    void sendImage()
+    {
+        setRawHeader("ETag", "\"foo\"");
+        setRawHeader("Last-Modified", "Mon, 12 Oct 2009 12:00:00 GMT");
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, status);
+
+        emit metaDataChanged();
+        emit readyRead();
+        emit finished();
+    }
+
+private:
+    QByteArray data;
+    qint64 position;
+    int status;
+};
+
+class ImageTestNetworkAccessManager : public QNetworkAccessManager
+{
+public:
+    ImageTestNetworkAccessManager(QObject *parent = 0)
+        : QNetworkAccessManager(parent)
+        , requestCount(0)
+    {
+        QImage image(2, 2, QImage::Format_ARGB32);
+        image.fill(0xff00ff00);
+
+        QBuffer buffer(&imageData);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+    }
+
+    QByteArray imageData;
+    QNetworkRequest lastRequest;
+    int requestCount;
+
+protected:
+    QNetworkReply *createRequest(QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice * = 0)
+    {
+        lastRequest = request;
+        ++requestCount;
+
+        // Like the replies of QNetworkAccessManager, they are deleted along with it.
+        if (request.url().path() == QLatin1String("/broken.png"))
+            return new ImageTestNetworkReply(request, QByteArray("foo"), 200, this);
+
+        if (request.rawHeader("If-None-Match") == "\"foo\"")
+            return new ImageTestNetworkReply(request, QByteArray(), 304, this);
+
+        return new ImageTestNetworkReply(request, imageData, 200, this);
+    }
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchImageCache::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchImageCache::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchImageCache::init()
+{
+    QDir directory(cacheDirectory());
+    foreach (const QString &fileName, directory.entryList(QDir::Files))
+        directory.remove(fileName);
+}
+
+// This will be called after every test function.
+void tst_OpenSearchImageCache::cleanup()
+{
+    init();
+    QDir().rmdir(cacheDirectory());
+}
+
+QString tst_OpenSearchImageCache::cacheDirectory() const
+{
+    return QDir::tempPath() + QLatin1String("/tst_opensearchimagecache");
+}
+
+void tst_OpenSearchImageCache::load()
+{
+    ImageTestNetworkAccessManager manager;
+    OpenSearchImageCache cache;
+    QSignalSpy spy(&cache, SIGNAL(imageLoaded(QString)));
+
+    QString url = QLatin1String("http://foobar.baz/favicon.png");
+    QVERIFY(cache.image(url).isNull());
+
+    cache.load(url, &manager);
+    cache.load(url, &manager);
+    QVERIFY(cache.isLoading(url));
+    QCOMPARE(manager.requestCount, 1);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), url);
+    QVERIFY(!cache.isLoading(url));
+    QCOMPARE(cache.image(url).size(), QSize(2, 2));
+
+    // Fresh images are not requested again.
+    cache.load(url, &manager);
+    QCOMPARE(manager.requestCount, 1);
+}
+
+void tst_OpenSearchImageCache::failure()
+{
+    ImageTestNetworkAccessManager manager;
+    OpenSearchImageCache cache;
+
+    QString url = QLatin1String("http://foobar.baz/broken.png");
+    cache.load(url, &manager);
+    QTRY_VERIFY(!cache.isLoading(url));
+
+    QVERIFY(cache.hasFailed(url));
+    QVERIFY(cache.image(url).isNull());
+
+    cache.load(url, &manager);
+    QCOMPARE(manager.requestCount, 1);
+
+    cache.setFailureTimeToLive(0);
+    cache.load(url, &manager);
+    QCOMPARE(manager.requestCount, 2);
+}
+
+void tst_OpenSearchImageCache::managerDestroyed()
+{
+    OpenSearchImageCache cache;
+    QSignalSpy spy(&cache, SIGNAL(imageLoaded(QString)));
+
+    QString url = QLatin1String("http://foobar.baz/favicon.png");
+    ImageTestNetworkAccessManager *manager = new ImageTestNetworkAccessManager;
+    cache.load(url, manager);
+    QVERIFY(cache.isLoading(url));
+
+    // The pending reply goes away with the manager.
+    delete manager;
+    QVERIFY(!cache.isLoading(url));
+    QVERIFY(!cache.hasFailed(url));
+
+    ImageTestNetworkAccessManager other;
+    cache.load(url, &other);
+    QCOMPARE(other.requestCount, 1);
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(cache.image(url).size(), QSize(2, 2));
+}
+
+void tst_OpenSearchImageCache::persistence()
+{
+    ImageTestNetworkAccessManager manager;
+    QString url = QLatin1String("http://foobar.baz/favicon.png");
+
+    {
+        OpenSearchImageCache cache;
+        cache.setCacheDirectory(cacheDirectory());
+        QCOMPARE(cache.cacheDirectory(), cacheDirectory());
+
+        cache.load(url, &manager);
+        QTRY_VERIFY(!cache.image(url).isNull());
+    }
+
+    OpenSearchImageCache cache;
+    cache.setCacheDirectory(cacheDirectory());
+    QCOMPARE(cache.image(url).size(), QSize(2, 2));
+
+    cache.load(url, &manager);
+    QCOMPARE(manager.requestCount, 1);
+}
+
+void tst_OpenSearchImageCache::revalidation()
+{
+    ImageTestNetworkAccessManager manager;
+    OpenSearchImageCache cache;
+    QSignalSpy spy(&cache, SIGNAL(imageLoaded(QString)));
+
+    QString url = QLatin1String("http://foobar.baz/favicon.png");
+    cache.load(url, &manager);
+    QTRY_COMPARE(spy.count(), 1);
+
+    cache.setRevalidationInterval(0);
+    QCOMPARE(cache.revalidationInterval(), 0);
+    cache.load(url, &manager);
+    QCOMPARE(manager.requestCount, 2);
+    QCOMPARE(manager.lastRequest.rawHeader("If-None-Match"), QByteArray("\"foo\""));
+    QCOMPARE(manager.lastRequest.rawHeader("If-Modified-Since"), QByteArray("Mon, 12 Oct 2009 12:00:00 GMT"));
+
+    // Not modified, the cached image is kept.
+    QTRY_VERIFY(!cache.isLoading(url));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(cache.image(url).size(), QSize(2, 2));
+}
+
+void tst_OpenSearchImageCache::sharedBetweenEngines()
+{
+    ImageTestNetworkAccessManager manager;
+    OpenSearchImageCache cache;
+
+    OpenSearchEngine engine1;
+    engine1.setNetworkAccessManager(&manager);
+    engine1.setImageUrl("http://foobar.baz/favicon.png");
+    QCOMPARE(engine1.imageCache(), OpenSearchImageCache::instance());
+    engine1.setImageCache(&cache);
+    QCOMPARE(engine1.imageCache(), &cache);
+
+    OpenSearchEngine engine2;
+    engine2.setNetworkAccessManager(&manager);
+    engine2.setImageUrl("http://foobar.baz/favicon.png");
+    engine2.setImageCache(&cache);
+
+    // Connections made by others to the engine are left alone.
+    QVERIFY(QObject::connect(&cache, SIGNAL(imageLoaded(QString)), &engine1, SLOT(finishSuggestions())));
+
+    QSignalSpy spy1(&engine1, SIGNAL(imageChanged()));
+    QSignalSpy spy2(&engine2, SIGNAL(imageChanged()));
+
+    QVERIFY(engine1.image().isNull());
+    QVERIFY(engine2.image().isNull());
+    QCOMPARE(manager.requestCount, 1);
+
+    QTRY_COMPARE(spy1.count(), 1);
+    QTRY_COMPARE(spy2.count(), 1);
+    QVERIFY(!engine1.image().isNull());
+    QVERIFY(!engine2.image().isNull());
+
+    OpenSearchEngine engine3;
+    engine3.setNetworkAccessManager(&manager);
+    engine3.setImageUrl("http://foobar.baz/favicon.png");
+    engine3.setImageCache(&cache);
+    QVERIFY(!engine3.image().isNull());
+    QCOMPARE(manager.requestCount, 1);
+
+    engine1.setImageCache(0);
+    QVERIFY(QObject::disconnect(&cache, SIGNAL(imageLoaded(QString)), &engine1, SLOT(finishSuggestions())));
+}
+
+void tst_OpenSearchImageCache::decodeImage_data()
+{
+    QTest::addColumn<QSize>("imageSize");
+    QTest::addColumn<QSize>("maximumSize");
+    QTest::addColumn<QSize>("decodedSize");
+
+    QTest::newRow("unlimited") << QSize(64, 32) << QSize() << QSize(64, 32);
+    QTest::newRow("smaller") << QSize(8, 8) << QSize(16, 16) << QSize(8, 8);
+    QTest::newRow("larger") << QSize(64, 32) << QSize(16, 16) << QSize(16, 8);
+    QTest::newRow("tall") << QSize(32, 64) << QSize(16, 16) << QSize(8, 16);
+}
+
+void tst_OpenSearchImageCache::decodeImage()
+{
+    QFETCH(QSize, imageSize);
+    QFETCH(QSize, maximumSize);
+    QFETCH(QSize, decodedSize);
+
+    QImage image(imageSize, QImage::Format_ARGB32);
+    image.fill(0xff00ff00);
+
+    foreach (const QByteArray &format, QList<QByteArray>() << "PNG" << "BMP") {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, format.constData());
+
+        QCOMPARE(OpenSearchImageCache::decodeImage(data, maximumSize).size(), decodedSize);
+    }
+
+    QVERIFY(OpenSearchImageCache::decodeImage(QByteArray("foo"), maximumSize).isNull());
+}
+
+void tst_OpenSearchImageCache::maximumImageSize()
+{
+    ImageTestNetworkAccessManager manager;
+    OpenSearchImageCache cache;
+    QCOMPARE(cache.maximumImageSize(), QSize());
+    cache.setMaximumImageSize(QSize(1, 1));
+    QCOMPARE(cache.maximumImageSize(), QSize(1, 1));
+
+    QSignalSpy spy(&cache, SIGNAL(imageLoaded(QString)));
+    QString url = QLatin1String("http://foobar.baz/favicon.png");
+    cache.load(url, &manager);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(cache.image(url).size(), QSize(1, 1));
+}
+
+void tst_OpenSearchImageCache::engineWithoutCache()
+{
+    ImageTestNetworkAccessManager manager;
+
+    OpenSearchEngine engine;
+    engine.setNetworkAccessManager(&manager);
+    engine.setImageCache(0);
+    engine.setImageUrl("http://foobar.baz/favicon.png");
+    QCOMPARE(engine.maximumImageSize(), QSize());
+    engine.setMaximumImageSize(QSize(1, 1));
+    QCOMPARE(engine.property("maximumImageSize").toSize(), QSize(1, 1));
+
+    QSignalSpy spy(&engine, SIGNAL(imageChanged()));
+    QVERIFY(engine.image().isNull());
+    QCOMPARE(manager.requestCount, 1);
+
+    // The image is decoded in another thread, the signal comes from the engine's one.
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(engine.image().size(), QSize(1, 1));
+
+    // A decoded image does not replace one that has been set in the meantime.
+    OpenSearchEngine other;
+    other.setNetworkAccessManager(&manager);
+    other.setImageCache(0);
+    other.setImageUrl("http://foobar.baz/favicon.png");
+    QSignalSpy otherSpy(&other, SIGNAL(imageChanged()));
+    QVERIFY(other.image().isNull());
+
+    QImage image(4, 4, QImage::Format_ARGB32);
+    image.fill(0);
+    other.setImage(image);
+    QCOMPARE(otherSpy.count(), 1);
+
+    QTest::qWait(100);
+    QCOMPARE(otherSpy.count(), 1);
+    QCOMPARE(other.image().size(), QSize(4, 4));
+
+    // Data URLs are decoded right away, but scaled the same way.
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QImage(4, 2, QImage::Format_ARGB32).save(&buffer, "PNG");
+
+    OpenSearchEngine dataEngine;
+    dataEngine.setMaximumImageSize(QSize(2, 2));
+    dataEngine.setImageUrl(QString("data:image/png;base64,").append(data.toBase64()));
+    QCOMPARE(dataEngine.image().size(), QSize(2, 1));
+}
+
+QTEST_MAIN(tst_OpenSearchImageCache)
+
+#include "tst_opensearchimagecache.moc"
@@ -38,6 +38,10 @@ public slots:
 private slots:
     void read_data();
     void read();
+    void readNextDescription();
+    void readNextDescriptionChunks_data();
+    void readNextDescriptionChunks();
+    void additionalUrls();
 };
 
 // This will be called before the first test function is executed.
@@ -120,6 +124,12 @@ void tst_OpenSearchReader::read_data()
     QTest::newRow("testfile8") << QString(":/testfile8.xml") << true << QString("Web Search") << QString("Use Example.com to search the Web.")
             << QString("http://example.com/") << QString() << QString() << Parameters() << Parameters() << QString("get")
             << QString("get") << (QStringList() << "example" << "web");
+
+    QTest::newRow("testfile9") << QString(":/testfile9.xml") << true << QString("Nested") << QString("Skips nested and foreign elements")
+            << QString("http://example.com/search") << QString() << QString()
+            << (Parameters() << Parameter(QString("q"), QString("{searchTerms}"))
+                                               << Parameter(QString("b"), QString("foo")))
+            << Parameters() << QString("get") << QString("get") << QStringList();
 }
 
 void tst_OpenSearchReader::read()
@@ -157,6 +167,126 @@ void tst_OpenSearchReader::read()
     delete engine;
 }
 
+void tst_OpenSearchReader::readNextDescription()
+{
+    QFile file(":/bundle.xml");
+    OpenSearchReader reader;
+    reader.setDevice(&file);
+
+    QStringList names;
+    OpenSearchDescription description;
+    while (reader.readNextDescription(&description)) {
+        QVERIFY(description.isValid());
+        names.append(description.name());
+    }
+
+    QVERIFY(!reader.hasError());
+    QCOMPARE(names, QStringList() << "Wikipedia (en)" << "GitHub" << "Web Search");
+    QCOMPARE(description.name(), QString("Web Search"));
+    QCOMPARE(description.tags(), QStringList() << "example" << "web");
+    QVERIFY(!reader.readNextDescription(&description));
+
+    // Descriptions read before the feed is cut are still returned.
+    file.close();
+    file.open(QIODevice::ReadOnly);
+    QByteArray data = file.readAll();
+    OpenSearchReader truncated;
+    truncated.addData(data.left(data.indexOf("<ShortName>Web Search")));
+
+    names.clear();
+    while (truncated.readNextDescription(&description))
+        names.append(description.name());
+
+    QCOMPARE(names, QStringList() << "Wikipedia (en)" << "GitHub");
+    QCOMPARE(truncated.error(), QXmlStreamReader::PrematureEndOfDocumentError);
+}
+
+void tst_OpenSearchReader::readNextDescriptionChunks_data()
+{
+    QTest::addColumn<int>("chunkSize");
+    QTest::newRow("1") << 1;
+    QTest::newRow("7") << 7;
+    QTest::newRow("100") << 100;
+}
+
+void tst_OpenSearchReader::readNextDescriptionChunks()
+{
+    QFETCH(int, chunkSize);
+
+    QFile file(":/bundle.xml");
+    OpenSearchReader reader;
+    reader.setDevice(&file);
+
+    QList<OpenSearchDescription> expected;
+    OpenSearchDescription description;
+    while (reader.readNextDescription(&description))
+        expected.append(description);
+    QCOMPARE(expected.count(), 3);
+
+    file.close();
+    file.open(QIODevice::ReadOnly);
+    QByteArray data = file.readAll();
+
+    // The data is split inside the descriptions, in their elements and their text.
+    QList<OpenSearchDescription> descriptions;
+    OpenSearchReader chunked;
+    for (int i = 0; i < data.size(); i += chunkSize) {
+        chunked.addData(data.mid(i, chunkSize));
+        while (chunked.readNextDescription(&description))
+            descriptions.append(description);
+        QVERIFY(!chunked.hasError() || chunked.error() == QXmlStreamReader::PrematureEndOfDocumentError);
+    }
+
+    QCOMPARE(descriptions.count(), expected.count());
+    for (int i = 0; i < expected.count(); ++i) {
+        QCOMPARE(descriptions.at(i).name(), expected.at(i).name());
+        QCOMPARE(descriptions.at(i).tags(), expected.at(i).tags());
+        QCOMPARE(descriptions.at(i).searchMethod(), expected.at(i).searchMethod());
+        QVERIFY(descriptions.at(i) == expected.at(i));
+    }
+
+    // A single split in the middle of the text of an element.
+    int middle = data.indexOf("<ShortName>Web Search") + 15;
+    OpenSearchReader split;
+    split.addData(data.left(middle));
+
+    QStringList names;
+    while (split.readNextDescription(&description))
+        names.append(description.name());
+    QCOMPARE(names, QStringList() << "Wikipedia (en)" << "GitHub");
+    QCOMPARE(split.error(), QXmlStreamReader::PrematureEndOfDocumentError);
+
+    split.addData(data.mid(middle));
+    QVERIFY(split.readNextDescription(&description));
+    QCOMPARE(description.name(), QString("Web Search"));
+    QCOMPARE(description.tags(), QStringList() << "example" << "web");
+    // Without a device, the reader cannot tell whether more data follows the feed.
+    QVERIFY(!split.readNextDescription(&description));
+    QVERIFY(!split.hasError() || split.error() == QXmlStreamReader::PrematureEndOfDocumentError);
+}
+
+void tst_OpenSearchReader::additionalUrls()
+{
+    QFile file(":/testfile1.xml");
+    OpenSearchReader reader;
+    OpenSearchDescription description;
+    QVERIFY(reader.read(&file, &description));
+
+    // Only the first text/html URL is the search one, no URL is lost though.
+    OpenSearchDescription::Urls urls = description.additionalUrls();
+    QCOMPARE(urls.count(), 2);
+    QCOMPARE(urls.at(0).type, QString("application/rss+xml"));
+    QCOMPARE(urls.at(0).rel, QString("results"));
+    QCOMPARE(urls.at(0).urlTemplate, QString("http://en.wikipedia.org/rss"));
+    QCOMPARE(urls.at(1).type, QString());
+    QCOMPARE(urls.at(1).urlTemplate, QString("http://en.wikipedia.org/baz"));
+    QCOMPARE(urls.at(1).method, QString("get"));
+
+    QCOMPARE(description.resultTypes(), QStringList() << "text/html" << "application/rss+xml");
+    QCOMPARE(description.resultsUrl("foo", "application/rss+xml"), QUrl("http://en.wikipedia.org/rss"));
+    QCOMPARE(description.url("text/html").urlTemplate, QString("http://en.wikipedia.org/bar"));
+}
+
 QTEST_MAIN(tst_OpenSearchReader)
 
 #include "tst_opensearchreader.moc"
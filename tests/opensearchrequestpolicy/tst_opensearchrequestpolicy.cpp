@@ -0,0 +1,176 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include "opensearchrequestpolicy.h"
+
+#include <qnetworkaccessmanager.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+
+class tst_OpenSearchRequestPolicy : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void defaults();
+    void apply_data();
+    void apply();
+    void watch();
+};
+
+// A reply that only finishes when it is aborted.
+class HangingTestNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    HangingTestNetworkReply(QObject *parent = 0)
+        : QNetworkReply(parent)
+        , aborted(false)
+    {
+        setOpenMode(QIODevice::ReadOnly);
+    }
+
+    qint64 readData(char *, qint64)
+    {
+        return -1;
+    }
+
+    void abort()
+    {
+        aborted = true;
+        setError(QNetworkReply::OperationCanceledError, tr("Operation canceled"));
+        setFinished(true);
+        emit finished();
+    }
+
+    void finish()
+    {
+        setFinished(true);
+        emit finished();
+    }
+
+    bool aborted;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchRequestPolicy::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchRequestPolicy::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchRequestPolicy::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchRequestPolicy::cleanup()
+{
+}
+
+void tst_OpenSearchRequestPolicy::defaults()
+{
+    OpenSearchRequestPolicy policy;
+    QCOMPARE(policy.priority(), QNetworkRequest::NormalPriority);
+    QCOMPARE(policy.timeout(), 0);
+    QVERIFY(policy.isPipeliningAllowed());
+    QVERIFY(policy.keepAlive());
+
+    OpenSearchRequestPolicy other(QNetworkRequest::HighPriority, 100);
+    QCOMPARE(other.priority(), QNetworkRequest::HighPriority);
+    QCOMPARE(other.timeout(), 100);
+    QVERIFY(other != policy);
+
+    other.setPriority(QNetworkRequest::NormalPriority);
+    other.setTimeout(-1);
+    QCOMPARE(other.timeout(), 0);
+    QVERIFY(other == policy);
+}
+
+void tst_OpenSearchRequestPolicy::apply_data()
+{
+    QTest::addColumn<bool>("pipeliningAllowed");
+    QTest::addColumn<bool>("keepAlive");
+    QTest::addColumn<QByteArray>("connection");
+    QTest::newRow("default") << true << true << QByteArray("keep-alive");
+    QTest::newRow("close") << true << false << QByteArray("close");
+    QTest::newRow("no pipelining") << false << true << QByteArray("keep-alive");
+}
+
+void tst_OpenSearchRequestPolicy::apply()
+{
+    QFETCH(bool, pipeliningAllowed);
+    QFETCH(bool, keepAlive);
+    QFETCH(QByteArray, connection);
+
+    OpenSearchRequestPolicy policy(QNetworkRequest::LowPriority);
+    policy.setPipeliningAllowed(pipeliningAllowed);
+    policy.setKeepAlive(keepAlive);
+    QCOMPARE(policy.isPipeliningAllowed(), pipeliningAllowed);
+    QCOMPARE(policy.keepAlive(), keepAlive);
+
+    QNetworkRequest request(QUrl("http://foobar.baz/"));
+    policy.apply(&request);
+    QCOMPARE(request.priority(), QNetworkRequest::LowPriority);
+    QCOMPARE(request.attribute(QNetworkRequest::HttpPipeliningAllowedAttribute).toBool(), pipeliningAllowed);
+    QCOMPARE(request.rawHeader("Connection"), connection);
+}
+
+void tst_OpenSearchRequestPolicy::watch()
+{
+    OpenSearchRequestPolicy policy(QNetworkRequest::NormalPriority, 50);
+
+    HangingTestNetworkReply reply1;
+    policy.watch(&reply1);
+    QTRY_VERIFY(reply1.aborted);
+    QCOMPARE(reply1.error(), QNetworkReply::OperationCanceledError);
+
+    HangingTestNetworkReply reply2;
+    policy.watch(&reply2);
+    reply2.finish();
+    QTest::qWait(100);
+    QVERIFY(!reply2.aborted);
+
+    HangingTestNetworkReply reply3;
+    policy.setTimeout(0);
+    policy.watch(&reply3);
+    QTest::qWait(100);
+    QVERIFY(!reply3.aborted);
+}
+
+QTEST_MAIN(tst_OpenSearchRequestPolicy)
+
+#include "tst_opensearchrequestpolicy.moc"
@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = tst_opensearchrequestscheduler
+
+QT += network
+
+include(../tests.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_opensearchrequestscheduler.cpp
@@ -0,0 +1,477 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include "opensearchrequestscheduler.h"
+
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+
+class tst_OpenSearchRequestScheduler : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void defaults();
+    void hostKey_data();
+    void hostKey();
+    void connectionLimit();
+    void requestRate();
+    void enqueue();
+    void cancel();
+    void dropped();
+    void destroyedReceiver();
+    void releaseTicket();
+    void watch();
+    void backoff_data();
+    void backoff();
+    void parseRetryAfter_data();
+    void parseRetryAfter();
+};
+
+// A reply finishing with a given status code.
+class TestNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    TestNetworkReply(const QUrl &url, QObject *parent = 0)
+        : QNetworkReply(parent)
+    {
+        setUrl(url);
+        setOpenMode(QIODevice::ReadOnly);
+    }
+
+    qint64 readData(char *, qint64)
+    {
+        return -1;
+    }
+
+    void abort()
+    {
+    }
+
+    void finish(int statusCode, const QByteArray &retryAfter = QByteArray())
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, statusCode);
+        if (!retryAfter.isEmpty())
+            setRawHeader("Retry-After", retryAfter);
+        setFinished(true);
+        emit finished();
+    }
+};
+
+// Records the tickets of the granted requests.
+class TestReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    QList<int> tickets;
+
+public slots:
+    void grant(int ticket)
+    {
+        tickets.append(ticket);
+    }
+};
+
+// Gives up on the granted requests.
+class ReleasingReceiver : public TestReceiver
+{
+    Q_OBJECT
+
+public:
+    ReleasingReceiver(OpenSearchRequestScheduler *releasingScheduler)
+        : scheduler(releasingScheduler)
+    {
+    }
+
+    OpenSearchRequestScheduler *scheduler;
+
+public slots:
+    void grant(int ticket)
+    {
+        TestReceiver::grant(ticket);
+        scheduler->release(ticket);
+    }
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchRequestScheduler::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchRequestScheduler::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchRequestScheduler::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchRequestScheduler::cleanup()
+{
+}
+
+void tst_OpenSearchRequestScheduler::defaults()
+{
+    OpenSearchRequestScheduler scheduler;
+    QCOMPARE(scheduler.maximumConnectionsPerHost(), 6);
+    QCOMPARE(scheduler.requestRate(), qreal(0));
+    QCOMPARE(scheduler.burstSize(), 4);
+    QCOMPARE(scheduler.maximumQueueLength(), 8);
+    QCOMPARE(scheduler.backoff(), 1000);
+    QCOMPARE(scheduler.maximumBackoff(), 60000);
+    QCOMPARE(scheduler.queueLength(), 0);
+    QCOMPARE(scheduler.droppedRequests(), 0);
+    QCOMPARE(scheduler.backoffs(), 0);
+
+    scheduler.setMaximumConnectionsPerHost(-1);
+    QCOMPARE(scheduler.maximumConnectionsPerHost(), 0);
+    scheduler.setRequestRate(-1);
+    QCOMPARE(scheduler.requestRate(), qreal(0));
+    scheduler.setBurstSize(0);
+    QCOMPARE(scheduler.burstSize(), 1);
+    scheduler.setMaximumQueueLength(-1);
+    QCOMPARE(scheduler.maximumQueueLength(), 0);
+}
+
+void tst_OpenSearchRequestScheduler::hostKey_data()
+{
+    QTest::addColumn<QUrl>("url");
+    QTest::addColumn<QString>("key");
+    QTest::newRow("http") << QUrl("http://foo.bar/baz?q=1") << QString("http://foo.bar:80");
+    QTest::newRow("explicit port") << QUrl("http://foo.bar:80/") << QString("http://foo.bar:80");
+    QTest::newRow("other port") << QUrl("http://foo.bar:8080/") << QString("http://foo.bar:8080");
+    QTest::newRow("https") << QUrl("https://foo.bar/") << QString("https://foo.bar:443");
+    QTest::newRow("case") << QUrl("HTTP://Foo.Bar/Baz") << QString("http://foo.bar:80");
+}
+
+void tst_OpenSearchRequestScheduler::hostKey()
+{
+    QFETCH(QUrl, url);
+    QFETCH(QString, key);
+
+    QCOMPARE(OpenSearchRequestScheduler::hostKey(url), key);
+}
+
+void tst_OpenSearchRequestScheduler::connectionLimit()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(2);
+
+    QUrl url("http://foo.bar/suggestions?q=a");
+    QVERIFY(scheduler.tryAcquire(url));
+    QVERIFY(scheduler.tryAcquire(QUrl("http://foo.bar/suggestions?q=ab")));
+    QVERIFY(!scheduler.tryAcquire(url));
+    QCOMPARE(scheduler.activeRequests(url), 2);
+
+    // Other hosts have their own budget.
+    QVERIFY(scheduler.tryAcquire(QUrl("http://baz.bar/")));
+    QCOMPARE(scheduler.activeRequests(QUrl("http://baz.bar/")), 1);
+
+    scheduler.release(url);
+    QCOMPARE(scheduler.activeRequests(url), 1);
+    QVERIFY(scheduler.tryAcquire(url));
+
+    scheduler.setMaximumConnectionsPerHost(0);
+    QVERIFY(scheduler.tryAcquire(url));
+    QCOMPARE(scheduler.activeRequests(url), 3);
+}
+
+void tst_OpenSearchRequestScheduler::requestRate()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(0);
+    scheduler.setRequestRate(20);
+    scheduler.setBurstSize(2);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+    QVERIFY(scheduler.tryAcquire(url));
+    QVERIFY(!scheduler.tryAcquire(url));
+
+    // A token comes back every 50 milliseconds.
+    QTest::qWait(100);
+    QVERIFY(scheduler.tryAcquire(url));
+
+    // Queued requests are granted as the bucket refills.
+    TestReceiver receiver;
+    QVERIFY(scheduler.enqueue(url, &receiver, "grant"));
+    QVERIFY(!scheduler.tryAcquire(url));
+    QTRY_COMPARE(receiver.tickets.count(), 1);
+    QCOMPARE(scheduler.queueLength(url), 0);
+}
+
+void tst_OpenSearchRequestScheduler::enqueue()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    TestReceiver receiver;
+    int first = scheduler.enqueue(url, &receiver, "grant");
+    int second = scheduler.enqueue(url, &receiver, "grant");
+    QVERIFY(first > 0);
+    QVERIFY(second > 0);
+    QVERIFY(first != second);
+    QCOMPARE(scheduler.queueLength(), 2);
+    QCOMPARE(scheduler.queueLength(url), 2);
+    QCOMPARE(scheduler.queueLength(QUrl("http://baz.bar/")), 0);
+
+    // Nothing is granted while the host is busy.
+    QTest::qWait(50);
+    QVERIFY(receiver.tickets.isEmpty());
+
+    scheduler.release(url);
+    QTRY_COMPARE(receiver.tickets, QList<int>() << first);
+    QCOMPARE(scheduler.queueLength(url), 1);
+    QCOMPARE(scheduler.activeRequests(url), 1);
+
+    // The queued requests go before the new ones.
+    QVERIFY(!scheduler.tryAcquire(url));
+
+    scheduler.release(url);
+    QTRY_COMPARE(receiver.tickets, QList<int>() << first << second);
+    QCOMPARE(scheduler.queueLength(), 0);
+
+    scheduler.release(url);
+    QVERIFY(scheduler.tryAcquire(url));
+}
+
+void tst_OpenSearchRequestScheduler::cancel()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    TestReceiver receiver;
+    int first = scheduler.enqueue(url, &receiver, "grant");
+    int second = scheduler.enqueue(url, &receiver, "grant");
+
+    scheduler.cancel(first);
+    QCOMPARE(scheduler.queueLength(url), 1);
+
+    scheduler.release(url);
+    QTRY_COMPARE(receiver.tickets, QList<int>() << second);
+    QCOMPARE(scheduler.queueLength(url), 0);
+}
+
+void tst_OpenSearchRequestScheduler::dropped()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+    scheduler.setMaximumQueueLength(1);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    TestReceiver receiver;
+    QVERIFY(scheduler.enqueue(url, &receiver, "grant") > 0);
+    QCOMPARE(scheduler.enqueue(url, &receiver, "grant"), 0);
+    QCOMPARE(scheduler.enqueue(url, &receiver, "grant"), 0);
+    QCOMPARE(scheduler.droppedRequests(), 2);
+    QCOMPARE(scheduler.queueLength(), 1);
+
+    // The queues are per host.
+    QVERIFY(scheduler.enqueue(QUrl("http://baz.bar/"), &receiver, "grant") > 0);
+    QCOMPARE(scheduler.droppedRequests(), 2);
+
+    scheduler.resetStatistics();
+    QCOMPARE(scheduler.droppedRequests(), 0);
+}
+
+void tst_OpenSearchRequestScheduler::destroyedReceiver()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    TestReceiver *destroyed = new TestReceiver;
+    TestReceiver receiver;
+    scheduler.enqueue(url, destroyed, "grant");
+    int ticket = scheduler.enqueue(url, &receiver, "grant");
+    delete destroyed;
+
+    scheduler.release(url);
+    QTRY_COMPARE(receiver.tickets, QList<int>() << ticket);
+    QCOMPARE(scheduler.activeRequests(url), 1);
+}
+
+void tst_OpenSearchRequestScheduler::releaseTicket()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    ReleasingReceiver receiver(&scheduler);
+    int ticket = scheduler.enqueue(url, &receiver, "grant");
+    scheduler.release(url);
+    QTRY_COMPARE(receiver.tickets, QList<int>() << ticket);
+    QCOMPARE(scheduler.activeRequests(url), 0);
+
+    // Outside of its receiver, a ticket is not released again.
+    QVERIFY(scheduler.tryAcquire(url));
+    scheduler.release(ticket);
+    QCOMPARE(scheduler.activeRequests(url), 1);
+}
+
+void tst_OpenSearchRequestScheduler::watch()
+{
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setMaximumConnectionsPerHost(1);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    TestNetworkReply *reply = new TestNetworkReply(url);
+    scheduler.watch(reply);
+    QVERIFY(!scheduler.tryAcquire(url));
+
+    reply->finish(200);
+    QCOMPARE(scheduler.activeRequests(url), 0);
+    QVERIFY(!scheduler.isBackingOff(url));
+    delete reply;
+    QCOMPARE(scheduler.activeRequests(url), 0);
+
+    // Replies destroyed before they have finished give their slot back too.
+    QVERIFY(scheduler.tryAcquire(url));
+    reply = new TestNetworkReply(url);
+    scheduler.watch(reply);
+    delete reply;
+    QCOMPARE(scheduler.activeRequests(url), 0);
+
+    // So do the ones that have finished before they are watched.
+    QVERIFY(scheduler.tryAcquire(url));
+    TestNetworkReply finished(url);
+    finished.finish(200);
+    scheduler.watch(&finished);
+    QCOMPARE(scheduler.activeRequests(url), 0);
+}
+
+void tst_OpenSearchRequestScheduler::backoff_data()
+{
+    QTest::addColumn<int>("statusCode");
+    QTest::addColumn<QByteArray>("retryAfter");
+    QTest::addColumn<bool>("backingOff");
+    QTest::newRow("ok") << 200 << QByteArray() << false;
+    QTest::newRow("not found") << 404 << QByteArray() << false;
+    QTest::newRow("too many requests") << 429 << QByteArray() << true;
+    QTest::newRow("unavailable") << 503 << QByteArray() << true;
+    QTest::newRow("retry after") << 429 << QByteArray("0") << false;
+    QTest::newRow("malformed retry after") << 503 << QByteArray("later") << true;
+}
+
+void tst_OpenSearchRequestScheduler::backoff()
+{
+    QFETCH(int, statusCode);
+    QFETCH(QByteArray, retryAfter);
+    QFETCH(bool, backingOff);
+
+    OpenSearchRequestScheduler scheduler;
+    scheduler.setBackoff(100);
+
+    QUrl url("http://foo.bar/");
+    QVERIFY(scheduler.tryAcquire(url));
+
+    TestNetworkReply reply(url);
+    scheduler.watch(&reply);
+    reply.finish(statusCode, retryAfter);
+
+    QCOMPARE(scheduler.isBackingOff(url), backingOff);
+    QCOMPARE(scheduler.backoffs(), (statusCode == 429 || statusCode == 503) ? 1 : 0);
+    QVERIFY(!scheduler.isBackingOff(QUrl("http://baz.bar/")));
+
+    if (!backingOff) {
+        QVERIFY(scheduler.tryAcquire(url));
+        return;
+    }
+
+    // The requests wait until the pause is over.
+    QVERIFY(!scheduler.tryAcquire(url));
+    TestReceiver receiver;
+    QVERIFY(scheduler.enqueue(url, &receiver, "grant") > 0);
+    QTest::qWait(50);
+    QVERIFY(receiver.tickets.isEmpty());
+
+    QTRY_COMPARE(receiver.tickets.count(), 1);
+    QVERIFY(!scheduler.isBackingOff(url));
+
+    // The pause never exceeds the maximum.
+    scheduler.setMaximumBackoff(0);
+    TestNetworkReply again(url);
+    scheduler.watch(&again);
+    again.finish(statusCode, "3600");
+    QVERIFY(!scheduler.isBackingOff(url));
+    QCOMPARE(scheduler.backoffs(), 2);
+}
+
+void tst_OpenSearchRequestScheduler::parseRetryAfter_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<int>("msecs");
+    QTest::newRow("empty") << QByteArray() << -1;
+    QTest::newRow("seconds") << QByteArray("120") << 120000;
+    QTest::newRow("zero") << QByteArray("0") << 0;
+    QTest::newRow("spaces") << QByteArray(" 5 ") << 5000;
+    QTest::newRow("negative") << QByteArray("-1") << -1;
+    QTest::newRow("text") << QByteArray("soon") << -1;
+    QTest::newRow("date") << QByteArray("Wed, 21 Oct 2015 07:28:00 GMT") << 30000;
+    QTest::newRow("past date") << QByteArray("Wed, 21 Oct 2015 07:00:00 GMT") << 0;
+    QTest::newRow("bad month") << QByteArray("Wed, 21 Foo 2015 07:28:00 GMT") << -1;
+    QTest::newRow("misaligned month") << QByteArray("Wed, 21 anF 2015 07:28:00 GMT") << -1;
+    QTest::newRow("bad time") << QByteArray("Wed, 21 Oct 2015 07:28 GMT") << -1;
+    QTest::newRow("no zone") << QByteArray("Wed, 21 Oct 2015 07:28:00") << -1;
+}
+
+void tst_OpenSearchRequestScheduler::parseRetryAfter()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(int, msecs);
+
+    QDateTime now(QDate(2015, 10, 21), QTime(7, 27, 30), Qt::UTC);
+    QCOMPARE(OpenSearchRequestScheduler::parseRetryAfter(value, now), msecs);
+}
+
+QTEST_MAIN(tst_OpenSearchRequestScheduler)
+
+#include "tst_opensearchrequestscheduler.moc"
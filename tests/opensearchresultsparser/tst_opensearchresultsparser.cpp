@@ -0,0 +1,403 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include "opensearchengine.h"
+#include "opensearchresultsparser.h"
+
+#include <qnetworkaccessmanager.h>
+#include <qnetworkreply.h>
+#include <qnetworkrequest.h>
+
+class tst_OpenSearchResultsParser : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void parse_data();
+    void parse();
+    void chunks_data();
+    void chunks();
+    void responseElements();
+    void takeResults();
+    void fetchSearchResults();
+    void fetchSearchResultsSuperseded();
+};
+
+static const char rssFeed[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<rss version=\"2.0\" xmlns:opensearch=\"http://a9.com/-/spec/opensearch/1.1/\""
+    " xmlns:atom=\"http://www.w3.org/2005/Atom\" xmlns:media=\"http://search.yahoo.com/mrss/\">\n"
+    "  <channel>\n"
+    "    <title>Example.com Search: foo</title>\n"
+    "    <link>http://example.com/search?q=foo</link>\n"
+    "    <opensearch:totalResults>4230000</opensearch:totalResults>\n"
+    "    <opensearch:startIndex>21</opensearch:startIndex>\n"
+    "    <opensearch:itemsPerPage>10</opensearch:itemsPerPage>\n"
+    "    <item>\n"
+    "      <title>Foo &amp; Bar</title>\n"
+    "      <link>http://example.com/foo</link>\n"
+    "      <description><![CDATA[A <b>foo</b> page]]></description>\n"
+    "      <media:title>Not the title</media:title>\n"
+    "    </item>\n"
+    "    <item>\n"
+    "      <title>Baz</title>\n"
+    "      <atom:link rel=\"alternate\" href=\"http://example.com/baz\"/>\n"
+    "      <link>http://example.com/ignored</link>\n"
+    "    </item>\n"
+    "  </channel>\n"
+    "</rss>\n";
+
+static const char atomFeed[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<feed xmlns=\"http://www.w3.org/2005/Atom\" xmlns:opensearch=\"http://a9.com/-/spec/opensearch/1.1/\">\n"
+    "  <title>Example.com Search: foo</title>\n"
+    "  <link href=\"http://example.com/search?q=foo\"/>\n"
+    "  <opensearch:totalResults>2</opensearch:totalResults>\n"
+    "  <entry>\n"
+    "    <title>Foo</title>\n"
+    "    <link rel=\"related\" href=\"http://example.com/related\"/>\n"
+    "    <link href=\"http://example.com/foo\"/>\n"
+    "    <content type=\"xhtml\"><div xmlns=\"http://www.w3.org/1999/xhtml\">Full <b>content</b></div></content>\n"
+    "    <summary>Summary</summary>\n"
+    "  </entry>\n"
+    "  <entry>\n"
+    "    <title type=\"html\">Bar</title>\n"
+    "    <link rel=\"alternate\" href=\"http://example.com/bar\"/>\n"
+    "    <content>Content only</content>\n"
+    "  </entry>\n"
+    "</feed>\n";
+
+static OpenSearchResult result(const QString &title, const QString &link, const QString &snippet)
+{
+    OpenSearchResult result;
+    result.title = title;
+    result.link = QUrl(link);
+    result.snippet = snippet;
+    return result;
+}
+
+class ResultsTestNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    ResultsTestNetworkReply(const QNetworkRequest &request, const QByteArray &data, QObject *parent = 0)
+        : QNetworkReply(parent)
+        , data(data)
+        , position(0)
+        , published(0)
+    {
+        setOperation(QNetworkAccessManager::GetOperation);
+        setRequest(request);
+        setUrl(request.url());
+        setOpenMode(QIODevice::ReadOnly);
+        setError(QNetworkReply::NoError, tr("No Error"));
+
+        QTimer::singleShot(10, this, SLOT(sendChunk()));
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return published - position + QNetworkReply::bytesAvailable();
+    }
+
+    qint64 readData(char *buffer, qint64 maxSize)
+    {
+        qint64 size = qMin(maxSize, qint64(published - position));
+        memcpy(buffer, data.constData() + position, size);
+        position += size;
+        return size;
+    }
+
+    void abort()
+    {
+        published = data.size();
+        position = data.size();
+    }
+
+private slots:
+    void sendChunk()
+    {
+        if (position == data.size() && published == data.size())
+            return;
+
+        // The feed is cut in the middle of the second item.
+        published = (published == 0) ? data.indexOf("<title>Baz") : data.size();
+
+        emit readyRead();
+
+        if (published < data.size())
+            QTimer::singleShot(10, this, SLOT(sendChunk()));
+        else
+            emit finished();
+    }
+
+private:
+    QByteArray data;
+    int position;
+    int published;
+};
+
+class ResultsTestNetworkAccessManager : public QNetworkAccessManager
+{
+public:
+    ResultsTestNetworkAccessManager(QObject *parent = 0)
+        : QNetworkAccessManager(parent)
+        , requestCount(0)
+    {
+    }
+
+    QNetworkRequest lastRequest;
+    int requestCount;
+
+protected:
+    QNetworkReply *createRequest(QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice * = 0)
+    {
+        lastRequest = request;
+        ++requestCount;
+
+        return new ResultsTestNetworkReply(request, QByteArray(rssFeed), 0);
+    }
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchResultsParser::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchResultsParser::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchResultsParser::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchResultsParser::cleanup()
+{
+}
+
+void tst_OpenSearchResultsParser::parse_data()
+{
+    QTest::addColumn<QByteArray>("response");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<OpenSearchResults>("results");
+
+    QTest::newRow("empty") << QByteArray() << false << OpenSearchResults();
+    QTest::newRow("rss") << QByteArray(rssFeed) << true
+            << (OpenSearchResults() << result("Foo & Bar", "http://example.com/foo", "A <b>foo</b> page")
+                                    << result("Baz", "http://example.com/baz", QString()));
+    QTest::newRow("atom") << QByteArray(atomFeed) << true
+            << (OpenSearchResults() << result("Foo", "http://example.com/foo", "Summary")
+                                    << result("Bar", "http://example.com/bar", "Content only"));
+    QTest::newRow("rss 1.0") << QByteArray("<rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\""
+                                           " xmlns=\"http://purl.org/rss/1.0/\"><channel/>"
+                                           "<item><title>Foo</title><link>http://example.com/</link></item>"
+                                           "</rdf:RDF>") << true
+            << (OpenSearchResults() << result("Foo", "http://example.com/", QString()));
+    QTest::newRow("no items") << QByteArray("<rss><channel><title>Nothing</title></channel></rss>") << true
+            << OpenSearchResults();
+    QTest::newRow("truncated") << QByteArray(rssFeed).left(200) << false << OpenSearchResults();
+    QTest::newRow("malformed") << QByteArray("<rss><channel></rss>") << false << OpenSearchResults();
+}
+
+void tst_OpenSearchResultsParser::parse()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(bool, valid);
+    QFETCH(OpenSearchResults, results);
+
+    bool ok;
+    QCOMPARE(OpenSearchResultsParser::parse(response, &ok), results);
+    QCOMPARE(ok, valid);
+}
+
+void tst_OpenSearchResultsParser::chunks_data()
+{
+    parse_data();
+}
+
+void tst_OpenSearchResultsParser::chunks()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(bool, valid);
+    QFETCH(OpenSearchResults, results);
+
+    OpenSearchResultsParser parser;
+    OpenSearchResults parsed;
+    for (int i = 0; i < response.size(); ++i) {
+        parser.addData(response.constData() + i, 1);
+        parsed += parser.takeResults();
+    }
+
+    QCOMPARE(parser.finish(), valid);
+    if (valid)
+        QCOMPARE(parsed, results);
+}
+
+void tst_OpenSearchResultsParser::responseElements()
+{
+    OpenSearchResultsParser parser;
+    QCOMPARE(parser.totalResults(), -1);
+    QCOMPARE(parser.startIndex(), -1);
+    QCOMPARE(parser.itemsPerPage(), -1);
+
+    QVERIFY(parser.addData(QByteArray(rssFeed)));
+    QVERIFY(parser.finish());
+    QVERIFY(parser.atEnd());
+    QCOMPARE(parser.totalResults(), 4230000);
+    QCOMPARE(parser.startIndex(), 21);
+    QCOMPARE(parser.itemsPerPage(), 10);
+
+    parser.reset();
+    QCOMPARE(parser.totalResults(), -1);
+    QVERIFY(!parser.addData(QByteArray("<rss><channel></rss>")));
+    QVERIFY(parser.hasError());
+    QVERIFY(!parser.errorString().isEmpty());
+}
+
+void tst_OpenSearchResultsParser::takeResults()
+{
+    QByteArray feed(rssFeed);
+    int cut = feed.indexOf("<title>Baz");
+
+    // Results are available as soon as their item has been parsed.
+    OpenSearchResultsParser parser;
+    QVERIFY(parser.addData(feed.left(cut)));
+    QVERIFY(!parser.hasError());
+    QVERIFY(!parser.atEnd());
+    QVERIFY(parser.hasResults());
+    QCOMPARE(parser.takeResults().count(), 1);
+    QVERIFY(!parser.hasResults());
+
+    QVERIFY(parser.addData(feed.mid(cut)));
+    QVERIFY(parser.finish());
+    QCOMPARE(parser.takeResults(), OpenSearchResults() << result("Baz", "http://example.com/baz", QString()));
+}
+
+void tst_OpenSearchResultsParser::fetchSearchResults()
+{
+    ResultsTestNetworkAccessManager manager;
+
+    OpenSearchDescription::Url rss;
+    rss.type = QLatin1String("application/rss+xml");
+    rss.urlTemplate = QLatin1String("http://example.com/rss?q={searchTerms}&n={count}&s={startIndex}");
+
+    OpenSearchDescription description;
+    description.setName("Example");
+    description.setSearchUrlTemplate("http://example.com/search?q={searchTerms}");
+    description.setAdditionalUrls(OpenSearchDescription::Urls() << rss);
+
+    OpenSearchEngine engine(description);
+    engine.setNetworkAccessManager(&manager);
+
+    // The engine registers the results, no need to do it here.
+    QSignalSpy resultsSpy(&engine, SIGNAL(searchResults(OpenSearchResults)));
+    QSignalSpy finishedSpy(&engine, SIGNAL(searchResultsFinished(bool)));
+    QVERIFY(resultsSpy.isValid());
+
+    // Engines without feeds do not fetch anything.
+    OpenSearchEngine htmlOnly;
+    htmlOnly.setNetworkAccessManager(&manager);
+    htmlOnly.setSearchUrlTemplate("http://example.com/search?q={searchTerms}");
+    htmlOnly.fetchSearchResults("foo");
+    QVERIFY(!htmlOnly.isFetchingSearchResults());
+    QCOMPARE(manager.requestCount, 0);
+
+    engine.fetchSearchResults("foo bar", OpenSearchTemplateContext(10, 20));
+    QVERIFY(engine.isFetchingSearchResults());
+    QCOMPARE(manager.requestCount, 1);
+    QCOMPARE(manager.lastRequest.url(), QUrl::fromEncoded("http://example.com/rss?q=foo%20bar&n=10&s=20"));
+    QCOMPARE(manager.lastRequest.rawHeader("Accept"), QByteArray("application/rss+xml"));
+
+    // The first item arrives before the rest of the feed.
+    QTRY_COMPARE(resultsSpy.count(), 1);
+    QCOMPARE(finishedSpy.count(), 0);
+    OpenSearchResults first = qvariant_cast<OpenSearchResults>(resultsSpy.at(0).at(0));
+    QCOMPARE(first, OpenSearchResults() << result("Foo & Bar", "http://example.com/foo", "A <b>foo</b> page"));
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toBool(), true);
+    QCOMPARE(resultsSpy.count(), 2);
+    QCOMPARE(qvariant_cast<OpenSearchResults>(resultsSpy.at(1).at(0)).count(), 1);
+    QVERIFY(!engine.isFetchingSearchResults());
+    QCOMPARE(engine.searchResultsTotal(), 4230000);
+}
+
+void tst_OpenSearchResultsParser::fetchSearchResultsSuperseded()
+{
+    ResultsTestNetworkAccessManager manager;
+
+    OpenSearchDescription::Url atom;
+    atom.type = QLatin1String("application/atom+xml");
+    atom.urlTemplate = QLatin1String("http://example.com/atom?q={searchTerms}");
+
+    OpenSearchDescription::Url rss;
+    rss.type = QLatin1String("application/rss+xml");
+    rss.urlTemplate = QLatin1String("http://example.com/rss?q={searchTerms}");
+
+    OpenSearchDescription description;
+    description.setAdditionalUrls(OpenSearchDescription::Urls() << rss << atom);
+
+    OpenSearchEngine engine(description);
+    engine.setNetworkAccessManager(&manager);
+
+    QSignalSpy resultsSpy(&engine, SIGNAL(searchResults(OpenSearchResults)));
+    QSignalSpy finishedSpy(&engine, SIGNAL(searchResultsFinished(bool)));
+
+    // Atom is preferred, unless a type is given.
+    engine.fetchSearchResults("foo");
+    QCOMPARE(manager.lastRequest.url(), QUrl("http://example.com/atom?q=foo"));
+
+    engine.fetchSearchResults("bar", OpenSearchTemplateContext(), "application/rss+xml");
+    QCOMPARE(manager.requestCount, 2);
+    QCOMPARE(manager.lastRequest.url(), QUrl("http://example.com/rss?q=bar"));
+
+    // Only the last request delivers results.
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QTest::qWait(50);
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(resultsSpy.count(), 2);
+
+    engine.fetchSearchResults("baz");
+    engine.abortSearchResults();
+    QVERIFY(!engine.isFetchingSearchResults());
+    QTest::qWait(50);
+    QCOMPARE(resultsSpy.count(), 2);
+    QCOMPARE(finishedSpy.count(), 1);
+}
+
+QTEST_MAIN(tst_OpenSearchResultsParser)
+
+#include "tst_opensearchresultsparser.moc"
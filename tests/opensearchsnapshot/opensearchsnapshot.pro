@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = tst_opensearchsnapshot
+
+include(../tests.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_opensearchsnapshot.cpp
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchengine.h"
+#include "opensearchsnapshot.h"
+#include "opensearchwriter.h"
+
+typedef OpenSearchEngine::Parameters Parameters;
+typedef OpenSearchEngine::Parameter Parameter;
+
+class tst_OpenSearchSnapshot : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void write();
+    void open_data();
+    void open();
+    void loadEngines();
+
+private:
+    QString filePath(const QString &fileName) const;
+    void writeFile(const QString &fileName, const QByteArray &data);
+    QList<OpenSearchEngine*> m_engines;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchSnapshot::initTestCase()
+{
+    OpenSearchEngine *engine = new OpenSearchEngine(this);
+    engine->setName("Foo");
+    engine->setDescription(QString::fromUtf8("Zażółć gęślą jaźń"));
+    engine->setSearchUrlTemplate("http://foo.bar/search?q={searchTerms}");
+    engine->setSearchMethod("post");
+    engine->setSearchParameters(Parameters() << Parameter("a", "b") << Parameter("c", "{searchTerms}"));
+    engine->setSuggestionsUrlTemplate("http://foo.bar/suggest?q={searchTerms}");
+    engine->setSuggestionsParameters(Parameters() << Parameter("a", "b"));
+    engine->setImageUrl("http://foo.bar/favicon.png");
+    engine->setTags(QStringList() << "foo" << "bar");
+
+    OpenSearchDescription::Url url;
+    url.type = "application/rss+xml";
+    url.urlTemplate = "http://foo.bar/rss?q={searchTerms}";
+    url.method = "post";
+    url.parameters = Parameters() << Parameter("d", "{searchTerms}");
+    OpenSearchDescription description = engine->openSearchDescription();
+    description.setAdditionalUrls(OpenSearchDescription::Urls() << url);
+    engine->setOpenSearchDescription(description);
+    m_engines.append(engine);
+
+    engine = new OpenSearchEngine(this);
+    engine->setName("Bar");
+    engine->setSearchUrlTemplate("http://bar.baz/?q={searchTerms}");
+    m_engines.append(engine);
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchSnapshot::cleanupTestCase()
+{
+    qDeleteAll(m_engines);
+    m_engines.clear();
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchSnapshot::init()
+{
+    QDir().mkpath(filePath(QString()));
+}
+
+// This will be called after every test function.
+void tst_OpenSearchSnapshot::cleanup()
+{
+    QDir directory(filePath(QString()));
+    foreach (const QString &fileName, directory.entryList(QDir::Files))
+        directory.remove(fileName);
+    QDir().rmdir(directory.path());
+}
+
+QString tst_OpenSearchSnapshot::filePath(const QString &fileName) const
+{
+    return QDir::tempPath() + QLatin1String("/tst_opensearchsnapshot/") + fileName;
+}
+
+void tst_OpenSearchSnapshot::writeFile(const QString &fileName, const QByteArray &data)
+{
+    QFile file(filePath(fileName));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+}
+
+void tst_OpenSearchSnapshot::write()
+{
+    QFile file(filePath("snapshot.bin"));
+    OpenSearchWriter writer;
+    QVERIFY(writer.writeSnapshot(&file, m_engines, 42));
+    file.close();
+
+    OpenSearchSnapshot snapshot;
+    QVERIFY(!snapshot.isOpen());
+    QCOMPARE(snapshot.count(), 0);
+
+    QVERIFY(snapshot.open(file.fileName()));
+    QVERIFY(snapshot.isOpen());
+    QCOMPARE(snapshot.sourceChecksum(), quint64(42));
+    QCOMPARE(snapshot.count(), 2);
+
+    QCOMPARE(snapshot.name(0), QString("Foo"));
+    QCOMPARE(snapshot.description(0), QString::fromUtf8("Zażółć gęślą jaźń"));
+    QCOMPARE(snapshot.searchUrlTemplate(0), QString("http://foo.bar/search?q={searchTerms}"));
+    QCOMPARE(snapshot.suggestionsUrlTemplate(0), QString("http://foo.bar/suggest?q={searchTerms}"));
+    QCOMPARE(snapshot.imageUrl(0), QString("http://foo.bar/favicon.png"));
+    QCOMPARE(snapshot.tags(0), QStringList() << "foo" << "bar");
+    QCOMPARE(snapshot.name(1), QString("Bar"));
+    QCOMPARE(snapshot.description(1), QString());
+    QCOMPARE(snapshot.name(2), QString());
+
+    for (int i = 0; i < m_engines.count(); ++i) {
+        OpenSearchEngine *engine = snapshot.engine(i);
+        QVERIFY(engine);
+        QVERIFY(*engine == *m_engines.at(i));
+        QCOMPARE(engine->searchMethod(), m_engines.at(i)->searchMethod());
+        QCOMPARE(engine->suggestionsMethod(), m_engines.at(i)->suggestionsMethod());
+        QCOMPARE(engine->tags(), m_engines.at(i)->tags());
+        QCOMPARE(engine->openSearchDescription().additionalUrls(),
+                 m_engines.at(i)->openSearchDescription().additionalUrls());
+        delete engine;
+    }
+
+    QVERIFY(!snapshot.engine(-1));
+    QVERIFY(!snapshot.engine(2));
+
+    // Engines do not depend on the snapshot.
+    OpenSearchEngine *engine = snapshot.engine(0);
+    snapshot.close();
+    QVERIFY(!snapshot.isOpen());
+    QCOMPARE(engine->name(), QString("Foo"));
+    delete engine;
+}
+
+void tst_OpenSearchSnapshot::open_data()
+{
+    QTest::addColumn<bool>("truncated");
+    QTest::addColumn<int>("corruptedOffset");
+    QTest::newRow("valid") << false << -1;
+    QTest::newRow("truncated") << true << -1;
+    QTest::newRow("magic") << false << 0;
+    QTest::newRow("version") << false << 4;
+    QTest::newRow("count") << false << 8;
+    QTest::newRow("reference") << false << 39;
+}
+
+void tst_OpenSearchSnapshot::open()
+{
+    QFETCH(bool, truncated);
+    QFETCH(int, corruptedOffset);
+
+    QBuffer buffer;
+    QVERIFY(OpenSearchSnapshot::write(&buffer, m_engines));
+
+    QByteArray data = buffer.data();
+    if (truncated)
+        data.chop(2);
+    if (corruptedOffset != -1)
+        data[corruptedOffset] = 0x7f;
+    writeFile("snapshot.bin", data);
+
+    OpenSearchSnapshot snapshot;
+    QCOMPARE(snapshot.open(filePath("snapshot.bin")), !truncated && corruptedOffset == -1);
+    QVERIFY(!snapshot.open(filePath("nonexistent.bin")));
+}
+
+void tst_OpenSearchSnapshot::loadEngines()
+{
+    writeFile("foo.xml", "<OpenSearchDescription xmlns=\"http://a9.com/-/spec/opensearch/1.1/\">"
+                         "<ShortName>Foo</ShortName></OpenSearchDescription>");
+    writeFile("broken.xml", "<OpenSearch");
+
+    QStringList fileNames;
+    fileNames << filePath("foo.xml") << filePath("broken.xml");
+    QString snapshotFileName = filePath("snapshot.bin");
+
+    QList<OpenSearchEngine*> engines = OpenSearchSnapshot::loadEngines(snapshotFileName, fileNames);
+    QCOMPARE(engines.count(), 1);
+    QCOMPARE(engines.at(0)->name(), QString("Foo"));
+    qDeleteAll(engines);
+
+    OpenSearchSnapshot snapshot;
+    QVERIFY(snapshot.open(snapshotFileName));
+    QVERIFY(snapshot.isUpToDate(fileNames));
+    QCOMPARE(snapshot.sourceChecksum(), OpenSearchSnapshot::checksum(fileNames));
+    snapshot.close();
+
+    // The snapshot is used as long as the sources do not change.
+    OpenSearchEngine engine;
+    engine.setName("Baz");
+    QFile file(snapshotFileName);
+    QVERIFY(OpenSearchSnapshot::write(&file, QList<OpenSearchEngine*>() << &engine,
+                                      OpenSearchSnapshot::checksum(fileNames)));
+    file.close();
+
+    engines = OpenSearchSnapshot::loadEngines(snapshotFileName, fileNames);
+    QCOMPARE(engines.count(), 1);
+    QCOMPARE(engines.at(0)->name(), QString("Baz"));
+    qDeleteAll(engines);
+
+    writeFile("foo.xml", "<OpenSearchDescription xmlns=\"http://a9.com/-/spec/opensearch/1.1/\">"
+                         "<ShortName>Foobar</ShortName></OpenSearchDescription>");
+    QVERIFY(snapshot.open(snapshotFileName));
+    QVERIFY(!snapshot.isUpToDate(fileNames));
+    snapshot.close();
+
+    engines = OpenSearchSnapshot::loadEngines(snapshotFileName, fileNames);
+    QCOMPARE(engines.count(), 1);
+    QCOMPARE(engines.at(0)->name(), QString("Foobar"));
+    qDeleteAll(engines);
+}
+
+QTEST_MAIN(tst_OpenSearchSnapshot)
+
+#include "tst_opensearchsnapshot.moc"
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+
+#include <QtTest/QtTest>
+
+#include "opensearchstringpool.h"
+
+#include <qtconcurrentmap.h>
+
+class tst_OpenSearchStringPool : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void intern();
+    void internData();
+    void sizeOf();
+    void releaseUnused();
+    void threads();
+};
+
+static QString internNumber(const int &number)
+{
+    return OpenSearchStringPool::intern(QString::number(number % 10));
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchStringPool::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchStringPool::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchStringPool::init()
+{
+    OpenSearchStringPool::releaseUnused();
+}
+
+// This will be called after every test function.
+void tst_OpenSearchStringPool::cleanup()
+{
+}
+
+void tst_OpenSearchStringPool::intern()
+{
+    QString first = QString("application/rss+xml");
+    QString second = QString("application/rss+xml");
+    QVERIFY(first.constData() != second.constData());
+    QVERIFY(!OpenSearchStringPool::contains(first));
+
+    QString internedFirst = OpenSearchStringPool::intern(first);
+    QString internedSecond = OpenSearchStringPool::intern(second);
+    QCOMPARE(internedFirst, first);
+    QCOMPARE(internedFirst.constData(), first.constData());
+    QCOMPARE(internedSecond.constData(), first.constData());
+    QVERIFY(OpenSearchStringPool::contains(internedSecond));
+    QVERIFY(!OpenSearchStringPool::contains(second));
+
+    QVERIFY(OpenSearchStringPool::intern(QString()).isNull());
+    QVERIFY(!OpenSearchStringPool::contains(QString()));
+
+    QStringList tags = OpenSearchStringPool::intern(QStringList() << QString("web") << QString("web"));
+    QCOMPARE(tags, QStringList() << "web" << "web");
+    QCOMPARE(tags.at(0).constData(), tags.at(1).constData());
+}
+
+void tst_OpenSearchStringPool::internData()
+{
+    QByteArray first("http://foobar.baz/?q=");
+    QByteArray second("http://foobar.baz/?q=");
+
+    QByteArray internedFirst = OpenSearchStringPool::intern(first);
+    QByteArray internedSecond = OpenSearchStringPool::intern(second);
+    QCOMPARE(internedSecond, second);
+    QCOMPARE(internedSecond.constData(), internedFirst.constData());
+    QVERIFY(OpenSearchStringPool::contains(internedSecond));
+    QVERIFY(!OpenSearchStringPool::contains(second));
+}
+
+void tst_OpenSearchStringPool::sizeOf()
+{
+    QString string(100, QLatin1Char('x'));
+    QCOMPARE(OpenSearchStringPool::sizeOf(string), qint64(100 * sizeof(QChar)));
+    QCOMPARE(OpenSearchStringPool::sizeOf(QString()), qint64(0));
+
+    qint64 usage = OpenSearchStringPool::memoryUsage();
+    int count = OpenSearchStringPool::count();
+
+    QString interned = OpenSearchStringPool::intern(string);
+    QCOMPARE(OpenSearchStringPool::sizeOf(interned), qint64(0));
+    QCOMPARE(OpenSearchStringPool::count(), count + 1);
+    QVERIFY(OpenSearchStringPool::memoryUsage() >= usage + qint64(100 * sizeof(QChar)));
+
+    QByteArray data(100, 'x');
+    QCOMPARE(OpenSearchStringPool::sizeOf(data), qint64(100));
+    QCOMPARE(OpenSearchStringPool::sizeOf(OpenSearchStringPool::intern(data)), qint64(0));
+}
+
+void tst_OpenSearchStringPool::releaseUnused()
+{
+    int count = OpenSearchStringPool::count();
+
+    QString kept = OpenSearchStringPool::intern(QString("kept"));
+    OpenSearchStringPool::intern(QString("dropped"));
+    OpenSearchStringPool::intern(QByteArray("dropped"));
+    QCOMPARE(OpenSearchStringPool::count(), count + 3);
+
+    OpenSearchStringPool::releaseUnused();
+    QCOMPARE(OpenSearchStringPool::count(), count + 1);
+    QVERIFY(OpenSearchStringPool::contains(kept));
+
+    kept.clear();
+    OpenSearchStringPool::releaseUnused();
+    QCOMPARE(OpenSearchStringPool::count(), count);
+}
+
+void tst_OpenSearchStringPool::threads()
+{
+    QList<int> numbers;
+    for (int i = 0; i < 1000; ++i)
+        numbers.append(i);
+
+    QList<QString> strings = QtConcurrent::blockingMapped<QList<QString> >(numbers, internNumber);
+    QCOMPARE(strings.count(), numbers.count());
+    for (int i = 10; i < strings.count(); ++i) {
+        QCOMPARE(strings.at(i), QString::number(i % 10));
+        QCOMPARE(strings.at(i).constData(), strings.at(i % 10).constData());
+    }
+}
+
+QTEST_MAIN(tst_OpenSearchStringPool)
+
+#include "tst_opensearchstringpool.moc"
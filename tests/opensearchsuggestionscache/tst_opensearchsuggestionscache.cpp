@@ -0,0 +1,173 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchsuggestionscache.h"
+
+class tst_OpenSearchSuggestionsCache : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void lookup();
+    void normalizedTerm_data();
+    void normalizedTerm();
+    void maximumSize();
+    void timeToLive();
+    void prefixFiltering();
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchSuggestionsCache::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchSuggestionsCache::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchSuggestionsCache::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchSuggestionsCache::cleanup()
+{
+}
+
+void tst_OpenSearchSuggestionsCache::lookup()
+{
+    OpenSearchSuggestionsCache cache;
+    QStringList suggestions;
+
+    QVERIFY(!cache.lookup("a", "foo", &suggestions));
+    QCOMPARE(cache.misses(), 1);
+    QCOMPARE(cache.hits(), 0);
+
+    cache.insert("a", "foo", QStringList() << "foo bar" << "foobar");
+    QCOMPARE(cache.count(), 1);
+
+    QVERIFY(cache.lookup("a", "foo", &suggestions));
+    QCOMPARE(suggestions, QStringList() << "foo bar" << "foobar");
+    QVERIFY(cache.lookup("a", " FOO ", &suggestions));
+    QVERIFY(!cache.lookup("b", "foo", &suggestions));
+    QCOMPARE(cache.hits(), 2);
+    QCOMPARE(cache.misses(), 2);
+
+    cache.insert("a", "bar", QStringList());
+    QVERIFY(cache.lookup("a", "bar", &suggestions));
+    QCOMPARE(suggestions, QStringList());
+
+    cache.resetStatistics();
+    QCOMPARE(cache.hits(), 0);
+    QCOMPARE(cache.misses(), 0);
+
+    cache.clear();
+    QCOMPARE(cache.count(), 0);
+    QVERIFY(!cache.lookup("a", "foo", &suggestions));
+}
+
+void tst_OpenSearchSuggestionsCache::normalizedTerm_data()
+{
+    QTest::addColumn<QString>("searchTerm");
+    QTest::addColumn<QString>("normalizedTerm");
+    QTest::newRow("null") << QString() << QString();
+    QTest::newRow("simple") << QString("foo") << QString("foo");
+    QTest::newRow("case") << QString("FoO") << QString("foo");
+    QTest::newRow("whitespace") << QString("  foo \t bar ") << QString("foo bar");
+}
+
+void tst_OpenSearchSuggestionsCache::normalizedTerm()
+{
+    QFETCH(QString, searchTerm);
+    QFETCH(QString, normalizedTerm);
+
+    QCOMPARE(OpenSearchSuggestionsCache::normalizedTerm(searchTerm), normalizedTerm);
+}
+
+void tst_OpenSearchSuggestionsCache::maximumSize()
+{
+    OpenSearchSuggestionsCache cache(2);
+    QCOMPARE(cache.maximumSize(), 2);
+
+    QStringList suggestions;
+    cache.insert("a", "1", QStringList() << "1");
+    cache.insert("a", "2", QStringList() << "2");
+    QVERIFY(cache.lookup("a", "1", &suggestions));
+    cache.insert("a", "3", QStringList() << "3");
+
+    QCOMPARE(cache.count(), 2);
+    QVERIFY(cache.lookup("a", "1", &suggestions));
+    QVERIFY(!cache.lookup("a", "2", &suggestions));
+    QVERIFY(cache.lookup("a", "3", &suggestions));
+
+    cache.setMaximumSize(1);
+    QCOMPARE(cache.count(), 1);
+}
+
+void tst_OpenSearchSuggestionsCache::timeToLive()
+{
+    OpenSearchSuggestionsCache cache(10, 100);
+    QCOMPARE(cache.timeToLive(), 100);
+
+    QStringList suggestions;
+    cache.insert("a", "foo", QStringList() << "foobar");
+    QVERIFY(cache.lookup("a", "foo", &suggestions));
+
+    QTest::qWait(200);
+    QVERIFY(!cache.lookup("a", "foo", &suggestions));
+    QCOMPARE(cache.count(), 0);
+
+    cache.setTimeToLive(0);
+    cache.insert("a", "foo", QStringList() << "foobar");
+    QTest::qWait(200);
+    QVERIFY(cache.lookup("a", "foo", &suggestions));
+}
+
+void tst_OpenSearchSuggestionsCache::prefixFiltering()
+{
+    OpenSearchSuggestionsCache cache;
+    QVERIFY(!cache.prefixFiltering());
+
+    QStringList suggestions;
+    cache.insert("a", "wea", QStringList() << "weather" << "wearable" << "Weather radar");
+    QVERIFY(!cache.lookup("a", "weath", &suggestions));
+
+    cache.setPrefixFiltering(true);
+    QVERIFY(cache.lookup("a", "weath", &suggestions));
+    QCOMPARE(suggestions, QStringList() << "weather" << "Weather radar");
+
+    QVERIFY(!cache.lookup("a", "weak", &suggestions));
+    QVERIFY(!cache.lookup("b", "weath", &suggestions));
+}
+
+QTEST_MAIN(tst_OpenSearchSuggestionsCache)
+
+#include "tst_opensearchsuggestionscache.moc"
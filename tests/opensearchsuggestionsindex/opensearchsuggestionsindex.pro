@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = tst_opensearchsuggestionsindex
+
+include(../tests.pri)
+include(../../src/opensearch.pri)
+
+SOURCES += \
+    tst_opensearchsuggestionsindex.cpp
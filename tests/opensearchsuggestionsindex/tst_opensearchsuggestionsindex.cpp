@@ -0,0 +1,294 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchsuggestionsindex.h"
+
+class tst_OpenSearchSuggestionsIndex : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void lookup();
+    void maximumResults();
+    void maximumSize();
+    void import();
+    void save();
+    void failedSave();
+    void open_data();
+    void open();
+
+private:
+    QString filePath(const QString &fileName) const;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchSuggestionsIndex::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchSuggestionsIndex::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchSuggestionsIndex::init()
+{
+    QDir().mkpath(filePath(QString()));
+}
+
+// This will be called after every test function.
+void tst_OpenSearchSuggestionsIndex::cleanup()
+{
+    QDir directory(filePath(QString()));
+    foreach (const QString &fileName, directory.entryList(QDir::Files))
+        directory.remove(fileName);
+    QDir().rmdir(directory.path());
+}
+
+QString tst_OpenSearchSuggestionsIndex::filePath(const QString &fileName) const
+{
+    return QDir::tempPath() + QLatin1String("/tst_opensearchsuggestionsindex/") + fileName;
+}
+
+void tst_OpenSearchSuggestionsIndex::lookup()
+{
+    OpenSearchSuggestionsIndex index;
+    QCOMPARE(index.count(), 0);
+    QCOMPARE(index.lookup("sea"), QStringList());
+
+    index.insert(QStringList() << "sears" << "search engines" << "Seattle Times");
+    index.insert("search engines", 3);
+    index.insert("  SEARS ");
+    index.insert("weather");
+    QCOMPARE(index.count(), 4);
+
+    QVERIFY(index.contains("Search  Engines"));
+    QVERIFY(!index.contains("search"));
+    QCOMPARE(index.weight("search engines"), 4);
+    QCOMPARE(index.weight("sears"), 2);
+
+    // The heaviest first, the terms the way they have been added first.
+    QCOMPARE(index.lookup("sea"), QStringList() << "search engines" << "sears" << "Seattle Times");
+    QCOMPARE(index.lookup(" SEAR"), QStringList() << "search engines" << "sears");
+    QCOMPARE(index.lookup("seattle"), QStringList() << "Seattle Times");
+    QCOMPARE(index.lookup("x"), QStringList());
+    QCOMPARE(index.lookup(""), QStringList());
+
+    index.insert("sears", -1);
+    index.insert("", 1);
+    QCOMPARE(index.weight("sears"), 2);
+    QCOMPARE(index.count(), 4);
+
+    index.clear();
+    QCOMPARE(index.count(), 0);
+    QCOMPARE(index.lookup("sea"), QStringList());
+}
+
+void tst_OpenSearchSuggestionsIndex::maximumResults()
+{
+    OpenSearchSuggestionsIndex index;
+    QCOMPARE(index.maximumResults(), 10);
+
+    for (int i = 0; i < 20; ++i)
+        index.insert(QString("term %1").arg(i, 2, 10, QLatin1Char('0')), i + 1);
+
+    QStringList terms = index.lookup("term");
+    QCOMPARE(terms.count(), 10);
+    QCOMPARE(terms.first(), QString("term 19"));
+    QCOMPARE(terms.last(), QString("term 10"));
+
+    index.setMaximumResults(2);
+    QCOMPARE(index.lookup("term"), QStringList() << "term 19" << "term 18");
+    QCOMPARE(index.lookup("term 0"), QStringList() << "term 09" << "term 08");
+
+    index.setMaximumResults(0);
+    QCOMPARE(index.lookup("term"), QStringList());
+}
+
+void tst_OpenSearchSuggestionsIndex::maximumSize()
+{
+    OpenSearchSuggestionsIndex index(8);
+    QCOMPARE(index.maximumSize(), 8);
+
+    index.insert("heavy", 100);
+    for (int i = 0; i < 8; ++i)
+        index.insert(QString("light %1").arg(i));
+
+    // The lightest terms make room for a quarter more.
+    QCOMPARE(index.count(), 6);
+    QVERIFY(index.contains("heavy"));
+
+    index.setMaximumSize(1);
+    QCOMPARE(index.count(), 1);
+    QVERIFY(index.contains("heavy"));
+}
+
+void tst_OpenSearchSuggestionsIndex::import()
+{
+    QByteArray data = QString::fromUtf8("# Popular terms\n"
+                                        "weather\t10\n"
+                                        "\n"
+                                        "Zażółć gęślą jaźń\n"
+                                        "web\tmail\n"
+                                        "nothing\t0\n").toUtf8();
+    QBuffer buffer(&data);
+
+    OpenSearchSuggestionsIndex index;
+    QCOMPARE(index.import(&buffer), 3);
+    QCOMPARE(index.count(), 3);
+    QCOMPARE(index.weight("weather"), 10);
+    QCOMPARE(index.weight("web\tmail"), 1);
+    QCOMPARE(index.lookup(QString::fromUtf8("ZAŻ")), QStringList() << QString::fromUtf8("Zażółć gęślą jaźń"));
+    QCOMPARE(index.lookup("we"), QStringList() << "weather" << "web mail");
+}
+
+void tst_OpenSearchSuggestionsIndex::save()
+{
+    QString fileName = filePath("index.bin");
+
+    OpenSearchSuggestionsIndex index;
+    index.insert("sears", 2);
+    index.insert("Search Engines", 5);
+    QVERIFY(!index.isOpen());
+
+    QVERIFY(index.save(fileName));
+    QVERIFY(index.isOpen());
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.lookup("sea"), QStringList() << "Search Engines" << "sears");
+
+    // Terms added later are merged with the file, and written together with it.
+    index.insert("seattle", 3);
+    index.insert("sears", 2);
+    QCOMPARE(index.count(), 3);
+    QCOMPARE(index.weight("sears"), 4);
+    QCOMPARE(index.lookup("sea"), QStringList() << "Search Engines" << "sears" << "seattle");
+
+    index.setMaximumSize(2);
+    QVERIFY(index.save(fileName));
+    QCOMPARE(index.count(), 2);
+
+    OpenSearchSuggestionsIndex other;
+    QVERIFY(other.open(fileName));
+    QCOMPARE(other.count(), 2);
+    QCOMPARE(other.weight("search engines"), 5);
+    QCOMPARE(other.weight("sears"), 4);
+    QVERIFY(!other.contains("seattle"));
+    QCOMPARE(other.lookup("SEAR"), QStringList() << "Search Engines" << "sears");
+
+    other.close();
+    QVERIFY(!other.isOpen());
+    QCOMPARE(other.count(), 0);
+
+    // An empty index is a valid file too.
+    OpenSearchSuggestionsIndex empty;
+    QVERIFY(empty.save(filePath("empty.bin")));
+    QVERIFY(empty.isOpen());
+    QCOMPARE(empty.lookup("sea"), QStringList());
+}
+
+void tst_OpenSearchSuggestionsIndex::failedSave()
+{
+    QString fileName = filePath("index.bin");
+
+    OpenSearchSuggestionsIndex index;
+    index.insert("sears", 2);
+    QVERIFY(index.save(fileName));
+    index.insert("seattle");
+
+    // The previous file cannot be moved aside, so the new one cannot take its place.
+    QString backupPath = fileName + QLatin1String(".old");
+    QVERIFY(QDir().mkpath(backupPath + QLatin1String("/busy")));
+    QVERIFY(!index.save(fileName));
+    QVERIFY(QDir().rmdir(backupPath + QLatin1String("/busy")));
+    QVERIFY(QDir().rmdir(backupPath));
+
+    QVERIFY(index.isOpen());
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.lookup("sea"), QStringList() << "sears" << "seattle");
+    QVERIFY(!QFile::exists(fileName + QLatin1String(".new")));
+
+    OpenSearchSuggestionsIndex other;
+    QVERIFY(other.open(fileName));
+    QCOMPARE(other.count(), 1);
+    QCOMPARE(other.weight("sears"), 2);
+
+    // Once the way is clear, both are written and the backup is gone.
+    QVERIFY(index.save(fileName));
+    QCOMPARE(index.lookup("sea"), QStringList() << "sears" << "seattle");
+    QVERIFY(!QFile::exists(backupPath));
+}
+
+void tst_OpenSearchSuggestionsIndex::open_data()
+{
+    QTest::addColumn<bool>("truncated");
+    QTest::addColumn<int>("corruptedOffset");
+    QTest::newRow("valid") << false << -1;
+    QTest::newRow("truncated") << true << -1;
+    QTest::newRow("magic") << false << 0;
+    QTest::newRow("version") << false << 4;
+    QTest::newRow("count") << false << 8;
+    QTest::newRow("reference") << false << 23;
+    QTest::newRow("order") << false << 62;
+}
+
+void tst_OpenSearchSuggestionsIndex::open()
+{
+    QFETCH(bool, truncated);
+    QFETCH(int, corruptedOffset);
+
+    QString fileName = filePath("index.bin");
+
+    OpenSearchSuggestionsIndex index;
+    index.insert("a");
+    index.insert("b");
+    QVERIFY(index.save(fileName));
+    index.close();
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray data = file.readAll();
+    file.close();
+
+    if (truncated)
+        data.chop(2);
+    if (corruptedOffset != -1)
+        data[corruptedOffset] = corruptedOffset == 62 ? 'a' : 0x7f;
+
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+    file.close();
+
+    QCOMPARE(index.open(fileName), !truncated && corruptedOffset == -1);
+    QVERIFY(!index.open(filePath("nonexistent.bin")));
+}
+
+QTEST_MAIN(tst_OpenSearchSuggestionsIndex)
+
+#include "tst_opensearchsuggestionsindex.moc"
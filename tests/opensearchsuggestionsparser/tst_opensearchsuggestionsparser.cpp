@@ -0,0 +1,237 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchsuggestionsparser.h"
+
+class tst_OpenSearchSuggestionsParser : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void parse_data();
+    void parse();
+    void chunks_data();
+    void chunks();
+    void searchTerm();
+    void reset();
+    void acquire();
+    void threads();
+};
+
+class ParserThread : public QThread
+{
+public:
+    ParserThread() : idleParserCount(-1) {}
+
+    void run()
+    {
+        OpenSearchSuggestionsParser::release(OpenSearchSuggestionsParser::acquire());
+        idleParserCount = OpenSearchSuggestionsParser::idleParserCount();
+    }
+
+    int idleParserCount;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchSuggestionsParser::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchSuggestionsParser::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchSuggestionsParser::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchSuggestionsParser::cleanup()
+{
+}
+
+void tst_OpenSearchSuggestionsParser::parse_data()
+{
+    QTest::addColumn<QByteArray>("response");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QStringList>("suggestions");
+
+    QTest::newRow("null") << QByteArray() << false << QStringList();
+    QTest::newRow("whitespace") << QByteArray(" \n ") << false << QStringList();
+    QTest::newRow("empty array") << QByteArray("[]") << false << QStringList();
+    QTest::newRow("no suggestions") << QByteArray("[\"foo\"]") << false << QStringList();
+    QTest::newRow("object") << QByteArray("{\"foo\": [\"bar\"]}") << false << QStringList();
+    QTest::newRow("not an array") << QByteArray("[\"foo\", \"bar\"]") << false << QStringList();
+    QTest::newRow("unterminated") << QByteArray("[\"foo\", [\"bar\"") << false << QStringList();
+    QTest::newRow("trailing garbage") << QByteArray("[\"foo\", [\"bar\"]] x") << false << QStringList();
+    QTest::newRow("script") << QByteArray("[\"foo\", [alert(1)]]") << false << QStringList();
+    QTest::newRow("mismatched") << QByteArray("[\"foo\", [\"bar\"}]") << false << QStringList();
+
+    QTest::newRow("empty suggestions") << QByteArray("[\"foo\", []]") << true << QStringList();
+    QTest::newRow("simple") << QByteArray("[\"foo\",[\"foo bar\",\"foobar\"]]") << true
+            << (QStringList() << "foo bar" << "foobar");
+    QTest::newRow("whitespace around") << QByteArray("\r\n [ \"foo\" ,\t[ \"bar\" ] ] \n") << true
+            << (QStringList() << "bar");
+    QTest::newRow("full") << QByteArray("[\"sea\", [\"sears\", \"search\"], [\"7,390,000 results\", \"1 result\"],"
+                                        " [\"http://example.com?q=sears\", \"http://example.com?q=search\"]]")
+            << true << (QStringList() << "sears" << "search");
+    QTest::newRow("escapes") << QByteArray("[\"foo\", [\"a\\\"b\", \"c\\\\d\", \"e\\/f\", \"g\\nh\"]]") << true
+            << (QStringList() << "a\"b" << "c\\d" << "e/f" << "g\nh");
+    QTest::newRow("unicode") << QByteArray("[\"foo\", [\"\\u00e9t\\u00E9\", \"\xc3\xa9t\xc3\xa9\"]]") << true
+            << (QStringList() << QString::fromUtf8("\xc3\xa9t\xc3\xa9") << QString::fromUtf8("\xc3\xa9t\xc3\xa9"));
+    QTest::newRow("surrogates") << QByteArray("[\"foo\", [\"\\ud83d\\ude00\"]]") << true
+            << (QStringList() << QString::fromUtf8("\xf0\x9f\x98\x80"));
+    QTest::newRow("literals") << QByteArray("[\"foo\", [1, -2.5, true, null]]") << true
+            << (QStringList() << "1" << "-2.5" << "true" << "null");
+    QTest::newRow("nested") << QByteArray("[\"foo\", [[\"x\"], {\"k\": \"v\"}, \"y\"], {\"z\": [1, {}]}, []]") << true
+            << (QStringList() << "y");
+    QTest::newRow("bad literal") << QByteArray("[\"foo\", [tru]]") << false << QStringList();
+    QTest::newRow("bad escape") << QByteArray("[\"foo\", [\"\\x\"]]") << false << QStringList();
+}
+
+void tst_OpenSearchSuggestionsParser::parse()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(bool, valid);
+    QFETCH(QStringList, suggestions);
+
+    bool ok;
+    QCOMPARE(OpenSearchSuggestionsParser::parse(response, &ok), suggestions);
+    QCOMPARE(ok, valid);
+}
+
+void tst_OpenSearchSuggestionsParser::chunks_data()
+{
+    parse_data();
+}
+
+void tst_OpenSearchSuggestionsParser::chunks()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(bool, valid);
+    QFETCH(QStringList, suggestions);
+
+    OpenSearchSuggestionsParser parser;
+    for (int i = 0; i < response.size(); ++i)
+        parser.addData(response.constData() + i, 1);
+
+    QCOMPARE(parser.finish(), valid);
+    if (valid)
+        QCOMPARE(parser.suggestions(), suggestions);
+}
+
+void tst_OpenSearchSuggestionsParser::searchTerm()
+{
+    OpenSearchSuggestionsParser parser;
+    QVERIFY(parser.addData(QByteArray("[\"sea\", [\"sears\"")));
+    QCOMPARE(parser.searchTerm(), QString("sea"));
+    QCOMPARE(parser.suggestions(), QStringList() << "sears");
+    QVERIFY(!parser.hasSuggestions());
+    QVERIFY(!parser.atEnd());
+
+    QVERIFY(parser.addData(QByteArray("], [\"1 result\"]")));
+    QVERIFY(parser.hasSuggestions());
+    QVERIFY(!parser.atEnd());
+    QVERIFY(!parser.finish());
+
+    QVERIFY(parser.addData(QByteArray("]")));
+    QVERIFY(parser.atEnd());
+    QVERIFY(parser.finish());
+    QVERIFY(!parser.hasError());
+}
+
+void tst_OpenSearchSuggestionsParser::reset()
+{
+    OpenSearchSuggestionsParser parser;
+    QVERIFY(!parser.addData(QByteArray("foo")));
+    QVERIFY(parser.hasError());
+
+    parser.reset();
+    QVERIFY(!parser.hasError());
+    QVERIFY(parser.addData(QByteArray("[\"foo\", [\"bar\"]]")));
+    QVERIFY(parser.finish());
+    QCOMPARE(parser.suggestions(), QStringList() << "bar");
+}
+
+void tst_OpenSearchSuggestionsParser::acquire()
+{
+    OpenSearchSuggestionsParser::releaseIdleParsers();
+    QCOMPARE(OpenSearchSuggestionsParser::idleParserCount(), 0);
+    QCOMPARE(OpenSearchSuggestionsParser::memoryUsage(), qint64(0));
+
+    OpenSearchSuggestionsParser *first = OpenSearchSuggestionsParser::acquire();
+    OpenSearchSuggestionsParser *second = OpenSearchSuggestionsParser::acquire();
+    QVERIFY(first != second);
+
+    QVERIFY(first->addData(QByteArray("[\"foo\", [\"bar\", \"baz\"]]")));
+    QVERIFY(first->finish());
+    qint64 usage = OpenSearchSuggestionsParser::memoryUsage();
+    QVERIFY(usage > 0);
+
+    // Released parsers drop their state and are reused.
+    OpenSearchSuggestionsParser::release(first);
+    QCOMPARE(OpenSearchSuggestionsParser::idleParserCount(), 1);
+    QVERIFY(OpenSearchSuggestionsParser::memoryUsage() < usage);
+
+    OpenSearchSuggestionsParser *reused = OpenSearchSuggestionsParser::acquire();
+    QCOMPARE(reused, first);
+    QVERIFY(!reused->hasSuggestions());
+    QCOMPARE(reused->suggestions(), QStringList());
+    QCOMPARE(OpenSearchSuggestionsParser::idleParserCount(), 0);
+
+    OpenSearchSuggestionsParser::release(reused);
+    OpenSearchSuggestionsParser::release(second);
+    QCOMPARE(OpenSearchSuggestionsParser::idleParserCount(), 2);
+
+    OpenSearchSuggestionsParser::releaseIdleParsers();
+    QCOMPARE(OpenSearchSuggestionsParser::idleParserCount(), 0);
+    QCOMPARE(OpenSearchSuggestionsParser::memoryUsage(), qint64(0));
+}
+
+void tst_OpenSearchSuggestionsParser::threads()
+{
+    OpenSearchSuggestionsParser::releaseIdleParsers();
+    OpenSearchSuggestionsParser::release(OpenSearchSuggestionsParser::acquire());
+
+    ParserThread thread;
+    thread.start();
+    QVERIFY(thread.wait(5000));
+
+    // Each thread has its own context.
+    QCOMPARE(thread.idleParserCount, 1);
+    QCOMPARE(OpenSearchSuggestionsParser::idleParserCount(), 1);
+
+    OpenSearchSuggestionsParser::releaseIdleParsers();
+}
+
+QTEST_MAIN(tst_OpenSearchSuggestionsParser)
+
+#include "tst_opensearchsuggestionsparser.moc"
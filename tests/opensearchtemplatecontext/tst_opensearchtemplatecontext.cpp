@@ -0,0 +1,157 @@
+/*
+ * Copyright 2009 Jakub Wieczorek <faw217@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "opensearchdescription.h"
+#include "opensearchengine.h"
+#include "opensearchtemplatecontext.h"
+
+class tst_OpenSearchTemplateContext : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void opensearchtemplatecontext();
+    void paging_data();
+    void paging();
+    void environment();
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_OpenSearchTemplateContext::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_OpenSearchTemplateContext::cleanupTestCase()
+{
+    QLocale::setDefault(QLocale::system());
+}
+
+// This will be called before each test function is executed.
+void tst_OpenSearchTemplateContext::init()
+{
+}
+
+// This will be called after every test function.
+void tst_OpenSearchTemplateContext::cleanup()
+{
+}
+
+void tst_OpenSearchTemplateContext::opensearchtemplatecontext()
+{
+    OpenSearchTemplateContext context;
+    QCOMPARE(context.count(), 20);
+    QCOMPARE(context.startIndex(), 0);
+    QCOMPARE(context.startPage(), 0);
+
+    context.setCount(-1);
+    QCOMPARE(context.count(), 0);
+    context.setStartIndex(40);
+    QCOMPARE(context.startIndex(), 40);
+    context.setStartPage(3);
+    QCOMPARE(context.startPage(), 3);
+
+    QVERIFY(context == OpenSearchTemplateContext(0, 40, 3));
+    QVERIFY(context != OpenSearchTemplateContext());
+}
+
+void tst_OpenSearchTemplateContext::paging_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("startIndex");
+    QTest::addColumn<int>("startPage");
+    QTest::addColumn<QString>("url");
+
+    QTest::newRow("default") << 20 << 0 << 0 << QString("http://foobar.baz/?q=foo&c=20&i=0&p=0&n=20");
+    QTest::newRow("second page") << 10 << 10 << 1 << QString("http://foobar.baz/?q=foo&c=10&i=10&p=1&n=10");
+}
+
+void tst_OpenSearchTemplateContext::paging()
+{
+    QFETCH(int, count);
+    QFETCH(int, startIndex);
+    QFETCH(int, startPage);
+    QFETCH(QString, url);
+
+    OpenSearchTemplateContext context(count, startIndex, startPage);
+
+    OpenSearchDescription description;
+    description.setSearchUrlTemplate("http://foobar.baz/?q={searchTerms}&c={count}&i={startIndex}&p={startPage}");
+    description.setSearchParameters(OpenSearchDescription::Parameters()
+                                    << OpenSearchDescription::Parameter("n", "{count}"));
+    QCOMPARE(description.searchUrl("foo", context), QUrl(url));
+    QCOMPARE(description.encodedSearchUrl("foo", context), url.toLatin1());
+    QCOMPARE(description.encodedSearchUrls(QStringList() << "foo", context), QList<QByteArray>() << url.toLatin1());
+
+    OpenSearchEngine engine(description);
+    QCOMPARE(engine.searchUrl("foo", context), QUrl(url));
+
+    description.setSearchMethod("post");
+    QCOMPARE(description.searchPostData("foo", context), QByteArray("n=") + QByteArray::number(count));
+}
+
+void tst_OpenSearchTemplateContext::environment()
+{
+    OpenSearchDescription description;
+    description.setSearchUrlTemplate("http://foobar.baz/?l={language}&s={source}");
+
+    QLocale::setDefault(QLocale("pt_BR"));
+    QCOMPARE(OpenSearchTemplateContext::languageCode(), QByteArray("pt-BR"));
+    QCOMPARE(OpenSearchTemplateContext::source(), QByteArray("tst_opensearchtemplatecontext"));
+    QCOMPARE(description.encodedSearchUrl("foo"), QByteArray("http://foobar.baz/?l=pt-BR&s=tst_opensearchtemplatecontext"));
+
+    // Changes of the default locale and the application name are picked up.
+    QLocale::setDefault(QLocale("es"));
+    QCoreApplication::setApplicationName("foo");
+    QCOMPARE(description.encodedSearchUrl("foo"), QByteArray("http://foobar.baz/?l=es-ES&s=foo"));
+
+    QCoreApplication::setApplicationName("tst_opensearchtemplatecontext");
+    QEvent event(QEvent::LocaleChange);
+    QCoreApplication::sendEvent(qApp, &event);
+    OpenSearchTemplateContext::invalidateEnvironment();
+    QCOMPARE(OpenSearchTemplateContext::languageCode(), QByteArray("es-ES"));
+    QCOMPARE(OpenSearchTemplateContext::source(), QByteArray("tst_opensearchtemplatecontext"));
+
+    // A resolved context keeps the values it has taken.
+    OpenSearchTemplateContext context;
+    QCOMPARE(context.resolvedLanguageCode(), QByteArray("es-ES"));
+    context.resolveEnvironment();
+    QCoreApplication::setApplicationName("bar");
+    QCOMPARE(context.resolvedSource(), QByteArray("tst_opensearchtemplatecontext"));
+    QCOMPARE(description.encodedSearchUrl("foo", context),
+             QByteArray("http://foobar.baz/?l=es-ES&s=tst_opensearchtemplatecontext"));
+    QCOMPARE(description.encodedSearchUrl("foo"), QByteArray("http://foobar.baz/?l=es-ES&s=bar"));
+    QCOMPARE(description.encodedSearchUrls(QStringList() << "foo" << "bar"),
+             QList<QByteArray>() << "http://foobar.baz/?l=es-ES&s=bar" << "http://foobar.baz/?l=es-ES&s=bar");
+    QCoreApplication::setApplicationName("tst_opensearchtemplatecontext");
+}
+
+QTEST_MAIN(tst_OpenSearchTemplateContext)
+
+#include "tst_opensearchtemplatecontext.moc"
@@ -21,6 +21,7 @@
 
 #include "opensearchwriter.h"
 #include "opensearchengine.h"
+#include "opensearchreader.h"
 
 class tst_OpenSearchWriter : public QObject
 {
@@ -35,6 +36,16 @@ public slots:
 private slots:
     void write_data();
     void write();
+    void additionalUrls();
+    void compact();
+    void writeBundle_data();
+    void writeBundle();
+    void writeDirectory();
+    void fileName_data();
+    void fileName();
+
+private:
+    static QList<OpenSearchDescription> descriptions(int count);
 };
 
 // This will be called before the first test function is executed.
@@ -128,6 +139,203 @@ void tst_OpenSearchWriter::write()
     QCOMPARE(output, expected.readAll());
 }
 
+void tst_OpenSearchWriter::additionalUrls()
+{
+    OpenSearchDescription::Urls urls;
+
+    OpenSearchDescription::Url rss;
+    rss.type = QLatin1String("application/rss+xml");
+    rss.urlTemplate = QLatin1String("http://foobar.barfoo/rss?q={searchTerms}");
+    urls.append(rss);
+
+    OpenSearchDescription::Url atom;
+    atom.type = QLatin1String("application/atom+xml");
+    atom.urlTemplate = QLatin1String("http://foobar.barfoo/atom");
+    atom.parameters.append(OpenSearchDescription::Parameter("q", "{searchTerms}"));
+    atom.method = QLatin1String("post");
+    urls.append(atom);
+
+    OpenSearchDescription::Url self;
+    self.type = QLatin1String("application/opensearchdescription+xml");
+    self.rel = QLatin1String("self");
+    self.urlTemplate = QLatin1String("http://foobar.barfoo/opensearch.xml");
+    urls.append(self);
+
+    OpenSearchDescription description;
+    description.setName("Foo Bar");
+    description.setSearchUrlTemplate("http://foobar.barfoo/search?q={searchTerms}");
+    description.setAdditionalUrls(urls);
+
+    QByteArray output;
+    QBuffer buffer(&output);
+    OpenSearchWriter writer;
+    QVERIFY(writer.write(&buffer, description));
+
+    QFile expected(":/testfile4.xml");
+    expected.open(QIODevice::ReadOnly);
+    QCOMPARE(output, expected.readAll());
+
+    // Every URL survives a round trip, in the same order.
+    buffer.close();
+    OpenSearchReader reader;
+    OpenSearchDescription read;
+    QVERIFY(reader.read(&buffer, &read));
+    QVERIFY(read == description);
+    QCOMPARE(read.additionalUrls(), urls);
+    QCOMPARE(read.additionalUrls().at(1).method, QString("post"));
+    QCOMPARE(read.resultTypes(), QStringList() << "text/html" << "application/rss+xml" << "application/atom+xml");
+}
+
+void tst_OpenSearchWriter::compact()
+{
+    OpenSearchDescription description;
+    description.setName("Foo Bar");
+    description.setDescription("Bar Foo");
+    description.setSearchUrlTemplate("http://foobar.barfoo/search");
+    description.setSearchParameters(OpenSearchDescription::Parameters()
+                                    << OpenSearchDescription::Parameter("q", "{searchTerms}"));
+    description.setTags(QStringList() << "foo" << "bar");
+
+    OpenSearchWriter writer;
+    QVERIFY(!writer.isCompact());
+
+    QByteArray indented;
+    QBuffer indentedBuffer(&indented);
+    QVERIFY(writer.write(&indentedBuffer, description));
+
+    writer.setCompact(true);
+    QVERIFY(writer.isCompact());
+
+    QByteArray compact;
+    QBuffer compactBuffer(&compact);
+    QVERIFY(writer.write(&compactBuffer, description));
+
+    QVERIFY(compact.size() < indented.size());
+    QVERIFY(!compact.contains("\n    "));
+
+    compactBuffer.close();
+    OpenSearchReader reader;
+    OpenSearchDescription read;
+    QVERIFY(reader.read(&compactBuffer, &read));
+    QVERIFY(read == description);
+}
+
+void tst_OpenSearchWriter::writeBundle_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("compact");
+
+    QTest::newRow("empty") << 0 << false;
+    QTest::newRow("one") << 1 << false;
+    QTest::newRow("one-compact") << 1 << true;
+    QTest::newRow("many") << 300 << false;
+    QTest::newRow("many-compact") << 300 << true;
+}
+
+void tst_OpenSearchWriter::writeBundle()
+{
+    QFETCH(int, count);
+    QFETCH(bool, compact);
+
+    QList<OpenSearchDescription> written = descriptions(count);
+
+    QByteArray output;
+    QBuffer buffer(&output);
+    OpenSearchWriter writer;
+    writer.setCompact(compact);
+    QVERIFY(writer.writeBundle(&buffer, written));
+    QVERIFY(output.startsWith("<?xml"));
+
+    // The descriptions come back in the order they have been written.
+    buffer.close();
+    OpenSearchReader reader;
+    reader.setDevice(&buffer);
+
+    QList<OpenSearchDescription> read;
+    OpenSearchDescription description;
+    while (reader.readNextDescription(&description))
+        read.append(description);
+
+    QVERIFY(!reader.hasError());
+    QCOMPARE(read.count(), written.count());
+    for (int i = 0; i < read.count(); ++i)
+        QVERIFY(read.at(i) == written.at(i));
+}
+
+void tst_OpenSearchWriter::writeDirectory()
+{
+    QDir temp = QDir::temp();
+    QString path = temp.filePath(QString("tst_opensearchwriter-%1").arg(QCoreApplication::applicationPid()));
+
+    QList<OpenSearchDescription> written = descriptions(100);
+    // Names that map to the same file do not overwrite each other.
+    written[1].setName(written.at(0).name().toUpper());
+
+    OpenSearchWriter writer;
+    QStringList files = writer.writeDirectory(path, written);
+    QCOMPARE(files.count(), written.count());
+    QCOMPARE(QFileInfo(files.at(0)).fileName(), QString("engine-0.xml"));
+    QCOMPARE(QFileInfo(files.at(1)).fileName(), QString("engine-0-2.xml"));
+
+    for (int i = 0; i < files.count(); ++i) {
+        QVERIFY(!files.at(i).isEmpty());
+
+        QFile file(files.at(i));
+        OpenSearchReader reader;
+        OpenSearchDescription read;
+        QVERIFY(reader.read(&file, &read));
+        QVERIFY(read == written.at(i));
+    }
+
+    QDir directory(path);
+    QCOMPARE(directory.entryList(QDir::Files).count(), written.count());
+
+    foreach (const QString &file, directory.entryList(QDir::Files))
+        directory.remove(file);
+    QVERIFY(temp.rmdir(path));
+}
+
+void tst_OpenSearchWriter::fileName_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("plain") << "Foo" << "foo";
+    QTest::newRow("spaces") << "  Foo  Bar " << "foo-bar";
+    QTest::newRow("punctuation") << "Foo.bar/../Baz?" << "foo-bar-baz";
+    QTest::newRow("empty") << "" << "engine";
+    QTest::newRow("only-punctuation") << "../.." << "engine";
+}
+
+void tst_OpenSearchWriter::fileName()
+{
+    QFETCH(QString, name);
+    QFETCH(QString, fileName);
+
+    OpenSearchDescription description;
+    description.setName(name);
+    QCOMPARE(OpenSearchWriter::fileName(description), fileName);
+}
+
+QList<OpenSearchDescription> tst_OpenSearchWriter::descriptions(int count)
+{
+    QList<OpenSearchDescription> descriptions;
+    for (int i = 0; i < count; ++i) {
+        OpenSearchDescription description;
+        description.setName(QString("Engine %1").arg(i));
+        description.setDescription(QString("Searches for %1").arg(i));
+        description.setSearchUrlTemplate(QString("http://engine%1.barfoo/search?q={searchTerms}").arg(i));
+        if (i % 2) {
+            description.setSuggestionsUrlTemplate(QString("http://engine%1.barfoo/suggest").arg(i));
+            description.setSuggestionsParameters(OpenSearchDescription::Parameters()
+                                                 << OpenSearchDescription::Parameter("q", "{searchTerms}"));
+        }
+        description.setTags(QStringList() << "foo" << QString::number(i));
+        descriptions.append(description);
+    }
+    return descriptions;
+}
+
 QTEST_MAIN(tst_OpenSearchWriter)
 
 #include "tst_opensearchwriter.moc"
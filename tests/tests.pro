@@ -1,4 +1,4 @@
 TEMPLATE = subdirs
-SUBDIRS = opensearchengine opensearchreader opensearchwriter
+SUBDIRS = opensearchbatchreader opensearchcatalog opensearchdescription opensearchengine opensearchenginemanager opensearchimagecache opensearchreader opensearchrequestpolicy opensearchrequestscheduler opensearchresultsparser opensearchsnapshot opensearchstringpool opensearchsuggestionscache opensearchsuggestionsindex opensearchsuggestionsparser opensearchtemplatecontext opensearchwriter
 
 CONFIG += ordered